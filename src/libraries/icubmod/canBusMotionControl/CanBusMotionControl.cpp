@@ -629,6 +629,54 @@ speedEstimationHelper::speedEstimationHelper(int njoints, SpeedEstimationParamet
         memset(estim_params, 0, sizeof(SpeedEstimationParameters)*jointsNum);
 }
 
+configurationPacer::configurationPacer(double boardIntervalMs, double busLoad)
+{
+    // a frame with 8 data bytes takes up to 135 bits (bit stuffing included): 135us at 1Mbit/s
+    const double frameTime = 0.000135;
+
+    boardInterval = (boardIntervalMs > 0) ? boardIntervalMs/1000.0 : 0;
+    if (busLoad <= 0 || busLoad > 1)
+        busLoad = 1;
+    framePeriod = frameTime/busLoad;
+    nextBusWrite = 0;
+    frames = 0;
+    waited = 0;
+    boardsIdle();
+}
+
+void configurationPacer::pace(int board, int nframes)
+{
+    double now = yarp::os::Time::now();
+    double due = nextBusWrite;
+    if (board >= 0 && board < CAN_MAX_CARDS && lastBoardWrite[board]+boardInterval > due)
+        due = lastBoardWrite[board]+boardInterval;
+
+    if (due > now)
+    {
+        yarp::os::Time::delay(due-now);
+        waited += due-now;
+        now = due;
+    }
+
+    nextBusWrite = now+nframes*framePeriod;
+    if (board >= 0 && board < CAN_MAX_CARDS)
+        lastBoardWrite[board] = now;
+    frames += nframes;
+}
+
+void configurationPacer::boardsIdle()
+{
+    for (int i=0; i<CAN_MAX_CARDS; i++)
+        lastBoardWrite[i] = 0;
+}
+
+void configurationPacer::slowDown()
+{
+    boardInterval = (boardInterval > 0) ? 2*boardInterval : 0.001;
+    if (boardInterval > 0.010)
+        boardInterval = 0.010;
+}
+
 axisImpedanceHelper::axisImpedanceHelper(int njoints, ImpedanceLimits* imped_limits)
 {
     jointsNum=njoints;
@@ -1250,6 +1298,13 @@ bool CanBusMotionControlParameters::fromConfig(yarp::os::Searchable &p)
     _timeout=canGroup.check("CanTimeout",Value(20),"timeout period").asInt();
 
     _txTimeout=canGroup.check("CanTxTimeout", Value(20), "tx timeout").asInt();
+
+    _initBoardInterval=canGroup.check("CanInitBoardInterval", Value(1.0),
+                                      "min interval between two configuration messages to the same board [ms]").asDouble();
+    _initBusLoad=canGroup.check("CanInitBusLoad", Value(0.5),
+                                "max fraction of the bus used by the configuration messages").asDouble();
+    _initAck=canGroup.check("CanInitAck", Value(0),
+                            "wait the acknowledge of the boards after every configuration stage").asInt()!=0;
     _rxTimeout=canGroup.check("CanRxTimeout", Value(20), "rx timeout").asInt();
 
     // default values for CanTxQueueSize/CanRxQueueSize should be the 
@@ -1907,6 +1962,9 @@ CanBusMotionControlParameters::CanBusMotionControlParameters()
     _rxQueueSize = 2047;
     _txTimeout = 20;/** 20ms timeout */
     _rxTimeout = 20;
+    _initBoardInterval = 1.0;
+    _initBusLoad = 0.5;
+    _initAck = false;
     _broadcast_mask=0;
     _torqueControlUnits=MACHINE_UNITS;
 }
@@ -2414,6 +2472,8 @@ _done(0)
     _torqueControlHelper = 0;
     _firmwareVersionHelper = 0;
     _speedEstimationHelper = 0;
+    _configTxOverflows = 0;
+    threadPool = 0;
     _MCtorqueControlEnabled = false;
     _ref_command_positions = 0;
     _ref_positions = 0;
@@ -2446,6 +2506,7 @@ CanBusMotionControl::~CanBusMotionControl ()
 bool CanBusMotionControl::open (Searchable &config)
 {
     yTrace("Opening CanBusMotionControl Control\n");
+    double openStart = yarp::os::Time::now();
     std::string dbg_string = config.toString().c_str();
     
     CanBusResources& res = RES (system_resources);
@@ -2573,25 +2634,61 @@ bool CanBusMotionControl::open (Searchable &config)
     _mutex.post ();
 
     // default initialization for this device driver.
-    yarp::os::Time::delay(0.005);
-    setPids(VOCAB_PIDTYPE_POSITION, p._pids);
-    
+    // there are no fixed sleeps between the configuration messages: every stage is sent to all the joints in
+    // an order which alternates the boards, and configurationPacer delays a message only if its board or the
+    // bus need it (see CanInitBoardInterval, CanInitBusLoad). with CanInitAck the boards acknowledge every stage.
+    configurationPacer pacer(p._initBoardInterval, p._initBusLoad);
+    int *hwOrder = new int[p._njoints];
+    int *userOf = new int[p._njoints];
+    helper_configOrder(p, hwOrder, userOf);
+
+    _configTxOverflows = 0;
+    if (res.iCanErrors)
+    {
+        CanErrors errors;
+        if (res.iCanErrors->canGetErrors(errors))
+            _configTxOverflows = errors.txCanFifoOvr + errors.txBufferOvr;
+    }
+
+    if (p._initAck)
+    {
+        // the acknowledges are received by the thread. it is stopped again before the analog
+        // sensors are instantiated because they read the bus directly
+        threadPool = new ThreadPool2(res.iBufferFactory);
+        RateThread::setRate(p._polling_interval);
+        RateThread::start();
+    }
+
+    int i, k;
+    for (k = 0; k < p._njoints; k++)
+    {
+        helper_configPace(pacer, hwOrder[k], 8);
+        setPid(VOCAB_PIDTYPE_POSITION, userOf[hwOrder[k]], p._pids[userOf[hwOrder[k]]]);
+    }
+    helper_configBarrier(pacer, p._initAck, "position pids");
+
     if (p._torqueControlEnabled==true)
     {
         _MCtorqueControlEnabled = true;
-        yarp::os::Time::delay(0.005);
-        setPids(VOCAB_PIDTYPE_TORQUE, p._tpids);
+        for (k = 0; k < p._njoints; k++)
+        {
+            helper_configPace(pacer, hwOrder[k], 4);
+            setPid(VOCAB_PIDTYPE_TORQUE, userOf[hwOrder[k]], p._tpids[userOf[hwOrder[k]]]);
+        }
         
-        for (int i=0; i<p._njoints; i++)
+        for (k = 0; k < p._njoints; k++)
         {
-            yarp::os::Time::delay(0.002);
-            this->setBemfParam(i,p._bemfGain[i]);
+            helper_configPace(pacer, hwOrder[k], 1);
+            this->setBemfParam(userOf[hwOrder[k]], p._bemfGain[userOf[hwOrder[k]]]);
             //this->setMotorParam(i,p._bemfGain[i]); //ktau e bmef qui!
+        }
 
-            yarp::os::Time::delay(0.002);
-            this->setFilterTypeRaw(i,p._filterType[i]);
-            yarp::os::Time::delay(0.002);
+        for (k = 0; k < p._njoints; k++)
+        {
+            helper_configPace(pacer, hwOrder[k], 1);
+            this->setFilterTypeRaw(hwOrder[k], p._filterType[hwOrder[k]]);
         }
+        helper_configBarrier(pacer, p._initAck, "torque control parameters");
     }
     
     //set the source of the torque measurments to the boards
@@ -2603,66 +2700,126 @@ bool CanBusMotionControl::open (Searchable &config)
     }
     #endif
 
-    // intial value !=0 for velocity reference during trajectory generation
+    // intial value !=0 for velocity reference during trajectory generation (no message is sent)
     for (int j = 0; j<p._njoints; j++)
     {
-        yarp::os::Time::delay(0.002);
         setRefSpeed(j, 10.0);
     }
 
     // impedance parameters
-    for (int j=0; j<p._njoints; j++)
+    for (k = 0; k < p._njoints; k++)
     {
-        yarp::os::Time::delay(0.001);
+        int j = userOf[hwOrder[k]];
+        helper_configPace(pacer, hwOrder[k], 1);
         setImpedance(j,p._impedance_params[j].stiffness,p._impedance_params[j].damping);
     }
 
-    int i;
-    for(i = 0; i < p._njoints; i++)
+    for (k = 0; k < p._njoints; k++)
     {
-        yarp::os::Time::delay(0.001);
-        setBCastMessages(i, p._broadcast_mask[i]);
+        helper_configPace(pacer, hwOrder[k], 1);
+        setBCastMessages(hwOrder[k], p._broadcast_mask[hwOrder[k]]);
     }
 
     // set limits, on encoders and max current
-    for(i = 0; i < p._njoints; i++)
+    for (k = 0; k < p._njoints; k++)
     {
-        yarp::os::Time::delay(0.001);
+        i = userOf[hwOrder[k]];
+        helper_configPace(pacer, hwOrder[k], 2);
         setLimits(i, p._limitsMin[i], p._limitsMax[i]);
-        yarp::os::Time::delay(0.001);
         setVelLimits(i, 0, p._maxJntCmdVelocity[i]);
-        yarp::os::Time::delay(0.001);
+    }
+
+    for (k = 0; k < p._njoints; k++)
+    {
+        i = userOf[hwOrder[k]];
+        helper_configPace(pacer, hwOrder[k], 1);
         setMaxCurrent(i, p._currentLimits[i]);
     }
+    helper_configBarrier(pacer, p._initAck, "limits");
 
     // set limits, on encoders and max current
-    for(i = 0; i < p._njoints; i++)
+    for (k = 0; k < p._njoints; k++)
     {   
-        yarp::os::Time::delay(0.001);
+        i = hwOrder[k];
+        helper_configPace(pacer, i, 1);
         setVelocityShiftRaw(i, p._velocityShifts[i]);
-        yarp::os::Time::delay(0.001);
+    }
+
+    for (k = 0; k < p._njoints; k++)
+    {   
+        i = hwOrder[k];
+        helper_configPace(pacer, i, 1);
         setVelocityTimeoutRaw(i, p._velocityTimeout[i]);
-        yarp::os::Time::delay(0.001);
+    }
+
+    for (k = 0; k < p._njoints; k++)
+    {   
+        i = userOf[hwOrder[k]];
+        helper_configPace(pacer, hwOrder[k], 1);
         setPWMLimit(i, p._motorPwmLimits[i]);
     }
 
     // set parameters for speed/acceleration estimation
-    for(i = 0; i < p._njoints; i++)
+    for (k = 0; k < p._njoints; k++)
     {
-        yarp::os::Time::delay(0.001);
+        i = hwOrder[k];
+        helper_configPace(pacer, i, 1);
         setSpeedEstimatorShiftRaw(i,p._estim_params[i].jnt_Vel_estimator_shift,
                                     p._estim_params[i].jnt_Acc_estimator_shift,
                                     p._estim_params[i].mot_Vel_estimator_shift,
                                     p._estim_params[i].mot_Acc_estimator_shift);
     }
     _speedEstimationHelper = new speedEstimationHelper(p._njoints, p._estim_params);
+    helper_configBarrier(pacer, p._initAck, "velocity estimation parameters");
     
-    // disable the controller, cards will start with the pid controller & pwm off
+    // disable the controller, cards will start with the pid controller & pwm off.
+    // the command is sent to all the joints at once, then their broadcast status is checked together
+    // and only the joints which did not switch are handled one by one by setControlMode().
+    const int idleMode = from_modevocab_to_modeint(VOCAB_CM_IDLE);
+    for (k = 0; k < p._njoints; k++)
+    {
+        helper_configPace(pacer, hwOrder[k], 1);
+        _writeByte8(ICUBCANPROTO_POL_MC_CMD__SET_CONTROL_MODE, hwOrder[k], idleMode);
+    }
+    helper_configBarrier(pacer, p._initAck, "control modes");
+
+    bool allIdle = false;
+    for (int attempt = 0; (attempt <= 10) && !allIdle; attempt++)
+    {
+        if (attempt > 0)
+            yarp::os::Time::delay(0.010);
+        allIdle = true;
+        for (i = 0; i < p._njoints; i++)
+        {
+            int mode = VOCAB_CM_UNKNOWN;
+            getControlModeRaw(i, &mode);
+            if (ENABLED(i) && (mode != VOCAB_CM_IDLE) && (mode != VOCAB_CM_HW_FAULT))
+                allIdle = false;
+        }
+    }
+
     for (i = 0; i < p._njoints; i++)
     {
-        yarp::os::Time::delay(0.001);
-        setControlMode(i, VOCAB_CM_IDLE);
+        int mode = VOCAB_CM_UNKNOWN;
+        getControlModeRaw(i, &mode);
+        if (!ENABLED(i) || (mode == VOCAB_CM_IDLE))
+            continue;
+        if (mode == VOCAB_CM_HW_FAULT)
+        {
+            yError ("Unable to set the control mode of a joint (%s j:%d) in HW_FAULT", networkName.c_str(), i);
+            continue;
+        }
+        setControlMode(userOf[i], VOCAB_CM_IDLE);
+    }
+
+    delete [] hwOrder;
+    delete [] userOf;
+
+    if (p._initAck)
+    {
+        RateThread::stop();
     }
+
     const Bottle &analogList=config.findGroup("analog").tail();
     //    if (analogList!=0)
         if (analogList.size()>0)
@@ -2680,7 +2837,8 @@ bool CanBusMotionControl::open (Searchable &config)
 
         }
 
-    threadPool = new ThreadPool2(res.iBufferFactory);
+    if (threadPool == 0)
+        threadPool = new ThreadPool2(res.iBufferFactory);
 
     RateThread::setRate(p._polling_interval);
     RateThread::start();
@@ -2690,15 +2848,15 @@ bool CanBusMotionControl::open (Searchable &config)
     can_protocol_info icub_interface_protocol;
     icub_interface_protocol.major=CAN_PROTOCOL_MAJOR;
     icub_interface_protocol.minor=CAN_PROTOCOL_MINOR;
-    for (int j=0; j<p._njoints; j++) 
-    {
-        yarp::os::Time::delay(0.001);
-        bool b=getFirmwareVersionRaw(j,icub_interface_protocol,&(info[j]));
-        if (b==false) yError() << "Unable to read firmware version";
-    }
+    if (!helper_getFirmwareVersionsRaw(icub_interface_protocol, info))
+        yError() << "Unable to read firmware version";
     _firmwareVersionHelper = new firmwareVersionHelper(p._njoints, info, icub_interface_protocol);
     _firmwareVersionHelper->printFirmwareVersions();
 
+    yInfo("%s [%d] configured %d joints in %.3f s: %d configuration messages, %.3f s spent pacing them\n",
+          canDevName.c_str(), p._networkN, p._njoints, yarp::os::Time::now() - openStart,
+          pacer.getFrames(), pacer.getWaitedTime());
+
 #ifdef ICUB_CANPROTOCOL_STRICT
     ////////////////////////////
     if (!_firmwareVersionHelper->checkFirmwareVersions())
@@ -4568,34 +4726,50 @@ bool CanBusMotionControl::setImpedanceOffsetRaw (int axis, double off)
     return true;
 }
 
+const int POS_PID_REQUESTS = 8;
+const int TRQ_PID_REQUESTS = 4;
+
+int CanBusMotionControl::helper_addPosPidRequests (int axis, CanReadRequest *rq)
+{
+    rq[0] = CanReadRequest(ICUBCANPROTO_POL_MC_CMD__GET_P_GAIN, axis);
+    rq[1] = CanReadRequest(ICUBCANPROTO_POL_MC_CMD__GET_D_GAIN, axis);
+    rq[2] = CanReadRequest(ICUBCANPROTO_POL_MC_CMD__GET_I_GAIN, axis);
+    rq[3] = CanReadRequest(ICUBCANPROTO_POL_MC_CMD__GET_ILIM_GAIN, axis);
+    rq[4] = CanReadRequest(ICUBCANPROTO_POL_MC_CMD__GET_OFFSET, axis);
+    rq[5] = CanReadRequest(ICUBCANPROTO_POL_MC_CMD__GET_SCALE, axis);
+    rq[6] = CanReadRequest(ICUBCANPROTO_POL_MC_CMD__GET_TLIM, axis);
+    rq[7] = CanReadRequest(ICUBCANPROTO_POL_MC_CMD__GET_POS_STICTION_PARAMS, axis);
+    return POS_PID_REQUESTS;
+}
+
+void CanBusMotionControl::helper_parsePosPid (const CanReadRequest *rq, Pid *out)
+{
+    out->kp = double(*((short *)(rq[0].rxData+1)));
+    out->kd = double(*((short *)(rq[1].rxData+1)));
+    out->ki = double(*((short *)(rq[2].rxData+1)));
+    out->max_int = double(*((short *)(rq[3].rxData+1)));
+    out->offset = double(*((short *)(rq[4].rxData+1)));
+    out->scale = double(*((short *)(rq[5].rxData+1)));
+    out->max_output = double(*((short *)(rq[6].rxData+1)));
+    out->stiction_up_val = double(*((short *)(rq[7].rxData+1)));
+    out->stiction_down_val = double(*((short *)(rq[7].rxData+3)));
+}
+
 bool CanBusMotionControl::helper_getPosPidRaw (int axis, Pid *out)
 {
     //    ACE_ASSERT (axis >= 0 && axis <= (CAN_MAX_CARDS-1)*2);
     if (!(axis >= 0 && axis <= (CAN_MAX_CARDS-1)*2))
         return false;
 
-    short s;
-    short s2;
-
-    DEBUG_FUNC("Calling GET_P_GAIN\n");
-    _readWord16 (ICUBCANPROTO_POL_MC_CMD__GET_P_GAIN, axis, s); out->kp = double(s);
-    DEBUG_FUNC("Calling CAN_GET_D_GAIN\n");
-    _readWord16 (ICUBCANPROTO_POL_MC_CMD__GET_D_GAIN, axis, s); out->kd = double(s);
-    DEBUG_FUNC("Calling CAN_GET_I_GAIN\n");
-    _readWord16 (ICUBCANPROTO_POL_MC_CMD__GET_I_GAIN, axis, s); out->ki = double(s);
-    DEBUG_FUNC("Calling CAN_GET_ILIM_GAIN\n");
-    _readWord16 (ICUBCANPROTO_POL_MC_CMD__GET_ILIM_GAIN, axis, s); out->max_int = double(s);
-    DEBUG_FUNC("Calling CAN_GET_OFFSET\n");
-    _readWord16 (ICUBCANPROTO_POL_MC_CMD__GET_OFFSET, axis, s); out->offset= double(s);
-    DEBUG_FUNC("Calling CAN_GET_SCALE\n");
-    _readWord16 (ICUBCANPROTO_POL_MC_CMD__GET_SCALE, axis, s); out->scale = double(s);
-    DEBUG_FUNC("Calling CAN_GET_TLIM\n");
-    _readWord16 (ICUBCANPROTO_POL_MC_CMD__GET_TLIM, axis, s); out->max_output = double(s);
-    DEBUG_FUNC("Calling CAN_GET_POS_STICTION_PARAMS\n");
-    _readWord16Ex (ICUBCANPROTO_POL_MC_CMD__GET_POS_STICTION_PARAMS, axis, s, s2 ); out->stiction_up_val = double(s); out->stiction_down_val = double(s2);
+    CanReadRequest rq[POS_PID_REQUESTS];
+    helper_addPosPidRequests(axis, rq);
+
+    DEBUG_FUNC("Calling GET_P_GAIN ... GET_POS_STICTION_PARAMS\n");
+    bool ret = _readMultiple(rq, POS_PID_REQUESTS);
+    helper_parsePosPid(rq, out);
     DEBUG_FUNC("Get PID done!\n");
-    
-    return true;
+
+    return ret;
 }
 
 bool CanBusMotionControl::getPidRaw (const PidControlTypeEnum& pidtype, int axis, Pid *pid)
@@ -4630,12 +4804,43 @@ bool CanBusMotionControl::getPidsRaw (const PidControlTypeEnum& pidtype, Pid *pi
     CanBusResources& r = RES(system_resources);
 
     int i;
+    int perJoint = 0;
+    if (pidtype == VOCAB_PIDTYPE_POSITION)
+        perJoint = POS_PID_REQUESTS;
+    else if (pidtype == VOCAB_PIDTYPE_TORQUE)
+        perJoint = TRQ_PID_REQUESTS;
+
+    if (perJoint == 0)
+    {
+        for (i = 0; i < r.getJoints(); i++)
+        {
+            getPidRaw(pidtype,i,&pids[i]);
+        }
+        return true;
+    }
+
+    // the requests of all the joints are sent at once
+    CanReadRequest *rq = new CanReadRequest[perJoint*r.getJoints()];
     for (i = 0; i < r.getJoints(); i++)
     {
-        getPidRaw(pidtype,i,&pids[i]);
+        if (pidtype == VOCAB_PIDTYPE_POSITION)
+            helper_addPosPidRequests(i, rq+i*perJoint);
+        else
+            helper_addTrqPidRequests(i, rq+i*perJoint);
     }
 
-    return true;
+    bool ret = _readMultiple(rq, perJoint*r.getJoints());
+
+    for (i = 0; i < r.getJoints(); i++)
+    {
+        if (pidtype == VOCAB_PIDTYPE_POSITION)
+            helper_parsePosPid(rq+i*perJoint, &pids[i]);
+        else
+            helper_parseTrqPid(rq+i*perJoint, &pids[i]);
+    }
+
+    delete [] rq;
+    return ret;
 }
 
 bool CanBusMotionControl::helper_setTrqPidRaw(int axis, const Pid &pid)
@@ -4686,60 +4891,19 @@ bool CanBusMotionControl::helper_setTrqPidRaw(int axis, const Pid &pid)
     return true;
 }
 
-bool CanBusMotionControl::helper_getTrqPidRaw (int axis, Pid *out)
+int CanBusMotionControl::helper_addTrqPidRequests (int axis, CanReadRequest *rq)
 {
-    DEBUG_FUNC("Calling CAN_GET_TORQUE_PID \n");
-
-    CanBusResources& r = RES(system_resources);
-    if (!(axis >= 0 && axis <= (CAN_MAX_CARDS-1)*2))
-        return false;
-
- 
- 
-    if (!ENABLED(axis))
-    {
-        //@@@ TODO: check here
-        // value = 0;
-        return true;
-    }
- 
-
-    _mutex.wait();
-    int id;
-    if (!threadPool->getId(id))
-    {
-        yError("More than %d threads, cannot allow more\n", CANCONTROL_MAX_THREADS);
-        _mutex.post();
-        return false;
-    }
-
-    r.startPacket();
-    r.addMessage (id, axis, ICUBCANPROTO_POL_MC_CMD__GET_TORQUE_PID);
-    r.writePacket();
-
-    ThreadTable2 *t=threadPool->getThreadTable(id);
-    t->setPending(r._writeMessages);
-    _mutex.post();
-    t->synch();
-
-    if (!r.getErrorStatus() || (t->timedOut()))
-    {
-        yError("getTorquePid: message timed out\n");
-        //@@@ TODO: check here
-        // value=0;
-        return false;
-    }
-
-    CanMessage *m=t->get(0);
-    if (m==0)
-    {
-        //@@@ TODO: check here
-        // value=0;
-        return false;
-    }
+    rq[0] = CanReadRequest(ICUBCANPROTO_POL_MC_CMD__GET_TORQUE_PID, axis);
+    rq[1] = CanReadRequest(ICUBCANPROTO_POL_MC_CMD__GET_TORQUE_PIDLIMITS, axis);
+    rq[2] = CanReadRequest(ICUBCANPROTO_POL_MC_CMD__GET_MODEL_PARAMS, axis);
+    rq[3] = CanReadRequest(ICUBCANPROTO_POL_MC_CMD__GET_TORQUE_STICTION_PARAMS, axis);
+    return TRQ_PID_REQUESTS;
+}
 
-    unsigned char *data;
-    data=m->getData()+1;
+void CanBusMotionControl::helper_parseTrqPid (const CanReadRequest *rq, Pid *out)
+{
+    const unsigned char *data;
+    data=rq[0].rxData+1;
     out->kp= *((short *)(data));
     data+=2;
     out->ki= *((short *)(data));
@@ -4748,87 +4912,44 @@ bool CanBusMotionControl::helper_getTrqPidRaw (int axis, Pid *out)
     data+=2;
     out->scale= *((char *)(data));
 
-    t->clear();
-
-    _mutex.wait();
-    
-    DEBUG_FUNC("Calling CAN_GET_TORQUE_PIDLIMITS\n");
-   
-    r.startPacket();
-    r.addMessage (id, axis, ICUBCANPROTO_POL_MC_CMD__GET_TORQUE_PIDLIMITS);
-    r.writePacket();
-
-    // ThreadTable2 *t=threadPool->getThreadTable(id);
-    t->setPending(r._writeMessages);
-    _mutex.post();
-    t->synch();
-
-    if (!r.getErrorStatus() || (t->timedOut()))
-    {
-        yError("getTorquePidLimits: message timed out\n");
-        //@@@ TODO: check here
-        // value=0;
-        return false;
-    }
-
-    m=t->get(0);
-    if (m==0)
-    {
-        //@@@ TODO: check here
-        // value=0;
-        return false;
-    }
-
-    data=m->getData()+1;
+    data=rq[1].rxData+1;
     out->offset= *((short *)(data));
     data+=2;
     out->max_output= *((short *)(data));
     data+=2;
     out->max_int= *((short *)(data));
 
-    t->clear();
+    data=rq[2].rxData+1;
+    out->kff= *((short *)(data));
 
-    _mutex.wait();
-    
-    DEBUG_FUNC("Calling CAN_GET_MODEL_PARAMS\n");
-   
-    r.startPacket();
-    r.addMessage (id, axis, ICUBCANPROTO_POL_MC_CMD__GET_MODEL_PARAMS);
-    r.writePacket();
+    out->stiction_up_val = double(*((short *)(rq[3].rxData+1)));
+    out->stiction_down_val = double(*((short *)(rq[3].rxData+3)));
+}
 
-    // ThreadTable2 *t=threadPool->getThreadTable(id);
-    t->setPending(r._writeMessages);
-    _mutex.post();
-    t->synch();
+bool CanBusMotionControl::helper_getTrqPidRaw (int axis, Pid *out)
+{
+    DEBUG_FUNC("Calling CAN_GET_TORQUE_PID ... CAN_GET_TORQUE_STICTION_PARAMS\n");
 
-    if (!r.getErrorStatus() || (t->timedOut()))
-    {
-        yError("CAN_GET_MODEL_PARAMS: message timed out\n");
-        //@@@ TODO: check here
-        // value=0;
+    if (!(axis >= 0 && axis <= (CAN_MAX_CARDS-1)*2))
         return false;
-    }
 
-    m=t->get(0);
-    if (m==0)
+    if (!ENABLED(axis))
     {
         //@@@ TODO: check here
-        // value=0;
-        return false;
+        // value = 0;
+        return true;
     }
 
-    data=m->getData()+1;
-    out->kff= *((short *)(data));
+    CanReadRequest rq[TRQ_PID_REQUESTS];
+    helper_addTrqPidRequests(axis, rq);
 
-    t->clear();
-
-    DEBUG_FUNC("Calling CAN_GET_TORQUE_STICTION_PARAMS\n");
-    short s1;
-    short s2;
-    _readWord16Ex (ICUBCANPROTO_POL_MC_CMD__GET_TORQUE_STICTION_PARAMS, axis, s1, s2 );
-    out->stiction_up_val = double(s1); 
-    out->stiction_down_val = double(s2);
+    if (!_readMultiple(rq, TRQ_PID_REQUESTS))
+    {
+        yError("getTorquePid: message timed out\n");
+        return false;
+    }
 
+    helper_parseTrqPid(rq, out);
     return true;
 }
 
@@ -5316,6 +5437,49 @@ bool CanBusMotionControl::getFirmwareVersionRaw (int axis, can_protocol_info con
     return true;
 }
 
+bool CanBusMotionControl::helper_getFirmwareVersionsRaw (can_protocol_info const& icub_interface_protocol, firmware_info* info)
+{
+    CanBusResources& r = RES(system_resources);
+
+    // the requests of all the joints are sent at once, the replies are collected together
+    CanReadRequest *rq = new CanReadRequest[r.getJoints()];
+    for (int j = 0; j < r.getJoints(); j++)
+    {
+        rq[j] = CanReadRequest(ICUBCANPROTO_POL_MC_CMD__GET_FIRMWARE_VERSION, j);
+        rq[j].txLen = 2;
+        rq[j].txData[0] = (unsigned char)(icub_interface_protocol.major & 0xFF);
+        rq[j].txData[1] = (unsigned char)(icub_interface_protocol.minor & 0xFF);
+    }
+
+    bool ret = _readMultiple (rq, r.getJoints());
+
+    for (int j = 0; j < r.getJoints(); j++)
+    {
+        firmware_info* fw_info = &info[j];
+        if (!ENABLED(j))
+            continue;
+
+        fw_info->network_name=this->canDevName;
+        fw_info->joint=j;
+        fw_info->board_can_id=r._destinations[j/2] & 0x0f;
+        fw_info->network_number=r._networkN;
+
+        const unsigned char *data=rq[j].rxData+1;
+        fw_info->board_type= *((char *)(data));
+        fw_info->fw_major= *((char *)(data+1));
+        fw_info->fw_version= *((char *)(data+2));
+        fw_info->fw_build= *((char *)(data+3));
+        if (!rq[j].replied)
+            continue;
+        fw_info->can_protocol.major = *((char *)(data+4));
+        fw_info->can_protocol.minor = *((char *)(data+5));
+        fw_info->ack = *((char *)(data+6));
+    }
+
+    delete [] rq;
+    return ret;
+}
+
 bool CanBusMotionControl::getPidReferenceRaw(const PidControlTypeEnum& pidtype, int j, double *ref)
 {
     const int axis = j;
@@ -5369,6 +5533,21 @@ bool CanBusMotionControl::getPidReferencesRaw(const PidControlTypeEnum& pidtype,
     CanBusResources& r = RES(system_resources);
     if (refs==0) return false;
 
+    if (pidtype == VOCAB_PIDTYPE_POSITION)
+    {
+        CanReadRequest *rq = new CanReadRequest[r.getJoints()];
+        for (int i = 0; i < r.getJoints(); i++)
+            rq[i] = CanReadRequest(ICUBCANPROTO_POL_MC_CMD__GET_DESIRED_POSITION, i);
+
+        ret = _readMultiple (rq, r.getJoints());
+
+        for (int i = 0; i < r.getJoints(); i++)
+            refs[i] = double (*((int *)(rq[i].rxData+1)));
+
+        delete [] rq;
+        return ret;
+    }
+
     for (int i = 0; i < r.getJoints(); i++)
     {
         ret &= getPidReferenceRaw(pidtype, i, &refs[i]);
@@ -5758,20 +5937,24 @@ bool CanBusMotionControl::getRefAccelerationsRaw (double *accs)
 {
     CanBusResources& r = RES(system_resources);
     int i;
-    short value = 0;
+
+    CanReadRequest *rq = new CanReadRequest[r.getJoints()];
+    for(i = 0; i < r.getJoints(); i++)
+        rq[i] = CanReadRequest(ICUBCANPROTO_POL_MC_CMD__GET_DESIRED_ACCELER, i);
+
+    bool ret = _readMultiple (rq, r.getJoints());
 
     for(i = 0; i < r.getJoints(); i++)
     {
-        if (_readWord16 (ICUBCANPROTO_POL_MC_CMD__GET_DESIRED_ACCELER, i, value) == true) {
-            _ref_accs[i] = accs[i] = double (value);
-            accs[i] *= 1000.0;
-            accs[i] *= 1000.0;
-        }
-        else
-            return false;
+        if (ENABLED(i) && !rq[i].replied)
+            continue;
+        _ref_accs[i] = accs[i] = double (*((short *)(rq[i].rxData+1)));
+        accs[i] *= 1000.0;
+        accs[i] *= 1000.0;
     }
 
-    return true;
+    delete [] rq;
+    return ret;
 }
 
 /// cmd is an array of double (LATER: to be optimized).
@@ -5798,18 +5981,22 @@ bool CanBusMotionControl::getRefTorquesRaw (double *ref_trqs)
 {
     CanBusResources& r = RES(system_resources);
     int i;
-    short value = 0;
+
+    CanReadRequest *rq = new CanReadRequest[r.getJoints()];
+    for(i = 0; i < r.getJoints(); i++)
+        rq[i] = CanReadRequest(ICUBCANPROTO_POL_MC_CMD__GET_DESIRED_TORQUE, i);
+
+    bool ret = _readMultiple (rq, r.getJoints());
 
     for(i = 0; i < r.getJoints(); i++)
     {
-        if (_readWord16 (ICUBCANPROTO_POL_MC_CMD__GET_DESIRED_TORQUE, i, value) == true) {
-            _ref_torques[i] = ref_trqs[i] = double (value);
-        }
-        else
-            return false;
+        if (ENABLED(i) && !rq[i].replied)
+            continue;
+        _ref_torques[i] = ref_trqs[i] = double (*((short *)(rq[i].rxData+1)));
     }
 
-    return true;
+    delete [] rq;
+    return ret;
 }
 
 /// cmd is an array of double (LATER: to be optimized).
@@ -6631,15 +6818,15 @@ bool CanBusMotionControl::getLimitsRaw(int axis, double *min, double *max)
 {
     if (!(axis >= 0 && axis <= (CAN_MAX_CARDS-1)*2))
         return false;
-    int iMin=0;
-    int iMax=0;
-    bool ret=true;
 
-    ret = ret && _readDWord (ICUBCANPROTO_POL_MC_CMD__GET_MIN_POSITION, axis, iMin);
-    ret = ret && _readDWord (ICUBCANPROTO_POL_MC_CMD__GET_MAX_POSITION, axis, iMax);
+    CanReadRequest rq[2];
+    rq[0] = CanReadRequest(ICUBCANPROTO_POL_MC_CMD__GET_MIN_POSITION, axis);
+    rq[1] = CanReadRequest(ICUBCANPROTO_POL_MC_CMD__GET_MAX_POSITION, axis);
+
+    bool ret = _readMultiple (rq, 2);
 
-    *min=iMin;
-    *max=iMax;
+    *min = *((int *)(rq[0].rxData+1));
+    *max = *((int *)(rq[1].rxData+1));
 
     return ret;
 }
@@ -6715,11 +6902,29 @@ bool CanBusMotionControl::getRefSpeedsRaw(const int n_joint, const int *joints,
 
 bool CanBusMotionControl::getRefAccelerationsRaw(const int n_joint, const int *joints, double *accs)
 {
-    bool ret = true;
+    if (n_joint <= 0) return true;
+
+    CanReadRequest *rq = new CanReadRequest[n_joint];
+    for(int j=0; j<n_joint; j++)
+        rq[j] = CanReadRequest(ICUBCANPROTO_POL_MC_CMD__GET_DESIRED_ACCELER, joints[j]);
+
+    bool ret = _readMultiple (rq, n_joint);
+
     for(int j=0; j<n_joint; j++)
     {
-        ret = ret && getRefAccelerationRaw(joints[j], &accs[j]);
+        const int axis = joints[j];
+        if (!(axis >= 0 && axis <= (CAN_MAX_CARDS-1)*2))
+        {
+            ret = false;
+            continue;
+        }
+        if (ENABLED(axis) && !rq[j].replied)
+            continue;
+        _ref_accs[axis] = double (*((short *)(rq[j].rxData+1)));
+        accs[j] = _ref_accs[axis] * 1000.0 * 1000.0;
     }
+
+    delete [] rq;
     return ret;
 }
 
@@ -7148,69 +7353,21 @@ bool CanBusMotionControl::_readDWord (int msg, int axis, int& value)
 bool CanBusMotionControl::_readDWordArray (int msg, double *out)
 {
     CanBusResources& r = RES(system_resources);
-    int i = 0;
-
-    _mutex.wait();
-    int id;
-    if (!threadPool->getId(id))
-    {
-        yError("More than %d threads, cannot allow more\n", CANCONTROL_MAX_THREADS);
-        _mutex.post();
-        return false;
-    }
-
-    r.startPacket();
+    int i;
 
+    CanReadRequest *rq = new CanReadRequest[r.getJoints()];
     for (i = 0; i < r.getJoints(); i++)
-    {
-        if (ENABLED(i))
-        {
-            r.addMessage (id, msg, i);
-            //r.addMessage (msg, i);
-        }
-        else
-            out[i] = 0;
-    }
+        rq[i] = CanReadRequest(msg, i);
 
-    if (r._writeMessages < 1)
-    {
-        _mutex.post();
-        return false;
-    }
-
-    r.writePacket(); //write now
-
-    ThreadTable2 *t=threadPool->getThreadTable(id);
-    t->setPending(r._writeMessages);
-    _mutex.post();
-    t->synch();
+    bool ret = _readMultiple (rq, r.getJoints());
 
-    if (!r.getErrorStatus() || t->timedOut())
+    for (i = 0; i < r.getJoints(); i++)
     {
-        yError("readDWordArray: at least one message timed out\n");
-        memset (out, 0, sizeof(double) * r.getJoints());
-        return false;
+        out[i] = (rq[i].replied) ? *((int *)(rq[i].rxData+1)) : 0;
     }
 
-    int j;
-    for (i = 0, j = 0; i < r.getJoints(); i++)
-    {
-        if (ENABLED(i))
-        {
-            CanMessage *m = t->getByJoint(i, r._destInv);
-            if ( (m!=0) && (m->getId() != 0xffff) )
-            {
-                out[i] = *((int *)(m->getData()+1));
-            }
-            else
-            {
-                out[i]=0;
-            }
-            j++;
-        }
-    }
-    t->clear();
-    return true;
+    delete [] rq;
+    return ret;
 }
 
 bool CanBusMotionControl::_readWord16 (int msg, int axis, short& value)
@@ -7380,64 +7537,179 @@ bool CanBusMotionControl::_readWord16Array (int msg, double *out)
     CanBusResources& r = RES(system_resources);
     int i;
 
-    _mutex.wait();
-    int id;
-    if (!threadPool->getId(id))
+    CanReadRequest *rq = new CanReadRequest[r.getJoints()];
+    for (i = 0; i < r.getJoints(); i++)
+        rq[i] = CanReadRequest(msg, i);
+
+    bool ret = _readMultiple (rq, r.getJoints());
+
+    for (i = 0; i < r.getJoints(); i++)
     {
-        yError("More than %d threads, cannot allow more\n", CANCONTROL_MAX_THREADS);
-        _mutex.post();
-        return false;
+        out[i] = (rq[i].replied) ? *((short *)(rq[i].rxData+1)) : 0;
     }
 
-    r.startPacket ();
+    delete [] rq;
+    return ret;
+}
 
-    for(i = 0; i < r.getJoints(); i++)
+/// the order in which open() configures the joints: even joints of all the boards, then odd joints,
+/// so that consecutive messages go to different boards. userOf[] maps a hw axis to its user joint.
+void CanBusMotionControl::helper_configOrder(const CanBusMotionControlParameters &p, int *hwOrder, int *userOf)
+{
+    int j, k = 0;
+    for (j = 0; j < p._njoints; j += 2)
+        hwOrder[k++] = j;
+    for (j = 1; j < p._njoints; j += 2)
+        hwOrder[k++] = j;
+
+    for (j = 0; j < p._njoints; j++)
+        userOf[j] = j;
+    for (j = 0; j < p._njoints; j++)
     {
-        if (ENABLED(i))
-        {
-            r.addMessage (id, i, msg);
-            //            r.addMessage (msg, i);
-        }
-        else
-            out[i] = 0;
+        if (p._axisMap[j] >= 0 && p._axisMap[j] < p._njoints)
+            userOf[p._axisMap[j]] = j;
     }
+}
 
-    if (r._writeMessages < 1)
+/// waits until nframes configuration messages can be sent to the board of a hw axis.
+void CanBusMotionControl::helper_configPace(configurationPacer &pacer, int axis, int nframes)
+{
+    CanBusResources& r = RES(system_resources);
+    if (!ENABLED(axis))
+        return;
+    pacer.pace(r._destinations[axis/2] & 0x0f, nframes);
+}
+
+/// the end of a configuration stage: it slows down the pacing if the tx queues overflowed and, if ack is
+/// set, it waits for a reply from every board. the boards process their messages in order, so the reply
+/// means that all the messages of the stage have been consumed.
+bool CanBusMotionControl::helper_configBarrier(configurationPacer &pacer, bool ack, const char *stage)
+{
+    CanBusResources& r = RES(system_resources);
+
+    if (r.iCanErrors)
     {
-        _mutex.post();
-        return false;
+        CanErrors errors;
+        if (r.iCanErrors->canGetErrors(errors))
+        {
+            unsigned int overflows = errors.txCanFifoOvr + errors.txBufferOvr;
+            if (overflows > _configTxOverflows)
+            {
+                pacer.slowDown();
+                yWarning("%s [%d] tx queue overflow while sending the %s, now %.1f ms between messages to the same board\n",
+                         canDevName.c_str(), r._networkN, stage, 1000.0*pacer.getBoardInterval());
+            }
+            _configTxOverflows = overflows;
+        }
     }
 
+    if (!ack)
+        return true;
 
-    r.writePacket();
+    CanReadRequest rq[CAN_MAX_CARDS];
+    int n = 0;
+    for (int axis = 0; (axis < r.getJoints()) && (n < CAN_MAX_CARDS); axis += 2)
+        rq[n++] = CanReadRequest(ICUBCANPROTO_POL_MC_CMD__GET_CONTROL_MODE, axis);
 
-    ThreadTable2 *t=threadPool->getThreadTable(id);
-    t->setPending(r._writeMessages);
-    _mutex.post();
-    t->synch();
+    bool ret = _readMultiple(rq, n);
+    if (!ret)
+        yWarning("%s [%d] not all the boards acknowledged the %s\n", canDevName.c_str(), r._networkN, stage);
+
+    pacer.boardsIdle();
+    return ret;
+}
 
-    if (!r.getErrorStatus()||(t->timedOut()))
+/// sends a list of requests at once and waits for all of them.
+/// the requests are tracked by the run() thread by (joint, message type), each one with its own
+/// timeout, and the calling thread is woken up only when all of them are replied or timed out.
+/// the replies of the requests which did not time out are valid even if the function returns false.
+bool CanBusMotionControl::_readMultiple (CanReadRequest *requests, int n)
+{
+    CanBusResources& r = RES(system_resources);
+    int timedout = 0;
+    int k;
+
+    for (k = 0; k < n; k++)
     {
-        yError("readWord16Array: at least one message timed out\n");
-        memset (out, 0, sizeof(double) * r.getJoints());
-        return false;
+        requests[k].replied = false;
+        memset (requests[k].rxData, 0, sizeof(requests[k].rxData));
     }
 
-    int j;
-    for (i = 0, j = 0; i < r.getJoints(); i++)
+    int first = 0;
+    while (first < n)
     {
-        if (ENABLED(i))
+        _mutex.wait();
+        int id;
+        if (!threadPool->getId(id))
         {
-            CanMessage *m = t->getByJoint(i, r._destInv);
-            if ( (m!=0) && (m->getId() != 0xffff) )
-                out[i] = *((short *)(m->getData()+1));
-            else
-                out[i]=0;
-            j++;
+            yError("More than %d threads, cannot allow more\n", CANCONTROL_MAX_THREADS);
+            _mutex.post();
+            return false;
+        }
+
+        r.startPacket();
+
+        // a packet cannot exceed the write buffer nor the buffer of the replies of the thread table
+        int last = first;
+        while ((last < n) && (r._writeMessages < (unsigned int)BUF_SIZE))
+        {
+            CanReadRequest &rq = requests[last];
+            if ((rq.axis >= 0) && (rq.axis < r.getJoints()) && ENABLED(rq.axis))
+            {
+                const unsigned int m = r._writeMessages;
+                r.addMessage (id, rq.axis, rq.msg);
+                unsigned char *data = r._writeBuffer[m].getData();
+                for (int b = 0; b < rq.txLen; b++)
+                    data[1+b] = rq.txData[b];
+                r._writeBuffer[m].setLen(1+rq.txLen);
+            }
+            last++;
         }
+
+        if (r._writeMessages < 1)
+        {
+            _mutex.post();
+            first = last;
+            continue;
+        }
+
+        r.writePacket();
+
+        ThreadTable2 *t=threadPool->getThreadTable(id);
+        t->setPending(r._writeMessages);
+        _mutex.post();
+        t->synch();
+
+        const bool valid = r.getErrorStatus();
+        for (k = first; k < last; k++)
+        {
+            CanReadRequest &rq = requests[k];
+            if ((rq.axis < 0) || (rq.axis >= r.getJoints()) || !ENABLED(rq.axis))
+                continue;
+
+            CanMessage *m = (valid) ? t->getByJointAndType(rq.axis, rq.msg, r._destInv) : 0;
+            if (m == 0)
+            {
+                timedout++;
+                continue;
+            }
+
+            int len = m->getLen();
+            if (len > 8) len = 8;
+            memcpy (rq.rxData, m->getData(), len);
+            rq.replied = true;
+        }
+
+        t->clear();
+        first = last;
+    }
+
+    if (timedout > 0)
+    {
+        yError("%s [%d] readMultiple: %d of %d requests timed out\n", canDevName.c_str(), r._networkN, timedout, n);
+        return false;
     }
 
-    t->clear();
     return true;
 }
 
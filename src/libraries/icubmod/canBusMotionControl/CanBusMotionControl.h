@@ -44,6 +44,7 @@
 #include <iCub/FactoryInterface.h>
 #include <iCub/LoggerInterfaces.h>
 #include <messages.h>
+#include <canControlConstants.h>
 
 namespace yarp{
     namespace dev{
@@ -93,6 +94,30 @@ struct ImpedanceLimits
     double get_min_damp()  {return min_damp;}
     double get_max_damp()  {return max_damp;}
 };
+
+/**
+* A read request of CanBusMotionControl::_readMultiple(). The caller fills the message type, the
+* axis and the optional payload; on return the reply (if any) is in rxData.
+*/
+struct CanReadRequest
+{
+    int msg;
+    int axis;
+    unsigned char txLen;        // number of payload bytes which follow the message type
+    unsigned char txData[7];
+    bool replied;               // false if the axis is disabled or the request timed out
+    unsigned char rxData[8];    // the data of the reply, rxData[0] is the message type
+
+    CanReadRequest()
+    {
+        msg=0; axis=0; txLen=0; replied=false;
+    }
+
+    CanReadRequest(int m, int j)
+    {
+        msg=m; axis=j; txLen=0; replied=false;
+    }
+};
 /**
 * \file CanBusMotionControl.h 
 * class for interfacing with a generic can device driver.
@@ -172,6 +197,9 @@ public:
     unsigned char _my_address;                  /** my address */
     int _polling_interval;                      /** thread polling interval [ms] */
     int _timeout;                               /** number of cycles before timing out */
+    double _initBoardInterval;                  /** min time between two configuration messages to the same board [ms] */
+    double _initBusLoad;                        /** max fraction of the bus used by the configuration messages */
+    bool _initAck;                              /** wait the acknowledge of the boards after every configuration stage */
 
     std::string *_axisName;                     /** axis name */
     std::string *_axisType;                     /** axis type */
@@ -386,6 +414,37 @@ class speedEstimationHelper
     }
 };
 
+/**
+* Paces the configuration messages sent by open() to the boards. A message waits only for the
+* minimum interval since the previous message to the same board and for the share of the bus
+* reserved to the configuration, so that messages to different boards are sent back to back.
+*/
+class configurationPacer
+{
+    double boardInterval;                       /** min time between two messages to the same board [s] */
+    double framePeriod;                         /** min time between two messages on the bus [s] */
+    double lastBoardWrite[CAN_MAX_CARDS];
+    double nextBusWrite;
+    int    frames;
+    double waited;
+
+    public:
+    configurationPacer(double boardIntervalMs, double busLoad);
+
+    // blocks until nframes messages can be sent to the board
+    void pace(int board, int nframes);
+
+    // the boards have processed all the messages sent so far
+    void boardsIdle();
+
+    // doubles the interval between messages to the same board, up to 10ms
+    void slowDown();
+
+    inline int getFrames() { return frames; }
+    inline double getWaitedTime() { return waited; }
+    inline double getBoardInterval() { return boardInterval; }
+};
+
 #define BOARD_TYPE_4DC    0x03
 #define BOARD_TYPE_BLL    0x04 // Note: Also BLL2DC firmware is identified BLL. This is intentional.
 
@@ -878,6 +937,8 @@ public:
     //helpers
     bool helper_setPosPidRaw( int j, const Pid &pid);
     bool helper_getPosPidRaw(int j, Pid *pid);
+    int  helper_addPosPidRequests(int j, CanReadRequest *rq);
+    void helper_parsePosPid(const CanReadRequest *rq, Pid *pid);
 
     //
     /////////////////////////////// END Position Control INTERFACE
@@ -903,6 +964,8 @@ public:
     //helper
     bool helper_setTrqPidRaw(int j, const Pid &pid);
     bool helper_getTrqPidRaw(int j, Pid *pid);
+    int  helper_addTrqPidRequests(int j, CanReadRequest *rq);
+    void helper_parseTrqPid(const CanReadRequest *rq, Pid *pid);
     
     //
     /////////////////////////////// END Torque Control INTERFACE
@@ -1077,6 +1140,7 @@ public:
 
     // Firmware version
     virtual bool getFirmwareVersionRaw(int axis, can_protocol_info const& icub_interface_protocol, firmware_info *info);
+    bool helper_getFirmwareVersionsRaw(can_protocol_info const& icub_interface_protocol, firmware_info *info);
     // Torque measurement selection
     virtual bool setTorqueSource(int axis, char board_id, char board_chan);
 
@@ -1162,6 +1226,13 @@ protected:
     bool _writeNone  (int msg, int axis);
     bool _writeByte8 (int msg, int axis, int value);
     bool _readByte8(int msg, int axis, int& value);
+    bool _readMultiple (CanReadRequest *requests, int n);
+
+    // configuration of the boards at open()
+    void helper_configOrder(const CanBusMotionControlParameters &p, int *hwOrder, int *userOf);
+    void helper_configPace(configurationPacer &pacer, int axis, int nframes);
+    bool helper_configBarrier(configurationPacer &pacer, bool ack, const char *stage);
+    unsigned int _configTxOverflows;
     bool _writeByteWords16(int msg, int axis, unsigned char value, short s1, short s2, short s3);
     axisTorqueHelper      *_axisTorqueHelper;
     torqueControlHelper   *_torqueControlHelper;
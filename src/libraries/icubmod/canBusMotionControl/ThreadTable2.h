@@ -98,6 +98,10 @@ public:
     //get can message from joint number
     inline yarp::dev::CanMessage *getByJoint(int j, const unsigned char *destInv);
 
+    //get can message from joint number and message type, for threads
+    //which have requests of different types pending at the same time
+    inline yarp::dev::CanMessage *getByJointAndType(int j, int msg, const unsigned char *destInv);
+
     //get n-nth message in the list of replies
     inline yarp::dev::CanMessage *get(int n);
 };
@@ -118,6 +122,14 @@ yarp::dev::CanMessage *ThreadTable2::getByJoint(int j, const unsigned char *dest
     return 0;
 }
 
+yarp::dev::CanMessage *ThreadTable2::getByJointAndType(int j, int msg, const unsigned char *destInv)
+{
+    for(int k=0;k<_replied;k++)
+        if ((getJoint(_replies[k], destInv)==j) && (getMessageType(_replies[k])==(msg&0x7f)))
+            return &_replies[k];
+    return 0;
+}
+
 bool ThreadTable2::push(const yarp::dev::CanMessage &m)
 {
     lock();
@@ -149,7 +161,7 @@ bool ThreadTable2::push(const yarp::dev::CanMessage &m)
 bool ThreadTable2::timeout()
 {
     lock();
-    _replied++;
+    // a timed out request does not fill a slot of _replies
     _pending--;
     _timedOut++;
     if (_pending==0)
@@ -25,6 +25,7 @@ const int CAN_DRIVER_BUFFER_SIZE = 2047;
 
 using namespace std;
 using namespace iCub::skin::diagnostics;
+using iCub::skin::SkinFrameDecoder;
 using yarp::os::Bottle;
 using yarp::os::Property;
 using yarp::os::Value;
@@ -92,6 +93,16 @@ bool CanBusSkin::open(yarp::os::Searchable& config)
     data.resize(sensorsNum);
     data.zero();
 
+    decoder.clear();
+    for (size_t j = 0; j < cardId.size(); j++)
+    {
+        if (!decoder.setCard(0, cardId[j], j))
+        {
+            yError() << "CanBusSkin: invalid card address" << cardId[j] << "in skinCanIds";
+            return false;
+        }
+    }
+
     Property prop;
     prop.put("device", config.find("canbusDevice").asString().c_str());
     prop.put("physDevice", config.find("physDevice").asString().c_str());
@@ -620,7 +631,6 @@ void CanBusSkin::run() {
             unsigned int msgid = msg.getId();
             unsigned int id = (msgid & 0x00F0) >> 4;
             unsigned int sensorId = (msgid & 0x000F);
-            unsigned int msgType = (int) msg.getData()[0];
             int len = msg.getLen();
 
 #if 0
@@ -634,70 +644,50 @@ void CanBusSkin::run() {
             cout << "\n" << std::nouppercase << std::noshowbase << std::dec;
 #endif
 
-            for (size_t j = 0; j < cardId.size(); j++) {
-                if (id == cardId[j]) {
-                    int index = 16*12*j + sensorId*12;
-                    
-                    if (msgType == 0x40) {
-                        // Message head
-                        for(int k = 0; k < 7; k++) {
-                            data[index + k] = msg.getData()[k + 1];
-                        }
-                    } else if (msgType == 0xC0) {
-                        // Message tail
-                        for(int k = 0; k < 5; k++) {
-                            data[index + k + 7] = msg.getData()[k + 1];
-                        }
+            int frame = decoder.decode(0, msgid, msg.getData(), data.data());
 
-                        // Skin diagnostics
-                        if (_brdCfg.useDiagnostic)  // if user requests to check the diagnostic
-                        {
-                            if (len == 8)   // firmware is sending diagnostic info
-                            {
-                                _isDiagnosticPresent = true;
-
-                                // Get error code head and tail
-                                short head = msg.getData()[6];
-                                short tail = msg.getData()[7];
-                                int fullMsg = (head << 8) | (tail & 0xFF);
-
-                                // Store error message
-                                errors[i].net = netID;
-                                errors[i].board = id;
-                                errors[i].sensor = sensorId;
-                                errors[i].error = fullMsg;
-
-                                if(fullMsg != SkinErrorCode::StatusOK)
-                                {
-                                    yError() << "canBusSkin error code: " <<
-                                                "canDeviceNum: " << errors[i].net <<
-                                                "board: " <<  errors[i].board <<
-                                                "sensor: " << errors[i].sensor <<
-                                                "error: " << iCub::skin::diagnostics::printErrorCode(errors[i].error).c_str();
+            // Skin diagnostics
+            if ((frame == SkinFrameDecoder::tailFrame) && _brdCfg.useDiagnostic)  // if user requests to check the diagnostic
+            {
+                if (len == 8)   // firmware is sending diagnostic info
+                {
+                    _isDiagnosticPresent = true;
 
-                                    yarp::sig::Vector &out = portSkinDiagnosticsOut.prepare();
-                                    out.clear();
+                    // Get error code head and tail
+                    short head = msg.getData()[6];
+                    short tail = msg.getData()[7];
+                    int fullMsg = (head << 8) | (tail & 0xFF);
 
-                                    out.push_back(errors[i].net);
-                                    out.push_back(errors[i].board);
-                                    out.push_back(errors[i].sensor);
-                                    out.push_back(errors[i].error);
+                    // Store error message
+                    errors[i].net = netID;
+                    errors[i].board = id;
+                    errors[i].sensor = sensorId;
+                    errors[i].error = fullMsg;
 
-                                    portSkinDiagnosticsOut.write(true);
+                    if(fullMsg != SkinErrorCode::StatusOK)
+                    {
+                        yError() << "canBusSkin error code: " <<
+                                    "canDeviceNum: " << errors[i].net <<
+                                    "board: " <<  errors[i].board <<
+                                    "sensor: " << errors[i].sensor <<
+                                    "error: " << iCub::skin::diagnostics::printErrorCode(errors[i].error).c_str();
+
+                        yarp::sig::Vector &out = portSkinDiagnosticsOut.prepare();
+                        out.clear();
+
+                        out.push_back(errors[i].net);
+                        out.push_back(errors[i].board);
+                        out.push_back(errors[i].sensor);
+                        out.push_back(errors[i].error);
+
+                        portSkinDiagnosticsOut.write(true);
 
-                                }
-                            }
-                            else
-                            {
-                                _isDiagnosticPresent = false;
-                            }
-                        }
                     }
                 }
-          //    else
-          //        {
-          //            yError()<< "Error: skin received malformed message\n";
-          //        }
+                else
+                {
+                    _isDiagnosticPresent = false;
+                }
             }
         }
     }
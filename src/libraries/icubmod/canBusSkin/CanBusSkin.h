@@ -21,6 +21,7 @@
 
 #include "SkinConfigReader.h"
 #include <SkinDiagnostics.h>
+#include <SkinFrameDecoder.h>
 
 
 class CanBusSkin : public yarp::os::RateThread, public yarp::dev::IAnalogSensor, public yarp::dev::DeviceDriver 
@@ -78,6 +79,9 @@ protected:
     yarp::sig::VectorOf<int> cardId;
     int sensorsNum;
 
+    /** Where the frames of every card are written in data. */
+    iCub::skin::SkinFrameDecoder decoder;
+
     yarp::sig::Vector data;
 
     /** The detected skin errors. These are used for diagnostics purposes. */
@@ -39,4 +39,10 @@
 #undef     HOSTTRANSCEIVER_LOCK_EMBOBJNETVARS_INTERNALLY_BY_ENDPOINT
 #undef     HOSTTRANSCEIVER_LOCK_EMBOBJNETVARS_INTERNALLY_BY_NETVAR
 
+// on linux the ropframes of all the boards are sent with a single sendmmsg() per cycle of the EthSender.
+// elsewhere, or if undefined, there is one send() per board.
+#if defined(__linux__)
+#define     ETHMANAGER_TX_WITH_SENDMMSG
+#endif
+
 #endif
@@ -11,6 +11,7 @@
 #include <ethManager.h>
 #include <ethResource.h>
 #include <errno.h>
+#include <string.h>
 
 #include "EOYtheSystem.h"
 
@@ -473,6 +474,8 @@ TheEthManager::TheEthManager()
     // it is a singleton. the constructor is private.
     communicationIsInitted = false;
     UDP_socket  = NULL;
+    sender      = NULL;
+    receiver    = NULL;
 
     // the container of ethernet boards: resources and attached interfaces
     ethBoards = new(EthBoards);
@@ -628,8 +631,9 @@ void ethEvalTXropframe(EthResource *r, void* p)
 
     if(true == transmitthepacket)
     {
+        // the packet is sent by flushPackets() together with the ones of the other boards
         ACE_INET_Addr ipaddress = r->getRemoteAddress();
-        ethman->sendPacket(data2send, (size_t)numofbytes, ipaddress);
+        ethman->enqueuePacket(data2send, (size_t)numofbytes, ipaddress, r->getTimeOfFirstROPinTXframe());
     }
 }
 
@@ -639,6 +643,7 @@ bool TheEthManager::Transmission(void)
     lockTX(true);
 
     ethBoards->execute(ethEvalTXropframe, this);
+    flushPackets();
 
     lockTX(false);
 
@@ -646,6 +651,49 @@ bool TheEthManager::Transmission(void)
 }
 
 
+bool TheEthManager::Transmission(EthResource* r)
+{
+    if(NULL == r)
+    {
+        return false;
+    }
+
+    // the same lock of the EthSender, so that getTXpacket() of a board is never called by two threads at the same time
+    lockTX(true);
+
+    ethEvalTXropframe(r, this);
+    flushPackets();
+
+    lockTX(false);
+
+    return true;
+}
+
+
+void TheEthManager::notifyTransmission(void)
+{
+    if(NULL != sender)
+    {
+        sender->notify();
+    }
+}
+
+
+void TheEthManager::collectTXlatency(double latency)
+{
+    txLatency.add(latency);
+}
+
+
+void TheEthManager::printTXlatency(void)
+{
+    lockTX(true);
+    txLatency.print();
+    txLatency.clear();
+    lockTX(false);
+}
+
+
 void ethEvalPresence(EthResource *r, void* p)
 {
     if((NULL == r) || (NULL == p))
@@ -802,6 +850,8 @@ bool TheEthManager::initCommunication(yarp::os::Searchable &cfgtotal)
     //ACE_INET_Addr ipaddress((u_short)12345, ((10 << 24) | (0 << 16) | (1 << 8) | (104)));            // it must be found ...
     int txrate = -1;                    // it uses default
     int rxrate = -1;                    // it uses default
+    bool txeventdriven = false;         // the EthSender is periodic by default
+    double txcoalescing = 0;            // in seconds
 
 
     // localaddress
@@ -855,6 +905,30 @@ bool TheEthManager::initCommunication(yarp::os::Searchable &cfgtotal)
         yWarning () << "TheEthManager::initCommunication() cannot find ETH/PC104TXrate. thus using default value" << EthSender::EthSenderDefaultRate;
     }
 
+    // event driven tx: PC104TXeventDriven enables it, PC104TXcoalescing is the coalescing window in microseconds
+    // and PC104TXrate becomes the period in ms of the keepalive transmission.
+    if(cfgtotal.findGroup("PC104").check("PC104TXeventDriven"))
+    {
+        txeventdriven = cfgtotal.findGroup("PC104").find("PC104TXeventDriven").asBool();
+        if(txeventdriven)
+        {
+            txrate = EthSender::EthSenderDefaultKeepaliveRate;
+            if(cfgtotal.findGroup("PC104").check("PC104TXrate"))
+            {
+                int value = cfgtotal.findGroup("PC104").find("PC104TXrate").asInt();
+                if(value > 0)
+                    txrate = value;
+            }
+            if(cfgtotal.findGroup("PC104").check("PC104TXcoalescing"))
+            {
+                int value = cfgtotal.findGroup("PC104").find("PC104TXcoalescing").asInt();
+                if(value > 0)
+                    txcoalescing = 0.000001 * value;
+            }
+            yDebug() << "TheEthManager::initCommunication() uses an event driven EthSender with coalescing window =" << txcoalescing*1000000.0 << "us and keepalive =" << txrate << "ms";
+        }
+    }
+
     // rxrate
     if(cfgtotal.findGroup("PC104").check("PC104RXrate"))
     {
@@ -868,7 +942,7 @@ bool TheEthManager::initCommunication(yarp::os::Searchable &cfgtotal)
     }
 
     // localaddress
-    if(false == createCommunicationObjects(myIP, txrate, rxrate) )
+    if(false == createCommunicationObjects(myIP, txrate, rxrate, txeventdriven, txcoalescing) )
     {
         yError () << "TheEthManager::initCommunication() cannot create communication objects";
         return false;
@@ -1108,7 +1182,7 @@ double TheEthManager::getLifeTime(void)
 
 
 
-bool TheEthManager::createCommunicationObjects(ACE_INET_Addr localaddress, int txrate, int rxrate)
+bool TheEthManager::createCommunicationObjects(ACE_INET_Addr localaddress, int txrate, int rxrate, bool txeventdriven, double txcoalescing)
 {
     lock(true);
 
@@ -1132,7 +1206,15 @@ bool TheEthManager::createCommunicationObjects(ACE_INET_Addr localaddress, int t
             communicationIsInitted = true;
             localIPaddress = localaddress;
 
-            if((txrate <= 0) || (txrate > EthSender::EthSenderMaxRate))
+            if(txeventdriven)
+            {
+                // the rate is the one of the keepalive, thus it can be slower than EthSenderMaxRate
+                if(txrate <= 0)
+                {
+                    txrate = EthSender::EthSenderDefaultKeepaliveRate;
+                }
+            }
+            else if((txrate <= 0) || (txrate > EthSender::EthSenderMaxRate))
             {
                 txrate = EthSender::EthSenderDefaultRate;
             }
@@ -1140,7 +1222,7 @@ bool TheEthManager::createCommunicationObjects(ACE_INET_Addr localaddress, int t
             {
                 rxrate = EthReceiver::EthReceiverDefaultRate;
             }
-            sender = new EthSender(txrate);
+            sender = new EthSender(txrate, txeventdriven, txcoalescing);
             receiver = new EthReceiver(rxrate);
 
             sender->config(UDP_socket, this);
@@ -1214,6 +1296,40 @@ int TheEthManager::sendPacket(void *udpframe, size_t len, ACE_INET_Addr toaddres
 }
 
 
+bool TheEthManager::enqueuePacket(void *udpframe, size_t len, ACE_INET_Addr toaddress, double timeOfFirstROP)
+{
+    if(txQueue.full())
+    {
+        flushPackets();
+    }
+
+    return txQueue.push(udpframe, len, toaddress, timeOfFirstROP);
+}
+
+
+bool TheEthManager::flushPackets(void)
+{
+    if(0 == txQueue.size())
+    {
+        return true;
+    }
+
+    bool ret = (txQueue.send(UDP_socket) == txQueue.size());
+
+    double now = yarp::os::Time::now();
+    for(int i=0; i<txQueue.size(); i++)
+    {
+        if(0 != txQueue.timeOfFirstROP(i))
+        {
+            collectTXlatency(now - txQueue.timeOfFirstROP(i));
+        }
+    }
+
+    txQueue.clear();
+    return ret;
+}
+
+
 bool TheEthManager::Reception(ACE_INET_Addr adr, uint64_t* data, ssize_t size, bool collectStatistics)
 {
     ACE_UINT32 a32 = adr.get_ip_address();
@@ -1359,10 +1475,27 @@ bool TheEthManager::lockTXRX(bool on)
 // -- class EthSender
 // -- here is it code
 
-EthSender::EthSender(int txrate) : RateThread(txrate)
+EthSender::EthSender(int txrate, bool txeventdriven, double txcoalescing) : txevent(0)
 {
     rateofthread = txrate;
-    yDebug() << "EthSender is a RateThread with txrate =" << rateofthread << "ms";
+    eventdriven = txeventdriven;
+    coalescingwindow = txcoalescing;
+    timeOfLastLatencyPrint = 0;
+    if(eventdriven)
+        yDebug() << "EthSender is an event driven thread with coalescing window =" << coalescingwindow*1000.0 << "ms and keepalive =" << rateofthread << "ms";
+    else
+        yDebug() << "EthSender is a periodic thread with txrate =" << rateofthread << "ms";
+
+    // the user can have the histogram of the tx latency printed every ETHSENDER_LATENCY_PRINT_INTERVAL seconds
+    ConstString tmp = NetworkBase::getEnvironment("ETHSENDER_LATENCY_PRINT_INTERVAL");
+    if (tmp != "")
+    {
+        latencyPrintInterval = (double)NetType::toInt(tmp);
+    }
+    else
+    {
+        latencyPrintInterval = 0.0;
+    }
     yTrace();
 }
 
@@ -1400,12 +1533,73 @@ bool EthSender::threadInit()
 
 
 
+void EthSender::notify(void)
+{
+    if(eventdriven)
+    {
+        txevent.post();
+    }
+}
+
+
+void EthSender::onStop()
+{
+    // we unblock the wait in run() so that the thread can exit
+    txevent.post();
+}
+
+
 void EthSender::run()
 {
-    // by calling this metod of ethManager, we put protection vs concurrency internal to the class.
-    // for tx we must protect the EthResource not being changed. they can be changed by a device such as
-    // embObjMotionControl etc which adds or releases its resources.
-    ethManager->Transmission();
+    const double period = 0.001 * rateofthread;
+    double nexttick = yarp::os::Time::now() + period;
+
+    while(!isStopping())
+    {
+        if(eventdriven)
+        {
+            // we wait for some ROPs to be loaded or for the keepalive to expire
+            if(txevent.waitWithTimeout(period) && (coalescingwindow > 0))
+            {
+                yarp::os::Time::delay(coalescingwindow);
+            }
+            // the ROPs of all the notifications received so far are served by the next transmission
+            while(txevent.check()) {}
+        }
+        else
+        {
+            double now = yarp::os::Time::now();
+            if(nexttick > now)
+            {
+                yarp::os::Time::delay(nexttick - now);
+            }
+            else if((now - nexttick) > period)
+            {   // we are late by more than one period: we dont try to catch up
+                nexttick = now;
+            }
+            nexttick += period;
+        }
+
+        if(isStopping())
+        {
+            break;
+        }
+
+        // by calling this metod of ethManager, we put protection vs concurrency internal to the class.
+        // for tx we must protect the EthResource not being changed. they can be changed by a device such as
+        // embObjMotionControl etc which adds or releases its resources.
+        ethManager->Transmission();
+
+        if(latencyPrintInterval > 0)
+        {
+            double now = yarp::os::Time::now();
+            if((now - timeOfLastLatencyPrint) >= latencyPrintInterval)
+            {
+                ethManager->printTXlatency();
+                timeOfLastLatencyPrint = now;
+            }
+        }
+    }
 }
 
 
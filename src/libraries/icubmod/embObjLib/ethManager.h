@@ -38,6 +38,8 @@
 #include <stdio.h>
 #include <map>
 
+#include "embObjLibConf.h"
+
 
 // ACE includes
 #include <ace/ACE.h>
@@ -52,6 +54,7 @@
 #include <yarp/dev/DeviceDriver.h>
 #include <yarp/dev/PolyDriver.h>
 #include <yarp/os/RateThread.h>
+#include <yarp/os/Thread.h>
 #include <yarp/os/Bottle.h>
 #include <yarp/os/Semaphore.h>
 #include <yarp/os/Time.h>
@@ -62,6 +65,8 @@
 #include "FeatureInterface.h"
 #include "IethResource.h"
 #include "ethResource.h"
+#include "latencyHistogram.h"
+#include "ethTxQueue.h"
 
 // embobj includes
 #include "EoProtocol.h"
@@ -215,6 +220,18 @@ public:
 
     bool Transmission(void);
 
+    // transmits at once the ropframe of a single board without waiting for the next cycle of the EthSender
+    bool Transmission(EthResource* r);
+
+    // tells the EthSender that some ROPs are waiting. it has effect only if the EthSender is event driven.
+    void notifyTransmission(void);
+
+    // called for every transmitted ropframe with the time elapsed since its first ROP was loaded. protected by the tx lock.
+    void collectTXlatency(double latency);
+
+    // prints and clears the histogram of the tx latency
+    void printTXlatency(void);
+
     bool CheckPresence(void);
 
     bool Reception(ACE_INET_Addr adr, uint64_t* data, ssize_t size, bool collectStatistics);
@@ -229,11 +246,17 @@ public:
 
     int sendPacket(void *udpframe, size_t len, ACE_INET_Addr toaddress);
 
+    // they are used inside Transmission() with the tx lock taken. enqueuePacket() keeps a reference to the udpframe, which must
+    // stay valid until flushPackets() returns. it is true for the ropframes of the HostTransceiver because they are
+    // changed only by the next getTXpacket(), which is also protected by the tx lock.
+    bool enqueuePacket(void *udpframe, size_t len, ACE_INET_Addr toaddress, double timeOfFirstROP);
+    bool flushPackets(void);
+
 private:
 
     bool isCommunicationInitted(void);
 
-    bool createCommunicationObjects(ACE_INET_Addr local_addr, int txrate, int rxrate);
+    bool createCommunicationObjects(ACE_INET_Addr local_addr, int txrate, int rxrate, bool txeventdriven = false, double txcoalescing = 0);
 
     bool initCommunication(yarp::os::Searchable &cfgtotal);
 
@@ -271,17 +294,31 @@ private:
     EthReceiver* receiver;
     ACE_SOCK_Dgram* UDP_socket;
 
+    LatencyHistogram txLatency;
+
+    // the tx queue: preallocated, with one slot per board. the payloads are not copied.
+    EthTxQueue<maxBoards> txQueue;
+
 };
 
 
 // -- class EthSender
-// -- it is a rate thread created by singleton TheEthManager. it regularly transmits packets (if any available) to the eth boards.
+// -- it is a thread created by singleton TheEthManager. it transmits packets (if any available) to the eth boards.
 // -- it uses methods made available by TheEthManager.
+// -- in periodic mode it transmits every txrate ms.
+// -- in event driven mode it sleeps until notify() is called (after ROPs are loaded), waits a coalescing window so that ROPs
+// -- loaded close in time go in the same ropframe, and then transmits. every txrate ms it also transmits as a keepalive, so that
+// -- nothing stays in the transceivers if a notification is missed.
 
-class EthSender : public yarp::os::RateThread
+class EthSender : public yarp::os::Thread
 {
 private:
     int rateofthread;
+    bool eventdriven;
+    double coalescingwindow;        // in seconds
+    yarp::os::Semaphore txevent;
+    double latencyPrintInterval;    // in seconds. if 0 the tx latency is never printed
+    double timeOfLastLatencyPrint;
 
     uint8_t                       *p_sendData;
     TheEthManager                 *ethManager;
@@ -291,12 +328,14 @@ private:
 
 public:
 
-    enum { EthSenderDefaultRate = 1, EthSenderMaxRate = 20 };
+    enum { EthSenderDefaultRate = 1, EthSenderMaxRate = 20, EthSenderDefaultKeepaliveRate = 10 };
 
-    EthSender(int txrate);
+    EthSender(int txrate, bool txeventdriven = false, double txcoalescing = 0);
     ~EthSender();
     bool config(ACE_SOCK_Dgram *pSocket, TheEthManager* _ethManager);
     bool threadInit();
+    void onStop();
+    void notify(void);
 
 };
 
@@ -495,6 +495,25 @@ bool EthResource::getTXpacket(uint8_t **packet, uint16_t *size, uint16_t *numofr
 }
 
 
+bool EthResource::transmitNow(void)
+{
+    if(NULL == ethManager)
+    {
+        return false;
+    }
+    return ethManager->Transmission(this);
+}
+
+
+void EthResource::onROPsLoaded(void)
+{
+    if(NULL != ethManager)
+    {
+        ethManager->notifyTransmission();
+    }
+}
+
+
 bool EthResource::printRXstatistics(void)
 {
     infoPkts->forceReport();
@@ -252,6 +252,12 @@ public:
     // it returns false if it cannot be transmitted: either it is with no rops inside in mode donttrxemptypackets, or there is an error somewhere
     bool            getTXpacket(uint8_t **packet, uint16_t *size, uint16_t *numofrops);
 
+    // it asks TheEthManager to transmit the ropframe now, without waiting for the EthSender
+    bool            transmitNow(void);
+
+    // from HostTransceiver: it wakes up the EthSender when it is event driven
+    void            onROPsLoaded(void);
+
     bool            canProcessRXpacket(uint64_t *data, uint16_t size);
 
     void            processRXpacket(uint64_t *data, uint16_t size, bool collectStatistics = true);
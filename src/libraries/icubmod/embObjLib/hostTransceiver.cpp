@@ -30,6 +30,7 @@ using namespace std;
 #include "FeatureInterface.h"
 
 #include "EOYmutex.h"
+#include "EOVmutex.h"
 #include "EOYtheSystem.h"
 #include "EOtheErrorManager.h"
 #include "EoCommon.h"
@@ -85,6 +86,64 @@ bool HostTransceiver::lock_nvs(bool on)
 
 
 
+
+bool HostTransceiver::lock_txframe(bool on)
+{
+    if(on)
+        txframemtx->wait();
+    else
+        txframemtx->post();
+    return true;
+}
+
+
+bool HostTransceiver::lock_rx(bool on)
+{
+    if(on)
+        rxmtx->wait();
+    else
+        rxmtx->post();
+    return true;
+}
+
+
+void HostTransceiver::markROPloaded(uint16_t ropsize)
+{
+    if(0 == timeOfFirstROP)
+    {
+        timeOfFirstROP = yarp::os::Time::now();
+    }
+    sizeOfLoadedROPs += ropsize;
+}
+
+
+// size of a rop inside the ropframe: a head of 8 bytes, the data padded to a multiple of 4 bytes, then the signature and the time if present.
+uint16_t HostTransceiver::sizeOfROP(eOropcode_t ropcode, eOprotID32_t id32, bool plussign, bool plustime)
+{
+    uint16_t size = 8;
+    if(eo_ropcode_ask != ropcode)
+    {
+        size += (eoprot_variable_sizeof_get(protboardnumber, id32) + 3) & ~3;
+    }
+    if(plussign)
+    {
+        size += 4;
+    }
+    if(plustime)
+    {
+        size += 8;
+    }
+    return size;
+}
+
+
+double HostTransceiver::getTimeOfFirstROPinTXframe(void)
+{
+    return timeOfFirstROPinTXframe;
+}
+
+
+
 HostTransceiver::HostTransceiver():delayAfterROPloadingFailure(0.001) // 1ms
 {
     yTrace();
@@ -96,6 +155,11 @@ HostTransceiver::HostTransceiver():delayAfterROPloadingFailure(0.001) // 1ms
     remoteipaddr        = 0;
     eo_common_ipv4addr_to_string(remoteipaddr, remoteipstring, sizeof(remoteipstring));
     pktsizerx           = 0;
+    timeOfLastRX        = 0;
+    timeOfFirstROP      = 0;
+    timeOfFirstROPinTXframe = 0;
+    sizeOfLoadedROPs    = 0;
+    capacityForROPs     = 0;
 
     protboardnumber     = eo_prot_BRDdummy;
     p_RxPkt             = NULL;
@@ -118,6 +182,8 @@ HostTransceiver::HostTransceiver():delayAfterROPloadingFailure(0.001) // 1ms
     htmtx = new Semaphore(1);
     nvmtx = new Semaphore(1);
 #endif
+    txframemtx = new Semaphore(1);
+    rxmtx = new Semaphore(1);
 }
 
 
@@ -127,6 +193,8 @@ HostTransceiver::~HostTransceiver()
     delete htmtx;
     delete nvmtx;
 #endif
+    delete txframemtx;
+    delete rxmtx;
 
     if(NULL != p_RxPkt)
     {
@@ -327,9 +395,15 @@ return true;
 
     for(int i=0; ( (i<maxNumberOfROPloadingAttempts) && (!ret) ); i++)
     {
+        lock_txframe(true);
         lock_transceiver(true);
         eores = eo_transceiver_OccasionalROP_Load(pc104txrx, &ropdesc);
         lock_transceiver(false);
+        if(eores_OK == eores)
+        {
+            markROPloaded(sizeOfROP(eo_ropcode_set, id32, (1 == ropdesc.control.plussign), true));
+        }
+        lock_txframe(false);
 
         if(eores_OK != eores)
         {
@@ -363,6 +437,10 @@ return true;
         yError() << "HostTransceiver::addSetMessage__(): ERROR in eo_transceiver_OccasionalROP_Load() for BOARD w/ IP" << remoteipstring+1 << "after all attempts" <<
                     "with id: " << nvinfo;
     }
+    else
+    {
+        onROPsLoaded();
+    }
 
     return ret;
 }
@@ -386,6 +464,101 @@ bool HostTransceiver::addSetMessageWithSignature(eOprotID32_t id32, uint8_t* dat
 }
 
 
+bool HostTransceiver::addSetMessages(const eOprotID32_t *id32s, uint8_t * const *data, uint16_t n)
+{
+#ifdef    ETHRES_DEBUG_DONTREADBACK   // in test beds in which no EMS are connected, just skip this and go on
+return true;
+#endif
+    if((NULL == id32s) || (NULL == data))
+    {
+        yError() << "HostTransceiver::addSetMessages() called w/ with NULL id32s or data";
+        return false;
+    }
+
+    // we verify everything before loading, so that we never send only a part of the group because of a wrong argument
+    uint16_t sizeofgroup = 0;
+    for(uint16_t i=0; i<n; i++)
+    {
+        if((eobool_false == eoprot_id_isvalid(protboardnumber, id32s[i])) || (NULL == data[i]))
+        {
+            char nvinfo[128];
+            eoprot_ID2information(id32s[i], nvinfo, sizeof(nvinfo));
+            yError() << "HostTransceiver::addSetMessages() called w/ invalid id or NULL data on BOARD /w IP" << remoteipstring <<
+                        "with id: " << nvinfo;
+            return false;
+        }
+        sizeofgroup += sizeOfROP(eo_ropcode_set, id32s[i], false, true);
+    }
+
+    if(sizeofgroup > capacityForROPs)
+    {
+        yError() << "HostTransceiver::addSetMessages(): a group of" << n << "rops of" << sizeofgroup << "bytes cannot fit the ropframe of" << capacityForROPs << "bytes for BOARD /w IP" << remoteipstring;
+        return false;
+    }
+
+    eOropdescriptor_t ropdesc = {0};
+    memcpy(&ropdesc, &eok_ropdesc_basic, sizeof(eOropdescriptor_t));
+    ropdesc.control.plustime    = 1;
+    ropdesc.control.plussign    = 0;
+    ropdesc.ropcode             = eo_ropcode_set;
+    ropdesc.size                = 0;        // marco.accame: the size is internally computed from the id32
+    ropdesc.signature           = eo_rop_SIGNATUREdummy;
+
+    uint16_t loaded = 0;
+
+    for(int i=0; ( (i<maxNumberOfROPloadingAttempts) && (loaded<n) ); i++)
+    {
+        // the EthSender cannot prepare the ropframe while we hold the lock, thus all the rops loaded in here go out together.
+        // if the whole group does not fit the space left in the ropframe, we load nothing and we wait for the EthSender to
+        // transmit it, so that the group goes out in the next one and is never split across two ropframes.
+        lock_txframe(true);
+        if((0 == loaded) && (sizeOfLoadedROPs + sizeofgroup > capacityForROPs))
+        {
+            lock_txframe(false);
+            onROPsLoaded();     // in event-driven mode it makes the EthSender transmit what is already in the ropframe
+            yarp::os::Time::delay(delayAfterROPloadingFailure);
+            continue;
+        }
+        for(; loaded<n; loaded++)
+        {
+            ropdesc.id32 = id32s[loaded];
+            ropdesc.data = data[loaded];
+
+            lock_transceiver(true);
+            eOresult_t eores = eo_transceiver_OccasionalROP_Load(pc104txrx, &ropdesc);
+            lock_transceiver(false);
+
+            if(eores_OK != eores)
+            {
+                break;
+            }
+            markROPloaded(sizeOfROP(eo_ropcode_set, id32s[loaded], false, true));
+        }
+        lock_txframe(false);
+
+        if(loaded > 0)
+        {
+            onROPsLoaded();
+        }
+
+        if(loaded < n)
+        {
+            // it should never happen because the space was checked before. we load the rest in the next ropframe rather than losing it
+            yWarning() << "HostTransceiver::addSetMessages(): the ropframe for BOARD /w IP" << remoteipstring << "could host only" << loaded << "of" << n << "rops at attempt num" << i+1;
+            yarp::os::Time::delay(delayAfterROPloadingFailure);
+        }
+    }
+
+    if(loaded < n)
+    {
+        yError() << "HostTransceiver::addSetMessages(): ERROR in eo_transceiver_OccasionalROP_Load() for BOARD w/ IP" << remoteipstring << "after all attempts:" << n-loaded << "rops are lost";
+        return false;
+    }
+
+    return true;
+}
+
+
 bool HostTransceiver::addGetMessage__(eOprotID32_t id32, uint32_t signature)
 {
     eOresult_t eores = eores_NOK_generic;
@@ -419,9 +592,15 @@ bool HostTransceiver::addGetMessage__(eOprotID32_t id32, uint32_t signature)
 
     for(int i=0; ( (i<maxNumberOfROPloadingAttempts) && (!ret) ); i++)
     {
+        lock_txframe(true);
         lock_transceiver(true);
         eores = eo_transceiver_OccasionalROP_Load(pc104txrx, &ropdesc);
         lock_transceiver(false);
+        if(eores_OK == eores)
+        {
+            markROPloaded(sizeOfROP(eo_ropcode_ask, id32, (1 == ropdesc.control.plussign), true));
+        }
+        lock_txframe(false);
 
         if(eores_OK != eores)
         {
@@ -455,6 +634,10 @@ bool HostTransceiver::addGetMessage__(eOprotID32_t id32, uint32_t signature)
         yError() << "HostTransceiver::addGetMessage__(): ERROR in eo_transceiver_OccasionalROP_Load() for BOARD w/ IP" << remoteipstring << "after all attempts " <<
                     "with id: " << nvinfo;
     }
+    else
+    {
+        onROPsLoaded();
+    }
     return ret;
 }
 
@@ -507,6 +690,67 @@ bool HostTransceiver::readBufferedValue(eOprotID32_t id32,  uint8_t *data, uint1
 }
 
 
+bool HostTransceiver::readBufferedValues(const eOprotID32_t *id32s, uint8_t * const *data, uint16_t n, double *rxtime)
+{
+    if((NULL == id32s) || (NULL == data))
+    {
+        yError() << "eo HostTransceiver: called readBufferedValues() with NULL id32s or data";
+        return false;
+    }
+
+    // lock_rx() keeps out onMsgReception() for the whole copy, thus all the values and rxtime come from the same received UDP packet.
+    // the mutex of the endpoint (the nvset is configured with eo_nvset_protection_one_per_endpoint) is still taken, because the nvs can
+    // also be written by addSetMessageAndCacheLocally(). we take it only when it changes from one nv to the next.
+
+    EOVmutexDerived *locked = NULL;
+    bool ret = true;
+
+    lock_rx(true);
+
+    for(uint16_t i=0; i<n; i++)
+    {
+        EOnv nv;
+        if((eobool_false == eoprot_id_isvalid(protboardnumber, id32s[i])) || (NULL == data[i]) || (NULL == getNVhandler(id32s[i], &nv)))
+        {
+            char nvinfo[128];
+            eoprot_ID2information(id32s[i], nvinfo, sizeof(nvinfo));
+            yError() << "HostTransceiver::readBufferedValues() cannot read: BOARD w/ IP" << remoteipstring << "with id: " << nvinfo;
+            ret = false;
+            break;
+        }
+
+        if(nv.mtx != locked)
+        {
+            if(NULL != locked)
+            {
+                eov_mutex_Release(locked);
+            }
+            locked = nv.mtx;
+            if(NULL != locked)
+            {
+                eov_mutex_Take(locked, eok_reltimeINFINITE);
+            }
+        }
+
+        memcpy(data[i], eo_nv_RAM(&nv), eo_nv_Size(&nv));
+    }
+
+    if(NULL != rxtime)
+    {
+        *rxtime = timeOfLastRX;
+    }
+
+    if(NULL != locked)
+    {
+        eov_mutex_Release(locked);
+    }
+
+    lock_rx(false);
+
+    return ret;
+}
+
+
 // use the readSentValue() to retrieve a value previously set into a EOnv with method ::addSetMessage__(id32, data, signature, bool writelocalcache = true).
 // take in mind however, that the opration is not clean.
 // the ram of EOnv is done to accept values coming from the network. if robot-interface writes data into a EOnv, then a received rop of type say<> or sig<> will
@@ -584,7 +828,12 @@ void HostTransceiver::onMsgReception(uint64_t *data, uint16_t size)
     // HOWEVER: it is a good thing to protect the nvs as the receiver writes them and someone else reads them to retrieve values for yarp ports
     // for this reason, we use eo_trans_protection_enabled and eo_nvset_protection_one_per_endpoint when we initialise the transceiver.
     // that solves concurrency problems for the transceiver
+    // however eo_transceiver_Receive() locks one endpoint at a time, thus lock_rx() is needed to give readBufferedValues() the values
+    // of a whole packet together with its time of reception.
+    lock_rx(true);
     eo_transceiver_Receive(pc104txrx, p_RxPkt, &numofrops, &txtime);
+    timeOfLastRX = yarp::os::Time::now();
+    lock_rx(false);
 }
 
 
@@ -641,9 +890,17 @@ bool HostTransceiver::getTransmit(uint8_t **data, uint16_t *size, uint16_t* numo
     uint16_t tmpnumofrops = 0;
 
     // it must be protected vs concurrent use of other threads attempting to put rops inside the transceiver.
+    // lock_txframe() also keeps together a group of rops being loaded by addSetMessages()
+    lock_txframe(true);
     lock_transceiver(true);
     res = eo_transceiver_outpacket_Prepare(pc104txrx, &tmpnumofrops, NULL);
     lock_transceiver(false);
+    // the occasional ropframe has been moved into the packet and is empty again
+    sizeOfLoadedROPs = 0;
+    // all the rops loaded so far are now inside the ropframe: we keep the time of the oldest one for the latency statistics
+    timeOfFirstROPinTXframe = timeOfFirstROP;
+    timeOfFirstROP = 0;
+    lock_txframe(false);
 
 #if defined(HOSTTRANSCEIVER_EmptyROPframesAreTransmitted)
     if((eores_OK != res))
@@ -1241,6 +1498,7 @@ bool HostTransceiver::prepareTransceiverConfig2(yarp::os::Searchable &cfgEthBoar
     hosttxrxcfg.sizes.capacityofropframereplies     = eo_ropframe_sizeforZEROrops;
     hosttxrxcfg.sizes.capacityofropframeoccasionals = (hosttxrxcfg.sizes.capacityoftxpacket - eo_ropframe_sizeforZEROrops) - hosttxrxcfg.sizes.capacityofropframeregulars - hosttxrxcfg.sizes.capacityofropframereplies;
     hosttxrxcfg.sizes.maxnumberofregularrops        = 0;
+    capacityForROPs = hosttxrxcfg.sizes.capacityofropframeoccasionals - eo_ropframe_sizeforZEROrops;
 
 
     // ok, now the nvset ... we use maximum capabilities so that we can manage communication of up to 12 jomos
@@ -74,6 +74,10 @@ public:
     bool addSetMessageWithSignature(eOprotID32_t id32, uint8_t* data, uint32_t sig);
     bool addSetMessageAndCacheLocally(eOprotID32_t id32, uint8_t* data);
 
+    // puts n set<> ROPs inside the UDP packet with a single lock vs. the EthSender, so that they all go in the same ropframe.
+    // if the ropframe becomes full before all ROPs are loaded, the remaining ones are loaded after it has been transmitted.
+    bool addSetMessages(const eOprotID32_t *id32s, uint8_t * const *data, uint16_t n);
+
     // methods which put a ask<> ROP inside the UDP packet which will be transmitted by the EthSender
     bool addGetMessage(eOprotID32_t id32);
     bool addGetMessageWithSignature(eOprotID32_t id32, uint32_t signature);
@@ -86,6 +90,11 @@ public:
     // reads the value of a network variable buffered by the object at reception of a UDP packet by method onMsgReception().
     bool readBufferedValue(eOprotID32_t id32,  uint8_t *data, uint16_t* size);
 
+    // reads the values of several network variables while onMsgReception() is kept out, so that all of them come from the same received
+    // UDP packet. data[i] must point to memory large enough for the variable id32s[i]. if rxtime is not NULL, it is filled with the time
+    // of reception of that UDP packet.
+    bool readBufferedValues(const eOprotID32_t *id32s, uint8_t * const *data, uint16_t n, double *rxtime = NULL);
+
     // This method echoes back a value that has just been sent from the HostTransceiver to someone else, if called addSetMessageAndCacheLocally()
     bool readSentValue(eOprotID32_t id32, uint8_t *data, uint16_t* size);
 
@@ -94,6 +103,9 @@ public:
     int getCapacityOfRXpacket(void);
 
 
+    // time at which the first ROP of the ropframe returned by the last successful getTransmit() was loaded. 0 if unknown.
+    double getTimeOfFirstROPinTXframe(void);
+
     // much better to remove this function from here, because direct access to EOnv data is not recommended.
     EOnv* getNVhandler(eOprotID32_t id32, EOnv* nv);
 
@@ -116,6 +128,11 @@ protected:
     eOipv4port_t            ipport;
     EOpacket                *p_RxPkt;
     uint16_t                pktsizerx;
+    double                  timeOfLastRX;       // written by onMsgReception() after the received values are copied into the nvs, with lock_rx() taken
+    double                  timeOfFirstROP;     // time at which the first ROP still waiting for transmission was loaded. 0 if none.
+    double                  timeOfFirstROPinTXframe;
+    uint16_t                sizeOfLoadedROPs;   // bytes of the ROPs loaded in the occasional ropframe since it was last prepared, with lock_txframe() taken
+    uint16_t                capacityForROPs;    // bytes available to ROPs in the occasional ropframe
 
     uint8_t TXrateOfRegularROPs;
     eOreltime_t cycletime;
@@ -139,6 +156,10 @@ protected:
 
     bool isSupported(eOprot_endpoint_t ep);
 
+    // it is called every time that one or more ROPs have been loaded in the transceiver and are ready to be transmitted.
+    // the derived class can use it to wake up the transmitter.
+    virtual void onROPsLoaded(void) {}
+
 
 private:
 
@@ -159,6 +180,18 @@ private:
     yarp::os::Semaphore *nvmtx;
 
 
+    // it is always used: it guarantees that getTransmit() does not prepare a ropframe in the middle of addSetMessages()
+    bool lock_txframe(bool on);
+    yarp::os::Semaphore *txframemtx;
+
+    void markROPloaded(uint16_t ropsize);   // to be called after a ROP is loaded, with lock_txframe() taken
+    uint16_t sizeOfROP(eOropcode_t ropcode, eOprotID32_t id32, bool plussign, bool plustime);
+
+    // it is always used: it guarantees that readBufferedValues() does not copy the nvs in the middle of the reception of a UDP packet
+    bool lock_rx(bool on);
+    yarp::os::Semaphore *rxmtx;
+
+
     bool addSetMessage__(eOprotID32_t id32, uint8_t* data, uint32_t signature, bool writelocalrxcache = false);
     bool addGetMessage__(eOprotID32_t id32, uint32_t signature);
 
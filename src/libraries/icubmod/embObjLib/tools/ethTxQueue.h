@@ -0,0 +1,145 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+/**
+ * @ingroup icub_hardware_modules
+ * \defgroup ethTxQueue ethTxQueue
+ *
+*/
+/* Copyright (C) 2016  iCub Facility, Istituto Italiano di Tecnologia
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+
+#ifndef __ethTxQueue__
+#define __ethTxQueue__
+
+#include <string.h>
+#include <errno.h>
+
+#include <ace/ACE.h>
+#include <ace/SOCK_Dgram.h>
+#include <ace/INET_Addr.h>
+
+#include <yarp/os/LogStream.h>
+
+#include "embObjLibConf.h"
+
+#if defined(ETHMANAGER_TX_WITH_SENDMMSG)
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#endif
+
+
+// the udp frames of a tx cycle, sent all together with a single sendmmsg() where available (see ETHMANAGER_TX_WITH_SENDMMSG
+// in embObjLibConf.h) and otherwise with one send() each. it is preallocated and the payloads are not copied, thus the
+// frames must stay valid until send() returns. it is not thread safe: TheEthManager uses it with the tx lock taken.
+template <int capacity>
+class EthTxQueue
+{
+public:
+
+    EthTxQueue() : numberOfFrames(0)
+    {
+#if defined(ETHMANAGER_TX_WITH_SENDMMSG)
+        memset(messages, 0, sizeof(messages));
+        for(int i=0; i<capacity; i++)
+        {
+            messages[i].msg_hdr.msg_iov = &iovectors[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+            messages[i].msg_hdr.msg_name = &addresses[i];
+            messages[i].msg_hdr.msg_namelen = sizeof(addresses[i]);
+        }
+#endif
+    }
+
+    int size(void) const                        { return numberOfFrames; }
+    bool full(void) const                       { return numberOfFrames >= capacity; }
+    double timeOfFirstROP(int i) const          { return firstROPtime[i]; }
+    void clear(void)                            { numberOfFrames = 0; }
+
+    bool push(void *udpframe, size_t len, const ACE_INET_Addr &toaddress, double timeOfFirstROP)
+    {
+        if(full())
+        {
+            return false;
+        }
+
+        firstROPtime[numberOfFrames] = timeOfFirstROP;
+#if defined(ETHMANAGER_TX_WITH_SENDMMSG)
+        iovectors[numberOfFrames].iov_base = udpframe;
+        iovectors[numberOfFrames].iov_len = len;
+        memcpy(&addresses[numberOfFrames], toaddress.get_addr(), sizeof(struct sockaddr_in));
+#else
+        frames[numberOfFrames] = udpframe;
+        lengths[numberOfFrames] = len;
+        addresses[numberOfFrames] = toaddress;
+#endif
+        numberOfFrames++;
+
+        return true;
+    }
+
+    // it sends the frames in the queue, which keeps them until clear(). it returns the number of frames sent.
+    int send(ACE_SOCK_Dgram *socket)
+    {
+        int sent = 0;
+
+#if defined(ETHMANAGER_TX_WITH_SENDMMSG)
+        while(sent < numberOfFrames)
+        {
+            // sendmmsg() may send fewer messages than requested: we go on from the first not sent one.
+            int r = sendmmsg(socket->get_handle(), &messages[sent], numberOfFrames - sent, 0);
+            if(r <= 0)
+            {
+                if((r < 0) && (EINTR == errno))
+                {
+                    continue;
+                }
+                yError() << "EthTxQueue::send() fails in sendmmsg() and loses" << numberOfFrames - sent << "packets: errno =" << errno;
+                break;
+            }
+            sent += r;
+        }
+#else
+        for(int i=0; i<numberOfFrames; i++)
+        {
+            if(socket->send(frames[i], lengths[i], addresses[i]) >= 0)
+            {
+                sent++;
+            }
+        }
+#endif
+
+        return sent;
+    }
+
+private:
+
+    int         numberOfFrames;
+    double      firstROPtime[capacity];
+#if defined(ETHMANAGER_TX_WITH_SENDMMSG)
+    struct mmsghdr      messages[capacity];
+    struct iovec        iovectors[capacity];
+    struct sockaddr_in  addresses[capacity];
+#else
+    void*               frames[capacity];
+    size_t              lengths[capacity];
+    ACE_INET_Addr       addresses[capacity];
+#endif
+};
+
+
+#endif  // __ethTxQueue__
+
+// eof
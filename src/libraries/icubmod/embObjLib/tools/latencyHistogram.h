@@ -0,0 +1,119 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+/**
+ * @ingroup icub_hardware_modules
+ * \defgroup latencyHistogram latencyHistogram
+ *
+*/
+/* Copyright (C) 2016  iCub Facility, Istituto Italiano di Tecnologia
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+
+#ifndef __latencyHistogram__
+#define __latencyHistogram__
+
+#include <string>
+#include <sstream>
+
+#include <yarp/os/LogStream.h>
+
+#include "statExt.h"
+
+
+// this class collects latencies (in seconds) in a fixed set of bins, plus min / max / mean / deviation.
+// it does not allocate memory in add(), thus it can be used inside the communication threads.
+class LatencyHistogram
+{
+public:
+
+    enum { numberOfBins = 10 };
+
+private:
+
+    std::string name;
+    unsigned long bins[numberOfBins];
+    StatExt stat;
+
+    // upper limits of the bins in microseconds. the last bin collects everything above the previous limit.
+    static int upperLimit(int i)
+    {
+        static const int limits[numberOfBins-1] = { 50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000 };
+        return limits[i];
+    }
+
+public:
+
+    LatencyHistogram(const std::string &_name = "latency") : name(_name)
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        for(int i=0; i<numberOfBins; i++)
+        {
+            bins[i] = 0;
+        }
+        stat.clear();
+    }
+
+    void add(double seconds)
+    {
+        int usec = (int)(seconds * 1000000.0);
+        int i = 0;
+        while((i < numberOfBins-1) && (usec >= upperLimit(i)))
+        {
+            i++;
+        }
+        bins[i]++;
+        stat.add(seconds);
+    }
+
+    unsigned long count() const
+    {
+        unsigned long n = 0;
+        for(int i=0; i<numberOfBins; i++)
+        {
+            n += bins[i];
+        }
+        return n;
+    }
+
+    void print()
+    {
+        if(0 == count())
+        {
+            yDebug() << name.c_str() << ": no samples";
+            return;
+        }
+
+        std::ostringstream out;
+        for(int i=0; i<numberOfBins; i++)
+        {
+            if(i < numberOfBins-1)
+                out << "<" << upperLimit(i) << "us:" << bins[i] << " ";
+            else
+                out << ">=" << upperLimit(i-1) << "us:" << bins[i];
+        }
+
+        yDebug() << name.c_str() << ": samples =" << count() << "mean =" << stat.mean()*1000.0 << "ms, dev =" << stat.deviation()*1000.0
+                 << "ms, min =" << stat.getMin()*1000.0 << "ms, max =" << stat.getMax()*1000.0 << "ms";
+        yDebug() << name.c_str() << ":" << out.str().c_str();
+    }
+};
+
+
+#endif
+
+// eof
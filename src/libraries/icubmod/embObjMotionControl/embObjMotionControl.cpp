@@ -450,6 +450,29 @@ bool embObjMotionControl::alloc(int nj)
     _timeouts.reserve(nj);
     _impedance_params.reserve(nj);
     _axesInfo.reserve(nj);
+
+    // the status snapshot holds joint cores first and then motor basics, so that they are read in a single pass over the mc endpoint
+    _snapshotJoints.resize(nj);
+    _snapshotMotors.resize(nj);
+    _snapshotIDs.resize(2*nj);
+    _snapshotData.resize(2*nj);
+    for(int n=0; n<nj; n++)
+    {
+        _snapshotIDs[n] = eoprot_ID_get(eoprot_endpoint_motioncontrol, eoprot_entity_mc_joint, n, eoprot_tag_mc_joint_status_core);
+        _snapshotData[n] = (uint8_t*) &_snapshotJoints[n];
+        _snapshotIDs[nj+n] = eoprot_ID_get(eoprot_endpoint_motioncontrol, eoprot_entity_mc_motor, n, eoprot_tag_mc_motor_status_basic);
+        _snapshotData[nj+n] = (uint8_t*) &_snapshotMotors[n];
+    }
+
+    _allJoints.resize(nj);
+    _batchSetpoints.resize(nj);
+    _batchIDs.resize(nj);
+    _batchData.resize(nj);
+    for(int n=0; n<nj; n++)
+    {
+        _allJoints[n] = n;
+        _batchData[n] = (uint8_t*) &_batchSetpoints[n];
+    }
     //debug purpose
 
     return true;
@@ -529,6 +552,8 @@ embObjMotionControl::embObjMotionControl() :
     ImplementPWMControl(this),
     ImplementCurrentControl(this),
     _mutex(1),
+    _snapshotMutex(1),
+    _batchMutex(1),
     SAFETY_THRESHOLD(2.0),
     _rotorsLimits(0),
     _jointsLimits(0),
@@ -551,6 +576,7 @@ embObjMotionControl::embObjMotionControl() :
     _njoints      = 0;
     _axisMap      = NULL;
     _encodersStamp = NULL;
+    _snapshotRXtime = 0;
     _angleToEncoder = NULL;
     _twofocinfo = NULL;
     _cacheImpedance   = NULL;
@@ -588,6 +614,7 @@ embObjMotionControl::embObjMotionControl() :
 
     _useRawEncoderData = false;
     _pwmIsLimited     = false;
+    _immediateTX      = false;
 
     ConstString tmp = NetworkBase::getEnvironment("ETH_VERBOSEWHENOK");
     if (tmp != "")
@@ -1427,7 +1454,7 @@ bool embObjMotionControl::fromConfig(yarp::os::Searchable &config)
         return false;
     }
 
-    if(!_mcparser->parseBehaviourFalgs(config, _useRawEncoderData, _pwmIsLimited ))//in general info group
+    if(!_mcparser->parseBehaviourFalgs(config, _useRawEncoderData, _pwmIsLimited, _immediateTX ))//in general info group
     {
         return false;
     }
@@ -2109,28 +2136,37 @@ bool embObjMotionControl::setPidOffsetRaw(const PidControlTypeEnum& pidtype, int
 //    Velocity control interface raw  //
 ////////////////////////////////////////
 
-bool embObjMotionControl::velocityMoveRaw(int j, double sp)
+bool embObjMotionControl::helper_buildVelocitySetpoint(int j, double sp, int mode, eOmc_setpoint_t &setpoint)
 {
-    int mode=0;
-    getControlModeRaw(j, &mode);
     if( (mode != VOCAB_CM_VELOCITY) &&
         (mode != VOCAB_CM_MIXED) &&
         (mode != VOCAB_CM_IMPEDANCE_VEL) &&
         (mode != VOCAB_CM_IDLE))
     {
         yError() << "velocityMoveRaw: skipping command because BOARD" << res->getName() << "IP" << res->getIPv4string() << " joint " << j << " is not in VOCAB_CM_VELOCITY mode";
-        return true;
+        return false;
     }
 
-    eOprotID32_t protid = eoprot_ID_get(eoprot_endpoint_motioncontrol, eoprot_entity_mc_joint, j, eoprot_tag_mc_joint_cmmnds_setpoint);
-
     _ref_command_speeds[j] = sp ;   // save internally the new value of speed.
 
-    eOmc_setpoint_t setpoint;
     setpoint.type = eomc_setpoint_velocity;
     setpoint.to.velocity.value =  (eOmeas_velocity_t) S_32(_ref_command_speeds[j]);
     setpoint.to.velocity.withacceleration = (eOmeas_acceleration_t) S_32(_ref_accs[j]);
+    return true;
+}
+
+bool embObjMotionControl::velocityMoveRaw(int j, double sp)
+{
+    int mode=0;
+    getControlModeRaw(j, &mode);
 
+    eOmc_setpoint_t setpoint;
+    if(false == helper_buildVelocitySetpoint(j, sp, mode, setpoint))
+    {
+        return true;
+    }
+
+    eOprotID32_t protid = eoprot_ID_get(eoprot_endpoint_motioncontrol, eoprot_entity_mc_joint, j, eoprot_tag_mc_joint_cmmnds_setpoint);
 
     if(! res->addSetMessage(protid, (uint8_t *) &setpoint))
     {
@@ -2142,17 +2178,7 @@ bool embObjMotionControl::velocityMoveRaw(int j, double sp)
 
 bool embObjMotionControl::velocityMoveRaw(const double *sp)
 {
-    bool ret = true;
-    eOmc_setpoint_t setpoint;
-
-    setpoint.type = eomc_setpoint_velocity;
-
-    for(int j=0; j<_njoints; j++)
-    {
-        ret = velocityMoveRaw(j, sp[j]) && ret;
-    }
-
-    return ret;
+    return helper_sendSetpoints(_njoints, &_allJoints[0], sp, &embObjMotionControl::helper_buildVelocitySetpoint);
 }
 
 
@@ -2418,7 +2444,7 @@ bool embObjMotionControl::getAxes(int *ax)
     return true;
 }
 
-bool embObjMotionControl::positionMoveRaw(int j, double ref)
+bool embObjMotionControl::helper_buildPositionSetpoint(int j, double ref, int mode, eOmc_setpoint_t &setpoint)
 {
     if (yarp::os::Time::now()-_last_position_move_time[j]<MAX_POSITION_MOVE_INTERVAL)
     {
@@ -2426,38 +2452,41 @@ bool embObjMotionControl::positionMoveRaw(int j, double ref)
     }
     _last_position_move_time[j] = yarp::os::Time::now();
 
-    int mode = 0;
-    getControlModeRaw(j, &mode);
     if( (mode != VOCAB_CM_POSITION) &&
         (mode != VOCAB_CM_MIXED) &&
         (mode != VOCAB_CM_IMPEDANCE_POS) &&
         (mode != VOCAB_CM_IDLE))
     {
         yError() << "positionMoveRaw: skipping command because BOARD" << res->getName() << "IP" << res->getIPv4string() << " joint " << j << " is not in VOCAB_CM_POSITION mode";
-        return true;
+        return false;
     }
 
-    eOprotID32_t protid = eoprot_ID_get(eoprot_endpoint_motioncontrol, eoprot_entity_mc_joint, j, eoprot_tag_mc_joint_cmmnds_setpoint);
     _ref_command_positions[j] = ref;   // save internally the new value of pos.
 
-    eOmc_setpoint_t setpoint;
-
     setpoint.type = (eOenum08_t) eomc_setpoint_position;
     setpoint.to.position.value =  (eOmeas_position_t) S_32(_ref_command_positions[j]);
     setpoint.to.position.withvelocity = (eOmeas_velocity_t) S_32(_ref_speeds[j]);
-
-    return res->addSetMessage(protid, (uint8_t*) &setpoint);
+    return true;
 }
 
-bool embObjMotionControl::positionMoveRaw(const double *refs)
+bool embObjMotionControl::positionMoveRaw(int j, double ref)
 {
-    bool ret = true;
+    int mode = 0;
+    getControlModeRaw(j, &mode);
 
-    for(int j=0, index=0; j< _njoints; j++, index++)
+    eOmc_setpoint_t setpoint;
+    if(false == helper_buildPositionSetpoint(j, ref, mode, setpoint))
     {
-        ret &= positionMoveRaw(j, refs[index]);
+        return true;
     }
-    return ret;
+
+    eOprotID32_t protid = eoprot_ID_get(eoprot_endpoint_motioncontrol, eoprot_entity_mc_joint, j, eoprot_tag_mc_joint_cmmnds_setpoint);
+    return res->addSetMessage(protid, (uint8_t*) &setpoint);
+}
+
+bool embObjMotionControl::positionMoveRaw(const double *refs)
+{
+    return helper_sendSetpoints(_njoints, &_allJoints[0], refs, &embObjMotionControl::helper_buildPositionSetpoint);
 }
 
 bool embObjMotionControl::relativeMoveRaw(int j, double delta)
@@ -2622,12 +2651,7 @@ bool embObjMotionControl::stopRaw()
 
 bool embObjMotionControl::positionMoveRaw(const int n_joint, const int *joints, const double *refs)
 {
-    bool ret = true;
-    for(int j=0; j<n_joint; j++)
-    {
-        ret = ret &&positionMoveRaw(joints[j], refs[j]);
-    }
-    return ret;
+    return helper_sendSetpoints(n_joint, joints, refs, &embObjMotionControl::helper_buildPositionSetpoint);
 }
 
 bool embObjMotionControl::relativeMoveRaw(const int n_joint, const int *joints, const double *deltas)
@@ -2752,11 +2776,13 @@ bool embObjMotionControl::getControlModeRaw(int j, int *v)
 // IControl Mode 2
 bool embObjMotionControl::getControlModesRaw(int* v)
 {
-    bool ret = true;
-    for(int j=0; j< _njoints; j++)
+    _snapshotMutex.wait();
+    bool ret = readStatusSnapshot();
+    for(int j=0; j< _njoints && ret; j++)
     {
-        ret = ret && getControlModeRaw(j, &v[j]);
+        v[j] = controlModeStatusConvert_embObj2yarp((eOmc_controlmode_t) _snapshotJoints[j].modes.controlmodestatus);
     }
+    _snapshotMutex.post();
     return ret;
 }
 
@@ -2936,12 +2962,13 @@ bool embObjMotionControl::getEncoderRaw(int j, double *value)
 
 bool embObjMotionControl::getEncodersRaw(double *encs)
 {
-    bool ret = true;
+    _snapshotMutex.wait();
+    bool ret = readStatusSnapshot();
     for(int j=0; j< _njoints; j++)
     {
-        ret &= getEncoderRaw(j, &encs[j]);
-
+        encs[j] = (ret) ? (double) _snapshotJoints[j].measures.meas_position : 0;
     }
+    _snapshotMutex.post();
     return ret;
 }
 
@@ -2962,11 +2989,13 @@ bool embObjMotionControl::getEncoderSpeedRaw(int j, double *sp)
 
 bool embObjMotionControl::getEncoderSpeedsRaw(double *spds)
 {
-    bool ret = true;
+    _snapshotMutex.wait();
+    bool ret = readStatusSnapshot();
     for(int j=0; j< _njoints; j++)
     {
-        ret &= getEncoderSpeedRaw(j, &spds[j]);
+        spds[j] = (ret) ? (double) _snapshotJoints[j].measures.meas_velocity : 0;
     }
+    _snapshotMutex.post();
     return ret;
 }
 
@@ -2986,11 +3015,13 @@ bool embObjMotionControl::getEncoderAccelerationRaw(int j, double *acc)
 
 bool embObjMotionControl::getEncoderAccelerationsRaw(double *accs)
 {
-    bool ret = true;
+    _snapshotMutex.wait();
+    bool ret = readStatusSnapshot();
     for(int j=0; j< _njoints; j++)
     {
-        ret &= getEncoderAccelerationRaw(j, &accs[j]);
+        accs[j] = (ret) ? (double) _snapshotJoints[j].measures.meas_acceleration : 0;
     }
+    _snapshotMutex.post();
     return ret;
 }
 
@@ -2998,21 +3029,37 @@ bool embObjMotionControl::getEncoderAccelerationsRaw(double *accs)
 
 bool embObjMotionControl::getEncodersTimedRaw(double *encs, double *stamps)
 {
-    bool ret = getEncodersRaw(encs);
-    _mutex.wait();
+    // values and stamps come from the same snapshot, thus all the joints have the time of reception of the same packet
+    _snapshotMutex.wait();
+    bool ret = readStatusSnapshot();
     for(int i=0; i<_njoints; i++)
-        stamps[i] = _encodersStamp[i];
-    _mutex.post();
+    {
+        encs[i] = (ret) ? (double) _snapshotJoints[i].measures.meas_position : 0;
+        stamps[i] = _snapshotRXtime;
+    }
+    _snapshotMutex.post();
 
     return ret;
 }
 
 bool embObjMotionControl::getEncoderTimedRaw(int j, double *encs, double *stamp)
 {
-    bool ret = getEncoderRaw(j, encs);
-    _mutex.wait();
-    *stamp = _encodersStamp[j];
-    _mutex.post();
+    // value and stamp are read together as in getEncodersTimedRaw(): the stamp is the time of reception of the packet of the value
+    eOmc_joint_status_core_t core;
+    eOprotID32_t protid = eoprot_ID_get(eoprot_endpoint_motioncontrol, eoprot_entity_mc_joint, j, eoprot_tag_mc_joint_status_core);
+    uint8_t *data = (uint8_t *) &core;
+
+    bool ret = res->readBufferedValues(&protid, &data, 1, stamp);
+    if(ret)
+    {
+        *encs = (double) core.measures.meas_position;
+    }
+    else
+    {
+        yError() << "embObjMotionControl while reading encoder";
+        *encs = 0;
+        *stamp = 0;
+    }
 
     return ret;
 }
@@ -3077,12 +3124,13 @@ bool embObjMotionControl::getMotorEncoderRaw(int m, double *value)
 
 bool embObjMotionControl::getMotorEncodersRaw(double *encs)
 {
-    bool ret = true;
+    _snapshotMutex.wait();
+    bool ret = readStatusSnapshot();
     for(int j=0; j< _njoints; j++)
     {
-        ret &= getMotorEncoderRaw(j, &encs[j]);
-
+        encs[j] = (ret) ? (double) _snapshotMotors[j].mot_position : 0;
     }
+    _snapshotMutex.post();
     return ret;
 }
 
@@ -3106,11 +3154,13 @@ bool embObjMotionControl::getMotorEncoderSpeedRaw(int m, double *sp)
 
 bool embObjMotionControl::getMotorEncoderSpeedsRaw(double *spds)
 {
-    bool ret = true;
+    _snapshotMutex.wait();
+    bool ret = readStatusSnapshot();
     for(int j=0; j< _njoints; j++)
     {
-        ret &= getMotorEncoderSpeedRaw(j, &spds[j]);
+        spds[j] = (ret) ? (double) _snapshotMotors[j].mot_velocity : 0;
     }
+    _snapshotMutex.post();
     return ret;
 }
 
@@ -3134,31 +3184,48 @@ bool embObjMotionControl::getMotorEncoderAccelerationRaw(int m, double *acc)
 
 bool embObjMotionControl::getMotorEncoderAccelerationsRaw(double *accs)
 {
-    bool ret = true;
+    _snapshotMutex.wait();
+    bool ret = readStatusSnapshot();
     for(int j=0; j< _njoints; j++)
     {
-        ret &= getMotorEncoderAccelerationRaw(j, &accs[j]);
+        accs[j] = (ret) ? (double) _snapshotMotors[j].mot_acceleration : 0;
     }
+    _snapshotMutex.post();
     return ret;
 }
 
 bool embObjMotionControl::getMotorEncodersTimedRaw(double *encs, double *stamps)
 {
-    bool ret = getMotorEncodersRaw(encs);
-    _mutex.wait();
+    _snapshotMutex.wait();
+    bool ret = readStatusSnapshot();
     for(int i=0; i<_njoints; i++)
-        stamps[i] = _encodersStamp[i];
-    _mutex.post();
+    {
+        encs[i] = (ret) ? (double) _snapshotMotors[i].mot_position : 0;
+        stamps[i] = _snapshotRXtime;
+    }
+    _snapshotMutex.post();
 
     return ret;
 }
 
 bool embObjMotionControl::getMotorEncoderTimedRaw(int m, double *encs, double *stamp)
 {
-    bool ret = getMotorEncoderRaw(m, encs);
-    _mutex.wait();
-    *stamp = _encodersStamp[m];
-    _mutex.post();
+    // value and stamp are read together as in getMotorEncodersTimedRaw()
+    eOmc_motor_status_basic_t status;
+    eOprotID32_t protid = eoprot_ID_get(eoprot_endpoint_motioncontrol, eoprot_entity_mc_motor, m, eoprot_tag_mc_motor_status_basic);
+    uint8_t *data = (uint8_t *) &status;
+
+    bool ret = res->readBufferedValues(&protid, &data, 1, stamp);
+    if(ret)
+    {
+        *encs = (double) status.mot_position;
+    }
+    else
+    {
+        yError() << "embObjMotionControl while reading motor encoder position";
+        *encs = 0;
+        *stamp = 0;
+    }
 
     return ret;
 }
@@ -3189,11 +3256,13 @@ bool embObjMotionControl::getCurrentRaw(int j, double *value)
 
 bool embObjMotionControl::getCurrentsRaw(double *vals)
 {
-    bool ret = true;
+    _snapshotMutex.wait();
+    bool ret = readStatusSnapshot();
     for(int j=0; j< _njoints; j++)
     {
-        ret &= getCurrentRaw(j, &vals[j]);
+        vals[j] = (ret) ? (double) _snapshotMotors[j].mot_current : 0;
     }
+    _snapshotMutex.post();
     return ret;
 }
 
@@ -4186,17 +4255,19 @@ bool embObjMotionControl::getTorqueRangesRaw(double *min, double *max)
 
 bool embObjMotionControl::setRefTorquesRaw(const double *t)
 {
-    bool ret = true;
-    for(int j=0; j<_njoints && ret; j++)
-        ret &= setRefTorqueRaw(j, t[j]);
-    return ret;
+    return helper_sendSetpoints(_njoints, &_allJoints[0], t, &embObjMotionControl::helper_buildTorqueSetpoint);
 }
 
-bool embObjMotionControl::setRefTorqueRaw(int j, double t)
+void embObjMotionControl::helper_buildTorqueSetpoint(double t, eOmc_setpoint_t &setpoint)
 {
-    eOmc_setpoint_t setpoint;
     setpoint.type = (eOenum08_t) eomc_setpoint_torque;
     setpoint.to.torque.value =  (eOmeas_torque_t) S_32(t);
+}
+
+bool embObjMotionControl::setRefTorqueRaw(int j, double t)
+{
+    eOmc_setpoint_t setpoint;
+    helper_buildTorqueSetpoint(t, setpoint);
 
     eOprotID32_t protid = eoprot_ID_get(eoprot_endpoint_motioncontrol, eoprot_entity_mc_joint, j, eoprot_tag_mc_joint_cmmnds_setpoint);
     return res->addSetMessage(protid, (uint8_t*) &setpoint);
@@ -4204,12 +4275,7 @@ bool embObjMotionControl::setRefTorqueRaw(int j, double t)
 
 bool embObjMotionControl::setRefTorquesRaw(const int n_joint, const int *joints, const double *t)
 {
-    bool ret = true;
-    for(int j=0; j< n_joint; j++)
-    {
-        ret &= setRefTorqueRaw(joints[j], t[j]);
-    }
-    return ret;
+    return helper_sendSetpoints(n_joint, joints, t, &embObjMotionControl::helper_buildTorqueSetpoint);
 }
 
 bool embObjMotionControl::getRefTorquesRaw(double *t)
@@ -4493,13 +4559,7 @@ bool embObjMotionControl::setMotorTorqueParamsRaw(int j, const MotorTorqueParame
 // IVelocityControl2
 bool embObjMotionControl::velocityMoveRaw(const int n_joint, const int *joints, const double *spds)
 {
-    bool ret = true;
-
-    for(int j=0; j< n_joint; j++)
-    {
-        ret &= velocityMoveRaw(joints[j], spds[j]);
-    }
-    return ret;
+    return helper_sendSetpoints(n_joint, joints, spds, &embObjMotionControl::helper_buildVelocitySetpoint);
 }
 
 bool embObjMotionControl::helper_setVelPidRaw(int j, const Pid &pid)
@@ -4595,46 +4655,46 @@ bool embObjMotionControl::helper_getVelPidRaw(int j, Pid *pid)
 }
 
 // PositionDirect Interface
-bool embObjMotionControl::setPositionRaw(int j, double ref)
+bool embObjMotionControl::helper_buildDirectSetpoint(int j, double ref, int mode, eOmc_setpoint_t &setpoint)
 {
-    int mode = 0;
-    getControlModeRaw(j, &mode);
     if (mode != VOCAB_CM_POSITION_DIRECT &&
         mode != VOCAB_CM_IDLE)
     {
         yError() << "setReferenceRaw: skipping command because BOARD" << res->getName() << "IP" << res->getIPv4string() << " joint " << j << " is not in VOCAB_CM_POSITION_DIRECT mode";
-        return true;
+        return false;
     }
 
-    eOprotID32_t protoId = eoprot_ID_get(eoprot_endpoint_motioncontrol, eoprot_entity_mc_joint, j, eoprot_tag_mc_joint_cmmnds_setpoint);
-    eOmc_setpoint_t setpoint = {0};
-
     _ref_positions[j] = ref;   // save internally the new value of pos.
+    memset(&setpoint, 0, sizeof(setpoint));
     setpoint.type = (eOenum08_t) eomc_setpoint_positionraw;
     setpoint.to.position.value = (eOmeas_position_t) S_32(ref);
     setpoint.to.position.withvelocity = 0;
+    return true;
+}
+
+bool embObjMotionControl::setPositionRaw(int j, double ref)
+{
+    int mode = 0;
+    getControlModeRaw(j, &mode);
+
+    eOmc_setpoint_t setpoint = {0};
+    if(false == helper_buildDirectSetpoint(j, ref, mode, setpoint))
+    {
+        return true;
+    }
 
+    eOprotID32_t protoId = eoprot_ID_get(eoprot_endpoint_motioncontrol, eoprot_entity_mc_joint, j, eoprot_tag_mc_joint_cmmnds_setpoint);
     return res->addSetMessage(protoId, (uint8_t*) &setpoint);
 }
 
 bool embObjMotionControl::setPositionsRaw(const int n_joint, const int *joints, double *refs)
 {
-    bool ret = true;
-    for(int i=0; i<n_joint; i++)
-    {
-        ret &= setPositionRaw(joints[i], refs[i]);
-    }
-    return ret;
+    return helper_sendSetpoints(n_joint, joints, refs, &embObjMotionControl::helper_buildDirectSetpoint);
 }
 
 bool embObjMotionControl::setPositionsRaw(const double *refs)
 {
-    bool ret = true;
-    for (int i = 0; i<_njoints; i++)
-    {
-        ret &= setPositionRaw(i, refs[i]);
-    }
-    return ret;
+    return helper_sendSetpoints(_njoints, &_allJoints[0], refs, &embObjMotionControl::helper_buildDirectSetpoint);
 }
 
 
@@ -5047,11 +5107,13 @@ bool embObjMotionControl::getTemperatureRaw(int m, double* val)
 
 bool embObjMotionControl::getTemperaturesRaw(double *vals)
 {
-    bool ret = true;
+    _snapshotMutex.wait();
+    bool ret = readStatusSnapshot();
     for(int j=0; j< _njoints; j++)
     {
-        ret &= getTemperatureRaw(j, &vals[j]);
+        vals[j] = (ret) ? (double) _snapshotMotors[j].mot_temperature : 0;
     }
+    _snapshotMutex.post();
     return ret;
 }
 
@@ -5285,6 +5347,98 @@ bool embObjMotionControl::askRemoteValue(eOprotID32_t id32, void* value, uint16_
 }
 
 
+bool embObjMotionControl::helper_sendSetpoints(const int n_joint, const int *joints, const double *values, setpointBuilder_t builder)
+{
+    return helper_sendSetpoints__(n_joint, joints, values, builder, NULL);
+}
+
+bool embObjMotionControl::helper_sendSetpoints(const int n_joint, const int *joints, const double *values, plainSetpointBuilder_t builder)
+{
+    return helper_sendSetpoints__(n_joint, joints, values, NULL, builder);
+}
+
+// exactly one of builder and plainbuilder is not NULL
+bool embObjMotionControl::helper_sendSetpoints__(const int n_joint, const int *joints, const double *values, setpointBuilder_t builder, plainSetpointBuilder_t plainbuilder)
+{
+    if((n_joint < 0) || (n_joint > _njoints))
+    {
+        yError() << "embObjMotionControl::helper_sendSetpoints() called with" << n_joint << "joints for BOARD" << res->getName() << "IP" << res->getIPv4string() << "which has" << _njoints;
+        return false;
+    }
+    if(0 == n_joint)
+    {
+        return true;
+    }
+
+    _batchMutex.wait();
+
+    // the control modes of all joints come from one snapshot, which is read only if the builder needs them. then we build the setpoints
+    // and we load them as a single group of rops, so that the joints of one command are never split across two ropframes.
+    bool ret = true;
+    if(NULL != builder)
+    {
+        _snapshotMutex.wait();
+        ret = readStatusSnapshot();
+    }
+    int n = 0;
+    for(int i=0; (i<n_joint) && ret; i++)
+    {
+        int j = joints[i];
+        if((j < 0) || (j >= _njoints))
+        {
+            yError() << "embObjMotionControl::helper_sendSetpoints() skips invalid joint" << j << "for BOARD" << res->getName() << "IP" << res->getIPv4string();
+            continue;
+        }
+
+        bool built = true;
+        if(NULL != builder)
+        {
+            int mode = controlModeStatusConvert_embObj2yarp((eOmc_controlmode_t) _snapshotJoints[j].modes.controlmodestatus);
+            built = (this->*builder)(j, values[i], mode, _batchSetpoints[n]);
+        }
+        else
+        {
+            plainbuilder(values[i], _batchSetpoints[n]);
+        }
+
+        if(true == built)
+        {
+            _batchIDs[n] = eoprot_ID_get(eoprot_endpoint_motioncontrol, eoprot_entity_mc_joint, j, eoprot_tag_mc_joint_cmmnds_setpoint);
+            n++;
+        }
+    }
+    if(NULL != builder)
+    {
+        _snapshotMutex.post();
+    }
+
+    if(ret && (n > 0))
+    {
+        ret = res->addSetMessages(&_batchIDs[0], &_batchData[0], n);
+
+        if(ret && _immediateTX)
+        {
+            ret = res->transmitNow();
+        }
+    }
+
+    _batchMutex.post();
+
+    return ret;
+}
+
+bool embObjMotionControl::readStatusSnapshot(void)
+{
+    // all the joint cores and motor basics of the board are copied with one lock of the mc endpoint, thus they all come from the same ropframe
+    if(false == res->readBufferedValues(&_snapshotIDs[0], &_snapshotData[0], _snapshotIDs.size(), &_snapshotRXtime))
+    {
+        yError() << "embObjMotionControl::readStatusSnapshot() fails res->readBufferedValues() for BOARD" << res->getName() << "IP" << res->getIPv4string();
+        return false;
+    }
+    return true;
+}
+
+
 
 
 bool embObjMotionControl::checkRemoteControlModeStatus(int joint, int target_mode)
@@ -5373,26 +5527,25 @@ bool embObjMotionControl::iMange2focBoards(void)
 }
 
 //PWM interface
+void embObjMotionControl::helper_buildDutyCycleSetpoint(double v, eOmc_setpoint_t &setpoint)
+{
+    setpoint.type = (eOenum08_t)eomc_setpoint_openloop;
+    setpoint.to.openloop.value = (eOmeas_pwm_t)S_16(v);
+}
+
 bool embObjMotionControl::setRefDutyCycleRaw(int j, double v)
 {
     eOprotID32_t protid = eoprot_ID_get(eoprot_endpoint_motioncontrol, eoprot_entity_mc_joint, j, eoprot_tag_mc_joint_cmmnds_setpoint);
 
     eOmc_setpoint_t setpoint;
-
-    setpoint.type = (eOenum08_t)eomc_setpoint_openloop;
-    setpoint.to.openloop.value = (eOmeas_pwm_t)S_16(v);
+    helper_buildDutyCycleSetpoint(v, setpoint);
 
     return res->addSetMessage(protid, (uint8_t*)&setpoint);
 }
 
 bool embObjMotionControl::setRefDutyCyclesRaw(const double *v)
 {
-    bool ret = true;
-    for (int j = 0; j<_njoints; j++)
-    {
-        ret = ret && setRefDutyCycleRaw(j, v[j]);
-    }
-    return ret;
+    return helper_sendSetpoints(_njoints, &_allJoints[0], v, &embObjMotionControl::helper_buildDutyCycleSetpoint);
 }
 
 bool embObjMotionControl::getRefDutyCycleRaw(int j, double *v)
@@ -5446,11 +5599,13 @@ bool embObjMotionControl::getDutyCycleRaw(int j, double *v)
 
 bool embObjMotionControl::getDutyCyclesRaw(double *v)
 {
-    bool ret = true;
+    _snapshotMutex.wait();
+    bool ret = readStatusSnapshot();
     for (int j = 0; j< _njoints; j++)
     {
-        ret &= getDutyCycleRaw(j, &v[j]);
+        v[j] = (ret) ? (double) _snapshotMotors[j].mot_pwm : 0;
     }
+    _snapshotMutex.post();
     return ret;
 }
 
@@ -297,6 +297,8 @@ private:
     //int errors;
 
     yarp::os::Semaphore _mutex;
+    yarp::os::Semaphore _snapshotMutex;         /** protects the status snapshot below */
+    yarp::os::Semaphore _batchMutex;            /** protects the setpoint batch below */
 
 
     double *_angleToEncoder;                    /** angle to iCubDegrees conversion factors */
@@ -385,6 +387,23 @@ private:
     double  *_ref_positions;    // used for direct position control.
     double  *_ref_accs;         // for velocity control, in position min jerk eq is used.
 
+    // snapshot of the status of all joints and motors, copied from the transceiver with a single lock by readStatusSnapshot().
+    // the multi-joint getters use it so that they take the lock once per call and not once per joint.
+    double                                  _snapshotRXtime;
+    std::vector<eOmc_joint_status_core_t>   _snapshotJoints;
+    std::vector<eOmc_motor_status_basic_t>  _snapshotMotors;
+    std::vector<eOprotID32_t>               _snapshotIDs;
+    std::vector<uint8_t*>                   _snapshotData;
+
+    // setpoints of a multi-joint command, sent by helper_sendSetpoints() as a single group of rops in the same ropframe.
+    // if _immediateTX is true the ropframe is transmitted at once and not at the next cycle of the EthSender.
+    // it is set by the bool param immediateTX of the GENERAL group (false if missing).
+    bool                                    _immediateTX;
+    std::vector<int>                        _allJoints;
+    std::vector<eOmc_setpoint_t>            _batchSetpoints;
+    std::vector<eOprotID32_t>               _batchIDs;
+    std::vector<uint8_t*>                   _batchData;
+
     uint16_t        NVnumber;       // keep if useful to store, otherwise can be removed. It is used to pass the total number of this EP to the requestqueue
 
 
@@ -394,6 +413,21 @@ private:
 private:
 
     bool askRemoteValue(eOprotID32_t id32, void* value, uint16_t& size);
+    bool readStatusSnapshot(void);  // to be called with _snapshotMutex taken
+
+    // a setpoint builder fills the setpoint of joint j with value. it returns false if the joint must be skipped (e.g., wrong control mode).
+    typedef bool (embObjMotionControl::*setpointBuilder_t)(int j, double value, int mode, eOmc_setpoint_t &setpoint);
+    bool helper_sendSetpoints(const int n_joint, const int *joints, const double *values, setpointBuilder_t builder);
+    bool helper_buildPositionSetpoint(int j, double ref, int mode, eOmc_setpoint_t &setpoint);
+    bool helper_buildVelocitySetpoint(int j, double sp, int mode, eOmc_setpoint_t &setpoint);
+    bool helper_buildDirectSetpoint(int j, double ref, int mode, eOmc_setpoint_t &setpoint);
+
+    // a plain builder fills a setpoint which does not depend on the joint or on its control mode, thus no status snapshot is read.
+    typedef void (*plainSetpointBuilder_t)(double value, eOmc_setpoint_t &setpoint);
+    bool helper_sendSetpoints(const int n_joint, const int *joints, const double *values, plainSetpointBuilder_t builder);
+    static void helper_buildTorqueSetpoint(double t, eOmc_setpoint_t &setpoint);
+    static void helper_buildDutyCycleSetpoint(double v, eOmc_setpoint_t &setpoint);
+    bool helper_sendSetpoints__(const int n_joint, const int *joints, const double *values, setpointBuilder_t builder, plainSetpointBuilder_t plainbuilder);
     bool checkRemoteControlModeStatus(int joint, int target_mode);
 
     bool dealloc();
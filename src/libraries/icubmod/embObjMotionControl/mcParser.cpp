@@ -1345,7 +1345,7 @@ bool mcParser::isVerboseEnabled(yarp::os::Searchable &config)
     return ret;
 }
 
-bool mcParser::parseBehaviourFalgs(yarp::os::Searchable &config, bool &useRawEncoderData, bool  &pwmIsLimited )
+bool mcParser::parseBehaviourFalgs(yarp::os::Searchable &config, bool &useRawEncoderData, bool  &pwmIsLimited, bool &immediateTX )
 {
 
     // Check useRawEncoderData = do not use calibration data!
@@ -1393,6 +1393,25 @@ bool mcParser::parseBehaviourFalgs(yarp::os::Searchable &config, bool &useRawEnc
         }
     }
 
+    // Check immediateTX = the setpoints of a multi-joint command are transmitted at once, not at the next cycle of the EthSender
+    Value use_immediateTX = config.findGroup("GENERAL").find("immediateTX");
+    if(use_immediateTX.isNull())
+    {
+        immediateTX = false;
+    }
+    else
+    {
+        if(!use_immediateTX.isBool())
+        {
+            yWarning() << "embObjMotionControl::open() detected that immediateTX bool param is different from accepted values (true / false). Assuming false";
+            immediateTX = false;
+        }
+        else
+        {
+            immediateTX = use_immediateTX.asBool();
+        }
+    }
+
     return true;
 }
 
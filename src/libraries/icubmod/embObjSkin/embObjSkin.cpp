@@ -35,6 +35,7 @@
 
 using namespace std;
 using namespace iCub::skin::diagnostics;
+using iCub::skin::SkinFrameDecoder;
 
 
 int SkinPatchInfo::checkCardAddrIsInList(int cardAddr)
@@ -308,6 +309,24 @@ bool EmbObjSkin::fromConfig(yarp::os::Searchable& config)
         }
     }
 
+    // the table of the decoder: the boards of patch 1 follow the ones of patch 2 because they are sorted in decreasing order by can addr
+    _decoder.clear();
+    for(int i=0; i<_skCfg.numOfPatches; i++)
+    {
+        int first = 0;
+        if((_skCfg.numOfPatches == 2) && (i == 0))
+            first = _skCfg.patchInfoList[1].cardAddrList.size();
+
+        for(size_t j=0; j<_skCfg.patchInfoList[i].cardAddrList.size(); j++)
+        {
+            if(!_decoder.setCard(i, _skCfg.patchInfoList[i].cardAddrList[j], first+j))
+            {
+                yError() << "EmbObjSkin::fromConfig(): skin BOARD" << res->getName() << "IP" << res->getIPv4string() << "has invalid can address" << _skCfg.patchInfoList[i].cardAddrList[j] << "in patch" << _skCfg.patchInfoList[i].idPatch;
+                return false;
+            }
+        }
+    }
+
     // impose the number of sensors (triangles found in config file)
     sensorsNum = 16*12*_skCfg.totalCardsNum;     // max num of card
 
@@ -768,10 +787,10 @@ iethresType_t EmbObjSkin::type()
 
 bool EmbObjSkin::update(eOprotID32_t id32, double timestamp, void *rxdata)
 {
-    uint8_t           msgtype = 0;
     uint8_t           i, triangle = 0;
     static int error = 0;
     int p;
+    bool ret = true;
     EOarray* arrayof = (EOarray*)rxdata;
     uint8_t sizeofarray = eo_array_Size(arrayof);
 
@@ -792,6 +811,17 @@ bool EmbObjSkin::update(eOprotID32_t id32, double timestamp, void *rxdata)
 
     errors.resize(sizeofarray);
 
+    uint8_t skinClass;
+    if(_newCfg)
+        skinClass = ICUBCANPROTO_CLASS_PERIODIC_SKIN;
+    else
+        skinClass = ICUBCANPROTO_CLASS_PERIODIC_ANALOGSENSOR;
+
+    // marco.accame: added lock to avoid concurrent access to this->skindata. it is taken once for the whole array of frames
+    mutex.wait();
+
+    double *out = skindata.data();
+
     for(i=0; i<sizeofarray; i++)
     {       
         eOsk_candata_t *candata = (eOsk_candata_t*) eo_array_At(arrayof, i);
@@ -805,66 +835,18 @@ bool EmbObjSkin::update(eOprotID32_t id32, double timestamp, void *rxdata)
         uint8_t  canframesize = EOSK_CANDATA_INFO2SIZE(candata->info);
         uint8_t *canframedata = candata->data;
 
-        uint8_t mtbId = 255; // unknown mtb card addr
-        uint8_t cardAddr = 0;
-        uint8_t valid = 0;
-        uint8_t skinClass;
-
-        if(_newCfg)
-            skinClass = ICUBCANPROTO_CLASS_PERIODIC_SKIN;
-        else
-            skinClass = ICUBCANPROTO_CLASS_PERIODIC_ANALOGSENSOR;
-
-
-
-        valid = (((canframeid11 & 0x0f00) >> 8) == skinClass) ? 1 : 0;
-
-        if(valid)
+        if(((canframeid11 & 0x0f00) >> 8) == skinClass)
         {
-            cardAddr = (canframeid11 & 0x00f0) >> 4;
-            //get index of start of data of board with addr cardId.
-            for (size_t cId_index = 0; cId_index< _skCfg.patchInfoList[p].cardAddrList.size(); cId_index++)
-            {
-                if(_skCfg.patchInfoList[p].cardAddrList[cId_index] == cardAddr)
-                {
-                    mtbId = cId_index;
-                    if(_skCfg.numOfPatches==2 && p==0)
-                        mtbId +=  _skCfg.patchInfoList[1].cardAddrList.size(); //add max num of boards on patch number 2 because they are sorted in decreasing order by can addr
-                    break;
-                }
-            }
-
-            if(mtbId == 255)
+            // the position of the card addr in the output is in the table of the decoder (see fromConfig())
+            if(_decoder.offset(p, canframeid11) < 0)
             {
                 //yError() << "Unknown cardId from skin\n";
-                return false;
+                ret = false;
+                break;
             }
 
-            //printf("mtbId=%d\n", mtbId);
-            triangle = (canframeid11 & 0x000f);
-            msgtype = (int) canframedata[0];
-
-            int index=16*12*mtbId + triangle*12;
-
-            // marco.accame: added lock to avoid concurrent access to this->skindata. i lock at triangle resolution ...
-            mutex.wait();
-
-            if (msgtype == 0x40)
-            {
-                // Message head
-                for(int k = 0; k < 7; k++)
-                {
-                    skindata[index + k] = canframedata[k + 1];
-                }
-            }
-            else if (msgtype == 0xC0)
+            if(SkinFrameDecoder::tailFrame == _decoder.decode(p, canframeid11, canframedata, out))
             {
-                // Message tail
-                for(int k = 0; k < 5; k++)
-                {
-                    skindata[index + k + 7] = canframedata[k + 1];
-                }
-
                 // Skin diagnostics
                 if (_brdCfg.useDiagnostic)  // if user requests to check the diagnostic
                 {
@@ -877,10 +859,11 @@ bool EmbObjSkin::update(eOprotID32_t id32, double timestamp, void *rxdata)
                         short head = canframedata[6];
                         short tail = canframedata[7];
                         int fullMsg = (head << 8) | (tail & 0xFF);
+                        triangle = (canframeid11 & 0x000f);
 
                         // Store error message
                         errors[i].net = indexpatch;
-                        errors[i].board = cardAddr;
+                        errors[i].board = (canframeid11 & 0x00f0) >> 4;
                         errors[i].sensor = triangle;
                         errors[i].error = fullMsg;
 
@@ -901,12 +884,11 @@ bool EmbObjSkin::update(eOprotID32_t id32, double timestamp, void *rxdata)
                     }
                 }
             }
-            mutex.post();
         }
         else if(canframeid11 == 0x100)
         {
             /* Can frame with id =0x100 contains Debug info. SO I skip it.*/
-            return true;
+            break;
         }
         else
         {
@@ -917,7 +899,10 @@ bool EmbObjSkin::update(eOprotID32_t id32, double timestamp, void *rxdata)
                 error = 0;
         }
     }
-    return true;
+
+    mutex.post();
+
+    return ret;
 }
 
 /* *********************************************************************************************************************** */
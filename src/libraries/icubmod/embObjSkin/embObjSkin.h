@@ -40,6 +40,7 @@
 #include "IethResource.h"
 #include "SkinConfigReader.h"
 #include <SkinDiagnostics.h>
+#include <SkinFrameDecoder.h>
 #include "serviceParser.h"
 
 using namespace yarp::os;
@@ -100,6 +101,7 @@ protected:
     bool            _newCfg;
     SkinConfigReader  _cfgReader;
     SkinConfig        _skCfg;
+    iCub::skin::SkinFrameDecoder _decoder;
 
     bool            init();
     bool            fromConfig(yarp::os::Searchable& config);
@@ -0,0 +1,297 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+/*
+ * Copyright (C) 2016 iCub Facility - Istituto Italiano di Tecnologia
+ * CopyPolicy: Released under the terms of the GNU GPL v2.0.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include <yarp/os/LogStream.h>
+#include <yarp/sig/ImageFile.h>
+
+#include "ReplayFiles.h"
+
+#if !defined(_WIN32)
+    #define REPLAY_USE_MMAP
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+using namespace std;
+using namespace yarp::sig;
+
+static const char containerMagic[8]={'I','C','U','B','R','P','L','1'};
+
+static bool seek(FILE *f, size_t pos)
+{
+#if defined(_WIN32)
+    return _fseeki64(f, (__int64)pos, SEEK_SET)==0;
+#else
+    return fseeko(f, (off_t)pos, SEEK_SET)==0;
+#endif
+}
+
+
+bool ImageDirectory::open(const string &dir, const string &pattern, double framerate)
+{
+    files.clear();
+    timestamps.clear();
+
+    ifstream log((dir+"/data.log").c_str());
+    if (log.is_open())
+    {
+        string line;
+        while (getline(log, line))
+        {
+            istringstream tokens(line);
+            vector<string> t;
+            string s;
+            while (tokens >> s)
+                t.push_back(s);
+            if (t.size()<3)
+                continue;
+
+            files.push_back(dir+"/"+t.back());
+            timestamps.push_back(atof(t[1].c_str()));
+        }
+    }
+    else
+    {
+        if (framerate<=0.0)
+        {
+            yError() << "replay_grabber: the framerate has to be positive";
+            return false;
+        }
+
+        char name[256];
+        for (int i=0; ; i++)
+        {
+            snprintf(name, sizeof(name), pattern.c_str(), i);
+            string file=dir+"/"+name;
+            FILE *f=fopen(file.c_str(), "rb");
+            if (f==NULL)
+                break;
+            fclose(f);
+
+            files.push_back(file);
+            timestamps.push_back(i/framerate);
+        }
+    }
+
+    if (files.empty())
+    {
+        yError() << "replay_grabber: no frames found in" << dir;
+        return false;
+    }
+    return true;
+}
+
+bool ImageDirectory::read(int i, ImageOf<PixelRgb> &image) const
+{
+    return yarp::sig::file::read(image, files[i].c_str());
+}
+
+
+FrameContainer::FrameContainer() : w(0), h(0), n(0), frameSize(0), file(NULL), map(NULL), mapSize(0)
+{
+}
+
+FrameContainer::~FrameContainer()
+{
+    close();
+}
+
+bool FrameContainer::isContainer(const string &filename)
+{
+    FILE *f=fopen(filename.c_str(), "rb");
+    if (f==NULL)
+        return false;
+
+    char magic[8];
+    bool ok=(fread(magic, 1, 8, f)==8) && (memcmp(magic, containerMagic, 8)==0);
+    fclose(f);
+    return ok;
+}
+
+bool FrameContainer::open(const string &filename)
+{
+    close();
+
+    file=fopen(filename.c_str(), "rb");
+    if (file==NULL)
+    {
+        yError() << "replay_grabber: cannot open" << filename;
+        return false;
+    }
+
+    char magic[8];
+    int header[4];
+    if ((fread(magic, 1, 8, file)!=8) || (memcmp(magic, containerMagic, 8)!=0) ||
+        (fread(header, sizeof(int), 4, file)!=4) ||
+        (header[0]<=0) || (header[1]<=0) || (header[2]<=0))
+    {
+        yError() << filename << "is not a frame container";
+        close();
+        return false;
+    }
+
+    w=header[0];
+    h=header[1];
+    n=header[2];
+    frameSize=sizeof(double)+(size_t)w*h*3;
+
+    // the timestamps are read once, the frames on demand
+    timestamps.resize(n);
+    for (int i=0; i<n; i++)
+    {
+        if (!seek(file, offset(i)) || (fread(&timestamps[i], sizeof(double), 1, file)!=1))
+        {
+            yError() << filename << "is truncated at frame" << i;
+            close();
+            return false;
+        }
+    }
+
+#ifdef REPLAY_USE_MMAP
+    // Mapped, the frames are copied straight from the page cache without system calls;
+    // if the mapping fails (e.g. address space) the file is read with fread.
+    int fd=fileno(file);
+    struct stat st;
+    if ((fstat(fd, &st)==0) && ((size_t)st.st_size>=offset(n)))
+    {
+        void *p=mmap(NULL, offset(n), PROT_READ, MAP_SHARED, fd, 0);
+        if (p!=MAP_FAILED)
+        {
+            map=(unsigned char*)p;
+            mapSize=offset(n);
+            madvise(map, mapSize, MADV_SEQUENTIAL);
+            fclose(file);
+            file=NULL;
+        }
+    }
+#endif
+
+    yInfo() << "replay_grabber:" << filename << "has" << n << "frames" << w << "x" << h << (map ? "(mapped)" : "");
+    return true;
+}
+
+void FrameContainer::close()
+{
+#ifdef REPLAY_USE_MMAP
+    if (map!=NULL)
+        munmap(map, mapSize);
+#endif
+    map=NULL;
+    mapSize=0;
+
+    if (file!=NULL)
+        fclose(file);
+    file=NULL;
+
+    timestamps.clear();
+    w=h=n=0;
+}
+
+double FrameContainer::timestamp(int i) const
+{
+    return timestamps[i];
+}
+
+bool FrameContainer::read(int i, ImageOf<PixelRgb> &image)
+{
+    if ((i<0) || (i>=n))
+        return false;
+
+    image.resize(w, h);
+    const size_t rowSize=(size_t)w*3;
+
+    if (map!=NULL)
+    {
+        const unsigned char *src=map+offset(i)+sizeof(double);
+        for (int r=0; r<h; r++)
+            memcpy(image.getRow(r), src+r*rowSize, rowSize);
+        return true;
+    }
+
+    if (!seek(file, offset(i)+sizeof(double)))
+        return false;
+
+    // rows one by one only if the image is padded
+    if (image.getRowSize()==(int)rowSize)
+        return fread(image.getRawImage(), 1, rowSize*h, file)==rowSize*h;
+
+    for (int r=0; r<h; r++)
+        if (fread(image.getRow(r), 1, rowSize, file)!=rowSize)
+            return false;
+    return true;
+}
+
+void FrameContainer::willNeed(int i, int count)
+{
+#ifdef REPLAY_USE_MMAP
+    if ((map==NULL) || (i<0) || (i>=n))
+        return;
+
+    // madvise wants the address aligned to the page
+    count=std::min(count, n-i);
+    size_t page=(size_t)sysconf(_SC_PAGESIZE);
+    size_t start=offset(i)&~(page-1);
+    madvise(map+start, offset(i+count)-start, MADV_WILLNEED);
+#endif
+}
+
+bool FrameContainer::pack(const ImageDirectory &dir, const string &filename)
+{
+    ImageOf<PixelRgb> image;
+    if ((dir.frames()==0) || !dir.read(0, image))
+        return false;
+
+    FILE *f=fopen(filename.c_str(), "wb");
+    if (f==NULL)
+    {
+        yError() << "cannot write" << filename;
+        return false;
+    }
+
+    int header[4]={ image.width(), image.height(), 0, 0 };
+    fwrite(containerMagic, 1, 8, f);
+    fwrite(header, sizeof(int), 4, f);
+
+    const size_t rowSize=(size_t)header[0]*3;
+    bool ok=true;
+    for (int i=0; ok && (i<dir.frames()); i++)
+    {
+        if ((i>0) && !dir.read(i, image))
+        {
+            yWarning() << "cannot read frame" << i << ", the container stops there";
+            break;
+        }
+        if ((image.width()!=header[0]) || (image.height()!=header[1]))
+        {
+            yWarning() << "frame" << i << "has another size, the container stops there";
+            break;
+        }
+
+        double t=dir.timestamp(i);
+        ok=(fwrite(&t, sizeof(double), 1, f)==1);
+        for (int r=0; ok && (r<header[1]); r++)
+            ok=(fwrite(image.getRow(r), 1, rowSize, f)==rowSize);
+        if (ok)
+            header[2]++;
+    }
+
+    // the number of frames goes in the header at the end
+    ok=ok && seek(f, 8) && (fwrite(header, sizeof(int), 4, f)==4);
+    ok=(fclose(f)==0) && ok;
+
+    if (ok)
+        yInfo() << "packed" << header[2] << "frames" << header[0] << "x" << header[1] << "into" << filename;
+    return ok;
+}
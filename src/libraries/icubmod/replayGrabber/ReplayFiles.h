@@ -0,0 +1,97 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+/*
+ * Copyright (C) 2016 iCub Facility - Istituto Italiano di Tecnologia
+ * CopyPolicy: Released under the terms of the GNU GPL v2.0.
+ */
+
+#ifndef __ICUB_REPLAYFILES__
+#define __ICUB_REPLAYFILES__
+
+#include <string>
+#include <vector>
+#include <cstdio>
+
+#include <yarp/sig/Image.h>
+
+/**
+ * \file ReplayFiles.h
+ * The recordings replayed by the replay_grabber device.
+ */
+
+/**
+ * A directory of images recorded by yarpdatadumper: data.log lists, one per line,
+ * the sequence number, the timestamp(s) and the file of every frame (the first
+ * timestamp of the line is used, that is the envelope of the sender when the dumper
+ * stores it). Without data.log, the files are looked up with a printf pattern
+ * (e.g. %08d.ppm) starting from 0 and the frames are given the timestamps
+ * of the framerate.
+ */
+class ImageDirectory
+{
+public:
+    bool open(const std::string &dir, const std::string &pattern, double framerate);
+
+    int frames() const { return (int)files.size(); }
+    double timestamp(int i) const { return timestamps[i]; }
+
+    /** Reads and decodes the frame i (ppm) */
+    bool read(int i, yarp::sig::ImageOf<yarp::sig::PixelRgb> &image) const;
+
+private:
+    std::vector<std::string> files;
+    std::vector<double> timestamps;
+};
+
+
+/**
+ * A single file with frames all of the same size, that can be mapped in memory:
+ * a header followed by the frames, each made of its timestamp and of its rgb pixels.
+ * \code
+ *   header: "ICUBRPL1", width, height, frames (int32), reserved (int32)
+ *   frame:  timestamp (double), width*height*3 bytes (rows without padding)
+ * \endcode
+ * Values are in the byte order of the machine that wrote the file.
+ */
+class FrameContainer
+{
+public:
+    FrameContainer();
+    ~FrameContainer();
+
+    /** Opens a container, mapping it in memory where available (POSIX), else reading it with fread */
+    bool open(const std::string &filename);
+    void close();
+
+    int width() const  { return w; }
+    int height() const { return h; }
+    int frames() const { return n; }
+    double timestamp(int i) const;
+
+    /** Copies the frame i into image */
+    bool read(int i, yarp::sig::ImageOf<yarp::sig::PixelRgb> &image);
+
+    /** Tells the system that the frames [i, i+count) are needed soon */
+    void willNeed(int i, int count);
+
+    /** Writes a container with the frames of an image directory */
+    static bool pack(const ImageDirectory &dir, const std::string &filename);
+
+    /** True if filename is a container */
+    static bool isContainer(const std::string &filename);
+
+private:
+    enum { HEADER_SIZE=24 };
+
+    int w, h, n;
+    size_t frameSize;
+    std::vector<double> timestamps;
+
+    FILE *file;             // when the file is not mapped
+    unsigned char *map;     // the whole file, when mapped
+    size_t mapSize;
+
+    size_t offset(int i) const { return HEADER_SIZE + (size_t)i*frameSize; }
+};
+
+#endif
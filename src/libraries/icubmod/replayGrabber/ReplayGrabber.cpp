@@ -0,0 +1,204 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+/*
+ * Copyright (C) 2016 iCub Facility - Istituto Italiano di Tecnologia
+ * CopyPolicy: Released under the terms of the GNU GPL v2.0.
+ */
+
+#include <yarp/os/LogStream.h>
+
+#include "ReplayGrabber.h"
+
+using namespace yarp::os;
+using namespace yarp::dev;
+using namespace yarp::sig;
+
+
+ReplayPrefetcher::ReplayPrefetcher(ImageDirectory *dir, FrameContainer *container, int slots, bool loop) :
+    dir(dir), container(container), loop(loop), ring(slots), head(0), tail(0),
+    freeSlots(slots), readySlots(0)
+{
+}
+
+bool ReplayPrefetcher::readFrame(int i, Slot &slot)
+{
+    slot.index=i;
+    if (container!=NULL)
+    {
+        slot.timestamp=container->timestamp(i);
+        return container->read(i, slot.image);
+    }
+    slot.timestamp=dir->timestamp(i);
+    return dir->read(i, slot.image);
+}
+
+void ReplayPrefetcher::run()
+{
+    int frames=(container!=NULL) ? container->frames() : dir->frames();
+    int i=0;
+
+    while (!isStopping())
+    {
+        freeSlots.wait();
+        if (isStopping())
+            break;
+
+        Slot &slot=ring[tail];
+        if (i<frames)
+        {
+            if (container!=NULL)
+                container->willNeed(i+1, (int)ring.size());
+
+            if (!readFrame(i, slot))
+            {
+                yError() << "replay_grabber: cannot read frame" << i << ", the replay stops there";
+                slot.index=-1;
+            }
+
+            i++;
+            if ((i==frames) && loop)
+                i=0;
+        }
+        else
+        {
+            // the end of the recording
+            slot.index=-1;
+        }
+
+        tail=(tail+1)%ring.size();
+        readySlots.post();
+
+        if (slot.index<0)
+            break;
+    }
+}
+
+void ReplayPrefetcher::onStop()
+{
+    freeSlots.post();
+}
+
+ReplayPrefetcher::Slot &ReplayPrefetcher::front()
+{
+    readySlots.wait();
+    return ring[head];
+}
+
+void ReplayPrefetcher::pop()
+{
+    head=(head+1)%ring.size();
+    freeSlots.post();
+}
+
+
+bool ReplayGrabber::open(yarp::os::Searchable& config)
+{
+    ConstString source=config.check("source", Value(""), "the directory or the container to replay (string)").asString();
+    speed=config.check("speed", Value(1.0), "1.0 for real time, >1.0 accelerated, 0 as fast as possible").asDouble();
+    bool loop=config.check("loop", Value(true), "restart at the end of the recording").asBool();
+    int slots=config.check("prefetch", Value(8), "number of frames read in advance").asInt();
+    ConstString pattern=config.check("pattern", Value("%08d.ppm"), "pattern of the images in a directory without data.log").asString();
+    double framerate=config.check("framerate", Value(30.0), "framerate of the images in a directory without data.log").asDouble();
+
+    if (source=="")
+    {
+        yError() << "replay_grabber: 'source' is missing";
+        return false;
+    }
+    if ((speed<0.0) || (slots<1))
+    {
+        yError() << "replay_grabber: 'speed' cannot be negative and 'prefetch' has to be at least 1";
+        return false;
+    }
+
+    ImageOf<PixelRgb> first;
+    if (FrameContainer::isContainer(source.c_str()))
+    {
+        if (!container.open(source.c_str()) || !container.read(0, first))
+            return false;
+        prefetcher=new ReplayPrefetcher(NULL, &container, slots, loop);
+    }
+    else
+    {
+        if (!dir.open(source.c_str(), pattern.c_str(), framerate) || !dir.read(0, first))
+            return false;
+        prefetcher=new ReplayPrefetcher(&dir, NULL, slots, loop);
+    }
+
+    w=first.width();
+    h=first.height();
+    count=0;
+    ended=false;
+
+    // at every loop the first frame comes after the mean interval between the frames
+    int frames=container.frames()>0 ? container.frames() : dir.frames();
+    double duration=container.frames()>0 ? container.timestamp(frames-1)-container.timestamp(0) :
+                                            dir.timestamp(frames-1)-dir.timestamp(0);
+    loopGap=(frames>1) && (duration>0.0) ? duration/(frames-1) : (framerate>0.0 ? 1.0/framerate : 0.0);
+
+    yInfo() << "replay_grabber: replaying" << source << "at" << (speed>0.0 ? speed : 0.0) << (speed>0.0 ? "x real time" : "(as fast as possible)");
+    return prefetcher->start();
+}
+
+bool ReplayGrabber::close()
+{
+    if (prefetcher!=NULL)
+    {
+        prefetcher->stop();
+        delete prefetcher;
+        prefetcher=NULL;
+    }
+    container.close();
+    return true;
+}
+
+bool ReplayGrabber::getImage(yarp::sig::ImageOf<yarp::sig::PixelRgb>& image)
+{
+    if (ended || (prefetcher==NULL))
+        return false;
+
+    ReplayPrefetcher::Slot &slot=prefetcher->front();
+    if (slot.index<0)
+    {
+        yInfo() << "replay_grabber: end of the recording";
+        ended=true;
+        return false;
+    }
+
+    // the playback is anchored to the first frame, and again at every loop
+    double now=Time::now();
+    if (count==0)
+    {
+        playStart=lastDue=now;
+        firstTimestamp=slot.timestamp;
+    }
+    else if (slot.index==0)
+    {
+        playStart=lastDue+(speed>0.0 ? loopGap/speed : 0.0);
+        firstTimestamp=slot.timestamp;
+    }
+
+    if (speed>0.0)
+    {
+        lastDue=playStart+(slot.timestamp-firstTimestamp)/speed;
+        if (lastDue>now)
+            Time::delay(lastDue-now);
+    }
+
+    image.copy(slot.image);
+
+    mutex.wait();
+    stamp=Stamp(count++, slot.timestamp);
+    mutex.post();
+
+    prefetcher->pop();
+    return true;
+}
+
+Stamp ReplayGrabber::getLastInputStamp()
+{
+    mutex.wait();
+    Stamp s=stamp;
+    mutex.post();
+    return s;
+}
@@ -0,0 +1,127 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+/*
+ * Copyright (C) 2016 iCub Facility - Istituto Italiano di Tecnologia
+ * CopyPolicy: Released under the terms of the GNU GPL v2.0.
+ */
+
+#ifndef __ICUB_REPLAYGRABBER__
+#define __ICUB_REPLAYGRABBER__
+
+namespace yarp {
+    namespace dev
+    {
+        class ReplayGrabber;
+    }
+}
+
+#include <vector>
+
+#include <yarp/sig/all.h>
+#include <yarp/os/all.h>
+#include <yarp/dev/FrameGrabberInterfaces.h>
+#include <yarp/dev/PreciselyTimed.h>
+#include <yarp/dev/Drivers.h>
+
+#include "ReplayFiles.h"
+
+/**
+ * \file ReplayGrabber.h
+ * A grabber that replays a recording, for running (and benchmarking) the vision modules
+ * without the robot. The frames come from a directory of images recorded by yarpdatadumper
+ * or from a frame container (see ReplayFiles.h), and are given their original timestamps
+ * through IPreciselyTimed.
+ *
+ * Parameters:
+ * \code
+ *   source     the directory or the container to replay
+ *   speed      1.0 for real time (default), >1.0 accelerated, 0 as fast as possible
+ *   loop       restart at the end of the recording (default true)
+ *   prefetch   number of frames read in advance by a thread of their own (default 8)
+ *   pattern    printf pattern of the images in a directory without data.log (default %08d.ppm)
+ *   framerate  framerate of the images in a directory without data.log (default 30)
+ * \endcode
+ */
+
+/**
+ * Reads the frames in advance, in a ring of slots, so that the decoding and the
+ * disk do not stall the grabber.
+ */
+class ReplayPrefetcher : public yarp::os::Thread
+{
+public:
+    struct Slot
+    {
+        yarp::sig::ImageOf<yarp::sig::PixelRgb> image;
+        double timestamp;
+        int index;      // -1 at the end of the recording
+    };
+
+    ReplayPrefetcher(ImageDirectory *dir, FrameContainer *container, int slots, bool loop);
+
+    /** The next frame, waiting for it if it is not ready */
+    Slot &front();
+
+    /** Gives the slot of front() back */
+    void pop();
+
+    void run();
+    void onStop();
+
+private:
+    ImageDirectory *dir;
+    FrameContainer *container;
+    bool loop;
+
+    std::vector<Slot> ring;
+    int head, tail;
+    yarp::os::Semaphore freeSlots, readySlots;
+
+    bool readFrame(int i, Slot &slot);
+};
+
+class yarp::dev::ReplayGrabber :
+                        public yarp::dev::IFrameGrabberImage,
+                        public yarp::dev::IPreciselyTimed,
+                        public yarp::dev::DeviceDriver {
+private:
+
+    ImageDirectory dir;
+    FrameContainer container;
+    ReplayPrefetcher *prefetcher;
+
+    int w, h;
+    double speed;
+    double playStart;       // time at which the first frame (or the first after a loop) was served
+    double firstTimestamp;  // and its timestamp
+    double lastDue;         // time at which the last frame was due
+    double loopGap;         // interval between the last frame and the first one of the next loop
+    int count;
+    bool ended;
+    yarp::os::Stamp stamp;
+    yarp::os::Semaphore mutex;
+
+public:
+    ReplayGrabber() : prefetcher(NULL), w(0), h(0), speed(1.0), playStart(0.0), firstTimestamp(0.0),
+                      lastDue(0.0), loopGap(0.0), count(0), ended(false), mutex(1) {
+    }
+
+    virtual bool open(yarp::os::Searchable& config);
+
+    virtual bool close();
+
+    virtual bool getImage(yarp::sig::ImageOf<yarp::sig::PixelRgb>& image);
+
+    virtual int height() const {
+        return h;
+    }
+
+    virtual int width() const {
+        return w;
+    }
+
+    /** The original timestamp of the last frame */
+    virtual yarp::os::Stamp getLastInputStamp();
+};
+
+#endif
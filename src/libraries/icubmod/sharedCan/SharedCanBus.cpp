@@ -22,7 +22,7 @@ const int DEFAULT_THREAD_PERIOD = 10;
 class SharedCanBus : public yarp::os::RateThread
 {
 public:
-    SharedCanBus() : RateThread(DEFAULT_THREAD_PERIOD), writeMutex(1), configMutex(1)
+    SharedCanBus() : RateThread(DEFAULT_THREAD_PERIOD), writeMutex(1), configMutex(1), dispatchMutex(1)
     {
         mBufferSize=0;
         mCanDeviceNum=-1;
@@ -31,6 +31,8 @@ public:
         reqIdsUnion=new char[0x800];
 
         for (int i=0; i<0x800; ++i) reqIdsUnion[i]=UNREQ;
+
+        firstSubscriber.assign(0x801,0);
     }
 
     ~SharedCanBus()
@@ -81,6 +83,7 @@ public:
     {
         configMutex.wait();
         accessPoints.push_back(ap);
+        rebuildIdTable();
         configMutex.post();
     }
 
@@ -105,6 +108,9 @@ public:
                 
                 accessPoints.pop_back();
 
+                // after the rebuild no frame can be dispatched any more to ap, which can then be destroyed
+                rebuildIdTable();
+
                 break;
             }
         }
@@ -126,23 +132,19 @@ public:
 
         bool ret=theCanBus->canRead(readBufferUnion,mBufferSize,&msgsNum,NOWAIT);
 
-        if (ret)
+        if (ret && msgsNum)
         {
+            dispatchMutex.wait();
+
             for (unsigned int i=0; i<msgsNum; ++i)
             {
-                unsigned int id=readBufferUnion[i].getId();
-
-                for (unsigned int p=0; p<accessPoints.size(); ++p)
+                if (!dispatch(readBufferUnion[i],NULL))
                 {
-                    if (accessPoints[p]->hasId(id))
-                    {
-                        if (accessPoints[p]->pushReadMsg(readBufferUnion[i])==false)
-                        {
-                            yError("run()-pushReadMsg() failed on CAN bus %d", mCanDeviceNum);
-                        }
-                    }
+                    yError("run()-pushReadMsg() failed on CAN bus %d", mCanDeviceNum);
                 }
             }
+
+            dispatchMutex.post();
         } 
 
         configMutex.post();
@@ -154,25 +156,18 @@ public:
         bool ret=theCanBus->canWrite(msgs,size,sent,wait);
 
         //this allows other istances to read back the sent message (echo)
-        yarp::dev::CanBuffer buff=msgs;
+        dispatchMutex.wait();
+
         for (unsigned int m=0; m<size; ++m)
         {
-            unsigned int id=buff[m].getId();
-            if (reqIdsUnion[id])
+            if (!dispatch(msgs[m],pFrom))
             {
-                for (unsigned int p=0; p<accessPoints.size(); ++p)
-                {
-                    if (accessPoints[p]!=pFrom && accessPoints[p]->hasId(id))
-                    {
-                        if (accessPoints[p]->pushReadMsg(buff[m])==false)
-                        {
-                            yError("canWrite()-pushReadMsg() failed on CAN bus %d", mCanDeviceNum);
-                        }
-                    }
-                }
+                yError("canWrite()-pushReadMsg() failed on CAN bus %d", mCanDeviceNum);
             }
         }
 
+        dispatchMutex.post();
+
         writeMutex.post();
 
         return ret;
@@ -188,6 +183,8 @@ public:
             theCanBus->canIdAdd(id);
         }
 
+        rebuildIdTable();
+
         configMutex.post();
     }
 
@@ -197,6 +194,8 @@ public:
 
         canIdDeleteUnsafe(id);
 
+        rebuildIdTable();
+
         configMutex.post();
     }
     
@@ -297,6 +296,54 @@ public:
     }
 
 private:
+    // it pushes msg to all the access points which requested its id, except pFrom. dispatchMutex must be held
+    bool dispatch(const yarp::dev::CanMessage &msg, yarp::dev::CanBusAccessPoint* pFrom)
+    {
+        unsigned int id=msg.getId();
+
+        if (id>=0x800) return true;
+
+        bool ok=true;
+
+        for (int s=firstSubscriber[id]; s<firstSubscriber[id+1]; ++s)
+        {
+            if (subscriberList[s]!=pFrom)
+            {
+                ok=subscriberList[s]->pushReadMsg(msg) && ok;
+            }
+        }
+
+        return ok;
+    }
+
+    // it rebuilds the id -> access points table from the ids requested by every access point.
+    // the subscribers of id are subscriberList[firstSubscriber[id]] ... subscriberList[firstSubscriber[id+1]-1].
+    // configMutex must be held
+    void rebuildIdTable()
+    {
+        std::vector<int> first(0x801,0);
+        std::vector<yarp::dev::CanBusAccessPoint*> list;
+
+        for (int id=0; id<0x800; ++id)
+        {
+            first[id]=(int)list.size();
+
+            if (reqIdsUnion[id]==UNREQ) continue;
+
+            for (unsigned int p=0; p<accessPoints.size(); ++p)
+            {
+                if (accessPoints[p]->hasId(id)) list.push_back(accessPoints[p]);
+            }
+        }
+
+        first[0x800]=(int)list.size();
+
+        dispatchMutex.wait();
+        firstSubscriber.swap(first);
+        subscriberList.swap(list);
+        dispatchMutex.post();
+    }
+
     void canIdDeleteUnsafe(unsigned int id)
     {
         if (reqIdsUnion[id]==REQST)
@@ -319,6 +366,7 @@ private:
 
     yarp::os::Semaphore writeMutex;
     yarp::os::Semaphore configMutex;
+    yarp::os::Semaphore dispatchMutex;
 
     yarp::os::ConstString mDevice;
     int mCanDeviceNum;
@@ -334,6 +382,9 @@ private:
     yarp::dev::CanBuffer readBufferUnion;
 
     char *reqIdsUnion; //[0x800];
+
+    std::vector<int> firstSubscriber; //[0x801]
+    std::vector<yarp::dev::CanBusAccessPoint*> subscriberList;
 };
 
 class SharedCanBusManager // singleton
@@ -409,7 +460,11 @@ bool yarp::dev::CanBusAccessPoint::open(yarp::os::Searchable& config)
     
     if (!mSharedPhysDevice) return false;
 
-    mBufferSize=(unsigned int)(mSharedPhysDevice->getBufferSize());
+    // the ring is indexed with a mask, which stays in sequence when the counters wrap around
+    unsigned int size=(unsigned int)(mSharedPhysDevice->getBufferSize());
+    mBufferSize=1;
+    while (mBufferSize<size) mBufferSize<<=1;
+    mBufferMask=mBufferSize-1;
 
     readBuffer=createBuffer(mBufferSize);
 
@@ -32,6 +32,17 @@
 #define UNREQ 0
 #define REQST 1
 
+// the read buffer of an access point is a ring with a single producer (the SharedCanBus, which serialises
+// its dispatch of received and echoed frames) and a single consumer (canRead()), thus it needs only barriers:
+// each side reads the counter of the other one and then fences (acquire) before touching the slots, and fences
+// (release) after the slots are done before publishing its own counter.
+#if defined(_MSC_VER)
+#include <windows.h>
+#define SHAREDCAN_MEMORY_BARRIER() MemoryBarrier()
+#else
+#define SHAREDCAN_MEMORY_BARRIER() __sync_synchronize()
+#endif
+
 namespace yarp{
     namespace dev{
         class CanBusAccessPoint;
@@ -46,7 +57,7 @@ class yarp::dev::CanBusAccessPoint :
     public DeviceDriver
 {
 public:
-    CanBusAccessPoint() : waitReadMutex(0),synchroMutex(1)
+    CanBusAccessPoint() : waitReadMutex(0)
     {
         mSharedPhysDevice=NULL;
 
@@ -57,8 +68,9 @@ public:
         waitingOnRead=false;
 
         mBufferSize=0;
+        mBufferMask=0;
 
-        nRecv=0;
+        rxHead=rxTail=0;
     }
 
     ~CanBusAccessPoint()
@@ -73,26 +85,33 @@ public:
         return reqIds[id]==REQST;
     }
 
-    bool pushReadMsg(CanMessage& msg)
+    // it must be called only by the SharedCanBus while it dispatches
+    bool pushReadMsg(const CanMessage& msg)
     {
-        synchroMutex.wait();
+        unsigned int head=rxHead;
+        unsigned int tail=rxTail;
 
-        if (nRecv>=mBufferSize)
+        if (head-tail>=mBufferSize)
         {
-            synchroMutex.post();
-            yError("recv buffer overrun (%4d > %4d)", nRecv, mBufferSize);
+            yError("recv buffer overrun (%4d > %4d)", head-tail, mBufferSize);
             return false;
         }
 
-        readBuffer[nRecv++]=msg;
-        
+        // the slot is written only after the consumer has given it back (acquire)
+        SHAREDCAN_MEMORY_BARRIER();
+        readBuffer[head&mBufferMask]=msg;
+
+        // the message must be written before it is published (release)
+        SHAREDCAN_MEMORY_BARRIER();
+        rxHead=head+1;
+        SHAREDCAN_MEMORY_BARRIER();
+
         if (waitingOnRead)
         {
             waitingOnRead=false;
             waitReadMutex.post();
         }
-        
-        synchroMutex.post();
+
         return true;
     }
 
@@ -110,34 +129,40 @@ public:
 
     virtual bool canRead(CanBuffer &msgs, unsigned int size, unsigned int *nmsg, bool wait=false)
     {
-        synchroMutex.wait();
-
-        if (wait && !nRecv)
+        if (wait && (rxHead==rxTail))
         {
+            // a post left by a producer which saw the flag of a previous wait is consumed before raising the flag again
+            while (waitReadMutex.check()) {}
+
             waitingOnRead=true;
-            synchroMutex.post();
-            waitReadMutex.wait();
-            synchroMutex.wait();
-        }
+            SHAREDCAN_MEMORY_BARRIER();
 
-        if (nRecv)
-        {
-            for (unsigned int i=0; i<nRecv && i<size; ++i)
+            if (rxHead==rxTail)
             {
-                msgs[i]=readBuffer[i];
+                waitReadMutex.wait();
             }
 
-            *nmsg=nRecv;
-            nRecv=0;
-            synchroMutex.post();
-            return true;
+            waitingOnRead=false;
         }
-        else
+
+        unsigned int tail=rxTail;
+        unsigned int n=rxHead-tail;
+        if (n>size) n=size;
+
+        // the messages published are read only after their counter (acquire)
+        SHAREDCAN_MEMORY_BARRIER();
+
+        for (unsigned int i=0; i<n; ++i)
         {
-            *nmsg=0;
-            synchroMutex.post();
-            return true;
+            msgs[i]=readBuffer[(tail+i)&mBufferMask];
         }
+
+        // the messages must be read before their slots are given back to the producer (release)
+        SHAREDCAN_MEMORY_BARRIER();
+        rxTail=tail+n;
+
+        *nmsg=n;
+        return true;
     }
 
     virtual bool canWrite(const CanBuffer &msgs, unsigned int size, unsigned int *sent, bool wait=false);
@@ -160,16 +185,19 @@ public:
 
 protected:
     yarp::os::Semaphore waitReadMutex;
-    yarp::os::Semaphore synchroMutex;
     
-    bool waitingOnRead;
+    volatile bool waitingOnRead;
 
-    unsigned int nRecv;
+    // written only by the producer and by the consumer respectively. they wrap around at 2^32,
+    // which keeps the slots in sequence since the capacity is a power of two
+    volatile unsigned int rxHead;
+    volatile unsigned int rxTail;
     CanBuffer readBuffer;
     
     char *reqIds; //[0x800];
 
-    unsigned int mBufferSize;
+    unsigned int mBufferSize;   // a power of two
+    unsigned int mBufferMask;
 
     SharedCanBus* mSharedPhysDevice;
 };
@@ -0,0 +1,143 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+/*
+ * Copyright (C) 2016 iCub Facility - Istituto Italiano di Tecnologia
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#ifndef SKIN_FRAME_DECODER
+#define SKIN_FRAME_DECODER
+
+#include <string.h>
+
+
+namespace iCub {
+    namespace skin {
+
+        /**
+         * Decoder of the periodic frames of the MTB boards.
+         * Every triangle is sent in two frames with the id 0x?CT (C = card address, T = triangle): the head
+         * (data[0] == 0x40) carries the taxels 0..6 in data[1..7], the tail (data[0] == 0xC0) the taxels 7..11
+         * in data[1..5]. The position in the output of every (patch, card address, triangle) is computed once
+         * by setCard(), so a frame is decoded with one lookup and a copy of its taxels.
+         */
+        class SkinFrameDecoder
+        {
+        public:
+            enum
+            {
+                maxPatches = 2,
+                maxCards = 16,
+                trianglesPerCard = 16,
+                taxelsPerTriangle = 12,
+                taxelsPerCard = trianglesPerCard*taxelsPerTriangle,
+                headTaxels = 7,
+                tailTaxels = 5
+            };
+
+            enum
+            {
+                unknownFrame = 0,
+                headFrame = 0x40,
+                tailFrame = 0xC0
+            };
+
+            SkinFrameDecoder() { clear(); }
+
+            /** Forgets all the cards. */
+            void clear()
+            {
+                for (int i = 0; i < maxPatches*maxCards*trianglesPerCard; i++)
+                    table[i] = -1;
+            }
+
+            /**
+             * The taxels of the card with address cardAddr of a patch are written in the output from taxelsPerCard*position.
+             * @return false if the patch or the address are out of range
+             */
+            bool setCard(int patch, int cardAddr, int position)
+            {
+                if ((patch < 0) || (patch >= maxPatches) || (cardAddr < 0) || (cardAddr >= maxCards) || (position < 0))
+                    return false;
+
+                int *t = table + (patch*maxCards + cardAddr)*trianglesPerCard;
+                for (int triangle = 0; triangle < trianglesPerCard; triangle++)
+                    t[triangle] = taxelsPerCard*position + taxelsPerTriangle*triangle;
+                return true;
+            }
+
+            /** The position in the output of the first taxel of a triangle, -1 if the card is unknown. */
+            inline int offset(int patch, unsigned int canId) const
+            {
+                return table[((patch & (maxPatches-1))*maxCards + ((canId >> 4) & 0x0F))*trianglesPerCard + (canId & 0x0F)];
+            }
+
+            /**
+             * Writes the taxels of a frame in out (the buffer must hold taxelsPerCard taxels for every position given
+             * to setCard()). T is the type of the output, e.g. double for a yarp::sig::Vector or unsigned char for a
+             * compact buffer.
+             * @return headFrame or tailFrame, unknownFrame if the card is unknown or the frame does not carry taxels
+             */
+            template <typename T>
+            inline int decode(int patch, unsigned int canId, const unsigned char *data, T *out) const
+            {
+                int index = offset(patch, canId);
+                if (index < 0)
+                    return unknownFrame;
+
+                T *o = out + index;
+                const unsigned char *d = data + 1;
+                if (data[0] == headFrame)
+                {
+                    o[0] = d[0]; o[1] = d[1]; o[2] = d[2]; o[3] = d[3];
+                    o[4] = d[4]; o[5] = d[5]; o[6] = d[6];
+                    return headFrame;
+                }
+                if (data[0] == tailFrame)
+                {
+                    o += headTaxels;
+                    o[0] = d[0]; o[1] = d[1]; o[2] = d[2]; o[3] = d[3]; o[4] = d[4];
+                    return tailFrame;
+                }
+                return unknownFrame;
+            }
+
+        private:
+            int table[maxPatches*maxCards*trianglesPerCard];
+        };
+
+        /** The compact output needs no conversion: the taxels are copied as they are. */
+        template <>
+        inline int SkinFrameDecoder::decode<unsigned char>(int patch, unsigned int canId, const unsigned char *data, unsigned char *out) const
+        {
+            int index = offset(patch, canId);
+            if (index < 0)
+                return unknownFrame;
+
+            if (data[0] == headFrame)
+            {
+                memcpy(out + index, data + 1, headTaxels);
+                return headFrame;
+            }
+            if (data[0] == tailFrame)
+            {
+                memcpy(out + index + headTaxels, data + 1, tailTaxels);
+                return tailFrame;
+            }
+            return unknownFrame;
+        }
+
+    }
+}
+
+#endif // SKIN_FRAME_DECODER
@@ -15,11 +15,85 @@
 using namespace yarp::sig;
 using namespace yarp::os;
 
+compactSkinStreamer::compactSkinStreamer(int period) : RateThread(period)
+{
+    analog=NULL;
+}
+
+compactSkinStreamer::~compactSkinStreamer()
+{
+    closeParts();
+}
+
+bool compactSkinStreamer::addPart(const std::string &name, int offset, int length, unsigned int keyframePeriod)
+{
+    compactPart *part=new compactPart;
+    part->offset=offset;
+    part->length=length;
+    part->encoder.setKeyframePeriod(keyframePeriod);
+    if (!part->port.open(name.c_str()))
+    {
+        yError() << "skinWrapper: unable to open the compact port" << name;
+        delete part;
+        return false;
+    }
+    parts.push_back(part);
+    return true;
+}
+
+void compactSkinStreamer::closeParts()
+{
+    for (size_t i=0; i<parts.size(); i++)
+    {
+        parts[i]->port.interrupt();
+        parts[i]->port.close();
+        delete parts[i];
+    }
+    parts.clear();
+}
+
+void compactSkinStreamer::run()
+{
+    if ((analog==NULL) || (analog->read(data)!=yarp::dev::IAnalogSensor::AS_OK))
+        return;
+
+    stamp.update();
+    for (size_t i=0; i<parts.size(); i++)
+    {
+        compactPart *part=parts[i];
+        if (part->length<0)
+        {
+            part->values=data;
+        }
+        else
+        {
+            if (part->offset+part->length>(int)data.size())
+                continue;
+            part->values.resize(part->length);
+            for (int k=0; k<part->length; k++)
+                part->values[k]=data[part->offset+k];
+        }
+
+        // a reader that connects waits for the next keyframe
+        if (part->port.getOutputCount()==0)
+        {
+            part->encoder.forceKeyframe();
+            continue;
+        }
+
+        // strict write: a delta dropped because the previous message is still being sent would desynchronize the readers
+        part->encoder.encode(part->values, part->port.prepare());
+        part->port.setEnvelope(stamp);
+        part->port.write(true);
+    }
+}
+
 skinWrapper::skinWrapper()
 {
     yTrace(); 
     multipleWrapper=NULL;
     analog=NULL;
+    compactStreamer=NULL;
 		setId("undefinedPartName");
 }
 
@@ -86,11 +160,57 @@ bool skinWrapper::open(yarp::os::Searchable &params)
         yError()<<"skinWrapper: invalid device";
         return false;
     }
+
+    // optional compact stream of the same parts, see iCub/skinDynLib/skinDataCodec.h
+    if (params.check("compactStream") && params.find("compactStream").asBool())
+    {
+        int keyframePeriod=params.check("compactKeyframePeriod", Value(50)).asInt();
+        compactStreamer=new compactSkinStreamer(period);
+
+        bool ok=true;
+        Bottle *ports=params.find("ports").asList();
+        if (ports==NULL)
+        {
+            ok=compactStreamer->addPart(root_name+SKIN_COMPACT_PORT_SUFFIX, 0, -1, keyframePeriod);
+        }
+        else
+        {
+            for (int k=0; ok && k<ports->size(); k++)
+            {
+                std::string portName=ports->get(k).asString().c_str();
+                Bottle parameters=params.findGroup(portName.c_str());
+                if (parameters.size()!=5)
+                {
+                    yError()<<"skinWrapper: check the skin part configuration of" << portName;
+                    ok=false;
+                    break;
+                }
+                int wBase=parameters.get(1).asInt();
+                int wTop=parameters.get(2).asInt();
+                ok=compactStreamer->addPart(root_name+"/"+portName+SKIN_COMPACT_PORT_SUFFIX, wBase, wTop-wBase+1, keyframePeriod);
+            }
+        }
+
+        if (!ok)
+        {
+            delete compactStreamer;
+            compactStreamer=NULL;
+            return false;
+        }
+        yInfo()<<"skinWrapper: part"<<id<<"streams also the compact skin data, keyframe every"<<keyframePeriod<<"messages";
+    }
     return true;
 }
 
 bool skinWrapper::close()
 {
+    if (NULL != compactStreamer)
+    {
+        compactStreamer->stop();
+        delete compactStreamer;
+        compactStreamer=NULL;
+    }
+
     if (NULL != analog)
         analog=0;
 
@@ -140,12 +260,23 @@ bool skinWrapper::attachAll(const yarp::dev::PolyDriverList &skinDev)
         return false;
     }
     multipleWrapper->attachAll(skinDev);
+
+    if (NULL != compactStreamer)
+    {
+        compactStreamer->setSensor(analog);
+        compactStreamer->start();
+    }
     return true;
 }
 
 bool skinWrapper::detachAll()
 {
     yTrace();
+    if (NULL != compactStreamer)
+    {
+        compactStreamer->stop();
+        compactStreamer->setSensor(NULL);
+    }
     multipleWrapper->detachAll();
 //    analogServer->stop();
     return true;
@@ -41,6 +41,41 @@
 
 #include <yarp/os/LogStream.h>
 
+#include <iCub/skinDynLib/skinDataCodec.h>
+
+/**
+ * Publishes the skin parts on the compact stream of iCub/skinDynLib/skinDataCodec.h: every part port of
+ * the analogServer gets a twin port (the same name followed by SKIN_COMPACT_PORT_SUFFIX) which streams
+ * the taxels as bytes and, between two keyframes, only the taxels that changed.
+ */
+class compactSkinStreamer : public yarp::os::RateThread
+{
+private:
+    struct compactPart
+    {
+        int offset;
+        int length;                 // -1 for the whole data
+        yarp::sig::Vector values;
+        iCub::skinDynLib::skinDataEncoder encoder;
+        yarp::os::BufferedPort<yarp::os::Bottle> port;
+    };
+
+    yarp::dev::IAnalogSensor *analog;
+    std::vector<compactPart*> parts;
+    yarp::sig::Vector data;
+    yarp::os::Stamp stamp;
+
+public:
+    compactSkinStreamer(int period);
+    ~compactSkinStreamer();
+
+    bool addPart(const std::string &name, int offset, int length, unsigned int keyframePeriod);
+    void setSensor(yarp::dev::IAnalogSensor *s) { analog = s; }
+    void closeParts();
+
+    virtual void run();
+};
+
 class skinWrapper : public yarp::dev::DeviceDriver,
                     public yarp::dev::IMultipleWrapper
 {
@@ -50,6 +85,7 @@ private:
     yarp::dev::IAnalogSensor *analog;
     int numPorts;
     yarp::dev::IMultipleWrapper *multipleWrapper;
+    compactSkinStreamer *compactStreamer;
 
 //    yarp::sig::Vector wholeData;      // may be useful if one the skin wrapper has to get data from more than one device...
 
@@ -39,6 +39,10 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/time.h>
+#include <string>
 
 
 /* At time of writing, these constants are not defined in the headers */
@@ -57,10 +61,15 @@ using namespace yarp::os;
 
 const int TX_QUEUE_SIZE=2047;
 const int RX_QUEUE_SIZE=2047;
+const int MMSG_BATCH_SIZE=64;
 
 SocketCan::SocketCan()
 {
     skt = 0;
+    txTimeout = 500;
+    rxTimeout = 500;
+    rxTimestamps = false;
+    rxStampsNum = 0;
 }
 
 SocketCan::~SocketCan()
@@ -92,84 +101,114 @@ bool SocketCan::canIdDelete(unsigned int id)
     return true;
 }
 
+bool SocketCan::waitSocket(short events, int timeout)
+{
+    struct pollfd pfd;
+    pfd.fd = skt;
+    pfd.events = events;
+    pfd.revents = 0;
+
+    int res = 0;
+    do
+    {
+        res = poll(&pfd, 1, timeout);
+    } while ((res < 0) && (errno == EINTR));
+
+    return (res > 0) && (pfd.revents & events);
+}
+
 bool SocketCan::canRead(CanBuffer &msgs,
                      unsigned int size, 
                      unsigned int *readout,
                      bool wait)
 {
-/*
-    int res;
-    #ifdef WIN32
-        long lRead=size;
-    #else
-        int32_t lRead=size;
-    #endif
-
-    CMSG *tmp=reinterpret_cast<CMSG *>(msgs[0].getPointer());
-    if (wait)
-        res=::canRead(*handle, tmp, &lRead, 0);
-    else
-        res=::canTake(*handle, tmp, &lRead);
-
-    *readout=lRead;
-
-    if ( (res==NTCAN_SUCCESS)||(res==NTCAN_RX_TIMEOUT))
-        return true;
-
-    fprintf(stderr, "Error: canRead returned with code:%.8X\n", res);*/
+    unsigned int total=0;
+    const unsigned int batch=rxHeaders.size();
+    const size_t controlSize=CMSG_SPACE(sizeof(struct timeval));
 
-    int i=0;
-    int bytes_read=0;
     #if SOCK_DEBUG
         printf("Asked for %d messages\n", size);
     #endif
-    for (i=0; i<size; i++)
+
+    // not open
+    if ((!skt) || (batch==0))
     {
-        can_frame *frm=reinterpret_cast<can_frame *>(msgs[i].getPointer());
-        //printf("start reading\n");
-        bytes_read = 0;
-        bytes_read = read( skt, frm, sizeof(*frm) );
-        #if SOCK_DEBUG
-            printf("finished reading. read %d bytes\n",bytes_read);
-        #endif
-        if (bytes_read<=0) break;
-
-        #if SOCK_DEBUG
-            printf("Read: %d \n ",bytes_read);
-            printf("len %d ", frm->can_dlc);
-            printf("id %d ", frm->can_id);
-            printf("data: ");
-            for(int j=0;j<frm->can_dlc;j++)
-                printf("%2x ", frm->data[j]);
-            printf("\n");
-        #endif
-
-        //yarp::os::Time::delay(0.010); //test only
+        *readout=0;
+        rxStampsNum=0;
+        return false;
     }
-    *readout=i;
+
+    if (wait && (size > 0))
+    {
+        waitSocket(POLLIN, rxTimeout);
+    }
+
+    while (total<size)
+    {
+        unsigned int n=size-total;
+        if (n>batch) n=batch;
+
+        for (unsigned int i=0; i<n; i++)
+        {
+            rxVectors[i].iov_base=msgs[total+i].getPointer();
+            rxVectors[i].iov_len=sizeof(struct can_frame);
+            // the kernel overwrites the length of the control data, thus it must be set at every call
+            rxHeaders[i].msg_hdr.msg_controllen=(rxTimestamps) ? (controlSize) : (0);
+        }
+
+        int res=recvmmsg(skt, &rxHeaders[0], n, MSG_DONTWAIT, NULL);
+        if (res<0)
+        {
+            if (errno==EINTR) continue;
+            if ((errno!=EAGAIN) && (errno!=EWOULDBLOCK))
+            {
+                fprintf(stderr, "Error: SocketCan::canRead() failed with errno %d.\n", errno);
+            }
+            break;
+        }
+
+        if (res==0) break;
+
+        if (rxTimestamps)
+        {
+            for (int i=0; i<res; i++)
+            {
+                double stamp=0;
+                struct msghdr *hdr=&rxHeaders[i].msg_hdr;
+                for (struct cmsghdr *cmsg=CMSG_FIRSTHDR(hdr); cmsg!=NULL; cmsg=CMSG_NXTHDR(hdr, cmsg))
+                {
+                    if ((cmsg->cmsg_level==SOL_SOCKET) && (cmsg->cmsg_type==SCM_TIMESTAMP))
+                    {
+                        struct timeval tv;
+                        memcpy(&tv, CMSG_DATA(cmsg), sizeof(tv));
+                        stamp=tv.tv_sec+0.000001*tv.tv_usec;
+                    }
+                }
+                if (total+i<rxStamps.size()) rxStamps[total+i]=stamp;
+            }
+        }
+
+        total+=res;
+
+        // the socket is empty
+        if (res<(int)n) break;
+    }
+
+    *readout=total;
+    rxStampsNum=total;
     #if SOCK_DEBUG
         printf("Read %d messages\n", *readout);
     #endif
     return true;
+}
 
-	/*
-	//debug
-	//struct can_frame frame;
-    can_frame *frame=reinterpret_cast<can_frame *>(msgs[0].getPointer());
-    bytes_read = read( skt, frame, sizeof(*frame) );
-    *readout=1;
-
-    printf("Read: %d \n ",bytes_read);
-
-    printf("len %d ", frame->can_dlc);
-    printf("id %d ", frame->can_id);
-    printf("data: ");
-    for(i=0;i<frame->can_dlc;i++)
-        printf("%2x ", frame->data[i]);
-    printf("\n");
+bool SocketCan::canGetRxTimestamps(double *stamps, unsigned int size)
+{
+    if ((!rxTimestamps) || (size>rxStampsNum) || (size>rxStamps.size()))
+        return false;
 
+    memcpy(stamps, &rxStamps[0], size*sizeof(double));
     return true;
-	*/
 }
 
 bool SocketCan::canWrite(const CanBuffer &msgs,
@@ -177,58 +216,62 @@ bool SocketCan::canWrite(const CanBuffer &msgs,
                       unsigned int *sent,
                       bool wait)
 {
-    int res;
-    int32_t lRead=size;
-    int bytes_sent=0;
-
-/*
-    //debug
-    struct can_frame frame2;
-    frame2.can_id = 0x123;
-    strcpy( (char*)(&frame2.data), "YAY" );
-    frame2.can_dlc = strlen( (char*)(&frame2.data) );
-    bytes_sent = write( skt, &frame2, sizeof(frame2) );
-*/
-/*
-    //debug
-    can_frame frame3;
-    frame3.can_id = 0x123;
-    frame3.data[0] = 'Y';
-    frame3.can_dlc = 1;
-    bytes_sent = write( skt, &frame3, sizeof(frame3) );
-*/
+    // the frames are written in batches without any fixed delay. when the socket is full (EAGAIN) we wait for POLLOUT,
+    // when the queue of the interface is full (ENOBUFS, which is not signalled by poll) we retry after a short pause.
+    // in both cases we give up after the tx timeout. a smaller canSndBuf moves the back-pressure from the
+    // interface queue (where frames could be dropped) to the socket.
+    CanBuffer &buffer=const_cast<CanBuffer &>(msgs);
+    const unsigned int batch=txHeaders.size();
+    const double deadline=Time::now()+0.001*txTimeout;
+
+    (*sent)=0;
+    if ((!skt) || (batch==0))
+    {
+        fprintf(stderr, "Error: SocketCan::canWrite() called on a device that is not open.\n");
+        return false;
+    }
 
-    //debug
-    //fprintf(stderr, "id:%d data:%d size:%d\n", tmp->can_id, tmp->data[0], tmp->can_dlc );
-   
-    //@@@ IMPORTANT (RANDAZ): I'm putting here a delay of one millisecond.
-	//I noticed that without this delay a lot CAN messages are lost when iCubInterface starts and
-	//sends the configuration parameters (PIDs etc.) to the control boards.
-	//Further investigation is required in order to understand how the internal buffer is handled 
-	//when the function write( skt, tmp, sizeof(*tmp) ); is called.
-	Time::delay(0.001);
-	
-    int i=0;
-	(*sent)=0;
-	for (i=0; i<size; i++)
+    while ((*sent)<size)
     {
-		CanBuffer &buffer=const_cast<CanBuffer &>(msgs);
-		const struct can_frame *tmp=reinterpret_cast<const struct can_frame*>(buffer[i].getPointer());   
-		bytes_sent = write( skt, tmp, sizeof(*tmp) );
-		if (bytes_sent>0) 
-		{
-			(*sent)++;
-		}
+        unsigned int n=size-(*sent);
+        if (n>batch) n=batch;
+
+        for (unsigned int i=0; i<n; i++)
+        {
+            txVectors[i].iov_base=buffer[(*sent)+i].getPointer();
+            txVectors[i].iov_len=sizeof(struct can_frame);
+        }
+
+        int res=sendmmsg(skt, &txHeaders[0], n, MSG_DONTWAIT);
+        if (res>0)
+        {
+            (*sent)+=res;
+            continue;
+        }
+
+        if ((res<0) && (errno==EINTR)) continue;
+
+        double remaining=deadline-Time::now();
+        if (remaining<=0) break;
+
+        if ((res<0) && ((errno==EAGAIN) || (errno==EWOULDBLOCK)))
+        {
+            waitSocket(POLLOUT, (int)(remaining*1000.0)+1);
+        }
+        else if ((res<0) && (errno==ENOBUFS))
+        {
+            Time::delay(0.0001);
+        }
         else
-		{
-			fprintf(stderr, "Error: SocketCan::canWrite() was unable to send message.\n");
-			//break;
-		}
-	}
-	
+        {
+            fprintf(stderr, "Error: SocketCan::canWrite() was unable to send message (errno %d).\n", errno);
+            break;
+        }
+    }
+
     if (*sent <size)
        {
-           fprintf(stderr, "Error: SocketCan::canWrite() not all messages were sent.\n");
+           fprintf(stderr, "Error: SocketCan::canWrite() not all messages were sent (%d of %d).\n", *sent, size);
            return false;
        }
    
@@ -240,8 +283,9 @@ bool SocketCan::open(yarp::os::Searchable &par)
     int canTxQueue=TX_QUEUE_SIZE;
     int canRxQueue=RX_QUEUE_SIZE;
     int netId =-1;
-    int txTimeout=500;
-    int rxTimeout=500;
+    int sndBuf=0;
+    int timestamps=0;
+    std::string devName;
 
                          netId=par.check("CanDeviceNum", Value(-1), "numeric identifier of the can device").asInt();
     if  (netId == -1)    netId=par.check("canDeviceNum", Value(-1), "numeric identifier of the can device").asInt();
@@ -258,25 +302,90 @@ bool SocketCan::open(yarp::os::Searchable &par)
                                       canRxQueue=par.check("CanRxQueue", Value(RX_QUEUE_SIZE), "length of rx buffer").asInt() ;
     if  (canRxQueue == RX_QUEUE_SIZE) canRxQueue=par.check("canRxQueue", Value(RX_QUEUE_SIZE), "length of rx buffer").asInt() ;
 
-   int so_timestamping_flags = 0;
+                           devName=par.check("CanDeviceName", Value(""), "name of the can interface, e.g. vcan0. if missing it is can<CanDeviceNum>").asString();
+    if  (devName.empty())  devName=par.check("canDeviceName", Value(""), "name of the can interface, e.g. vcan0. if missing it is can<CanDeviceNum>").asString();
+
+                           sndBuf=par.check("CanSndBuf", Value(0), "size of the socket tx buffer [bytes], 0 keeps the kernel default").asInt();
+    if  (sndBuf == 0)      sndBuf=par.check("canSndBuf", Value(0), "size of the socket tx buffer [bytes], 0 keeps the kernel default").asInt();
+
+                           timestamps=par.check("CanRxTimestamps", Value(0), "if 1 the kernel timestamps of the received frames are available").asInt();
+    if  (timestamps == 0)  timestamps=par.check("canRxTimestamps", Value(0), "if 1 the kernel timestamps of the received frames are available").asInt();
+
    /* Create the socket */
    skt = socket( PF_CAN, SOCK_RAW, CAN_RAW );
+   if (skt < 0)
+   {
+       fprintf(stderr, "Error: SocketCan::open() cannot create the socket.\n");
+       skt = 0;
+       return false;
+   }
  
    /* Locate the interface you wish to use */
    struct ifreq ifr;
-   sprintf (ifr.ifr_name, "can%d",netId);
-   ioctl(skt, SIOCGIFINDEX, &ifr); // ifr.ifr_ifindex gets filled with that device's index
+   if (devName.empty())
+       snprintf (ifr.ifr_name, IFNAMSIZ, "can%d",netId);
+   else
+       snprintf (ifr.ifr_name, IFNAMSIZ, "%s",devName.c_str());
+   if (ioctl(skt, SIOCGIFINDEX, &ifr) < 0) // ifr.ifr_ifindex gets filled with that device's index
+   {
+       fprintf(stderr, "Error: SocketCan::open() cannot find the interface %s.\n", ifr.ifr_name);
+       close();
+       return false;
+   }
  
    /* Select that CAN interface, and bind the socket to it. */
    struct sockaddr_can addr;
+   memset(&addr, 0, sizeof(addr));
    addr.can_family = AF_CAN;
    addr.can_ifindex = ifr.ifr_ifindex;
-   bind( skt, (struct sockaddr*)&addr, sizeof(addr) );
+   if (bind( skt, (struct sockaddr*)&addr, sizeof(addr) ) < 0)
+   {
+       fprintf(stderr, "Error: SocketCan::open() cannot bind to the interface %s.\n", ifr.ifr_name);
+       close();
+       return false;
+   }
 
     int flags;
     if (-1 == (flags = fcntl(skt, F_GETFL, 0))) flags = 0;
     fcntl(skt, F_SETFL, flags | O_NONBLOCK);
 
+    if (sndBuf > 0)
+    {
+        if (setsockopt(skt, SOL_SOCKET, SO_SNDBUF, &sndBuf, sizeof(sndBuf)) < 0)
+            fprintf(stderr, "Warning: SocketCan::open() cannot set SO_SNDBUF to %d.\n", sndBuf);
+    }
+
+    rxTimestamps = (timestamps != 0);
+    if (rxTimestamps)
+    {
+        int on = 1;
+        if (setsockopt(skt, SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on)) < 0)
+        {
+            fprintf(stderr, "Warning: SocketCan::open() cannot enable the rx timestamps.\n");
+            rxTimestamps = false;
+        }
+    }
+
+    // the headers of the batches point once for all to their iovec and control buffer. the frames are set at every call
+    const size_t controlSize=CMSG_SPACE(sizeof(struct timeval));
+    rxHeaders.resize(MMSG_BATCH_SIZE);
+    rxVectors.resize(MMSG_BATCH_SIZE);
+    rxControl.resize(MMSG_BATCH_SIZE*controlSize);
+    rxStamps.resize(canRxQueue > 0 ? canRxQueue : RX_QUEUE_SIZE);
+    rxStampsNum = 0;
+    txHeaders.resize(MMSG_BATCH_SIZE);
+    txVectors.resize(MMSG_BATCH_SIZE);
+    memset(&rxHeaders[0], 0, MMSG_BATCH_SIZE*sizeof(struct mmsghdr));
+    memset(&txHeaders[0], 0, MMSG_BATCH_SIZE*sizeof(struct mmsghdr));
+    for (int i=0; i<MMSG_BATCH_SIZE; i++)
+    {
+        rxHeaders[i].msg_hdr.msg_iov=&rxVectors[i];
+        rxHeaders[i].msg_hdr.msg_iovlen=1;
+        rxHeaders[i].msg_hdr.msg_control=&rxControl[i*controlSize];
+        rxHeaders[i].msg_hdr.msg_controllen=controlSize;
+        txHeaders[i].msg_hdr.msg_iov=&txVectors[i];
+        txHeaders[i].msg_hdr.msg_iovlen=1;
+    }
 
    return true;
 }
@@ -300,6 +409,7 @@ bool SocketCan::close()
     if (!skt)
         return false;
 
-    //not yet implemented 
+    ::close(skt);
+    skt=0;
     return true;
 }
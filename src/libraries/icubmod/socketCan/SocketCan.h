@@ -34,8 +34,10 @@
 #include <yarp/dev/CanBusInterface.h>
 
 #include "memory.h"
+#include <vector>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <linux/can.h>
 #include <linux/can/raw.h>
 
@@ -105,6 +107,22 @@ class yarp::dev::SocketCan: public ImplementCanBufferFactory<SocketCanMessage, c
 {
 private:
     int skt;
+    int txTimeout;      // [ms]
+    int rxTimeout;      // [ms]
+    bool rxTimestamps;
+
+    // the frames are read and written in batches with recvmmsg() / sendmmsg(). the headers of a batch
+    // are allocated in open() and then only pointed to the frames of the CanBuffer.
+    std::vector<struct mmsghdr> rxHeaders;
+    std::vector<struct iovec>   rxVectors;
+    std::vector<char>           rxControl;
+    std::vector<double>         rxStamps;
+    unsigned int                rxStampsNum;
+    std::vector<struct mmsghdr> txHeaders;
+    std::vector<struct iovec>   txVectors;
+
+    bool waitSocket(short events, int timeout);
+
 public:
     SocketCan();
     ~SocketCan();
@@ -125,6 +143,15 @@ public:
         unsigned int *sent,
         bool wait=false);
 
+    /**
+     * Gets the kernel timestamps [s] of the frames returned by the latest canRead(). They are available only if
+     * the device was opened with canRxTimestamps 1.
+     * @param stamps the array which receives the timestamps
+     * @param size the number of timestamps to get. it cannot be more than the frames read by the latest canRead()
+     * @return true if the timestamps are available
+     */
+    bool canGetRxTimestamps(double *stamps, unsigned int size);
+
     /*Device Driver*/
     virtual bool open(yarp::os::Searchable &par);
     virtual bool close();
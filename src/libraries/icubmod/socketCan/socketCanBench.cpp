@@ -0,0 +1,143 @@
+// -*- Mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+/*
+ * Copyright (C) 2016 iCub Facility - Istituto Italiano di Tecnologia
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+*/
+
+// Throughput benchmark of the socketcan device. It opens two devices on the same interface (a vcan is fine),
+// writes frames in batches with one and reads them back with the other. It prints the frames per second and,
+// from the kernel rx timestamps, the latency between canWrite() and the reception of each frame.
+//
+// sudo modprobe vcan; sudo ip link add dev vcan0 type vcan; sudo ip link set up vcan0
+// socketCanBench --device vcan0 --frames 100000 --batch 32
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include <yarp/os/Network.h>
+#include <yarp/os/Property.h>
+#include <yarp/os/Time.h>
+
+#include "SocketCan.h"
+
+using namespace yarp::dev;
+using namespace yarp::os;
+
+
+int main(int argc, char *argv[])
+{
+    Property opt;
+    opt.fromCommand(argc, argv);
+
+    std::string device = opt.check("device", Value("vcan0")).asString();
+    int frames = opt.check("frames", Value(100000)).asInt();
+    int batch = opt.check("batch", Value(32)).asInt();
+    int sndbuf = opt.check("sndbuf", Value(0)).asInt();
+
+    if ((frames <= 0) || (batch <= 0))
+    {
+        fprintf(stderr, "socketCanBench: frames and batch must be positive\n");
+        return 1;
+    }
+
+    Property cfg;
+    cfg.put("canDeviceName", device.c_str());
+    cfg.put("canSndBuf", sndbuf);
+    cfg.put("canRxQueue", batch*4);
+    cfg.put("canRxTimestamps", 1);
+
+    SocketCan writer, reader;
+    if (!writer.open(cfg) || !reader.open(cfg))
+    {
+        fprintf(stderr, "socketCanBench: cannot open the interface %s\n", device.c_str());
+        return 1;
+    }
+
+    CanBuffer txBuffer = writer.createBuffer(batch);
+    CanBuffer rxBuffer = reader.createBuffer(batch*4);
+    double *stamps = new double[batch*4];
+
+    for (int i=0; i<batch; i++)
+    {
+        txBuffer[i].setId(0x100 + (i & 0xff));
+        txBuffer[i].setLen(8);
+    }
+
+    int written = 0, received = 0, failures = 0;
+    double latencySum = 0, latencyMax = 0;
+    int latencyNum = 0;
+    // the frames carry their counter, which gives back the time they were handed to canWrite()
+    std::vector<double> writeTime(frames, 0.0);
+
+    double start = Time::now();
+    while ((written < frames) || (received < written))
+    {
+        if (written < frames)
+        {
+            unsigned int n = (frames - written < batch) ? (frames - written) : (batch);
+            unsigned int sent = 0;
+            for (unsigned int i=0; i<n; i++)
+            {
+                unsigned char *data = txBuffer[i].getData();
+                int counter = written + i;
+                data[0] = counter & 0xff;
+                data[1] = (counter >> 8) & 0xff;
+                data[2] = (counter >> 16) & 0xff;
+            }
+            double now = Time::now();
+            for (unsigned int i=0; i<n; i++)
+                writeTime[written + i] = now;
+            if (!writer.canWrite(txBuffer, n, &sent))
+                failures++;
+            written += sent;
+        }
+
+        unsigned int got = 0;
+        reader.canRead(rxBuffer, batch*4, &got, (written >= frames));
+        if ((got > 0) && reader.canGetRxTimestamps(stamps, got))
+        {
+            for (unsigned int i=0; i<got; i++)
+            {
+                const unsigned char *data = rxBuffer[i].getData();
+                int counter = data[0] | (data[1] << 8) | (data[2] << 16);
+                if ((rxBuffer[i].getLen() < 3) || (counter >= frames))
+                    continue;
+
+                double latency = stamps[i] - writeTime[counter];
+                latencySum += latency;
+                if (latency > latencyMax) latencyMax = latency;
+                latencyNum++;
+            }
+        }
+        received += got;
+
+        if ((written >= frames) && (got == 0))
+            break;
+    }
+    double elapsed = Time::now() - start;
+
+    printf("socketCanBench: %d frames written in batches of %d, %d received, %d failed writes\n", written, batch, received, failures);
+    printf("socketCanBench: %.3f s, %.0f frames/s\n", elapsed, received / elapsed);
+    if (latencyNum > 0)
+        printf("socketCanBench: latency from canWrite() to kernel rx: mean %.1f us, max %.1f us\n", 1000000.0 * latencySum / latencyNum, 1000000.0 * latencyMax);
+
+    delete [] stamps;
+    writer.destroyBuffer(txBuffer);
+    reader.destroyBuffer(rxBuffer);
+    writer.close();
+    reader.close();
+
+    return 0;
+}
@@ -39,6 +39,15 @@ static double getEpochTimeShift()
     return epoch - uptime;
 }
 
+// YUYV to RGB24 done by opencv, which splits the rows among its worker threads and, since opencv 4, uses its SIMD intrinsics.
+// the BT.601 rounding of opencv may differ by a unit or two from libv4lconvert. dst must hold width*height*3 bytes.
+static void yuyvToRgb(const unsigned char *src, unsigned char *dst, int width, int height, int stride)
+{
+    const cv::Mat yuyv(height, width, CV_8UC2, (void*) src, stride);
+    cv::Mat rgb(height, width, CV_8UC3, dst);
+    cv::cvtColor(yuyv, rgb, CV_YUV2RGB_YUYV);
+}
+
 
 #define NOT_PRESENT -1
 int V4L_camera::convertYARP_to_V4L(int feature)
@@ -82,6 +91,8 @@ V4L_camera::V4L_camera() : RateThread(1000/DEFAULT_FRAMERATE), doCropping(false)
     param.fd  = -1;
     param.image_size = 0;
     param.n_buffers = 0;
+    param.req_buffers = VIDIOC_REQBUFS_COUNT;
+    param.held_buffer = -1;
     param.dst_image = NULL;
     param.buffers = NULL;
     param.camModel = STANDARD_UVC;
@@ -89,6 +100,7 @@ V4L_camera::V4L_camera() : RateThread(1000/DEFAULT_FRAMERATE), doCropping(false)
     param.tmp_image= NULL;
     param.tmp_image2 = NULL;
     param.raw_image = NULL;
+    param.raw_image_size = 0;
     myCounter = 0;
     timeTot = 0;
 
@@ -341,6 +353,14 @@ bool V4L_camera::fromConfig(yarp::os::Searchable& config)
 
     param.flip=config.check("flip",Value("false")).asBool();
 
+    int buffers=config.check("buffers",Value(VIDIOC_REQBUFS_COUNT),"number of buffers in the queue of the driver").asInt();
+    if(buffers < 2)
+    {
+        yError() << "usbCamera: 'buffers' has to be at least 2, one of them is held for the conversion";
+        return false;
+    }
+    param.req_buffers = buffers;
+
 
 
     if(!config.check("camModel") )
@@ -794,6 +814,8 @@ bool V4L_camera::deviceUninit()
     
     if(param.buffers != 0)
         free(param.buffers);
+    param.buffers = NULL;
+    param.n_buffers = 0;
 
     if(param.dst_image != NULL)
     {
@@ -819,12 +841,10 @@ bool V4L_camera::deviceUninit()
         param.tmp_image2=NULL;
     }
 
-    if(param.raw_image != NULL)
-    {
-        free (param.raw_image);
-        param.raw_image=NULL;
-
-    }
+    // raw_image points into the buffers
+    param.raw_image = NULL;
+    param.raw_image_size = 0;
+    param.held_buffer = -1;
     return ret;
 }
 
@@ -856,7 +876,18 @@ bool V4L_camera::getRgbBuffer(unsigned char *buffer)
 {
     bool res=false;
     mutex.wait();
-    if(configured){
+    if(configured && param.raw_image == NULL)
+    {
+        // streaming, but no frame yet
+        mutex.post();
+        res=false;
+    }
+    else if(configured && convertsInPlace())
+    {
+        res=convertInPlace(buffer);
+        mutex.post();
+    }
+    else if(configured){
         imageProcess(param.raw_image);
     //     memcpy(buffer, param.dst_image, param.rgb_src_image_size*12/16);
     //     memcpy(buffer, param.tmp_image2, param.rgb_src_image_size*12/16);
@@ -884,7 +915,12 @@ bool V4L_camera::getRawBuffer(unsigned char *buffer)
 {
     bool res=false;
     mutex.wait();
-    if(configured)
+    if(configured && param.raw_image == NULL)
+    {
+        // streaming, but no frame yet
+        res=false;
+    }
+    else if(configured)
     {
         imageProcess(param.raw_image);
         switch(param.camModel)
@@ -1114,14 +1150,15 @@ void* V4L_camera::full_FrameRead(void)
 void* V4L_camera::frameRead()
 {
     struct v4l2_buffer buf;
-    unsigned int i;
     mutex.wait();
     
     switch (param.io) 
     {
         case IO_METHOD_READ:
+        {
             printf("IO_METHOD_READ\n");
-            if (-1 == v4l2_read(param.fd, param.buffers[0].start, param.buffers[0].length))
+            int n = v4l2_read(param.fd, param.buffers[0].start, param.buffers[0].length);
+            if (-1 == n)
             {
                 switch (errno) 
                 {
@@ -1138,100 +1175,85 @@ void* V4L_camera::frameRead()
                         mutex.post();
                         return NULL;
                 }
-                timeStamp.update(toEpochOffset + buf.timestamp.tv_sec + buf.timestamp.tv_usec/1000000.0);
             }
-            
-//             memcpy(param.raw_image, param.buffers[0].start, param.image_size);
-//             imageProcess(param.buffers[0].start);
-            break;
+            // no kernel timestamp with read i/o
+            param.raw_image = param.buffers[0].start;
+            param.raw_image_size = n;
+            timeStamp.update(yarp::os::Time::now());
+        } break;
 
 
-            case IO_METHOD_MMAP:
+        case IO_METHOD_MMAP:
+        case IO_METHOD_USERPTR:
+        {
+            // Dequeue up to the most recent frame: the older ones are given back to the driver
+            // straight away, so that the latency does not grow when the conversion is slower
+            // than the camera (the device is opened in non blocking mode).
+            bool got_it = false;
+            struct v4l2_buffer next;
+            for (;;)
             {
-//                 printf("IO_METHOD_MMAP\n");
-
-                CLEAR(buf);
-                
-                buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-                buf.memory = V4L2_MEMORY_MMAP;
+                CLEAR(next);
+                next.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+                next.memory = (param.io == IO_METHOD_MMAP) ? V4L2_MEMORY_MMAP : V4L2_MEMORY_USERPTR;
 
-                if (-1 == xioctl(param.fd, VIDIOC_DQBUF, &buf)) 
+                if (-1 == xioctl(param.fd, VIDIOC_DQBUF, &next))
                 {
-                    switch (errno) 
-                    {
-                        default:
-                            printf("\n ERROR: VIDIOC_DQBUF\n");
-                            mutex.post();
-                            return NULL;
-                    }
-                }
-                
-                if( !(buf.index < param.n_buffers) )
-                {
-                    yError() << "at line " << __LINE__;
+                    // no more frames ready
+                    if (errno == EAGAIN)
+                        break;
+
+                    // a real failure (e.g. the device is gone): the frame dequeued so far goes back
+                    printf("\n ERROR: VIDIOC_DQBUF %s\n", strerror(errno));
+                    if (got_it)
+                        requeueBuffer(buf.index);
                     mutex.post();
                     return NULL;
                 }
-                
 
-                memcpy(param.raw_image, param.buffers[buf.index].start, param.buffers[0].length); //param.image_size);
-//                 param.raw_image = param.buffers[buf.index].start;
-//                 imageProcess(param.raw_image);
-                timeStamp.update(toEpochOffset + buf.timestamp.tv_sec + buf.timestamp.tv_usec/1000000.0);
-
-                if (-1 == xioctl(param.fd, VIDIOC_QBUF, &buf))
+                if( !(next.index < param.n_buffers) ||
+                    ((param.io == IO_METHOD_USERPTR) && (next.m.userptr != (unsigned long)param.buffers[next.index].start)) )
                 {
-                    errno_exit("VIDIOC_QBUF");
+                    yError() << "at line " << __LINE__;
+                    // the buffer is out of the queue anyway: give it back, or the driver runs out of buffers
+                    if (next.index < param.n_buffers)
+                        requeueBuffer(next.index);
+                    if (got_it)
+                        requeueBuffer(buf.index);
                     mutex.post();
                     return NULL;
                 }
 
-            } break;
-            
-            case IO_METHOD_USERPTR:
-            {
-                printf("IO_METHOD_USERPTR\n");
-
-                CLEAR (buf);
-                
-                buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-                buf.memory = V4L2_MEMORY_USERPTR;
-                
-                if (-1 == xioctl(param.fd, VIDIOC_DQBUF, &buf)) 
+                // corrupted frame (e.g. a truncated jpeg), skip it
+                if (next.flags & V4L2_BUF_FLAG_ERROR)
                 {
-                    switch (errno) 
-                    {
-                        case EAGAIN:
-                            return 0;
-                            
-                        case EIO:
-                            // Could ignore EIO, see spec.
-                            // fall through
-                            
-                        default:
-                            errno_exit("VIDIOC_DQBUF");
-                    }
+                    requeueBuffer(next.index);
+                    continue;
                 }
-                
-                for (i = 0; i < param.n_buffers; ++i)
-                    if (buf.m.userptr == (unsigned long)param.buffers[i].start && buf.length == param.buffers[i].length)
-                        break;
-                    
-                    if(! (i < param.n_buffers) )
-                    {
-                        yError() << "at line " << __LINE__;
-                        mutex.post();
-                        return NULL;
-                    }
 
-                memcpy(param.raw_image, param.buffers[buf.index].start, param.image_size);
-//                 param.raw_image = (void*) buf.m.userptr;
-                timeStamp.update(toEpochOffset + buf.timestamp.tv_sec + buf.timestamp.tv_usec/1000000.0);
+                if (got_it)
+                    requeueBuffer(buf.index);
+                buf = next;
+                got_it = true;
+            }
 
+            if (!got_it)
+            {
+                mutex.post();
+                return NULL;
+            }
 
-                if (-1 == xioctl(param.fd, VIDIOC_QBUF, &buf))
-                    errno_exit("VIDIOC_QBUF");
-            }  break;
+            // The frame is converted straight from the buffer, which is held out of the queue until
+            // the next frame arrives; the previous one has been converted already and goes back.
+            if (param.held_buffer >= 0)
+                requeueBuffer(param.held_buffer);
+            param.held_buffer = buf.index;
+            param.raw_image = param.buffers[buf.index].start;
+            param.raw_image_size = buf.bytesused;
+
+            // time of the capture of the frame, taken by the kernel
+            timeStamp.update(toEpochOffset + buf.timestamp.tv_sec + buf.timestamp.tv_usec/1000000.0);
+        } break;
 
         default:
         {
@@ -1243,6 +1265,83 @@ void* V4L_camera::frameRead()
     return (void*) param.raw_image; //param.dst_image;
 }
 
+/**
+ *    give a dequeued buffer back to the driver
+ */
+bool V4L_camera::requeueBuffer(unsigned int index)
+{
+    struct v4l2_buffer buf;
+    CLEAR(buf);
+
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.index = index;
+    if (param.io == IO_METHOD_USERPTR)
+    {
+        buf.memory = V4L2_MEMORY_USERPTR;
+        buf.m.userptr = (unsigned long) param.buffers[index].start;
+        buf.length = param.buffers[index].length;
+    }
+    else
+        buf.memory = V4L2_MEMORY_MMAP;
+
+    if (-1 == xioctl(param.fd, VIDIOC_QBUF, &buf))
+    {
+        errno_exit("VIDIOC_QBUF");
+        return false;
+    }
+    return true;
+}
+
+/**
+ *   check if the frame can be converted into the output image without intermediate images
+ */
+bool V4L_camera::convertsInPlace() const
+{
+    return (param.camModel == STANDARD_UVC) && !doCropping &&
+           (param.pixelType == V4L2_PIX_FMT_RGB24) &&
+           (param.src_fmt.fmt.pix.width == param.width) &&
+           (param.src_fmt.fmt.pix.height == param.height);
+}
+
+/**
+ *   convert the frame read into the output image
+ */
+bool V4L_camera::convertInPlace(unsigned char *buffer)
+{
+    static int err=0;
+
+    const struct v4l2_pix_format &pix = param.src_fmt.fmt.pix;
+
+    if ((pix.pixelformat == V4L2_PIX_FMT_YUYV) && (param.raw_image_size >= pix.bytesperline * pix.height))
+    {
+        yuyvToRgb((const unsigned char*) param.raw_image, buffer, pix.width, pix.height, pix.bytesperline);
+    }
+    else
+    {
+        // mjpeg (decoded by libjpeg) and all the other formats
+        if( v4lconvert_convert((v4lconvert_data*) _v4lconvert_data,  &param.src_fmt,   &param.dst_fmt,
+                               (unsigned char *) param.raw_image, param.raw_image_size, buffer, param.width * param.height * 3)  <0 )
+        {
+            if((err %20) == 0)
+            {
+                printf("error converting \n"); fflush(stdout);
+                printf("Message is: %s", v4lconvert_get_error_message(_v4lconvert_data));
+                err=0;
+            }
+            err++;
+            return false;
+        }
+    }
+
+    if(param.flip)
+    {
+        // Flipping around y-axis
+        cv::Mat out(param.height, param.width, CV_8UC3, buffer);
+        cv::flip(out, out, 1);
+    }
+    return true;
+}
+
 /**
  *   process image read
  */
@@ -1312,7 +1411,7 @@ void V4L_camera::imageProcess(void* p, bool useRawData)
         {
 
             if( v4lconvert_convert((v4lconvert_data*) _v4lconvert_data,  &param.src_fmt,   &param.dst_fmt,
-                                                      (unsigned char *)p, param.image_size, param.tmp_image, param.rgb_src_image_size)  <0 )
+                                                      (unsigned char *)p, param.raw_image_size, param.tmp_image, param.rgb_src_image_size)  <0 )
             {
                 if((err %20) == 0)
                 {
@@ -1410,6 +1509,14 @@ void V4L_camera::captureStop()
             }
             break;
     }
+
+    // STREAMOFF dequeues all the buffers, the one held included
+    param.held_buffer = -1;
+    if(param.io != IO_METHOD_READ)
+    {
+        param.raw_image = NULL;
+        param.raw_image_size = 0;
+    }
 }
 
 /**
@@ -1420,6 +1527,10 @@ void V4L_camera::captureStart()
     unsigned int i;
     enum v4l2_buf_type type;
 
+    // the kernel stamps the buffers with the monotonic clock, update its offset from the epoch
+    toEpochOffset = getEpochTimeShift();
+    param.held_buffer = -1;
+
     switch (param.io)
     {
         case IO_METHOD_READ:
@@ -1499,7 +1610,7 @@ bool V4L_camera::mmapInit()
 {
     CLEAR(param.req);
 
-    param.n_buffers = VIDIOC_REQBUFS_COUNT;
+    param.n_buffers = param.req_buffers;
     param.req.count = param.n_buffers;
     param.req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     param.req.memory = V4L2_MEMORY_MMAP;
@@ -1560,8 +1671,8 @@ bool V4L_camera::mmapInit()
             errno_exit("mmap");
     }
 
-    param.raw_image = malloc(param.image_size);
-    yInfo() << "size is " << buf.length << " or " << param.image_size << param.raw_image;
+    // frames are converted straight from the mapped buffers, raw_image points to the last one
+    yInfo() << "size is " << buf.length << " or " << param.image_size;
 
     return true;
 }
@@ -1576,7 +1687,7 @@ bool V4L_camera::userptrInit(unsigned int buffer_size)
 
     CLEAR(param.req);
 
-    param.req.count = VIDIOC_REQBUFS_COUNT;
+    param.req.count = param.req_buffers;
     param.req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     param.req.memory = V4L2_MEMORY_USERPTR;
 
@@ -1594,7 +1705,7 @@ bool V4L_camera::userptrInit(unsigned int buffer_size)
         }
     }
 
-    param.buffers = (struct buffer *) calloc(4, sizeof(*(param.buffers)));
+    param.buffers = (struct buffer *) calloc(param.req.count, sizeof(*(param.buffers)));
 
     if (!param.buffers) 
     {
@@ -1602,7 +1713,7 @@ bool V4L_camera::userptrInit(unsigned int buffer_size)
         return false;
     }
 
-    for (param.n_buffers = 0; param.n_buffers < 4; ++param.n_buffers) 
+    for (param.n_buffers = 0; param.n_buffers < param.req.count; ++param.n_buffers) 
     {
         param.buffers[param.n_buffers].length = buffer_size;
         param.buffers[param.n_buffers].start = memalign(/* boundary */ page_size, buffer_size);
@@ -55,11 +55,11 @@
 
 #define CLEAR(x) memset (&(x), 0, sizeof (x))
 
-// minimum number of buffers to request in VIDIOC_REQBUFS call
 #define DEFAULT_WIDTH           640
 #define DEFAULT_HEIGHT          480
 #define DEFAULT_FRAMERATE       30
-#define VIDIOC_REQBUFS_COUNT    2
+// default number of buffers to request in VIDIOC_REQBUFS call (one of them is held for the conversion)
+#define VIDIOC_REQBUFS_COUNT    4
 
 namespace yarp {
     namespace dev {
@@ -99,16 +99,19 @@ typedef struct
     unsigned int    image_size;
     unsigned int    rgb_src_image_size;
     unsigned int    dst_image_size;
+    unsigned int    raw_image_size;     // bytes used by the frame in raw_image
     unsigned char   *dst_image;
     unsigned char   *tmp_image;
     unsigned char   *tmp_image2;
-    void            *raw_image;
+    void            *raw_image;         // last frame, in the buffer held out of the driver queue
     cv::Mat         outMat;
     cv::Mat         img;
     yarp::sig::VectorOf<yarp::dev::CameraConfig> configurations;
     bool            flip;
 
     unsigned int    n_buffers;
+    unsigned int    req_buffers;
+    int             held_buffer;        // index of the buffer of raw_image, -1 if none
     struct buffer   *buffers;
     struct v4l2_format src_fmt;
     struct v4l2_format dst_fmt;
@@ -281,6 +284,15 @@ private:
 
     void imageProcess(void* p, bool raw=false);
 
+    // true if the frame can be converted straight into the output image (no crop nor resize)
+    bool convertsInPlace() const;
+
+    // converts the last frame into buffer, with the size of the output image
+    bool convertInPlace(unsigned char *buffer);
+
+    // gives a dequeued buffer back to the driver
+    bool requeueBuffer(unsigned int index);
+
     int getfd();
 
 private:
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2016 iCub Facility - Istituto Italiano di Tecnologia
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+// Throughput of the serialization of skinContactList: a list of contacts is written and read back
+// (as a BufferedPort does) with the list of skinContact representation and with the compact one.
+// The same skinContactList is used for reading, as the content of a BufferedPort is.
+//
+// skinContactListBench [contacts] [taxelsPerContact] [iterations]
+// skinContactListBench 4 30 20000
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <yarp/os/Network.h>
+#include <yarp/os/Portable.h>
+#include <yarp/os/Time.h>
+#include <yarp/math/Math.h>
+#include "iCub/skinDynLib/skinContactList.h"
+
+using namespace std;
+using namespace yarp::os;
+using namespace yarp::sig;
+using namespace yarp::math;
+using namespace iCub::skinDynLib;
+
+static skinContactList makeContacts(int contacts, int taxels)
+{
+    skinContactList list;
+    for(int c=0; c<contacts; c++)
+    {
+        Vector CoP(3), geoCenter(3), normal(3), F(3);
+        for(int i=0; i<3; i++)
+        {
+            CoP[i]       = 0.01*(rand()%100);
+            geoCenter[i] = 0.01*(rand()%100);
+            normal[i]    = 0.1*(rand()%10);
+            F[i]         = 0.5*(rand()%10);
+        }
+        vector<unsigned int> taxelList(taxels);
+        for(int i=0; i<taxels; i++)
+            taxelList[i] = rand()%768;
+        skinContact sc(LEFT_ARM, SKIN_LEFT_FOREARM, 4, CoP, geoCenter, taxelList, rand()%100, normal);
+        sc.setForce(F);
+        list.push_back(sc);
+    }
+    return list;
+}
+
+// seconds per list written and read back
+static double copyLists(skinContactList &src, skinContactList &dst, int iterations, bool &ok)
+{
+    ok = true;
+    double t0 = Time::now();
+    for(int i=0; i<iterations; i++)
+        ok = Portable::copyPortable(src, dst) && ok;
+    return (Time::now()-t0)/iterations;
+}
+
+static bool sameContacts(const skinContactList &a, const skinContactList &b)
+{
+    if(a.size()!=b.size())
+        return false;
+    for(size_t i=0; i<a.size(); i++)
+        if(a[i].toString(6)!=b[i].toString(6) || a[i].getTaxelList()!=b[i].getTaxelList())
+            return false;
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    Network::init();
+    int contacts   = argc>1 ? atoi(argv[1]) : 4;
+    int taxels     = argc>2 ? atoi(argv[2]) : 30;
+    int iterations = argc>3 ? atoi(argv[3]) : 20000;
+    if(contacts<0 || taxels<0 || iterations<=0)
+    {
+        fprintf(stderr, "skinContactListBench: wrong arguments\n");
+        return 1;
+    }
+
+    skinContactList src = makeContacts(contacts, taxels), dst;
+    bool okList, okCompact;
+
+    src.setCompact(false);
+    double tList = copyLists(src, dst, iterations, okList);
+    okList = okList && sameContacts(src, dst);
+
+    src.setCompact(true);
+    double tCompact = copyLists(src, dst, iterations, okCompact);
+    okCompact = okCompact && sameContacts(src, dst);
+
+    printf("skinContactListBench: %d contacts of %d taxels, %d iterations\n", contacts, taxels, iterations);
+    printf("skinContactListBench: list of skinContact %.2f us (%s), compact %.2f us (%s), x%.1f\n",
+           1e6*tList, okList ? "ok" : "ERROR", 1e6*tCompact, okCompact ? "ok" : "ERROR",
+           tCompact>0.0 ? tList/tCompact : 0.0);
+
+    Network::fini();
+    return okList && okCompact ? 0 : 1;
+}
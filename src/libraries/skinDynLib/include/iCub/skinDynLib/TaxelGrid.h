@@ -0,0 +1,141 @@
+/**
+ * Copyright (C) 2016 iCub Facility, Istituto Italiano di Tecnologia
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ *
+ *
+ * This file contains the definition of a uniform grid over the positions of the taxels.
+ *
+ * \section intro_sec Description
+ *
+ * The points are bucketed in cubic cells and sorted by cell, so that a radius query visits only
+ * the cells that intersect the sphere instead of all the points. With cells as large as the
+ * radius of the queries, the neighbors of all the taxels are found in O(n) instead of O(n^2).
+ *
+ * \section tested_os_sec Tested OS
+ *
+ * Linux
+ *
+ **/
+
+#ifndef __TAXELGRID_H__
+#define __TAXELGRID_H__
+
+#include <vector>
+#include <utility>
+#include <yarp/sig/Vector.h>
+
+namespace iCub
+{
+namespace skinDynLib
+{
+
+/**
+* @ingroup skinDynLib
+*
+* Uniform grid spatial index over a set of 3D points (e.g. the positions of the taxels of a skin part).
+* The index of a point is its position in the vector given to build().
+*/
+class TaxelGrid
+{
+  protected:
+    struct Cell
+    {
+        long long key;
+        int       first;    // first point of the cell in sortedPoints
+        int       last;     // one past the last point
+        bool operator<(const Cell &c) const { return key<c.key; }
+    };
+
+    double              cellSize;
+    std::vector<double> xyz;            // coordinates of the points, 3 per point
+    std::vector<int>    sortedPoints;   // points sorted by cell
+    std::vector<Cell>   cells;          // non empty cells sorted by key
+
+    long long cellKey(long long cx, long long cy, long long cz) const;
+    long long cellCoord(double v) const;
+    bool outOfRange(long long c) const;
+    const Cell* findCell(long long key) const;
+
+  public:
+    /**
+    * Constructor: the index is empty
+    **/
+    TaxelGrid();
+
+    /**
+     * Builds the index
+     * @param positions are the positions of the points (3D, only the first 3 elements are used)
+     * @param cellSize is the edge of the cells; the best value is the radius of the queries
+     * @return false if cellSize is not positive
+     */
+    bool build(const std::vector<yarp::sig::Vector> &positions, double cellSize);
+
+    /**
+     * Builds the index
+     * @param xyz are the coordinates of the n points, 3 per point
+     * @param n is the number of points
+     * @param cellSize is the edge of the cells; the best value is the radius of the queries
+     * @return false if cellSize is not positive
+     */
+    bool build(const double *xyz, unsigned int n, double cellSize);
+
+    /**
+     * Moves a point to a new position, updating only the cells it leaves and enters
+     * @param i is the index of the point
+     * @param p is the new position (3D)
+     * @return false if i is not a point of the index
+     */
+    bool move(unsigned int i, const double *p);
+    bool move(unsigned int i, const yarp::sig::Vector &p);
+
+    /**
+     * Removes all the points
+     */
+    void clear();
+
+    /**
+     * Gets the number of points in the index
+     */
+    unsigned int size() const { return xyz.size()/3; }
+
+    /**
+     * Finds the points within a distance from p (bounds included)
+     * @param p is the center of the query (3D)
+     * @param radius is the max distance
+     * @param result are the indices of the points found (it is cleared first)
+     * @param exclude is a point not to report (e.g. the taxel whose neighbors are searched), -1 for none
+     */
+    void radiusQuery(const double *p, double radius, std::vector<int> &result, int exclude=-1) const;
+    void radiusQuery(const yarp::sig::Vector &p, double radius, std::vector<int> &result, int exclude=-1) const;
+
+    /**
+     * Finds the point closest to p
+     * @param p is the center of the query (3D)
+     * @param maxDist is the max distance of the point
+     * @return the index of the point, -1 if there is no point within maxDist
+     */
+    int nearest(const double *p, double maxDist) const;
+    int nearest(const yarp::sig::Vector &p, double maxDist) const;
+
+    /**
+     * Finds all the pairs of points within a distance (bounds included)
+     * @param radius is the max distance
+     * @param pairs are the pairs (i, j) with i<j, it is cleared first
+     */
+    void radiusPairs(double radius, std::vector< std::pair<int,int> > &pairs) const;
+};
+
+}
+}
+
+#endif
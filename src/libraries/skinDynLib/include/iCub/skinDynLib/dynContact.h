@@ -84,6 +84,14 @@ protected:
         const yarp::sig::Vector &_Mu=yarp::sig::Vector(0), const yarp::sig::Vector &_Fdir=yarp::sig::Vector(0));
     bool checkVectorDim(const yarp::sig::Vector &v, unsigned int dim, const std::string &descr="");
 
+    // fields of the compact representation, in network byte order (little endian)
+    static char*        packInt(char *buf, int v);
+    static char*        packDouble(char *buf, double v);
+    static char*        packVector3(char *buf, const yarp::sig::Vector &v);
+    static const char*  unpackInt(const char *buf, int &v);
+    static const char*  unpackDouble(const char *buf, double &v);
+    static const char*  unpackVector3(const char *buf, yarp::sig::Vector &v);
+
 public:
     //~~~~~~~~~~~~~~~~~~~~~~
     //   CONSTRUCTORS
@@ -308,6 +316,25 @@ public:
     */
     virtual bool write(yarp::os::ConnectionWriter& connection);
 
+    /**
+    * Get the size in bytes of the compact representation of this contact (see writeCompact()).
+    */
+    virtual size_t getCompactSize() const;
+    /**
+    * Write this contact in a compact binary representation with a fixed layout:
+    * contactId, bodyPart, linkNumber (3 int32), CoP, force, moment (9 float64).
+    * @param buf the buffer to write to, of at least getCompactSize() bytes
+    * @return a pointer to the first byte after the contact
+    */
+    virtual char* writeCompact(char *buf) const;
+    /**
+    * Read this contact from its compact binary representation (see writeCompact()).
+    * No memory is allocated.
+    * @param buf the buffer to read from
+    * @param end the end of the buffer
+    * @return a pointer to the first byte after the contact, NULL if the buffer is too short
+    */
+    virtual const char* readCompact(const char *buf, const char *end);
     
     /**
      * Convert this contact into a string. Useful to print some information.
@@ -62,6 +62,10 @@ protected:
     unsigned int activeTaxels;
     // list of active taxel ids
     std::vector<unsigned int> taxelList;
+
+    // read the fields of the skinContact that follow the list tag (used by skinContactList::read)
+    bool readFields(yarp::os::ConnectionReader& connection);
+    friend class skinContactList;
     
 public:
     //~~~~~~~~~~~~~~~~~~~~~~
@@ -255,6 +259,30 @@ public:
     */
     virtual bool write(yarp::os::ConnectionWriter& connection);
 
+    /**
+    * Get the size in bytes of the compact representation of this skinContact (see writeCompact()).
+    */
+    virtual size_t getCompactSize() const;
+
+    /**
+    * Write this skinContact in a compact binary representation with a fixed layout:
+    * the compact representation of the dynContact, followed by
+    * skinPart, number of active taxels N (2 int32), geometric center, normal direction, pressure (7 float64),
+    * active taxel ids (N int32).
+    * @param buf the buffer to write to, of at least getCompactSize() bytes
+    * @return a pointer to the first byte after the skinContact
+    */
+    virtual char* writeCompact(char *buf) const;
+
+    /**
+    * Read this skinContact from its compact binary representation (see writeCompact()).
+    * No memory is allocated if the taxel list has already had this size.
+    * @param buf the buffer to read from
+    * @param end the end of the buffer
+    * @return a pointer to the first byte after the skinContact, NULL if the data are not valid
+    */
+    virtual const char* readCompact(const char *buf, const char *end);
+
     /**
     * Convert this skinContact to a vector. The size of the vector is 21 plus
     * the number of active taxels. The vector contains this data, in this order:
@@ -28,9 +28,13 @@
 #include <vector>
 #include <map>
 #include <yarp/os/Portable.h>
+#include <yarp/os/Vocab.h>
 #include "iCub/skinDynLib/skinContact.h"
 #include "iCub/skinDynLib/dynContactList.h"
 
+// first element of a skinContactList in the compact representation
+#define VOCAB_SKIN_CONTACTS_COMPACT VOCAB4('s','c','l','c')
+
 namespace iCub
 {
 namespace skinDynLib
@@ -44,6 +48,11 @@ namespace skinDynLib
 class skinContactList  : public std::vector<skinContact>, public yarp::os::Portable
 {
 protected:
+    bool compact;                       // if true the list is written in the compact representation
+    std::vector<char> compactBuffer;    // buffer of the compact representation, reused by read and write
+
+    bool readCompact(yarp::os::ConnectionReader& connection);
+    bool writeCompact(yarp::os::ConnectionWriter& connection);
     
 public:
     //~~~~~~~~~~~~~~~~~~~~~~
@@ -74,7 +83,9 @@ public:
     //   SERIALIZATION methods
     //~~~~~~~~~~~~~~~~~~~~~~~~~
     /*
-    * Read skinContactList from a connection.
+    * Read skinContactList from a connection. Both the list of skinContact and the compact representation
+    * (see setCompact()) are accepted. The contacts already in the list are overwritten, so if the number
+    * of contacts and of their taxels does not grow no memory is allocated by the compact representation.
     * return true iff a skinContactList was read correctly
     */
     virtual bool read(yarp::os::ConnectionReader& connection);
@@ -85,6 +96,20 @@ public:
     */
     virtual bool write(yarp::os::ConnectionWriter& connection);
 
+    /**
+    * Select the representation used by write(). The default one is a list of skinContact (see skinContact::write()).
+    * The compact one is a list of 2 elements, the vocab VOCAB_SKIN_CONTACTS_COMPACT and a blob containing the number
+    * of contacts (int32) followed by the compact representation of every contact (see skinContact::writeCompact()).
+    * It is much faster to write and to read, but it cannot be interpreted by readers that are not skinContactList.
+    * @param _compact true to write the compact representation
+    */
+    void setCompact(bool _compact){ compact = _compact; }
+
+    /**
+    * @return true if the list is written in the compact representation
+    */
+    bool isCompact() const { return compact; }
+
     /**
      * Convert this skinContactList to a dynContactList casting all its elements
      * to dynContact.
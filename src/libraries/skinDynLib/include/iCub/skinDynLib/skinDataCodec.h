@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2016 iCub Facility, Istituto Italiano di Tecnologia
+ * CopyPolicy: Released under the terms of the GNU GPL v2.0.
+ *
+ */
+
+/**
+ * Encoder and decoder of the compact skin data stream.
+ *
+ * \section intro_sec Description
+ *
+ * The skin ports stream a yarp::sig::Vector of doubles, 8 bytes for every taxel even though the
+ * value of a taxel fits in a byte and most of the taxels do not change between two readings.
+ * The compact stream sends the taxels as bytes and, between two keyframes, only the runs of
+ * taxels whose value changed.
+ *
+ * Every message is a Bottle (vocab skcp) (int seq) (int type) (int taxels) (blob payload):
+ * - seq is incremented at every message (wrapping around, it is unsigned) so that the decoder detects the lost messages;
+ * - a keyframe (type 0) carries all the taxels as a sequence of (varint length, byte value) runs;
+ * - a delta (type 1) carries a sequence of (varint unchanged, varint changed, changed bytes) with
+ *   respect to the previous message; the trailing unchanged taxels are omitted.
+ * The varints are little endian base 128 (7 bits per byte, the msb set in all the bytes but the last).
+ *
+ * A decoder which connects to a stream, or loses a message, waits for the next keyframe.
+ *
+ * Copyright (C) 2016 iCub Facility, Istituto Italiano di Tecnologia
+ * CopyPolicy: Released under the terms of the GNU GPL v2.0.
+ *
+ **/
+
+#ifndef __SKINDATACODEC_H__
+#define __SKINDATACODEC_H__
+
+#include <vector>
+#include <yarp/os/Bottle.h>
+#include <yarp/os/Vocab.h>
+#include <yarp/sig/Vector.h>
+
+/** Vocab at the head of every message of the compact skin stream. */
+#define VOCAB_SKIN_COMPACT  VOCAB4('s','k','c','p')
+
+/** Suffix added to the name of a skin port to get the name of its compact stream. */
+#define SKIN_COMPACT_PORT_SUFFIX    "/compact"
+
+namespace iCub
+{
+namespace skinDynLib
+{
+
+/**
+* @ingroup skinDynLib
+*
+* Encoder of the compact skin stream. It keeps the last values sent to compute the deltas.
+*/
+class skinDataEncoder
+{
+protected:
+    std::vector<unsigned char> last;        // values of the last message
+    std::vector<unsigned char> current;
+    std::vector<unsigned char> payload;
+    unsigned int keyframePeriod;
+    unsigned int sinceKeyframe;
+    bool keyframeRequested;
+    unsigned int seq;
+
+public:
+    /**
+    * @param keyframePeriod a keyframe is sent every keyframePeriod messages (0: only the first one)
+    */
+    skinDataEncoder(unsigned int keyframePeriod=50);
+
+    void setKeyframePeriod(unsigned int period){ keyframePeriod = period; }
+    unsigned int getKeyframePeriod() const { return keyframePeriod; }
+
+    /**
+    * The next message will be a keyframe.
+    */
+    void forceKeyframe(){ keyframeRequested = true; }
+
+    /**
+    * Encode the taxels in a message. The values are rounded and saturated to [0, 255].
+    * @param taxels the values of the taxels
+    * @param msg the message, it is cleared first
+    * @return the number of bytes of the payload
+    */
+    size_t encode(const yarp::sig::Vector &taxels, yarp::os::Bottle &msg);
+};
+
+/**
+* @ingroup skinDynLib
+*
+* Decoder of the compact skin stream. It keeps the values of the taxels, on which the deltas are applied.
+*/
+class skinDataDecoder
+{
+protected:
+    std::vector<unsigned char> taxels;
+    bool synchronized;
+    unsigned int lastSeq;
+    unsigned int lostMessages;
+
+    bool decodeKeyframe(const unsigned char *data, size_t len, size_t n);
+    bool decodeDelta(const unsigned char *data, size_t len);
+
+public:
+    skinDataDecoder();
+
+    /**
+    * Forget the state: the decoder waits for the next keyframe.
+    */
+    void reset();
+
+    /**
+    * Check whether a message belongs to the compact skin stream.
+    */
+    static bool isCompact(const yarp::os::Bottle &msg);
+
+    /**
+    * Decode a message.
+    * @param msg the message
+    * @param values the values of the taxels, resized to the number of taxels
+    * @return false if the message is malformed or if the decoder is waiting for a keyframe,
+    *         in this case values is not modified
+    */
+    bool decode(const yarp::os::Bottle &msg, yarp::sig::Vector &values);
+
+    /**
+    * Decode a message without converting the values to double. See getTaxels().
+    */
+    bool decode(const yarp::os::Bottle &msg);
+
+    /**
+    * The values of the taxels after the last message decoded.
+    */
+    const std::vector<unsigned char>& getTaxels() const { return taxels; }
+
+    bool isSynchronized() const { return synchronized; }
+
+    /**
+    * Number of messages lost (detected from the gaps in the sequence numbers) since the construction.
+    */
+    unsigned int getLostMessages() const { return lostMessages; }
+};
+
+}//end namespace skinDynLib
+}//end namespace iCub
+
+#endif
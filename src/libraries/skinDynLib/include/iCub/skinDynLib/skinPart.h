@@ -33,6 +33,7 @@
 #define __SKINPART_H__
 
 #include "iCub/skinDynLib/Taxel.h"
+#include "iCub/skinDynLib/TaxelGrid.h"
 #include "iCub/skinDynLib/common.h"
 
 #include <yarp/os/RFModule.h>
@@ -187,6 +188,11 @@ class skinPart : public skinPartBase
      */
     bool mapTaxelsOntoThemselves();
 
+    /**
+    * Spatial index over the positions of the taxels (the index of a point is its position in the taxels vector)
+    **/
+    TaxelGrid taxelGrid;
+
   public:
     /**
      * Constructor
@@ -241,6 +247,30 @@ class skinPart : public skinPartBase
      */
     void clearTaxels();
 
+    /**
+     * Builds the spatial index over the positions of the taxels. It is done by setTaxelPosesFromFile(),
+     * and it has to be done again if the taxels vector or the positions of the taxels are changed.
+     * @param  cellSize is the edge of the cells of the index; the best value is the radius of the queries
+     * @return true/false in case of success/failure
+     */
+    bool buildSpatialIndex(double cellSize=0.01);
+
+    /**
+     * Finds the taxels within a distance from a point, using the spatial index
+     * @param  pos is the position of the point, in the same reference frame as the positions of the taxels
+     * @param  radius is the max distance from pos
+     * @return the IDs of the taxels found
+     */
+    std::vector<int> getTaxelsWithinRadius(const yarp::sig::Vector &pos, double radius);
+
+    /**
+     * Finds the taxel closest to a point (e.g. the center of a contact), using the spatial index
+     * @param  pos is the position of the point, in the same reference frame as the positions of the taxels
+     * @param  maxDist is the max distance of the taxel from pos
+     * @return the ID of the taxel, -1 if there is no taxel within maxDist
+     */
+    int getClosestTaxel(const yarp::sig::Vector &pos, double maxDist);
+
     /**
     * Print Method
     * @param verbosity is the verbosity level
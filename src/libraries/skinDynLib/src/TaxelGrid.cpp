@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2016 iCub Facility - Istituto Italiano di Tecnologia
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "iCub/skinDynLib/TaxelGrid.h"
+
+using namespace std;
+using namespace iCub::skinDynLib;
+
+// every cell coordinate is stored in 21 bits of the key
+#define CELL_BITS   21
+#define CELL_OFFSET (1LL<<(CELL_BITS-1))
+#define CELL_MASK   ((1LL<<CELL_BITS)-1)
+
+TaxelGrid::TaxelGrid(): cellSize(1.0) {}
+
+long long TaxelGrid::cellKey(long long cx, long long cy, long long cz) const
+{
+    return (((cx+CELL_OFFSET)&CELL_MASK)<<(2*CELL_BITS)) |
+           (((cy+CELL_OFFSET)&CELL_MASK)<<CELL_BITS) |
+            ((cz+CELL_OFFSET)&CELL_MASK);
+}
+
+long long TaxelGrid::cellCoord(double v) const
+{
+    double c = floor(v/cellSize);
+    if(c < -(double)CELL_OFFSET)
+        return -CELL_OFFSET;
+    if(c > (double)(CELL_OFFSET-1))
+        return CELL_OFFSET-1;
+    return (long long)c;
+}
+
+bool TaxelGrid::outOfRange(long long c) const
+{
+    return c < -CELL_OFFSET || c > CELL_OFFSET-1;
+}
+
+const TaxelGrid::Cell* TaxelGrid::findCell(long long key) const
+{
+    Cell c;
+    c.key = key;
+    vector<Cell>::const_iterator it = lower_bound(cells.begin(), cells.end(), c);
+    if(it==cells.end() || it->key!=key)
+        return 0;
+    return &(*it);
+}
+
+bool TaxelGrid::build(const vector<yarp::sig::Vector> &positions, double _cellSize)
+{
+    vector<double> p(3*positions.size(), 0.0);
+    for(size_t i=0; i<positions.size(); i++)
+        for(size_t k=0; k<3 && k<positions[i].size(); k++)
+            p[3*i+k] = positions[i][k];
+    return build(p.empty() ? 0 : &p[0], positions.size(), _cellSize);
+}
+
+bool TaxelGrid::build(const double *_xyz, unsigned int n, double _cellSize)
+{
+    clear();
+    if(!(_cellSize>0.0))
+        return false;
+    cellSize = _cellSize;
+    xyz.assign(_xyz, _xyz+3*n);
+
+    // sort the points by cell, then store the range of every non empty cell
+    vector< pair<long long,int> > keys(n);
+    for(unsigned int i=0; i<n; i++)
+        keys[i] = make_pair(cellKey(cellCoord(xyz[3*i]), cellCoord(xyz[3*i+1]), cellCoord(xyz[3*i+2])), (int)i);
+    sort(keys.begin(), keys.end());
+
+    sortedPoints.resize(n);
+    for(unsigned int i=0; i<n; i++){
+        sortedPoints[i] = keys[i].second;
+        if(i==0 || keys[i].first!=keys[i-1].first){
+            Cell c;
+            c.key = keys[i].first;
+            c.first = i;
+            c.last = i+1;
+            cells.push_back(c);
+        }
+        else
+            cells.back().last = i+1;
+    }
+    return true;
+}
+
+bool TaxelGrid::move(unsigned int i, const double *p)
+{
+    if(i>=size())
+        return false;
+    double *q = &xyz[3*i];
+    long long oldKey = cellKey(cellCoord(q[0]), cellCoord(q[1]), cellCoord(q[2]));
+    long long newKey = cellKey(cellCoord(p[0]), cellCoord(p[1]), cellCoord(p[2]));
+    q[0] = p[0];
+    q[1] = p[1];
+    q[2] = p[2];
+    if(newKey==oldKey)
+        return true;
+
+    // the point is taken out of its cell, which is removed if it becomes empty...
+    Cell c;
+    c.key = oldKey;
+    vector<Cell>::iterator a = lower_bound(cells.begin(), cells.end(), c);
+    sortedPoints.erase(find(sortedPoints.begin()+a->first, sortedPoints.begin()+a->last, (int)i));
+    a->last--;
+    for(vector<Cell>::iterator it=a+1; it!=cells.end(); it++){
+        it->first--;
+        it->last--;
+    }
+    if(a->first==a->last)
+        cells.erase(a);
+
+    // ...and put in the new cell, in the same order as build() would
+    c.key = newKey;
+    vector<Cell>::iterator b = lower_bound(cells.begin(), cells.end(), c);
+    if(b==cells.end() || b->key!=newKey){
+        c.first = c.last = b==cells.end() ? (int)sortedPoints.size() : b->first;
+        b = cells.insert(b, c);
+    }
+    sortedPoints.insert(lower_bound(sortedPoints.begin()+b->first, sortedPoints.begin()+b->last, (int)i), (int)i);
+    b->last++;
+    for(vector<Cell>::iterator it=b+1; it!=cells.end(); it++){
+        it->first++;
+        it->last++;
+    }
+    return true;
+}
+
+bool TaxelGrid::move(unsigned int i, const yarp::sig::Vector &p)
+{
+    double q[3] = { 0.0, 0.0, 0.0 };
+    for(size_t k=0; k<3 && k<p.size(); k++)
+        q[k] = p[k];
+    return move(i, q);
+}
+
+void TaxelGrid::clear()
+{
+    xyz.clear();
+    sortedPoints.clear();
+    cells.clear();
+}
+
+void TaxelGrid::radiusQuery(const double *p, double radius, vector<int> &result, int exclude) const
+{
+    result.clear();
+    if(xyz.empty() || radius<0.0)
+        return;
+    double r2 = radius*radius;
+
+    long long lo[3], hi[3];
+    double cellsInRange = 1.0;
+    for(int k=0; k<3; k++){
+        lo[k] = cellCoord(p[k]-radius);
+        hi[k] = cellCoord(p[k]+radius);
+        cellsInRange *= (double)(hi[k]-lo[k]+1);
+    }
+
+    // a radius much larger than the cells would visit more empty cells than points
+    if(cellsInRange > (double)cells.size()){
+        for(unsigned int i=0; i<size(); i++){
+            const double *q = &xyz[3*i];
+            double dx=q[0]-p[0], dy=q[1]-p[1], dz=q[2]-p[2];
+            if((int)i!=exclude && dx*dx+dy*dy+dz*dz<=r2)
+                result.push_back(i);
+        }
+        return;
+    }
+
+    for(long long cx=lo[0]; cx<=hi[0]; cx++)
+        for(long long cy=lo[1]; cy<=hi[1]; cy++)
+            for(long long cz=lo[2]; cz<=hi[2]; cz++){
+                const Cell *c = findCell(cellKey(cx, cy, cz));
+                if(c==0)
+                    continue;
+                for(int s=c->first; s<c->last; s++){
+                    int i = sortedPoints[s];
+                    const double *q = &xyz[3*i];
+                    double dx=q[0]-p[0], dy=q[1]-p[1], dz=q[2]-p[2];
+                    if(i!=exclude && dx*dx+dy*dy+dz*dz<=r2)
+                        result.push_back(i);
+                }
+            }
+}
+
+void TaxelGrid::radiusQuery(const yarp::sig::Vector &p, double radius, vector<int> &result, int exclude) const
+{
+    double q[3] = { 0.0, 0.0, 0.0 };
+    for(size_t k=0; k<3 && k<p.size(); k++)
+        q[k] = p[k];
+    radiusQuery(q, radius, result, exclude);
+}
+
+int TaxelGrid::nearest(const double *p, double maxDist) const
+{
+    vector<int> candidates;
+    radiusQuery(p, maxDist, candidates);
+
+    int best = -1;
+    double bestD2 = 0.0;
+    for(size_t k=0; k<candidates.size(); k++){
+        const double *q = &xyz[3*candidates[k]];
+        double dx=q[0]-p[0], dy=q[1]-p[1], dz=q[2]-p[2];
+        double d2 = dx*dx+dy*dy+dz*dz;
+        if(best<0 || d2<bestD2 || (d2==bestD2 && candidates[k]<best)){
+            best = candidates[k];
+            bestD2 = d2;
+        }
+    }
+    return best;
+}
+
+int TaxelGrid::nearest(const yarp::sig::Vector &p, double maxDist) const
+{
+    double q[3] = { 0.0, 0.0, 0.0 };
+    for(size_t k=0; k<3 && k<p.size(); k++)
+        q[k] = p[k];
+    return nearest(q, maxDist);
+}
+
+void TaxelGrid::radiusPairs(double radius, vector< pair<int,int> > &pairs) const
+{
+    pairs.clear();
+    if(xyz.empty() || radius<0.0)
+        return;
+    double r2 = radius*radius;
+
+    // every pair of cells is visited once: the points of a cell are compared with each other and with the
+    // points of the cells that come after it (half of the neighboring cells), so no distance is computed twice
+    long long range = (long long)ceil(radius/cellSize);
+    for(size_t a=0; a<cells.size(); a++){
+        const Cell &ca = cells[a];
+        long long ax = ((ca.key>>(2*CELL_BITS))&CELL_MASK) - CELL_OFFSET;
+        long long ay = ((ca.key>>CELL_BITS)&CELL_MASK) - CELL_OFFSET;
+        long long az = (ca.key&CELL_MASK) - CELL_OFFSET;
+        for(long long dx=-range; dx<=range; dx++)
+            for(long long dy=-range; dy<=range; dy++)
+                for(long long dz=-range; dz<=range; dz++){
+                    if(outOfRange(ax+dx) || outOfRange(ay+dy) || outOfRange(az+dz))
+                        continue;
+                    long long key = cellKey(ax+dx, ay+dy, az+dz);
+                    if(key<ca.key)
+                        continue;
+                    const Cell *cb = key==ca.key ? &ca : findCell(key);
+                    if(cb==0)
+                        continue;
+                    for(int sa=ca.first; sa<ca.last; sa++){
+                        int i = sortedPoints[sa];
+                        const double *p = &xyz[3*i];
+                        for(int sb = cb==&ca ? sa+1 : cb->first; sb<cb->last; sb++){
+                            int j = sortedPoints[sb];
+                            const double *q = &xyz[3*j];
+                            double ex=q[0]-p[0], ey=q[1]-p[1], ez=q[2]-p[2];
+                            if(ex*ex+ey*ey+ez*ez<=r2)
+                                pairs.push_back(i<j ? make_pair(i, j) : make_pair(j, i));
+                        }
+                    }
+                }
+    }
+
+    // same order as comparing all the pairs (i, j) with i<j: counting sort on i, then every row is sorted on j
+    vector<int> rowStart(size()+1, 0);
+    for(size_t k=0; k<pairs.size(); k++)
+        rowStart[pairs[k].first+1]++;
+    for(unsigned int i=0; i<size(); i++)
+        rowStart[i+1] += rowStart[i];
+    vector< pair<int,int> > sorted(pairs.size());
+    vector<int> next(rowStart.begin(), rowStart.end()-1);
+    for(size_t k=0; k<pairs.size(); k++)
+        sorted[next[pairs[k].first]++] = pairs[k];
+    for(unsigned int i=0; i<size(); i++)
+        sort(sorted.begin()+rowStart[i], sorted.begin()+rowStart[i+1]);
+    pairs.swap(sorted);
+}
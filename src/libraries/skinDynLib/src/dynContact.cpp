@@ -11,6 +11,11 @@
 #include <string>
 #include "stdio.h"
 
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <yarp/os/NetInt32.h>
+#include <yarp/os/NetFloat64.h>
 #include <yarp/math/Math.h>
 #include "iCub/skinDynLib/dynContact.h"
 #include <iCub/ctrl/math.h>
@@ -258,6 +263,83 @@ bool dynContact::read(ConnectionReader& connection){
     return !connection.isError();
 }
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+size_t dynContact::getCompactSize() const{
+    return 3*sizeof(NetInt32) + 9*sizeof(NetFloat64);
+}
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+char* dynContact::writeCompact(char *buf) const{
+    buf = packInt(buf, contactId);
+    buf = packInt(buf, bodyPart);
+    buf = packInt(buf, linkNumber);
+    buf = packVector3(buf, CoP);
+    buf = packVector3(buf, F);
+    buf = packVector3(buf, Mu);
+    return buf;
+}
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+const char* dynContact::readCompact(const char *buf, const char *end){
+    if(buf==NULL || end-buf < (ptrdiff_t)dynContact::getCompactSize())
+        return NULL;
+    int id, bp, link;
+    buf = unpackInt(buf, id);
+    buf = unpackInt(buf, bp);
+    buf = unpackInt(buf, link);
+    contactId   = id;
+    bodyPart    = (BodyPart)bp;
+    linkNumber  = link;
+    buf = unpackVector3(buf, CoP);
+    buf = unpackVector3(buf, F);
+    buf = unpackVector3(buf, Mu);
+    // same as setForce(F), without temporary vectors
+    Fmodule = sqrt(F[0]*F[0] + F[1]*F[1] + F[2]*F[2]);
+    if(Fmodule!=0.0){
+        if(Fdir.size()!=3)
+            Fdir.resize(3);
+        for(int i=0;i<3;i++) Fdir[i] = F[i]/Fmodule;
+    }
+    return buf;
+}
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+char* dynContact::packInt(char *buf, int v){
+    NetInt32 n = v;
+    memcpy(buf, &n, sizeof(n));
+    return buf+sizeof(n);
+}
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+char* dynContact::packDouble(char *buf, double v){
+    NetFloat64 n = v;
+    memcpy(buf, &n, sizeof(n));
+    return buf+sizeof(n);
+}
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+char* dynContact::packVector3(char *buf, const Vector &v){
+    for(int i=0;i<3;i++)
+        buf = packDouble(buf, i<(int)v.size() ? v[i] : 0.0);
+    return buf;
+}
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+const char* dynContact::unpackInt(const char *buf, int &v){
+    NetInt32 n;
+    memcpy(&n, buf, sizeof(n));
+    v = n;
+    return buf+sizeof(n);
+}
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+const char* dynContact::unpackDouble(const char *buf, double &v){
+    NetFloat64 n;
+    memcpy(&n, buf, sizeof(n));
+    v = n;
+    return buf+sizeof(n);
+}
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+const char* dynContact::unpackVector3(const char *buf, Vector &v){
+    if(v.size()!=3)
+        v.resize(3);
+    for(int i=0;i<3;i++)
+        buf = unpackDouble(buf, v[i]);
+    return buf;
+}
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 string dynContact::toString(int precision) const{
     stringstream res;
     res<< "Contact id: "<< contactId<< ", Body part: "<< BodyPart_s[bodyPart]<< ", link: "<< linkNumber<< ", CoP: "<< 
@@ -8,6 +8,9 @@
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <cstddef>
+#include <yarp/os/NetInt32.h>
+#include <yarp/os/NetFloat64.h>
 #include <yarp/math/Math.h>
 #include "iCub/skinDynLib/skinContact.h"
 
@@ -153,6 +156,12 @@ bool skinContact::read(ConnectionReader& connection){
     // auto-convert text mode interaction
     connection.convertTextMode();
 
+    if(connection.expectInt() != BOTTLE_TAG_LIST)
+        return false;
+    return readFields(connection);
+}
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+bool skinContact::readFields(ConnectionReader& connection){
     // represent a skinContact as a list of 8 elements that are:
     // - a list of 4 int, i.e. contactId, bodyPart, linkNumber, skinPart
     // - a list of 3 double, i.e. the CoP
@@ -162,7 +171,7 @@ bool skinContact::read(ConnectionReader& connection){
     // - a list of 3 double, i.e. the normal direction
     // - a list of N int, i.e. the active taxel ids
     // - a double, i.e. the pressure
-    if(connection.expectInt() != BOTTLE_TAG_LIST || connection.expectInt() != 8)
+    if(connection.expectInt() != 8)
         return false;
 
     // - a list of 4 int, i.e. contactId, bodyPart, linkNumber, skinPart
@@ -214,6 +223,45 @@ bool skinContact::read(ConnectionReader& connection){
     return !connection.isError();
 }
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+size_t skinContact::getCompactSize() const{
+    return dynContact::getCompactSize() + (2+activeTaxels)*sizeof(NetInt32) + 7*sizeof(NetFloat64);
+}
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+char* skinContact::writeCompact(char *buf) const{
+    buf = dynContact::writeCompact(buf);
+    buf = packInt(buf, skinPart);
+    buf = packInt(buf, activeTaxels);
+    buf = packVector3(buf, geoCenter);
+    buf = packVector3(buf, normalDir);
+    buf = packDouble(buf, pressure);
+    for(unsigned int i=0;i<activeTaxels;i++)
+        buf = packInt(buf, i<taxelList.size() ? taxelList[i] : 0);
+    return buf;
+}
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+const char* skinContact::readCompact(const char *buf, const char *end){
+    buf = dynContact::readCompact(buf, end);
+    if(buf==NULL || end-buf < (ptrdiff_t)(2*sizeof(NetInt32) + 7*sizeof(NetFloat64)))
+        return NULL;
+    int sp, n;
+    buf = unpackInt(buf, sp);
+    buf = unpackInt(buf, n);
+    if(n<0 || end-buf < (ptrdiff_t)(7*sizeof(NetFloat64) + n*sizeof(NetInt32)))
+        return NULL;
+    skinPart        = (SkinPart)sp;
+    activeTaxels    = n;
+    buf = unpackVector3(buf, geoCenter);
+    buf = unpackVector3(buf, normalDir);
+    buf = unpackDouble(buf, pressure);
+    taxelList.resize(activeTaxels);
+    for(unsigned int i=0;i<activeTaxels;i++){
+        int id;
+        buf = unpackInt(buf, id);
+        taxelList[i] = id;
+    }
+    return buf;
+}
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 Vector skinContact::toVector() const{
     Vector v(activeTaxels+21);
     unsigned int index = 0;
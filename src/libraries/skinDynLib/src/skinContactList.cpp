@@ -9,7 +9,10 @@
 #include <sstream>
 #include <iomanip>
 #include <string>
+#include <cstring>
 
+#include <yarp/os/NetInt32.h>
+#include <yarp/os/NetFloat64.h>
 #include "iCub/skinDynLib/skinContactList.h"
 #include <iCub/ctrl/math.h>
 
@@ -17,15 +20,18 @@ using namespace std;
 using namespace yarp::os;
 using namespace iCub::skinDynLib;
 
+// size of the compact representation of a skinContact without taxels (see skinContact::writeCompact())
+static const size_t MIN_COMPACT_CONTACT_SIZE = 5*sizeof(NetInt32) + 16*sizeof(NetFloat64);
+
 
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 //   CONSTRUCTORS
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 skinContactList::skinContactList()
-:vector<skinContact>(){}
+:vector<skinContact>(), compact(false){}
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 skinContactList::skinContactList(const size_type &n, const skinContact& value)
-:vector<skinContact>(n, value){}
+:vector<skinContact>(n, value), compact(false){}
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 skinContactList skinContactList::filterBodyPart(const BodyPart &bp)
 {
@@ -57,17 +63,33 @@ map<SkinPart, skinContactList> skinContactList::splitPerSkinPart()
 bool skinContactList::read(ConnectionReader& connection)
 {
     // A skinContactList is represented as a list of list
-    // where each list is a skinContact
+    // where each list is a skinContact, or as a list (vocab blob) in the compact representation
     if(connection.expectInt()!=BOTTLE_TAG_LIST)
         return false;
 
     int listLength = connection.expectInt();
     if(listLength<0)
         return false;
+    if(listLength==0)
+    {
+        clear();
+        return !connection.isError();
+    }
+
+    int tag = connection.expectInt();
+    if(listLength==2 && tag==BOTTLE_TAG_VOCAB)
+        return readCompact(connection);
+    if(tag!=BOTTLE_TAG_LIST)
+        return false;
+
     if(listLength!=size())
         resize(listLength);
 
-    for(iterator it=begin(); it!=end(); it++)
+    // the tag of the first skinContact has already been read
+    iterator it=begin();
+    if(!it->readFields(connection))
+        return false;
+    for(it++; it!=end(); it++)
         if(!it->read(connection))
             return false;
 
@@ -76,6 +98,9 @@ bool skinContactList::read(ConnectionReader& connection)
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 bool skinContactList::write(ConnectionWriter& connection)
 {
+    if(compact)
+        return writeCompact(connection);
+
     // A skinContactList is represented as a list of list
     // where each list is a skinContact
     connection.appendInt(BOTTLE_TAG_LIST);
@@ -88,6 +113,61 @@ bool skinContactList::write(ConnectionWriter& connection)
     return !connection.isError();
 }
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+bool skinContactList::readCompact(ConnectionReader& connection)
+{
+    // the list tag, the list length and the vocab tag have already been read
+    if(connection.expectInt()!=VOCAB_SKIN_CONTACTS_COMPACT || connection.expectInt()!=BOTTLE_TAG_BLOB)
+        return false;
+    int len = connection.expectInt();
+    if(len<(int)sizeof(NetInt32))
+        return false;
+    compactBuffer.resize(len);
+    if(!connection.expectBlock(&compactBuffer[0], len))
+        return false;
+
+    const char *buf = &compactBuffer[0];
+    const char *bufEnd = buf + len;
+    NetInt32 n;
+    memcpy(&n, buf, sizeof(n));
+    buf += sizeof(n);
+    // every contact takes at least the size of a skinContact without taxels
+    if(n<0 || (size_t)n > (size_t)len/MIN_COMPACT_CONTACT_SIZE)
+        return false;
+
+    if((size_t)n!=size())
+        resize(n);
+    for(iterator it=begin(); it!=end(); it++)
+        if((buf = it->readCompact(buf, bufEnd))==NULL)
+            return false;
+
+    return !connection.isError();
+}
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+bool skinContactList::writeCompact(ConnectionWriter& connection)
+{
+    size_t len = sizeof(NetInt32);
+    for(iterator it=begin(); it!=end(); it++)
+        len += it->getCompactSize();
+    compactBuffer.resize(len);
+
+    char *buf = &compactBuffer[0];
+    NetInt32 n = size();
+    memcpy(buf, &n, sizeof(n));
+    buf += sizeof(n);
+    for(iterator it=begin(); it!=end(); it++)
+        buf = it->writeCompact(buf);
+
+    connection.appendInt(BOTTLE_TAG_LIST);
+    connection.appendInt(2);
+    connection.appendInt(BOTTLE_TAG_VOCAB);
+    connection.appendInt(VOCAB_SKIN_CONTACTS_COMPACT);
+    connection.appendInt(BOTTLE_TAG_BLOB);
+    connection.appendInt(len);
+    connection.appendBlock(&compactBuffer[0], len);     // the block is copied by the connection
+
+    return !connection.isError();
+}
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 dynContactList skinContactList::toDynContactList() const
 {
     dynContactList res(this->size());
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2016 iCub Facility, Istituto Italiano di Tecnologia
+ * CopyPolicy: Released under the terms of the GNU GPL v2.0.
+ *
+ */
+
+#include "iCub/skinDynLib/skinDataCodec.h"
+
+using namespace std;
+using namespace yarp::os;
+using namespace yarp::sig;
+using namespace iCub::skinDynLib;
+
+namespace
+{
+    enum { KEYFRAME = 0, DELTA = 1 };
+
+    inline void putVarint(vector<unsigned char> &out, size_t v)
+    {
+        while(v >= 0x80)
+        {
+            out.push_back((unsigned char)(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back((unsigned char)v);
+    }
+
+    inline bool getVarint(const unsigned char *&p, const unsigned char *end, size_t &v)
+    {
+        v = 0;
+        for(unsigned int shift=0; p<end && shift<32; shift+=7)
+        {
+            unsigned char b = *p++;
+            v |= (size_t)(b & 0x7f) << shift;
+            if(!(b & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    inline unsigned char quantize(double v)
+    {
+        if(v <= 0.0)
+            return 0;
+        if(v >= 255.0)
+            return 255;
+        return (unsigned char)(v + 0.5);
+    }
+}
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//   ENCODER
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+skinDataEncoder::skinDataEncoder(unsigned int _keyframePeriod)
+: keyframePeriod(_keyframePeriod), sinceKeyframe(0), keyframeRequested(true), seq(0){}
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+size_t skinDataEncoder::encode(const Vector &values, Bottle &msg)
+{
+    size_t n = values.size();
+    current.resize(n);
+    for(size_t i=0; i<n; i++)
+        current[i] = quantize(values[i]);
+
+    bool keyframe = keyframeRequested || last.size()!=n || (keyframePeriod>0 && sinceKeyframe>=keyframePeriod);
+
+    payload.clear();
+    if(keyframe)
+    {
+        // runs of equal values
+        size_t i = 0;
+        while(i<n)
+        {
+            size_t start = i;
+            while(i<n && current[i]==current[start])
+                i++;
+            putVarint(payload, i-start);
+            payload.push_back(current[start]);
+        }
+        keyframeRequested = false;
+        sinceKeyframe = 1;
+    }
+    else
+    {
+        // runs of unchanged taxels followed by runs of changed ones
+        size_t i = 0;
+        while(i<n)
+        {
+            size_t start = i;
+            while(i<n && current[i]==last[i])
+                i++;
+            if(i==n)
+                break;
+            size_t changed = i;
+            while(i<n && current[i]!=last[i])
+                i++;
+            putVarint(payload, changed-start);
+            putVarint(payload, i-changed);
+            payload.insert(payload.end(), current.begin()+changed, current.begin()+i);
+        }
+        sinceKeyframe++;
+    }
+    last.swap(current);
+
+    msg.clear();
+    msg.addVocab(VOCAB_SKIN_COMPACT);
+    msg.addInt((int)seq++);
+    msg.addInt(keyframe ? KEYFRAME : DELTA);
+    msg.addInt((int)n);
+    unsigned char empty = 0;
+    msg.add(Value::makeBlob(payload.empty() ? &empty : &payload[0], (int)payload.size()));
+
+    return payload.size();
+}
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//   DECODER
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+skinDataDecoder::skinDataDecoder()
+: synchronized(false), lastSeq(0), lostMessages(0){}
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+void skinDataDecoder::reset()
+{
+    synchronized = false;
+}
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+bool skinDataDecoder::isCompact(const Bottle &msg)
+{
+    return msg.size()==5 && msg.get(0).isVocab() && msg.get(0).asVocab()==VOCAB_SKIN_COMPACT;
+}
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+bool skinDataDecoder::decodeKeyframe(const unsigned char *data, size_t len, size_t n)
+{
+    const unsigned char *p = data, *end = data+len;
+    taxels.resize(n);
+    size_t i = 0;
+    while(p<end)
+    {
+        size_t run;
+        if(!getVarint(p, end, run) || p>=end || run>n-i)
+            return false;
+        unsigned char v = *p++;
+        for(size_t k=0; k<run; k++)
+            taxels[i++] = v;
+    }
+    return i==n;
+}
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+bool skinDataDecoder::decodeDelta(const unsigned char *data, size_t len)
+{
+    const unsigned char *p = data, *end = data+len;
+    size_t n = taxels.size();
+    size_t i = 0;
+    while(p<end)
+    {
+        size_t unchanged, changed;
+        if(!getVarint(p, end, unchanged) || !getVarint(p, end, changed))
+            return false;
+        if(unchanged>n-i || changed>n-i-unchanged || changed>(size_t)(end-p))
+            return false;
+        i += unchanged;
+        for(size_t k=0; k<changed; k++)
+            taxels[i++] = *p++;
+    }
+    return true;
+}
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+bool skinDataDecoder::decode(const Bottle &msg)
+{
+    if(!isCompact(msg) || !msg.get(4).isBlob())
+        return false;
+
+    unsigned int seq = (unsigned int)msg.get(1).asInt();
+    int type = msg.get(2).asInt();
+    int n = msg.get(3).asInt();
+    const unsigned char *data = (const unsigned char*)msg.get(4).asBlob();
+    size_t len = msg.get(4).asBlobLength();
+    if(n<0)
+        return false;
+
+    if(synchronized && seq!=lastSeq+1)
+    {
+        // the difference is taken modulo 2^32, so the wrap around of seq is not a gap.
+        // a step back (e.g. a restarted encoder) gives a huge gap, which is not counted
+        unsigned int gap = seq-lastSeq-1;
+        if(gap<0x80000000u)
+            lostMessages += gap;
+        synchronized = false;
+    }
+    lastSeq = seq;
+
+    if(type==KEYFRAME)
+    {
+        synchronized = decodeKeyframe(data, len, n);
+        return synchronized;
+    }
+
+    // a delta can be applied only on the previous message
+    if(type!=DELTA || !synchronized || (size_t)n!=taxels.size())
+    {
+        synchronized = false;
+        return false;
+    }
+    synchronized = decodeDelta(data, len);
+    return synchronized;
+}
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+bool skinDataDecoder::decode(const Bottle &msg, Vector &values)
+{
+    if(!decode(msg))
+        return false;
+
+    size_t n = taxels.size();
+    values.resize(n);
+    for(size_t i=0; i<n; i++)
+        values[i] = taxels[i];
+    return true;
+}
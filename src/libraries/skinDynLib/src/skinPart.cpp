@@ -104,6 +104,7 @@ using namespace iCub::skinDynLib;
         spatial_sampling = _sp.spatial_sampling;
         taxel2Repr       = _sp.taxel2Repr;
         repr2TaxelList   = _sp.repr2TaxelList;
+        taxelGrid        = _sp.taxelGrid;
 
         clearTaxels();
         for (std::vector<Taxel*>::const_iterator it = _sp.taxels.begin();
@@ -228,7 +229,7 @@ using namespace iCub::skinDynLib;
             return false;
         }
            
-        return true;
+        return buildSpatialIndex();
     }
 
     // see also Compensator::setTaxelPosesFromFile
@@ -281,7 +282,7 @@ using namespace iCub::skinDynLib;
                 setSize(getSize()+1);
         }
 
-        return mapTaxelsOntoThemselves() && initRepresentativeTaxels();
+        return mapTaxelsOntoThemselves() && initRepresentativeTaxels() && buildSpatialIndex();
     }
 
     bool skinPart::mapTaxelsOntoThemselves()
@@ -346,6 +347,55 @@ using namespace iCub::skinDynLib;
             taxels.pop_back();
         }
         taxels.clear();
+        taxelGrid.clear();
+    }
+
+    bool skinPart::buildSpatialIndex(double cellSize)
+    {
+        yarp::os::RecursiveLockGuard rlg(recursive_mutex);
+        std::vector<double> xyz(3*taxels.size(), 0.0);
+        for (size_t i = 0; i < taxels.size(); i++)
+        {
+            yarp::sig::Vector pos = taxels[i]->getPosition();
+            for (size_t k = 0; k < 3 && k < pos.size(); k++)
+            {
+                xyz[3*i+k] = pos[k];
+            }
+        }
+
+        if (!taxelGrid.build(xyz.empty() ? NULL : &xyz[0], taxels.size(), cellSize))
+        {
+            yError("[skinPart::buildSpatialIndex] Invalid cell size %f", cellSize);
+            return false;
+        }
+        return true;
+    }
+
+    std::vector<int> skinPart::getTaxelsWithinRadius(const yarp::sig::Vector &pos, double radius)
+    {
+        yarp::os::RecursiveLockGuard rlg(recursive_mutex);
+        std::vector<int> found, ids;
+        taxelGrid.radiusQuery(pos, radius, found);
+        ids.reserve(found.size());
+        for (size_t i = 0; i < found.size(); i++)
+        {
+            if (found[i] < (int)taxels.size())
+            {
+                ids.push_back(taxels[found[i]]->getID());
+            }
+        }
+        return ids;
+    }
+
+    int skinPart::getClosestTaxel(const yarp::sig::Vector &pos, double maxDist)
+    {
+        yarp::os::RecursiveLockGuard rlg(recursive_mutex);
+        int i = taxelGrid.nearest(pos, maxDist);
+        if (i < 0 || i >= (int)taxels.size())
+        {
+            return -1;
+        }
+        return taxels[i]->getID();
     }
 
     void skinPart::print(int verbosity)
@@ -32,7 +32,7 @@
 #include <cv.h>
 
 #include <string>
-#include <deque>
+#include <vector>
 #include <map>
 
 #include <iCub/utils.h>
@@ -45,6 +45,9 @@
 #define MODE_TRACK_TEMPLATE 0
 #define MODE_TRACK_MOTION   1
 
+#define PYRAMID_MIN_SIZE            8       // the levels smaller than this are not built
+#define TEMPLATE_CONFIDENT_MATCH    0.9     // the search stops at the first level matching this well
+
 using namespace std;
 using namespace yarp::os;
 using namespace yarp::sig;
@@ -57,6 +60,78 @@ struct StereoTracker
 };
 
 
+// fixed-size buffer: once full, pushing drops the oldest element
+template <class T>
+class RingBuffer
+{
+private:
+    vector<T>       data;
+    unsigned int    head;
+    unsigned int    count;
+
+public:
+    RingBuffer() :head(0),count(0) {}
+
+    void resize(const unsigned int capacity)
+    {
+        data.assign(capacity>0?capacity:1,T());
+        head=count=0;
+    }
+
+    void clear()                            { head=count=0; }
+    unsigned int size() const               { return count; }
+    bool empty() const                      { return count==0; }
+    bool full() const                       { return count==data.size(); }
+
+    T &front()                              { return data[head]; }
+    T &back()                               { return data[(head+count-1)%data.size()]; }
+    T &operator[](const unsigned int i)     { return data[(head+i)%data.size()]; }
+
+    void pop_front()
+    {
+        head=(head+1)%data.size();
+        count--;
+    }
+
+    void push_back(const T &item)
+    {
+        if(full())
+            pop_front();
+
+        data[(head+count)%data.size()]=item;
+        count++;
+    }
+};
+
+
+// gray levels pyramid of an image, kept across the cycles:
+// the levels are reallocated only when the size of the image changes
+class ImagePyramid
+{
+private:
+    int                 max_levels;
+    vector<IplImage*>   levels;
+    bool                stale;
+
+    void release();
+
+public:
+    ImagePyramid() :max_levels(1),stale(true) {}
+    ~ImagePyramid()                         { release(); }
+
+    void setMaxLevels(const int n)          { max_levels=n>0?n:1; }
+
+    void invalidate()                       { stale=true; }
+    bool isStale() const                    { return stale; }
+
+    // code is the conversion of the source to gray levels
+    void update(IplImage *src, const int code);
+
+    int size() const                        { return (int)levels.size(); }
+    IplImage *operator[](const int l)       { return levels[l]; }
+};
+
+
 
 
 class VisuoThread: public RateThread
@@ -99,6 +174,7 @@ private:
     unsigned int                minTrackBufSize;
     unsigned int                maxTrackBufSize;
     double                      timeTol;
+    double                      templateMatchThresh;
     double                      motionStdThresh;
     double                      speedStdThresh;
     double                      stereoDistThresh;
@@ -111,8 +187,21 @@ private:
     ImageOf<PixelRgb>           *img[2];
     ImageOf<PixelBgr>           tpl;
 
+    // the template is looked for in the pyramids of both eyes
+    ImagePyramid                pyramid[2];
+    ImagePyramid                tplPyramid;
+    int                         tplSide;        // side the template was extracted with, kept with tplPyramid under imgMutex
+
+    // speeds of the tracked points between consecutive cycles, with their running sums
+    struct TrackSpeed
+    {
+        double  v[2];
+    };
+
     StereoTracker               stereoTracker;
-    deque<Vector>               trackBuffer;
+    Vector                      lastTrack;
+    RingBuffer<TrackSpeed>      trackSpeeds;
+    double                      speedSum[2];
     bool                        tracking;
 
     bool                        newImage[2];
@@ -127,7 +216,20 @@ private:
         CvPoint p;
     };
 
-    deque<Item>                 buffer[2];
+    // motion blobs within timeTol, with the running sums of their sizes and positions
+    struct MotionBuffer
+    {
+        RingBuffer<Item>    items;
+        double              size;
+        double              u,v;
+        double              u2,v2;
+
+        void clear();
+        void push_back(const Item &item);
+        void pop_front();
+    };
+
+    MotionBuffer                buffer[2];
     //map<string,CvPoint>         locations[2];
     map<string,CvPoint>         locations;
 
@@ -144,6 +246,7 @@ private:
     void updateLocationsMIL();
     void updateMotionCUT();
     void updatePFTracker();
+    bool locateTemplate(const int eye, CvPoint &p, double &score);
 public:
     VisuoThread(ResourceFinder &_rf, Initializer *initializer);
 
@@ -20,6 +20,82 @@
 #include <iCub/VisuoThread.h>
 
 
+void ImagePyramid::release()
+{
+    for(size_t l=0; l<levels.size(); l++)
+        cvReleaseImage(&levels[l]);
+
+    levels.clear();
+}
+
+
+void ImagePyramid::update(IplImage *src, const int code)
+{
+    // the number of levels depends only on the size of the source
+    int n=1;
+    for(int w=src->width, h=src->height; n<max_levels && w/2>=PYRAMID_MIN_SIZE && h/2>=PYRAMID_MIN_SIZE; n++)
+    {
+        w/=2;
+        h/=2;
+    }
+
+    if(levels.size()==0 || levels[0]->width!=src->width || levels[0]->height!=src->height || (int)levels.size()!=n)
+    {
+        release();
+
+        CvSize size=cvGetSize(src);
+        for(int l=0; l<n; l++)
+        {
+            levels.push_back(cvCreateImage(size,IPL_DEPTH_8U,1));
+            size=cvSize((size.width+1)/2,(size.height+1)/2);
+        }
+    }
+
+    cvCvtColor(src,levels[0],code);
+    for(int l=1; l<n; l++)
+        cvPyrDown(levels[l-1],levels[l]);
+
+    stale=false;
+}
+
+
+void VisuoThread::MotionBuffer::clear()
+{
+    items.clear();
+    size=u=v=u2=v2=0.0;
+}
+
+
+void VisuoThread::MotionBuffer::push_back(const Item &item)
+{
+    if(items.full())
+        pop_front();
+
+    items.push_back(item);
+    size+=item.size;
+    u+=item.p.x;
+    v+=item.p.y;
+    u2+=item.p.x*item.p.x;
+    v2+=item.p.y*item.p.y;
+}
+
+
+void VisuoThread::MotionBuffer::pop_front()
+{
+    Item &item=items.front();
+    size-=item.size;
+    u-=item.p.x;
+    v-=item.p.y;
+    u2-=item.p.x*item.p.x;
+    v2-=item.p.y*item.p.y;
+    items.pop_front();
+
+    // do not let the rounding errors pile up
+    if(items.empty())
+        clear();
+}
+
+
 void VisuoThread::close()
 {
     if (closed)
@@ -66,34 +142,37 @@ bool VisuoThread::checkTracker(Vector *vec)
 {
     bool track=false;
 
-    trackBuffer.push_back(*vec);
-    
-    if(isTracking() && trackBuffer.size()>minTrackBufSize)
+    // the speeds enter and leave the window with their sums, no need to scan it
+    if(lastTrack.size()==vec->size())
     {
-        double speed_avg[2];
-        double speed_std[2];
-        speed_avg[LEFT]=speed_avg[RIGHT]=0.0;
-        speed_std[LEFT]=speed_std[RIGHT]=0.0;
+        if(trackSpeeds.full())
+        {
+            speedSum[LEFT]-=trackSpeeds.front().v[LEFT];
+            speedSum[RIGHT]-=trackSpeeds.front().v[RIGHT];
+            trackSpeeds.pop_front();
+        }
 
-        for(unsigned int i=1; i<trackBuffer.size(); i++)
+        TrackSpeed speed;
+        for(int cam=0; cam<2; cam++)
         {
-            double speed[2];
-            speed[LEFT]=(trackBuffer[i-1][0]-trackBuffer[i][0])*(trackBuffer[i-1][0]-trackBuffer[i][0])+
-                        (trackBuffer[i-1][1]-trackBuffer[i][1])*(trackBuffer[i-1][1]-trackBuffer[i][1]);
-            speed_avg[LEFT]+=sqrt(speed[LEFT]);
-            speed_std[LEFT]+=speed[LEFT];
-
-            speed[RIGHT]=(trackBuffer[i-1][0]-trackBuffer[i][0])*(trackBuffer[i-1][0]-trackBuffer[i][0])+
-                        (trackBuffer[i-1][1]-trackBuffer[i][1])*(trackBuffer[i-1][1]-trackBuffer[i][1]);
-            speed_avg[RIGHT]+=sqrt(speed[RIGHT]);
-            speed_std[RIGHT]+=speed[RIGHT];
+            double du=lastTrack[6*cam]-(*vec)[6*cam];
+            double dv=lastTrack[6*cam+1]-(*vec)[6*cam+1];
+            speed.v[cam]=sqrt(du*du+dv*dv);
+            speedSum[cam]+=speed.v[cam];
         }
+        trackSpeeds.push_back(speed);
+    }
+    lastTrack=*vec;
 
-        double n=1.0/(trackBuffer.size()-1);
-        speed_avg[LEFT]*=n;
-        speed_std[LEFT]=n*speed_std[LEFT]-speed_avg[LEFT]*speed_avg[LEFT];
-        speed_avg[RIGHT]*=n;
-        speed_std[RIGHT]=n*speed_std[RIGHT]-speed_avg[RIGHT]*speed_avg[RIGHT];
+    if(trackSpeeds.empty())
+        speedSum[LEFT]=speedSum[RIGHT]=0.0;
+
+    if(isTracking() && trackSpeeds.size()>0 && trackSpeeds.size()+1>minTrackBufSize)
+    {
+        double speed_avg[2];
+        double n=1.0/trackSpeeds.size();
+        speed_avg[LEFT]=n*speedSum[LEFT];
+        speed_avg[RIGHT]=n*speedSum[RIGHT];
 
         track=true;
 
@@ -103,31 +182,99 @@ bool VisuoThread::checkTracker(Vector *vec)
             track=false;
         }
 
-        double dist=(trackBuffer.back()[0]-trackBuffer.back()[6])*(trackBuffer.back()[0]-trackBuffer.back()[6])+
-                    (trackBuffer.back()[1]-trackBuffer.back()[7])*(trackBuffer.back()[1]-trackBuffer.back()[7]);
+        double dist=((*vec)[0]-(*vec)[6])*((*vec)[0]-(*vec)[6])+
+                    ((*vec)[1]-(*vec)[7])*((*vec)[1]-(*vec)[7]);
 
         // avoid strabicity
         if(sqrt(dist)>stereoDistThresh)
         {
             track=false;
         }
+
         // check that both images are tracking similar things
+        if(track && templateMatchThresh>0.0)
+        {
+            imgMutex.wait();
+            for(int cam=0; cam<2 && track; cam++)
+            {
+                CvPoint p=cvPoint(cvRound((*vec)[6*cam]),cvRound((*vec)[6*cam+1]));
+                double score;
+                if(locateTemplate(cam,p,score) && score<templateMatchThresh)
+                    track=false;
+            }
+            imgMutex.post();
+        }
+    }
 
+    return track;
+}
 
+
+// looks for the template around p, from the coarsest level of the pyramids down,
+// stopping as soon as the match is confident. To be called with imgMutex taken.
+bool VisuoThread::locateTemplate(const int eye, CvPoint &p, double &score)
+{
+    if(img[eye]==NULL || tplPyramid.size()==0)
+        return false;
+
+    if(pyramid[eye].isStale())
+        pyramid[eye].update((IplImage*)img[eye]->getIplImage(),CV_RGB2GRAY);
+
+    int top=(pyramid[eye].size()<tplPyramid.size()?pyramid[eye].size():tplPyramid.size())-1;
+
+    // at the coarsest level the whole template side is searched, then just the neighbourhood of the match
+    int radius=(tplSide>>(top+1))+1;
+    CvPoint q=cvPoint(p.x>>top,p.y>>top);
+
+    score=-1.0;
+    for(int l=top; l>=0; l--)
+    {
+        IplImage *I=pyramid[eye][l];
+        IplImage *T=tplPyramid[l];
+
+        int x0=q.x-T->width/2-radius;
+        int y0=q.y-T->height/2-radius;
+        int x1=x0+T->width+2*radius;
+        int y1=y0+T->height+2*radius;
+        x0=x0<0?0:x0;
+        y0=y0<0?0:y0;
+        x1=x1>I->width?I->width:x1;
+        y1=y1>I->height?I->height:y1;
+
+        // too close to the border
+        if(x1-x0<T->width || y1-y0<T->height)
+            return false;
+
+        CvMat window;
+        cvGetSubRect(I,&window,cvRect(x0,y0,x1-x0,y1-y0));
+
+        CvMat *result=cvCreateMat(y1-y0-T->height+1,x1-x0-T->width+1,CV_32FC1);
+        cvMatchTemplate(&window,T,result,CV_TM_CCOEFF_NORMED);
+
+        double min_val;
+        CvPoint min_loc,max_loc;
+        cvMinMaxLoc(result,&min_val,&score,&min_loc,&max_loc);
+        cvReleaseMat(&result);
+
+        q=cvPoint(x0+max_loc.x+T->width/2,y0+max_loc.y+T->height/2);
+
+        if(score>=TEMPLATE_CONFIDENT_MATCH)
+        {
+            p=cvPoint(q.x<<l,q.y<<l);
+            return true;
+        }
+
+        q=cvPoint(2*q.x,2*q.y);
+        radius=2;
     }
-        
-    
-    while(trackBuffer.size()>maxTrackBufSize)
-        trackBuffer.pop_front();
 
-    return track;
+    p=cvPoint(q.x/2,q.y/2);
+    return true;
 }
 
 
 void VisuoThread::startTracker(const Vector &stereo, const int &side)
 {
-    IplImage *ipl_img, *ipl_tpl;
-
     int eye_in_use;
 
     if(stereo[2*dominant_eye]==0.0 && stereo[2*dominant_eye+1]==0.0)
@@ -140,33 +287,36 @@ void VisuoThread::startTracker(const Vector &stereo, const int &side)
     else
         eye_in_use=dominant_eye;
 
-    imgMutex.wait();
-    ipl_img=img[eye_in_use]!=NULL? cvCloneImage((IplImage *) img[eye_in_use]->getIplImage()):NULL;
-    imgMutex.post();
+    bool extracted=false;
 
-    if(ipl_img!=NULL)
+    // the template is converted straight from a view on the image, which is not cloned
+    imgMutex.wait();
+    if(img[eye_in_use]!=NULL)
     {
+        IplImage *ipl_img=(IplImage*) img[eye_in_use]->getIplImage();
+
         int x=stereo[2*eye_in_use]-0.5*side<0?0:cvRound(stereo[2*eye_in_use]-0.5*side);
         int y=stereo[2*eye_in_use+1]-0.5*side<0?0:cvRound(stereo[2*eye_in_use+1]-0.5*side);
         int width=stereo[2*eye_in_use]+0.5*side>=ipl_img->width?ipl_img->width-x:side;
         int height=stereo[2*eye_in_use+1]+0.5*side>=ipl_img->height?ipl_img->height-y:side;
 
-        ipl_tpl=cvCreateImage(cvSize(side,side),ipl_img->depth,ipl_img->nChannels);
-        cvSetImageROI(ipl_img,cvRect(x,y,width,height));
-        cvCopy(ipl_img,ipl_tpl);
-        cvCvtColor(ipl_tpl,ipl_tpl,CV_BGR2RGB);
-        //ImageOf<PixelBgr> tpl;
-        if(tpl.width()>0)
+        if(width>0 && height>0)
         {
-            IplImage *tmp_ipl=(IplImage*) tpl.getIplImage();
-            //cvReleaseImage(&tmp_ipl);
-        }        
-        tpl.wrapIplImage(ipl_tpl);
-        pftOutPort.write(tpl);
+            CvMat roi;
+            cvGetSubRect(ipl_img,&roi,cvRect(x,y,width,height));
+
+            tpl.resize(width,height);
+            cvCvtColor(&roi,(IplImage*) tpl.getIplImage(),CV_RGB2BGR);
+            tplPyramid.update((IplImage*) tpl.getIplImage(),CV_BGR2GRAY);
+            tplSide=side;
 
-        cvReleaseImage(&ipl_img);
-        cvReleaseImage(&ipl_tpl);
+            extracted=true;
+        }
     }
+    imgMutex.post();
+
+    if(extracted)
+        pftOutPort.write(tpl);
 
     trackMutex.wait();
     stereoTracker.side=side;
@@ -191,24 +341,27 @@ void VisuoThread::updateImages()
     ImageOf<PixelRgb> *iL=imgPort[LEFT].read(false);
     ImageOf<PixelRgb> *iR=imgPort[RIGHT].read(false);
 
+    // the images are copied into the same buffers, the pyramids are rebuilt only if needed
     imgMutex.wait();
     if(iL!=NULL) 
     {
-        if(img[LEFT]!=NULL)
-            delete img[LEFT];
+        if(img[LEFT]==NULL)
+            img[LEFT]=new ImageOf<PixelRgb>(*iL);
+        else
+            *img[LEFT]=*iL;
 
-        img[LEFT]=new ImageOf<PixelRgb>(*iL);
-        
+        pyramid[LEFT].invalidate();
         newImage[LEFT]=true;
     }
 
     if(iR!=NULL)
     {
-        if(img[RIGHT]!=NULL)
-            delete img[RIGHT];
-        
-        img[RIGHT]=new ImageOf<PixelRgb>(*iR);
-        
+        if(img[RIGHT]==NULL)
+            img[RIGHT]=new ImageOf<PixelRgb>(*iR);
+        else
+            *img[RIGHT]=*iR;
+
+        pyramid[RIGHT].invalidate();
         newImage[RIGHT]=true;
     }
     imgMutex.post();
@@ -263,7 +416,7 @@ void VisuoThread::updateMotionCUT()
     {
         // if even the first element of the buffer is far (in time)
         // clear the whole buffer
-        if(buffer[cam].size()>0 && tNow-buffer[cam].back().t>timeTol)
+        if(buffer[cam].items.size()>0 && tNow-buffer[cam].items.back().t>timeTol)
             buffer[cam].clear();
 
         // If only a single moving blob has been detected
@@ -280,7 +433,7 @@ void VisuoThread::updateMotionCUT()
         }
 
         // Avoid time unconsistencies
-        while (buffer[cam].size() && (tNow-buffer[cam].front().t)>timeTol)
+        while (buffer[cam].items.size() && (tNow-buffer[cam].items.front().t)>timeTol)
             buffer[cam].pop_front();
     }
 
@@ -386,10 +539,13 @@ VisuoThread::VisuoThread(ResourceFinder &_rf, Initializer *initializer)
 
     img[LEFT]=NULL;
     img[RIGHT]=NULL;
+    tplSide=0;
 
     stereoTracker.vec.clear();
     stereoTracker.side=0;
 
+    speedSum[LEFT]=speedSum[RIGHT]=0.0;
+
     trackMode=MODE_TRACK_TEMPLATE;
     closed=false;
 }
@@ -411,6 +567,21 @@ bool VisuoThread::threadInit()
     stereoDistThresh=bVision.check("stereoDistThresh",Value(300.0)).asDouble();
     dominant_eye=bVision.check("dominant_eye",Value("left")).asString()=="left"?LEFT:RIGHT;
 
+    // 0 disables the check of the template in the tracked points
+    templateMatchThresh=bVision.check("template_match_thresh",Value(0.0)).asDouble();
+    int pyramidLevels=bVision.check("pyramid_levels",Value(3)).asInt();
+    pyramid[LEFT].setMaxLevels(pyramidLevels);
+    pyramid[RIGHT].setMaxLevels(pyramidLevels);
+    tplPyramid.setMaxLevels(pyramidLevels);
+
+    // one speed per cycle, one blob per cycle within timeTol
+    trackSpeeds.resize(maxTrackBufSize);
+    unsigned int motionBufSize=(unsigned int)(1000.0*timeTol/getRate())+2;
+    buffer[LEFT].items.resize(motionBufSize>minMotionBufSize?motionBufSize:minMotionBufSize+1);
+    buffer[RIGHT].items.resize(motionBufSize>minMotionBufSize?motionBufSize:minMotionBufSize+1);
+    buffer[LEFT].clear();
+    buffer[RIGHT].clear();
+
     rawWaitThresh=bVision.check("raw_detection_wait_thresh",Value(15.0)).asDouble();
     motionWaitThresh=bVision.check("motion_detection_wait_thresh",Value(5.0)).asDouble();
     objectWaitThresh=bVision.check("object_detection_wait_thresh",Value(5.0)).asDouble();
@@ -614,31 +785,20 @@ bool VisuoThread::getMotion(Bottle &bStereo)
         motMutex.wait();
         // If the buffers are sufficently dense and not so small, return true.
         double size=0.0;
-        if (buffer[LEFT].size()>minMotionBufSize && buffer[RIGHT].size()>minMotionBufSize)
+        if (buffer[LEFT].items.size()>minMotionBufSize && buffer[RIGHT].items.size()>minMotionBufSize)
         {
             Vector p[2];
             for (int cam=0; cam<2; cam++)
             {
-                double size_cam,u,v,n;
-                double u_std,v_std;
-                size_cam=u=v=0.0;
-                u_std=v_std=0.0;
-                n=1.0/buffer[cam].size();
-
-                for (unsigned int i=0; i<buffer[cam].size(); i++)
-                {
-                    size_cam+=buffer[cam][i].size;
-                    u+=buffer[cam][i].p.x;
-                    v+=buffer[cam][i].p.y;
-                    u_std+=buffer[cam][i].p.x*buffer[cam][i].p.x;
-                    v_std+=buffer[cam][i].p.y*buffer[cam][i].p.y;
-                }
-
-                size_cam*=n;
-                u*=n;
-                v*=n;
-                u_std=sqrt(n*u_std-u*u);
-                v_std=sqrt(n*v_std-v*v);
+                double n=1.0/buffer[cam].items.size();
+
+                double size_cam=n*buffer[cam].size;
+                double u=n*buffer[cam].u;
+                double v=n*buffer[cam].v;
+                double u_var=n*buffer[cam].u2-u*u;
+                double v_var=n*buffer[cam].v2-v*v;
+                double u_std=sqrt(u_var>0.0?u_var:0.0);
+                double v_std=sqrt(v_var>0.0?v_var:0.0);
 
                 //check if the motion detected point is not wildly moving
                 if (u_std<motionStdThresh && v_std<motionStdThresh)
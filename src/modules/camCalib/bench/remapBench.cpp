@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2016 iCub Facility - Istituto Italiano di Tecnologia
+ * CopyPolicy: Released under the terms of the GNU GPL v2.0.
+ *
+ */
+
+// Frames per second of the undistortion of stereo pairs of synthetic frames, with the
+// pinhole parameters of the iCub cameras: cvRemap with the float maps (as the calib tools did)
+// against the fixed-point tables, at full resolution and fused with a downscaling by 2
+// (against cvRemap followed by cvResize).
+//
+// remapBench [pairs]
+// remapBench 300
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <cv.h>
+#include <yarp/os/Time.h>
+#include <iCub/FixedPointRemap.h>
+
+using namespace yarp::os;
+
+static void makeFrame(IplImage *img, int seed)
+{
+    srand(seed);
+    for (int r=0; r<img->height; r++)
+    {
+        unsigned char *row=(unsigned char*)(img->imageData+r*img->widthStep);
+        for (int c=0; c<img->width; c++)
+        {
+            row[3*c]  =(unsigned char)(((c/8+r/8)%2)*160+rand()%64);
+            row[3*c+1]=(unsigned char)((c+r)%256);
+            row[3*c+2]=(unsigned char)(rand()%256);
+        }
+    }
+}
+
+// float undistortion maps of a camera calibrated at 320x240, scaled to size
+static void makeMaps(CvSize size, IplImage *mapX, IplImage *mapY)
+{
+    double s=size.width/320.0;
+    float k[9]={ (float)(219.0*s), 0.0f, (float)(173.0*s),
+                 0.0f, (float)(219.0*s), (float)(116.0*s),
+                 0.0f, 0.0f, 1.0f };
+    float d[4]={ -0.37f, 0.17f, 0.0002f, 0.0005f };
+    CvMat K=cvMat(3, 3, CV_32F, k);
+    CvMat D=cvMat(1, 4, CV_32F, d);
+    cvInitUndistortMap(&K, &D, mapX, mapY);
+}
+
+// largest difference of the channels, one pixel away from the border of the images
+static int maxDifference(const IplImage *a, const IplImage *b)
+{
+    int maxDiff=0;
+    for (int r=1; r<a->height-1; r++)
+    {
+        const unsigned char *ra=(const unsigned char*)(a->imageData+r*a->widthStep);
+        const unsigned char *rb=(const unsigned char*)(b->imageData+r*b->widthStep);
+        for (int c=3; c<3*(a->width-1); c++)
+            maxDiff=MAX(maxDiff, abs(ra[c]-rb[c]));
+    }
+    return maxDiff;
+}
+
+static bool bench(CvSize size, int pairs)
+{
+    IplImage *in[2], *outFloat[2], *outFixed[2], *outHalf[2], *outResize[2];
+    CvSize half=cvSize(size.width/2, size.height/2);
+    for (int i=0; i<2; i++)
+    {
+        in[i]=cvCreateImage(size, IPL_DEPTH_8U, 3);
+        outFloat[i]=cvCreateImage(size, IPL_DEPTH_8U, 3);
+        outFixed[i]=cvCreateImage(size, IPL_DEPTH_8U, 3);
+        outHalf[i]=cvCreateImage(half, IPL_DEPTH_8U, 3);
+        outResize[i]=cvCreateImage(half, IPL_DEPTH_8U, 3);
+        makeFrame(in[i], i+1);
+    }
+
+    IplImage *mapX=cvCreateImage(size, IPL_DEPTH_32F, 1);
+    IplImage *mapY=cvCreateImage(size, IPL_DEPTH_32F, 1);
+    makeMaps(size, mapX, mapY);
+
+    FixedPointRemap remap, remapHalf;
+    CvRect whole=cvRect(0, 0, size.width, size.height);
+    remap.build(mapX, mapY, whole, size);
+    remapHalf.build(mapX, mapY, whole, half);
+
+    double t0=Time::now();
+    for (int p=0; p<pairs; p++)
+        for (int i=0; i<2; i++)
+            cvRemap(in[i], outFloat[i], mapX, mapY, CV_INTER_LINEAR+CV_WARP_FILL_OUTLIERS, cvScalarAll(0));
+    double t1=Time::now();
+    for (int p=0; p<pairs; p++)
+        for (int i=0; i<2; i++)
+            remap.apply(in[i], outFixed[i]);
+    double t2=Time::now();
+    for (int p=0; p<pairs; p++)
+        for (int i=0; i<2; i++)
+        {
+            cvRemap(in[i], outFloat[i], mapX, mapY, CV_INTER_LINEAR+CV_WARP_FILL_OUTLIERS, cvScalarAll(0));
+            cvResize(outFloat[i], outResize[i], CV_INTER_LINEAR);
+        }
+    double t3=Time::now();
+    for (int p=0; p<pairs; p++)
+        for (int i=0; i<2; i++)
+            remapHalf.apply(in[i], outHalf[i]);
+    double t4=Time::now();
+
+    int maxDiff=MAX(maxDifference(outFloat[0], outFixed[0]), maxDifference(outFloat[1], outFixed[1]));
+
+    printf("remapBench: %dx%d stereo pairs, %d pairs\n", size.width, size.height, pairs);
+    printf("remapBench:   full size: float maps %.0f fps, fixed-point %.0f fps, x%.1f, max difference %d\n",
+           pairs/(t1-t0), pairs/(t2-t1), (t2-t1)>0.0 ? (t1-t0)/(t2-t1) : 0.0, maxDiff);
+    printf("remapBench:   half size: float maps + resize %.0f fps, fused fixed-point %.0f fps, x%.1f\n",
+           pairs/(t3-t2), pairs/(t4-t3), (t4-t3)>0.0 ? (t3-t2)/(t4-t3) : 0.0);
+
+    for (int i=0; i<2; i++)
+    {
+        cvReleaseImage(&in[i]);
+        cvReleaseImage(&outFloat[i]);
+        cvReleaseImage(&outFixed[i]);
+        cvReleaseImage(&outHalf[i]);
+        cvReleaseImage(&outResize[i]);
+    }
+    cvReleaseImage(&mapX);
+    cvReleaseImage(&mapY);
+
+    // cvRemap interpolates with 1/32 of pixel as well, only the rounding differs
+    return maxDiff<=2;
+}
+
+int main(int argc, char *argv[])
+{
+    int pairs=argc>1 ? atoi(argv[1]) : 300;
+    if (pairs<=0)
+    {
+        fprintf(stderr, "remapBench: wrong arguments\n");
+        return 1;
+    }
+
+    bool ok=bench(cvSize(320, 240), pairs);
+    ok=bench(cvSize(640, 480), pairs) && ok;
+    return ok ? 0 : 1;
+}
@@ -13,6 +13,7 @@
 //#include <yarp/sig/Image.h>
 #include <yarp/sig/all.h>
 #include <yarp/os/IConfig.h>
+#include <yarp/os/Bottle.h>
 #include <yarp/os/Value.h>
 
 // opencv
@@ -21,6 +22,7 @@
 // iCub
 #include <iCub/ICalibTool.h>
 #include <iCub/spherical_projection.h>
+#include <iCub/FixedPointRemap.h>
 
 
 /**
@@ -30,8 +32,7 @@ class SphericalCalibTool : public ICalibTool
 {
 private:
 
-    IplImage        *_mapX;
-    IplImage        *_mapY;
+    FixedPointRemap _remap;
 
     double          _fx, _fx_scaled;
     double          _fy, _fy_scaled;
@@ -46,6 +47,8 @@ private:
 
     CvSize          _calibImgSize;
     CvSize          _oldImgSize;
+    CvRect          _crop;
+    double          _scale;
 
     bool _drawCenterCross;
 
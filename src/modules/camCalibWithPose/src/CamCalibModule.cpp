@@ -20,6 +20,28 @@ using namespace yarp::os;
 using namespace yarp::math;
 using namespace yarp::sig;
 
+// scales the distance of every channel from the mean of the pixel by sat,
+// in fixed point (sat in 1/256)
+static void saturate(ImageOf<PixelRgb> &img, double sat)
+{
+    const int satQ=(int)floor(sat*256.0+0.5);
+    for (int r=0; r<img.height(); r++) {
+        unsigned char *pixel=img.getPixelAddress(0,r);
+        for (int c=0; c<img.width(); c++, pixel+=3) {
+            int sum=pixel[0]+pixel[1]+pixel[2];
+            for (int i=0; i<3; i++) {
+                // 768*(mean+sat*(pixel-mean))
+                int sn=256*sum+satQ*(3*pixel[i]-sum);
+                if (sn<0)
+                    sn=0;
+                else if (sn>768*255)
+                    sn=768*255;
+                pixel[i]=(unsigned char)(sn/768);
+            }
+        }
+    }
+}
+
 CamCalibPort::CamCalibPort() :
     portImgOut(NULL),
     calibTool(NULL),
@@ -103,24 +125,8 @@ void CamCalibPort::onRead(ImageOf<PixelRgb> &yrpImgIn)
         if (calibTool!=NULL) {
             calibTool->apply(yrpImgIn,yrpImgOut);
 
-            for (int r =0; r <yrpImgOut.height(); r++) {
-                for (int c=0; c<yrpImgOut.width(); c++) {
-                    unsigned char *pixel = yrpImgOut.getPixelAddress(c,r);
-                    double mean = (1.0/3.0)*(pixel[0]+pixel[1]+pixel[2]);
-
-                    for(int i=0; i<3; i++) {
-                        double s=pixel[i]-mean;
-                        double sn=currSat*s;
-                        sn+=mean;
-
-                        if(sn<0.0)
-                            sn=0.0;
-                        else if(sn>255.0)
-                            sn=255.0;
-
-                        pixel[i]=(unsigned char)sn;
-                    }
-                }
+            if (currSat!=1.0) {
+                saturate(yrpImgOut,currSat);
             }
 
             if (verbose)
@@ -11,13 +11,13 @@ using namespace yarp::os;
 using namespace yarp::sig;
 
 PinholeCalibTool::PinholeCalibTool(){
-    _mapUndistortX = NULL;
-    _mapUndistortY = NULL;
     _intrinsic_matrix = cvCreateMat(3,3, CV_32F);
     _intrinsic_matrix_scaled = cvCreateMat(3,3, CV_32F);
     _distortion_coeffs = cvCreateMat(1, 4, CV_32F);
     _oldImgSize.width = -1;
     _oldImgSize.height = -1;
+    _crop = cvRect(0,0,0,0);
+    _scale = 1.0;
     _needInit = true;
 }
 
@@ -26,12 +26,7 @@ PinholeCalibTool::~PinholeCalibTool(){
 }
 
 bool PinholeCalibTool::close(){
-    if (_mapUndistortX != NULL)
-        cvReleaseImage(&_mapUndistortX);
-    _mapUndistortX = NULL;
-    if (_mapUndistortY != NULL)
-        cvReleaseImage(&_mapUndistortY);
-    _mapUndistortY = NULL;
+    _remap.release();
     cvReleaseMat(&_intrinsic_matrix);
     cvReleaseMat(&_intrinsic_matrix_scaled);
     cvReleaseMat(&_distortion_coeffs);
@@ -96,6 +91,19 @@ bool PinholeCalibTool::configure (Searchable &config){
     if ( !config.check("p2") ) { stopConfig("p2"); return false;}
 
 
+    // optional crop and rescaling of the undistorted image
+    _crop = cvRect(0,0,0,0);
+    if (config.check("crop")){
+        Bottle *crop = config.find("crop").asList();
+        if (crop == NULL || crop->size() != 4) { stopConfig("crop"); return false; }
+        _crop = cvRect(crop->get(0).asInt(), crop->get(1).asInt(),
+                       crop->get(2).asInt(), crop->get(3).asInt());
+    }
+    _scale = config.check("scale",
+                          Value(1.0),
+                          "Scale of the output image with respect to the (cropped) undistorted image (double)").asDouble();
+    if (_scale <= 0.0) { stopConfig("scale"); return false; }
+
     fprintf(stdout,"fx=%g\n",config.find("fx").asDouble());
     fprintf(stdout,"fy=%g\n",config.find("fy").asDouble());
     fprintf(stdout,"cx=%g\n",config.find("cx").asDouble());
@@ -134,13 +142,7 @@ bool PinholeCalibTool::configure (Searchable &config){
 
 bool PinholeCalibTool::init(CvSize currImgSize, CvSize calibImgSize){
 
-    if (_mapUndistortX != NULL)
-        cvReleaseImage(&_mapUndistortX);
-    _mapUndistortX = NULL;
-    if (_mapUndistortY != NULL)
-        cvReleaseImage(&_mapUndistortY);
-    _mapUndistortY = NULL;
-
+    _remap.release();
 
     // Scale the intrinsics if required:
     // if current image size is not the same as the size for
@@ -172,14 +174,31 @@ bool PinholeCalibTool::init(CvSize currImgSize, CvSize calibImgSize){
         CV_MAT_ELEM( *_intrinsic_matrix_scaled , float, 2, 2) = CV_MAT_ELEM( *_intrinsic_matrix , float, 2, 2);
     }
 
-    _mapUndistortX = cvCreateImage(currImgSize, IPL_DEPTH_32F, 1);
-    _mapUndistortY = cvCreateImage(currImgSize, IPL_DEPTH_32F, 1);
+    IplImage *mapUndistortX = cvCreateImage(currImgSize, IPL_DEPTH_32F, 1);
+    IplImage *mapUndistortY = cvCreateImage(currImgSize, IPL_DEPTH_32F, 1);
 
     /* init the undistortion matrices */
     cvInitUndistortMap( _intrinsic_matrix_scaled, _distortion_coeffs,
-                        _mapUndistortX, _mapUndistortY);
-
+                        mapUndistortX, mapUndistortY);
+
+    /* and turn them into the fixed-point tables, cropped and rescaled */
+    CvRect crop = cvRect(0, 0, currImgSize.width, currImgSize.height);
+    if (_crop.width > 0 && _crop.height > 0)
+        crop = _crop;
+    CvSize outSize = cvSize(MAX(cvRound(crop.width*_scale), 1),
+                            MAX(cvRound(crop.height*_scale), 1));
+    bool ok = _remap.build(mapUndistortX, mapUndistortY, crop, outSize);
+
+    cvReleaseImage(&mapUndistortX);
+    cvReleaseImage(&mapUndistortY);
     _needInit = false;
+
+    if (!ok){
+        fprintf(stdout,"The crop (%d %d %d %d) is out of the %dx%d image\n",
+                crop.x, crop.y, crop.width, crop.height, currImgSize.width, currImgSize.height);
+        return false;
+    }
+
     return true;
 }
 
@@ -193,21 +212,26 @@ void PinholeCalibTool::apply(const ImageOf<PixelRgb> & in, ImageOf<PixelRgb> & o
         _needInit)
         init(inSize,_calibImgSize);
 
-    out.resize(inSize.width, inSize.height);
+    // buffering old image size
+    _oldImgSize.width  = inSize.width;
+    _oldImgSize.height = inSize.height;
+
+    if (!_remap.isValid()){
+        out.copy(in);
+        return;
+    }
+
+    CvSize outSize = _remap.getOutputSize();
+    out.resize(outSize.width, outSize.height);
 
-    cvRemap( in.getIplImage(), out.getIplImage(),
-           _mapUndistortX, _mapUndistortY);
+    _remap.apply((const IplImage*)in.getIplImage(), (IplImage*)out.getIplImage());
 
 	// painting crosshair at calibration center
     if (_drawCenterCross){
 	    yarp::sig::PixelRgb pix = yarp::sig::PixelRgb(255,255,255);
-        yarp::sig::draw::addCrossHair(out, pix, (int)CV_MAT_ELEM( *_intrinsic_matrix_scaled , float, 0, 2),
-		                                    (int)CV_MAT_ELEM( *_intrinsic_matrix_scaled , float, 1, 2),
-											10);
+        CvPoint center = _remap.toOutput(CV_MAT_ELEM( *_intrinsic_matrix_scaled , float, 0, 2),
+                                         CV_MAT_ELEM( *_intrinsic_matrix_scaled , float, 1, 2));
+        yarp::sig::draw::addCrossHair(out, pix, center.x, center.y, 10);
     }
-
-    // buffering old image size
-    _oldImgSize.width  = inSize.width;
-    _oldImgSize.height = inSize.height;
 }
 
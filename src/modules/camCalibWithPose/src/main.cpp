@@ -82,6 +82,12 @@
  * p2 0.000456613
  *
  * </pre>
+ *
+ * Optionally the undistorted image can be cropped and rescaled in the same pass
+ * (e.g. to send half resolution images): \c crop \c "(x y w h)" is the region
+ * to output, in pixels of the input image, and \c scale the scale of the output
+ * (default 1.0). The remap runs on all the cores when the module is compiled with OpenMP.
+ *
  * \section portsc_sec Ports Created
  *
  * Input port
@@ -27,6 +27,7 @@
 
 // iCub
 #include <iCub/ICalibTool.h>
+#include <iCub/FixedPointRemap.h>
 
 
 /**
@@ -42,13 +43,14 @@ class PinholeCalibTool : public ICalibTool
     CvMat           *_intrinsic_matrix_scaled;
     CvMat           *_distortion_coeffs;;
 
-    IplImage        *_mapUndistortX;
-    IplImage        *_mapUndistortY;
+    FixedPointRemap _remap;
 
     bool _needInit;
 
     CvSize          _calibImgSize;
     CvSize          _oldImgSize;
+    CvRect          _crop;
+    double          _scale;
 
     bool _drawCenterCross;
 
@@ -86,6 +88,10 @@ public:
       k2 0.2467\n
       p1 -0.00195\n
       p2 0.00185\n
+
+      Optionally the undistorted image can be cropped and rescaled in the same pass:\n
+      crop (x y w h) = region of the undistorted image to output, in pixels of the input image\n
+      scale = scale of the output with respect to the (cropped) undistorted image\n
     */ 
     virtual bool configure (yarp::os::Searchable &config);
 
@@ -94,7 +100,7 @@ public:
 
   /** Apply calibration, in = rgb image, out = calibrated rgb image.
     * If necessary the output image is resized to match the size of the 
-    * input image.
+    * input image (or of the crop, times the scale, if they are configured).
     */
     void apply(const yarp::sig::ImageOf<yarp::sig::PixelRgb> & in,
                yarp::sig::ImageOf<yarp::sig::PixelRgb> & out);    
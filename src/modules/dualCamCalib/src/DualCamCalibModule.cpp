@@ -6,11 +6,26 @@
 
 #include <iCub/DualCamCalibModule.h>
 #include <yarp/os/Network.h>
+#include <cstring>
+#include <algorithm>
 
 using namespace std;
 using namespace yarp::os;
 using namespace yarp::sig;
 
+// copies src into dst with its top left corner at (x,y), one memcpy per row
+static void pasteImage(const ImageOf<PixelRgb> &src, ImageOf<PixelRgb> &dst, int x, int y)
+{
+    int w = min(src.width(), dst.width()-x);
+    int h = min(src.height(), dst.height()-y);
+    if (w<=0 || h<=0)
+        return;
+
+    size_t rowsize_bytes = w*sizeof(PixelRgb);
+    for (int r=0; r<h; r++)
+        memcpy(dst.getPixelAddress(x,y+r), src.getPixelAddress(0,r), rowsize_bytes);
+}
+
 CamCalibModule::CamCalibModule()
 {
     calibToolLeft = NULL;
@@ -190,7 +205,6 @@ bool CamCalibModule::updateModule()
 {
     bool lready=false;
     bool rready=false;
-    bool init=false;
 
     int dual_rowsize_pixels, dual_height_pixels, single_rowsize_pixels;
     int dual_rowsize_bytes,  single_rowsize_bytes;
@@ -245,77 +259,41 @@ bool CamCalibModule::updateModule()
     {
         calibToolLeft->apply(*leftImage,calibratedImgLeft);
         lready=true;
-
-        if (init==false)
-        {
-            if (align == ALIGN_WIDTH)
-            {
-                outw = calibratedImgLeft.width()*2;
-                outh = calibratedImgLeft.height();
-            }
-            else if (align==ALIGN_HEIGHT)
-            {
-                outw = calibratedImgLeft.width();
-                outh = calibratedImgLeft.height()*2;
-            }
-            else
-            {
-                yError() << "Invalid alignment";
-            }
-            calibratedImgOut.copy(calibratedImgLeft,outw,outh);
-            init=true;
-        }
-
-        calibratedImgOut.resize(outw, outh);
-        for (int r=0; r<calibratedImgLeft.height(); r++)
-        for (int c=0; c<calibratedImgLeft.width(); c++)
-        {
-            unsigned char *pixel = calibratedImgOut.getPixelAddress(c,r);
-
-            pixel[0] = *(calibratedImgLeft.getPixelAddress(c,r)+0);
-            pixel[1] = *(calibratedImgLeft.getPixelAddress(c,r)+1);
-            pixel[2] = *(calibratedImgLeft.getPixelAddress(c,r)+2);
-        }
-
     }
     if (calibToolRight!=NULL && rightImage!=NULL)
     {
         calibToolRight->apply(*rightImage,calibratedImgRight);
         rready=true;
+    }
 
-        if (init==false)
+    // the calibrated images are pasted side by side (or one above the other) row by row
+    if (lready || rready)
+    {
+        const yarp::sig::ImageOf<yarp::sig::PixelRgb> &calibratedImg = lready ? calibratedImgLeft : calibratedImgRight;
+        if (align == ALIGN_WIDTH)
         {
-            int outw = 0;
-            int outh = 0;
-            if (align == ALIGN_WIDTH)
-            {
-                outw = calibratedImgLeft.width()*2;
-                outh = calibratedImgLeft.height();
-            }
-            else if (align==ALIGN_HEIGHT)
-            {
-                outw = calibratedImgLeft.width();
-                outh = calibratedImgLeft.height()*2;
-            }
-            else
-            {
-                yError() << "Invalid alignment";
-            }
-            calibratedImgOut.copy(calibratedImgRight,outw,outh);
-            init=true;
+            outw = calibratedImg.width()*2;
+            outh = calibratedImg.height();
+        }
+        else if (align==ALIGN_HEIGHT)
+        {
+            outw = calibratedImg.width();
+            outh = calibratedImg.height()*2;
+        }
+        else
+        {
+            yError() << "Invalid alignment";
         }
+        calibratedImgOut.resize(outw, outh);
 
-        for (int r=0; r<calibratedImgLeft.height(); r++)
-        for (int c=0; c<calibratedImgLeft.width(); c++)
+        if (lready)
+            pasteImage(calibratedImgLeft, calibratedImgOut, 0, 0);
+        if (rready)
         {
-            int cp = 0;
-            int rp = 0;
-            if      (align == ALIGN_WIDTH)  {cp = c+calibratedImgLeft.width();  rp = r;}
-            else if (align == ALIGN_HEIGHT) {cp = c; rp = r+calibratedImgLeft.height();}
-            unsigned char *pixel = calibratedImgOut.getPixelAddress(cp,rp);
-            pixel[0] = *(calibratedImgRight.getPixelAddress(c,r)+0);
-            pixel[1] = *(calibratedImgRight.getPixelAddress(c,r)+1);
-            pixel[2] = *(calibratedImgRight.getPixelAddress(c,r)+2);
+            if (align == ALIGN_WIDTH)
+                pasteImage(calibratedImgRight, calibratedImgOut, outw/2, 0);
+            else
+                pasteImage(calibratedImgRight, calibratedImgOut, 0, outh/2);
         }
     }
 
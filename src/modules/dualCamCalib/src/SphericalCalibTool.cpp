@@ -14,10 +14,10 @@ using namespace yarp::os;
 using namespace yarp::sig;
 
 SphericalCalibTool::SphericalCalibTool(){
-    _mapX = NULL;
-    _mapY = NULL;
     _oldImgSize.width = -1;
     _oldImgSize.height = -1;
+    _crop = cvRect(0,0,0,0);
+    _scale = 1.0;
     _needInit = true;
 }
 
@@ -30,12 +30,7 @@ bool SphericalCalibTool::open(Searchable &config){
 }
 
 bool SphericalCalibTool::close(){
-    if (_mapX != NULL)
-        cvReleaseImage(&_mapX);
-    _mapX = NULL;
-    if (_mapY != NULL)
-        cvReleaseImage(&_mapY);
-    _mapY = NULL;
+    _remap.release();
     return true;
 }
 
@@ -79,6 +74,17 @@ bool SphericalCalibTool::configure (Searchable &config){
     if ( !config.check("p1") ) { stopConfig("p1"); return false;}
     if ( !config.check("p2") ) { stopConfig("p2"); return false;}
 
+    // optional crop and rescaling of the projected image
+    _crop = cvRect(0,0,0,0);
+    if (config.check("crop")){
+        Bottle *crop = config.find("crop").asList();
+        if (crop == NULL || crop->size() != 4) { stopConfig("crop"); return false; }
+        _crop = cvRect(crop->get(0).asInt(), crop->get(1).asInt(),
+                       crop->get(2).asInt(), crop->get(3).asInt());
+    }
+    _scale = config.check("scale", Value(1.0), "Scale of the output image with respect to the (cropped) projected image (double)").asDouble();
+    if (_scale <= 0.0) { stopConfig("scale"); return false; }
+
     _fx_scaled = _fx;
     _fy_scaled = _fy;
     _cx_scaled = _cx;
@@ -92,12 +98,7 @@ bool SphericalCalibTool::configure (Searchable &config){
 
 bool SphericalCalibTool::init(CvSize currImgSize, CvSize calibImgSize){
 
-     if (_mapX != NULL)
-        cvReleaseImage(&_mapX);
-    _mapX = NULL;
-    if (_mapY != NULL)
-        cvReleaseImage(&_mapY);
-    _mapY = NULL;
+    _remap.release();
 
     // Scale the intrinsics if required:
     // if current image size is not the same as the size for
@@ -119,20 +120,32 @@ bool SphericalCalibTool::init(CvSize currImgSize, CvSize calibImgSize){
         _cy_scaled = _cy;
     }
 
-    _mapX = cvCreateImage(currImgSize, IPL_DEPTH_32F, 1);
-    _mapY = cvCreateImage(currImgSize, IPL_DEPTH_32F, 1);
-
-    
+    IplImage *mapX = cvCreateImage(currImgSize, IPL_DEPTH_32F, 1);
+    IplImage *mapY = cvCreateImage(currImgSize, IPL_DEPTH_32F, 1);
+    _needInit = false;
 
-    if(!compute_sp_map(currImgSize.height, currImgSize.width, 
-                       currImgSize.height, currImgSize.width,
-                        _fx_scaled, _fy_scaled, _cx_scaled, _cy_scaled, 
-                        _k1, _k2, _p1, _p2, 
-                        (float*)_mapX->imageData, (float*)_mapY->imageData))
-        return false;
+    bool ok = compute_sp_map(currImgSize.height, currImgSize.width, 
+                             currImgSize.height, currImgSize.width,
+                             _fx_scaled, _fy_scaled, _cx_scaled, _cy_scaled, 
+                             _k1, _k2, _p1, _p2, 
+                             (float*)mapX->imageData, (float*)mapY->imageData);
+
+    // turn the maps into the fixed-point tables, cropped and rescaled
+    if (ok){
+        CvRect crop = cvRect(0, 0, currImgSize.width, currImgSize.height);
+        if (_crop.width > 0 && _crop.height > 0)
+            crop = _crop;
+        CvSize outSize = cvSize(MAX(cvRound(crop.width*_scale), 1),
+                                MAX(cvRound(crop.height*_scale), 1));
+        ok = _remap.build(mapX, mapY, crop, outSize);
+        if (!ok)
+            fprintf(stdout,"The crop (%d %d %d %d) is out of the %dx%d image\n",
+                    crop.x, crop.y, crop.width, crop.height, currImgSize.width, currImgSize.height);
+    }
 
-    _needInit = false;
-    return true;
+    cvReleaseImage(&mapX);
+    cvReleaseImage(&mapY);
+    return ok;
 }
 
 void SphericalCalibTool::apply(const ImageOf<PixelRgb> & in, ImageOf<PixelRgb> & out){
@@ -145,19 +158,24 @@ void SphericalCalibTool::apply(const ImageOf<PixelRgb> & in, ImageOf<PixelRgb> &
         _needInit)
         init(inSize,_calibImgSize);
 
-    out.resize(inSize.width, inSize.height);
+    // buffering old image size
+    _oldImgSize.width  = inSize.width;
+    _oldImgSize.height = inSize.height;
+
+    if (!_remap.isValid()){
+        out.copy(in);
+        return;
+    }
+
+    CvSize outSize = _remap.getOutputSize();
+    out.resize(outSize.width, outSize.height);
 
-    cvRemap( in.getIplImage(), out.getIplImage(),
-           _mapX, _mapY,
-           CV_INTER_LINEAR+CV_WARP_FILL_OUTLIERS, cvScalarAll(0));
+    _remap.apply((const IplImage*)in.getIplImage(), (IplImage*)out.getIplImage());
 
     // painting crosshair at calibration center
     if (_drawCenterCross){
 	    yarp::sig::PixelRgb pix = yarp::sig::PixelRgb(255,255,255);
-		yarp::sig::draw::addCrossHair(out, pix, (int)_cx_scaled, (int)_cy_scaled, 10);
+        CvPoint center = _remap.toOutput(_cx_scaled, _cy_scaled);
+		yarp::sig::draw::addCrossHair(out, pix, center.x, center.y, 10);
     }
-
-    // buffering old image size
-    _oldImgSize.width  = inSize.width;
-    _oldImgSize.height = inSize.height;
 }
@@ -0,0 +1,81 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+/*
+ * Copyright (C) 2016 iCub Facility - Istituto Italiano di Tecnologia
+ * CopyPolicy: Released under the terms of the GNU GPL v2.0.
+ *
+ */
+
+#ifndef __FIXEDPOINTREMAP__
+#define __FIXEDPOINTREMAP__
+
+#include <vector>
+
+// opencv
+#include <cv.h>
+
+
+/**
+ * Bilinear remap of rgb images with precomputed fixed-point tables.\n
+ * Every pixel of the output stores the integer part of its source coordinates
+ * on 16 bits and the index of its interpolation weights (1/32 of pixel),
+ * that is 6 bytes instead of the 8 of the two float maps given to cvRemap.
+ * The output can be a crop and/or a rescaling of the grid of the float maps,
+ * so that undistortion, cropping and downscaling are done in the same pass.
+ * The rows of the output are remapped in bands, in parallel when OpenMP is available.
+ * Pixels falling outside the input are filled with 0, as cvRemap does with
+ * CV_WARP_FILL_OUTLIERS.
+ */
+class FixedPointRemap
+{
+public:
+
+    FixedPointRemap();
+
+    /**
+     * Builds the tables from float maps (IPL_DEPTH_32F, 1 channel) that give,
+     * for every pixel of the undistorted image, its coordinates in the input image;
+     * the input image has the size of the maps.
+     * @param mapX, mapY the float maps
+     * @param crop the region of the undistorted image to output, in pixels of the maps
+     *        (it is clipped to the maps)
+     * @param outSize the size of the output; if it differs from the size of crop,
+     *        the maps are resampled so that the crop is rescaled to outSize
+     * @return false if the maps are not valid or the crop is empty
+     */
+    bool build(const IplImage *mapX, const IplImage *mapY, CvRect crop, CvSize outSize);
+
+    /** Releases the tables */
+    void release();
+
+    bool isValid() const { return _outSize.width>0 && _outSize.height>0; }
+    CvSize getInputSize() const { return _inSize; }
+    CvSize getOutputSize() const { return _outSize; }
+
+    /** Position in the output of a point of the undistorted image (in pixels of the maps) */
+    CvPoint toOutput(double x, double y) const;
+
+    /**
+     * Remaps in (IPL_DEPTH_8U, 3 channels, of the size of the maps)
+     * into out (IPL_DEPTH_8U, 3 channels, of size getOutputSize()).
+     */
+    void apply(const IplImage *in, IplImage *out) const;
+
+private:
+
+    enum { INTER_BITS=5, INTER_TAB_SIZE=1<<INTER_BITS, COEF_BITS=14, BAND_ROWS=16 };
+
+    CvSize _inSize;
+    CvSize _outSize;
+    CvRect _crop;
+
+    std::vector<short>          _xy;        // integer part of the source coordinates, 2 per pixel
+    std::vector<unsigned short> _weight;    // index of the weights in _wtab, 1 per pixel
+    int _wtab[INTER_TAB_SIZE*INTER_TAB_SIZE][4];
+
+    void remapRows(const IplImage *in, IplImage *out, int r0, int r1) const;
+};
+
+
+#endif
+
@@ -0,0 +1,191 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+/*
+ * Copyright (C) 2016 iCub Facility - Istituto Italiano di Tecnologia
+ * CopyPolicy: Released under the terms of the GNU GPL v2.0.
+ *
+ */
+
+#include <iCub/FixedPointRemap.h>
+
+using namespace std;
+
+FixedPointRemap::FixedPointRemap(){
+    _inSize = cvSize(0,0);
+    _outSize = cvSize(0,0);
+    _crop = cvRect(0,0,0,0);
+
+    // bilinear weights of every 1/32 of pixel, scaled so that they sum to 1<<COEF_BITS
+    for (int i=0; i<INTER_TAB_SIZE; i++){
+        for (int j=0; j<INTER_TAB_SIZE; j++){
+            double ay = (double)i/INTER_TAB_SIZE;
+            double ax = (double)j/INTER_TAB_SIZE;
+            double w[4] = { (1.0-ax)*(1.0-ay), ax*(1.0-ay), (1.0-ax)*ay, ax*ay };
+            int *wt = _wtab[i*INTER_TAB_SIZE+j];
+            int sum = 0, kmax = 0;
+            for (int k=0; k<4; k++){
+                wt[k] = cvRound(w[k]*(1<<COEF_BITS));
+                sum += wt[k];
+                if (wt[k] > wt[kmax])
+                    kmax = k;
+            }
+            wt[kmax] += (1<<COEF_BITS) - sum;
+        }
+    }
+}
+
+void FixedPointRemap::release(){
+    _inSize = cvSize(0,0);
+    _outSize = cvSize(0,0);
+    _crop = cvRect(0,0,0,0);
+    _xy.clear();
+    _weight.clear();
+}
+
+bool FixedPointRemap::build(const IplImage *mapX, const IplImage *mapY, CvRect crop, CvSize outSize){
+
+    release();
+
+    if (mapX == NULL || mapY == NULL ||
+        mapX->depth != IPL_DEPTH_32F || mapY->depth != IPL_DEPTH_32F ||
+        mapX->nChannels != 1 || mapY->nChannels != 1 ||
+        mapX->width != mapY->width || mapX->height != mapY->height)
+        return false;
+
+    int w = mapX->width;
+    int h = mapX->height;
+
+    // clip the crop to the maps, as cvSetImageROI does
+    int x0 = MAX(crop.x, 0);
+    int y0 = MAX(crop.y, 0);
+    int x1 = MIN(crop.x + crop.width, w);
+    int y1 = MIN(crop.y + crop.height, h);
+    if (x1 <= x0 || y1 <= y0 || outSize.width <= 0 || outSize.height <= 0)
+        return false;
+
+    double scaleX = (double)(x1-x0) / outSize.width;
+    double scaleY = (double)(y1-y0) / outSize.height;
+
+    size_t n = (size_t)outSize.width*outSize.height;
+    _xy.resize(2*n);
+    _weight.resize(n);
+
+    short *xy = &_xy[0];
+    unsigned short *weight = &_weight[0];
+    for (int v=0; v<outSize.height; v++){
+
+        // position of the output row on the grid of the maps (centers of the pixels aligned)
+        double V = y0 + (v+0.5)*scaleY - 0.5;
+        V = MIN(MAX(V, 0.0), h-1.0);
+        int iv = (int)V;
+        int iv1 = MIN(iv+1, h-1);
+        double fv = V - iv;
+
+        const float *mx0 = (const float*)(mapX->imageData + iv*mapX->widthStep);
+        const float *mx1 = (const float*)(mapX->imageData + iv1*mapX->widthStep);
+        const float *my0 = (const float*)(mapY->imageData + iv*mapY->widthStep);
+        const float *my1 = (const float*)(mapY->imageData + iv1*mapY->widthStep);
+
+        for (int u=0; u<outSize.width; u++, xy+=2, weight++){
+
+            double U = x0 + (u+0.5)*scaleX - 0.5;
+            U = MIN(MAX(U, 0.0), w-1.0);
+            int iu = (int)U;
+            int iu1 = MIN(iu+1, w-1);
+            double fu = U - iu;
+
+            double X = (1.0-fv)*((1.0-fu)*mx0[iu] + fu*mx0[iu1]) + fv*((1.0-fu)*mx1[iu] + fu*mx1[iu1]);
+            double Y = (1.0-fv)*((1.0-fu)*my0[iu] + fu*my0[iu1]) + fv*((1.0-fu)*my1[iu] + fu*my1[iu1]);
+
+            // whatever is beyond one pixel from the input is filled with 0 anyway
+            X = MIN(MAX(X, -2.0), w+1.0);
+            Y = MIN(MAX(Y, -2.0), h+1.0);
+
+            int fx = cvRound(X*INTER_TAB_SIZE);
+            int fy = cvRound(Y*INTER_TAB_SIZE);
+            xy[0] = (short)(fx >> INTER_BITS);
+            xy[1] = (short)(fy >> INTER_BITS);
+            *weight = (unsigned short)((fy & (INTER_TAB_SIZE-1))*INTER_TAB_SIZE + (fx & (INTER_TAB_SIZE-1)));
+        }
+    }
+
+    _inSize = cvSize(w, h);
+    _outSize = outSize;
+    _crop = cvRect(x0, y0, x1-x0, y1-y0);
+    return true;
+}
+
+CvPoint FixedPointRemap::toOutput(double x, double y) const{
+
+    if (!isValid())
+        return cvPoint(cvRound(x), cvRound(y));
+
+    return cvPoint(cvRound((x - _crop.x + 0.5)*_outSize.width/_crop.width - 0.5),
+                   cvRound((y - _crop.y + 0.5)*_outSize.height/_crop.height - 0.5));
+}
+
+void FixedPointRemap::remapRows(const IplImage *in, IplImage *out, int r0, int r1) const{
+
+    const int round = 1 << (COEF_BITS-1);
+    const int step = in->widthStep;
+    const unsigned char *src = (const unsigned char*)in->imageData;
+    const int lastX = _inSize.width-1;
+    const int lastY = _inSize.height-1;
+
+    for (int r=r0; r<r1; r++){
+
+        unsigned char *dst = (unsigned char*)(out->imageData + r*out->widthStep);
+        const short *xy = &_xy[2*(size_t)r*_outSize.width];
+        const unsigned short *weight = &_weight[(size_t)r*_outSize.width];
+
+        for (int c=0; c<_outSize.width; c++, xy+=2, dst+=3){
+
+            int x = xy[0];
+            int y = xy[1];
+            const int *wt = _wtab[weight[c]];
+
+            if ((unsigned)x < (unsigned)lastX && (unsigned)y < (unsigned)lastY){
+                const unsigned char *s0 = src + y*step + 3*x;
+                const unsigned char *s1 = s0 + step;
+                dst[0] = (unsigned char)((s0[0]*wt[0] + s0[3]*wt[1] + s1[0]*wt[2] + s1[3]*wt[3] + round) >> COEF_BITS);
+                dst[1] = (unsigned char)((s0[1]*wt[0] + s0[4]*wt[1] + s1[1]*wt[2] + s1[4]*wt[3] + round) >> COEF_BITS);
+                dst[2] = (unsigned char)((s0[2]*wt[0] + s0[5]*wt[1] + s1[2]*wt[2] + s1[5]*wt[3] + round) >> COEF_BITS);
+            }
+            else if (x >= -1 && x <= lastX && y >= -1 && y <= lastY){
+                // on the border: the neighbours outside the input count as 0
+                int acc[3] = { round, round, round };
+                for (int k=0; k<4; k++){
+                    int tx = x + (k&1);
+                    int ty = y + (k>>1);
+                    if (tx >= 0 && tx <= lastX && ty >= 0 && ty <= lastY){
+                        const unsigned char *s = src + ty*step + 3*tx;
+                        acc[0] += s[0]*wt[k];
+                        acc[1] += s[1]*wt[k];
+                        acc[2] += s[2]*wt[k];
+                    }
+                }
+                dst[0] = (unsigned char)(acc[0] >> COEF_BITS);
+                dst[1] = (unsigned char)(acc[1] >> COEF_BITS);
+                dst[2] = (unsigned char)(acc[2] >> COEF_BITS);
+            }
+            else{
+                dst[0] = dst[1] = dst[2] = 0;
+            }
+        }
+    }
+}
+
+void FixedPointRemap::apply(const IplImage *in, IplImage *out) const{
+
+    CV_Assert(isValid());
+    CV_Assert(in->depth == IPL_DEPTH_8U && in->nChannels == 3 &&
+              in->width == _inSize.width && in->height == _inSize.height);
+    CV_Assert(out->depth == IPL_DEPTH_8U && out->nChannels == 3 &&
+              out->width == _outSize.width && out->height == _outSize.height);
+
+    // bands of rows, one after the other or spread across the cores
+    int bands = (_outSize.height + BAND_ROWS - 1) / BAND_ROWS;
+    #pragma omp parallel for schedule(static)
+    for (int b=0; b<bands; b++)
+        remapRows(in, out, b*BAND_ROWS, MIN((b+1)*BAND_ROWS, _outSize.height));
+}
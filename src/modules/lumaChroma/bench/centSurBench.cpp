@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2016 iCub Facility - Istituto Italiano di Tecnologia
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+// Throughput and numerical equivalence of the centre-surround of lumaChroma on synthetic
+// YCrCb frames (with the size of the extended images of the module): the planes are split and
+// processed one by one with every level upsampled to full resolution (as the module did, the
+// code is below) and processed together by the fused kernel of CentSur.
+//
+// centSurBench [width] [height] [frames]
+// centSurBench 320 240 100
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+
+#include <yarp/os/Time.h>
+#include <iCub/centsur.h>
+
+using namespace std;
+using namespace yarp::os;
+
+#define KERNSIZE 3
+#define KERNSIZEMAX 9
+
+// the centre-surround before the fused kernel, on a single plane
+class LegacyCentSur
+{
+public:
+    LegacyCentSur(cv::Size size, int n) : srcSize(size), ngauss(n)
+    {
+        for (int ng=0; ng<ngauss; ng++)
+        {
+            int w=(int)ceil(((double)srcSize.width)/double(1<<ng));
+            psize.push_back(cv::Size(w, (int)ceil((((double)srcSize.height)/((double)srcSize.width))*w)));
+        }
+        csTot32f=cv::Mat(srcSize.height, srcSize.width, CV_32FC1);
+        csTot32fTmp=cv::Mat(srcSize.height, srcSize.width, CV_32FC1);
+    }
+
+    void proc_im_8u(const cv::Mat &img_8u)
+    {
+        img_8u.convertTo(img_32f, CV_32FC1, 1.0/255.0);
+
+        img_32f.copyTo(pyramid[0]);
+        cv::boxFilter(pyramid[0], pyramid_gauss[0], -1, cv::Size(KERNSIZE, KERNSIZE), cv::Point(-1,-1), true, cv::BORDER_REPLICATE);
+        pyramid_gauss[0].copyTo(gauss[0]);
+        for (int sg=1; sg<ngauss; sg++)
+        {
+            cv::resize(pyramid[sg-1], pyramid[sg], psize[sg], 0.5, 0.5, cv::INTER_LANCZOS4);
+            cv::boxFilter(pyramid[sg], pyramid_gauss[sg], -1, cv::Size(KERNSIZE, KERNSIZE), cv::Point(-1,-1), true, cv::BORDER_REPLICATE);
+            double su=double(1<<sg);
+            cv::resize(pyramid_gauss[sg], gauss[sg], srcSize, su, su, cv::INTER_LANCZOS4);
+        }
+
+        csTot32f.setTo(cv::Scalar(0));
+        for (int nd=0; nd<ngauss-1; nd++)
+        {
+            cv::absdiff(gauss[nd], gauss[nd+1], csTot32fTmp);
+            cv::add(csTot32fTmp, csTot32f, csTot32f);
+        }
+        for (int ndd=0; ndd<ngauss-2; ndd++)
+        {
+            cv::absdiff(gauss[ndd], gauss[ndd+2], csTot32fTmp);
+            cv::add(csTot32fTmp, csTot32f, csTot32f);
+        }
+        csTot32f.convertTo(csTot8u, CV_8UC1, 1.0*255.0);
+    }
+
+    cv::Mat csTot32f, csTot8u;
+
+private:
+    cv::Size srcSize;
+    int ngauss;
+    vector<cv::Size> psize;
+    cv::Mat pyramid[10], pyramid_gauss[10], gauss[10], img_32f, csTot32fTmp;
+};
+
+static void makeFrame(cv::Mat &rgb, int t)
+{
+    rgb.setTo(cv::Scalar(60, 60, 60));
+    for (int i=0; i<10; i++)
+    {
+        cv::Point p((41*i+5*t)%rgb.cols, (29*i+3*t)%rgb.rows);
+        cv::circle(rgb, p, 5+(13*i)%40, cv::Scalar((90*i)%256, (150*i+40)%256, (210*i+70)%256), -1);
+    }
+    for (int r=0; r<rgb.rows; r++)
+    {
+        uchar *row=rgb.ptr<uchar>(r);
+        for (int c=0; c<3*rgb.cols; c++)
+            row[c]=cv::saturate_cast<uchar>(row[c]+rand()%24-12);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int width  = argc>1 ? atoi(argv[1]) : 320;
+    int height = argc>2 ? atoi(argv[2]) : 240;
+    int frames = argc>3 ? atoi(argv[3]) : 100;
+    if (width<=0 || height<=0 || frames<=0)
+    {
+        fprintf(stderr, "centSurBench: wrong arguments\n");
+        return 1;
+    }
+
+    // the size of the images extended by lumaChroma, and its number of scales
+    cv::Size size(width+2*KERNSIZEMAX, height+KERNSIZEMAX);
+    const int ncsscale=4;
+
+    LegacyCentSur legacy(size, ncsscale);
+    CentSur fused(size, ncsscale);
+    cv::Mat rgb(size, CV_8UC3), ycc;
+
+    double tLegacy=0.0, tFused=0.0, maxDiff32f=0.0;
+    int maxDiff8u=0;
+    for (int t=0; t<frames; t++)
+    {
+        makeFrame(rgb, t);
+        cv::cvtColor(rgb, ycc, CV_RGB2YCrCb);
+
+        double t0=Time::now();
+        vector<cv::Mat> planes;
+        cv::split(ycc, planes);
+        vector<cv::Mat> legacy32f(3), legacy8u(3);
+        for (int c=0; c<3; c++)
+        {
+            legacy.proc_im_8u(planes[c]);
+            legacy.csTot32f.copyTo(legacy32f[c]);
+            legacy.csTot8u.copyTo(legacy8u[c]);
+        }
+        double t1=Time::now();
+        fused.proc_im_8u(ycc);
+        double t2=Time::now();
+
+        tLegacy+=t1-t0;
+        tFused+=t2-t1;
+        for (int c=0; c<3; c++)
+        {
+            maxDiff32f=max(maxDiff32f, cv::norm(legacy32f[c], fused.get_centsur_32f(c), cv::NORM_INF));
+            maxDiff8u=max(maxDiff8u, (int)cv::norm(legacy8u[c], fused.get_centsur_norm8u(c), cv::NORM_INF));
+        }
+    }
+
+    printf("centSurBench: %dx%d frames (extended to %dx%d), 3 planes, %d frames\n",
+           width, height, size.width, size.height, frames);
+    printf("centSurBench: per plane %.0f fps, fused %.0f fps, x%.1f, max difference %g (32f) %d (8u)\n",
+           frames/tLegacy, frames/tFused, tFused>0.0 ? tLegacy/tFused : 0.0, maxDiff32f, maxDiff8u);
+
+    // only the order of the float operations differs
+    return maxDiff32f<1e-4 && maxDiff8u<=1 ? 0 : 1;
+}
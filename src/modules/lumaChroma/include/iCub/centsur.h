@@ -29,6 +29,7 @@
 #ifndef __CENTSUR_H__
 #define __CENTSUR_H__
 
+#include <vector>
 #include <opencv2/opencv.hpp>
 
 class CentSur 
@@ -43,43 +44,58 @@ public:
      */
     ~CentSur();
 
-    cv::Mat csTot32f, csTot32fTmp, csTot8u;
-
     /**
      * convert image to 32f precision
+     * @param im_8u image of 1 to 3 channels, the channels are processed together
      */ 
     void proc_im_8u(const cv::Mat &im_8u);
 
     /**
-     * process 32f image creating gauss pyramids:
+     * process 32f image creating gauss pyramids and summing the differences of gaussians:
+     * @param im_32f image of 1 to 3 channels, the channels are processed together
      */
     void proc_im_32f( const cv::Mat &im_32f );
 
     /**
-     * get center surround image in 32f precision
+     * get center surround image of a channel in 32f precision
     */
-    cv::Mat get_centsur_32f(){ return csTot32f; }
+    cv::Mat get_centsur_32f(int channel = 0){ return csTot32f[channel]; }
 
     /**
-     * get center surround image in 8u precision
+     * get center surround image of a channel in 8u precision
      */
-    cv::Mat  get_centsur_norm8u(){ return csTot8u; }
+    cv::Mat  get_centsur_norm8u(int channel = 0){ return csTot8u[channel]; }
     
     
 private:
 
     cv::Size srcSize, *psize;
     cv::Rect *proi;
-    cv::Mat pyramid[10], pyramid_gauss[10], gauss[10], img_32f;
+    cv::Mat pyramid[10], pyramid_gauss[10], img_32f;
+    cv::Mat csTot32f[3], csTot8u[3];
     double sigma;
     int ngauss;
-    std::vector<cv::Mat> dst;
+    int nchannels;
+
+    /**
+     * the levels above the first are upsampled to srcSize (lanczos4, as cv::resize does)
+     * inside the centre-surround kernel: horizontally once per level, at the height of
+     * the level, and vertically row by row, so that the full resolution levels are never stored.
+     */
+    cv::Mat gauss_h[10];                        // pyramid_gauss upsampled horizontally only
+    std::vector<int>   xofs[10], yofs[10];      // source columns/rows of the 8 taps of every output column/row
+    std::vector<float> xalpha[10], yalpha[10];  // and their coefficients
+
     /**
      * creates pyramids
      */
     void make_pyramid(const cv::Mat &im_in);
+
+    /**
+     * sums the absolute differences of the 1st and 2nd neighbouring levels, row by row
+     */
+    void centre_surround();
 };
 #endif
 //empty line to make gcc happy
 
-
@@ -17,6 +17,8 @@
  */
 
 #include <math.h>
+#include <float.h>
+#include <algorithm>
 #include <iostream>
 #include <stdlib.h>
 #include "iCub/centsur.h"
@@ -25,12 +27,63 @@
 
 using namespace std;
 
+/**
+ * coefficients of the 8 taps of the lanczos4 interpolation at x (0<=x<1),
+ * computed as cv::resize does
+ */
+static void lanczos4_coeffs( float x, float *coeffs )
+{
+    static const double s45 = 0.70710678118654752440084436210485;
+    static const double cs[][2] = { {1, 0}, {-s45, -s45}, {0, 1}, {s45, -s45}, {-1, 0}, {s45, s45}, {0, -1}, {-s45, s45} };
+
+    if ( x < FLT_EPSILON )
+    {
+        for ( int i = 0; i < 8; i++ )
+            coeffs[i] = 0;
+        coeffs[3] = 1;
+        return;
+    }
+
+    float sum = 0;
+    double y0 = -(x+3)*CV_PI*0.25, s0 = sin(y0), c0 = cos(y0);
+    for ( int i = 0; i < 8; i++ )
+    {
+        double y = -(x+3-i)*CV_PI*0.25;
+        coeffs[i] = (float)((cs[i][0]*s0 + cs[i][1]*c0)/(y*y));
+        sum += coeffs[i];
+    }
+
+    sum = 1.f/sum;
+    for ( int i = 0; i < 8; i++ )
+        coeffs[i] *= sum;
+}
+
+/**
+ * taps of the lanczos4 upsampling from ssize to dsize samples (borders replicated)
+ */
+static void lanczos4_table( int ssize, int dsize, vector<int> &ofs, vector<float> &alpha )
+{
+    double scale = (double)ssize/dsize;
+    ofs.resize( 8*dsize );
+    alpha.resize( 8*dsize );
+    for (int d=0; d<dsize; d++)
+    {
+        float f = (float)((d+0.5)*scale - 0.5);
+        int s = cvFloor( f );
+        f -= s;
+        lanczos4_coeffs( f, &alpha[8*d] );
+        for (int k=0; k<8; k++)
+            ofs[8*d+k] = std::min( std::max( s-3+k, 0 ), ssize-1 );
+    }
+}
+
 CentSur::CentSur(cv::Size tmpSize,int tmpGauss, double tmpSigma)
 {
     srcSize = tmpSize;
     ngauss = 0;
     ngauss = tmpGauss;
     sigma = tmpSigma;
+    nchannels = 0;
     psize = (cv::Size*)malloc(ngauss*sizeof(cv::Size));
     proi = (cv::Rect*)malloc(ngauss*sizeof(cv::Rect));
 
@@ -42,15 +95,18 @@ CentSur::CentSur(cv::Size tmpSize,int tmpGauss, double tmpSigma)
         proi[ng].y          = 0;
         proi[ng].width      = psize[ng].width;
         proi[ng].height     = psize[ng].height;
-        pyramid[ng]         = cv::Mat ( psize[ng].height, psize[ng].width, CV_32FC1 );
-        pyramid_gauss[ng]   = cv::Mat ( psize[ng].height, psize[ng].width, CV_32FC1 );
-        gauss[ng]           = cv::Mat ( srcSize.height, srcSize.width, CV_32FC1 );
-        
+
+        if (ng > 0)
+        {
+            lanczos4_table( psize[ng].width, srcSize.width, xofs[ng], xalpha[ng] );
+            lanczos4_table( psize[ng].height, srcSize.height, yofs[ng], yalpha[ng] );
+        }
+    }
+    for (int c=0; c<3; c++)
+    {
+        csTot32f[c]     = cv::Mat ( srcSize.height, srcSize.width, CV_32FC1 );
+        csTot8u[c]      = cv::Mat ( srcSize.height, srcSize.width, CV_8UC1 );
     }
-    img_32f         = cv::Mat ( srcSize.height, srcSize.width, CV_32FC1 );
-    csTot32f        = cv::Mat ( srcSize.height, srcSize.width, CV_32FC1 );
-    csTot32fTmp     = cv::Mat ( srcSize.height, srcSize.width, CV_32FC1 );
-    csTot8u         = cv::Mat ( srcSize.height, srcSize.width, CV_8UC1 );
 }
 
 CentSur::~CentSur() 
@@ -63,54 +119,35 @@ CentSur::~CentSur()
     {
         pyramid[ng].release();
         pyramid_gauss[ng].release();
-        gauss[ng].release();
+        gauss_h[ng].release();
     }
     
     img_32f.release();
-    csTot32f.release();
-    csTot8u.release();
-    csTot32fTmp.release();
+    for (int c=0; c<3; c++)
+    {
+        csTot32f[c].release();
+        csTot8u[c].release();
+    }
 }
 
 void CentSur::proc_im_8u( const cv::Mat &img_8u )
 {
     //convert im precision to 32f:
-    img_8u.convertTo( img_32f, CV_32FC1, 1.0/255.0 );
+    img_8u.convertTo( img_32f, CV_MAKETYPE(CV_32F, img_8u.channels()), 1.0/255.0 );
     //process as normal:
     proc_im_32f( img_32f );
 }
 
 void CentSur::proc_im_32f( const cv::Mat &im_32f )
 {
-    //make image & gauss pyramids:
-    make_pyramid( im_32f );
-    
-    //reset tot cs_tot_tmp:
-    csTot32f.setTo( cv::Scalar(0) );
+    CV_Assert( im_32f.depth() == CV_32F && im_32f.channels() <= 3 && im_32f.size() == srcSize );
+    nchannels = im_32f.channels();
 
-    //subtractions (ABSDIFF) to make DOG pyramid:
-    //1st neighbours:  
-    for (int nd=0; nd<ngauss-1; nd++)
-    {
-        cv::absdiff( gauss[nd], gauss[nd+1], csTot32fTmp);
-        cv::add(csTot32fTmp, csTot32f, csTot32f);
-    }
+    //make image & gauss pyramids (at the resolution of the levels):
+    make_pyramid( im_32f );
 
-    //2nd neighbours:
-    for (int ndd=0;ndd<ngauss-2;ndd++)
-    {
-        cv::absdiff( gauss[ndd], gauss[ndd+2], csTot32fTmp);
-        cv::add(csTot32fTmp, csTot32f, csTot32f);
-    }
-    /*//norm8u:
-    double min, max;
-    min = 0.0f;
-    max = 0.0f;
-    cv::minMaxLoc(csTot32f, &min, &max);
-    if (max == min){max=255.0f;min=0.0f;}*/
-
-    //convert back to 8u with scale
-    csTot32f.convertTo( csTot8u, CV_8UC1, 1.0 * 255.0 );
+    //sum of the DOG pyramid, without the upsampled levels:
+    centre_surround();
 }
 
 void CentSur::make_pyramid( const cv::Mat &im_32f )
@@ -122,11 +159,8 @@ void CentSur::make_pyramid( const cv::Mat &im_32f )
     cv::Size ksize(KERNSIZE, KERNSIZE);
     cv::boxFilter(pyramid[0], pyramid_gauss[0],-1, ksize, anchor, true, cv::BORDER_REPLICATE); 
     //cv::GaussianBlur(pyramid[0], pyramid_gauss[0], cv::Size(1, 1), sigma, 0.0, cv::BORDER_REPLICATE );
-    //copy filter output to gauss:
-    pyramid_gauss[0].copyTo( gauss[0] );
 
     double sd = 0.5;
-    double su = 2.0;
 
     for (int sg=1;sg<ngauss;sg++)
     {
@@ -137,11 +171,78 @@ void CentSur::make_pyramid( const cv::Mat &im_32f )
         cv::Size ksize(KERNSIZE, KERNSIZE);
         cv::boxFilter(pyramid[sg], pyramid_gauss[sg],-1, ksize, anchor, true, cv::BORDER_REPLICATE); 
         //cv::GaussianBlur(pyramid[sg], pyramid_gauss[sg], cv::Size(1, 1), sigma, 0.0, cv::BORDER_REPLICATE );
-        su = double(1<< sg); 
-        //Upsize and store to gauss:
-        cv::resize(pyramid_gauss[sg], gauss[sg], srcSize/*cv::Size(proi[sg].width,proi[sg].height)*/, su, su, cv::INTER_LANCZOS4);
-//cv::INTER_LANCZOS4 INTER_CUBIC
+
+        //Upsize horizontally only, the rows are upsized by centre_surround():
+        const int cn = nchannels;
+        const int *ofs = &xofs[sg][0];
+        const float *alpha = &xalpha[sg][0];
+        gauss_h[sg].create( psize[sg].height, srcSize.width, CV_MAKETYPE(CV_32F, cn) );
+        #pragma omp parallel for schedule(static)
+        for (int r=0; r<psize[sg].height; r++)
+        {
+            const float *S = pyramid_gauss[sg].ptr<float>(r);
+            float *D = gauss_h[sg].ptr<float>(r);
+            for (int x=0; x<srcSize.width; x++, D+=cn)
+            {
+                const int *o = ofs + 8*x;
+                const float *a = alpha + 8*x;
+                for (int c=0; c<cn; c++)
+                    D[c] = S[o[0]*cn+c]*a[0] + S[o[1]*cn+c]*a[1] + S[o[2]*cn+c]*a[2] + S[o[3]*cn+c]*a[3] +
+                           S[o[4]*cn+c]*a[4] + S[o[5]*cn+c]*a[5] + S[o[6]*cn+c]*a[6] + S[o[7]*cn+c]*a[7];
+            }
+        }
     }
 }
 
+void CentSur::centre_surround()
+{
+    const int cn = nchannels;
+    const int width = srcSize.width;
+    const int rowlen = width*cn;
 
+    #pragma omp parallel
+    {
+        //one upsampled row per level (level 0 is already at full resolution)
+        vector<float> rows( ngauss*rowlen );
+        vector<const float*> level( ngauss );
+
+        #pragma omp for schedule(static)
+        for (int y=0; y<srcSize.height; y++)
+        {
+            level[0] = pyramid_gauss[0].ptr<float>(y);
+            for (int sg=1; sg<ngauss; sg++)
+            {
+                const int *o = &yofs[sg][8*y];
+                const float *b = &yalpha[sg][8*y];
+                const float *S0 = gauss_h[sg].ptr<float>(o[0]), *S1 = gauss_h[sg].ptr<float>(o[1]);
+                const float *S2 = gauss_h[sg].ptr<float>(o[2]), *S3 = gauss_h[sg].ptr<float>(o[3]);
+                const float *S4 = gauss_h[sg].ptr<float>(o[4]), *S5 = gauss_h[sg].ptr<float>(o[5]);
+                const float *S6 = gauss_h[sg].ptr<float>(o[6]), *S7 = gauss_h[sg].ptr<float>(o[7]);
+                float *D = &rows[sg*rowlen];
+                for (int i=0; i<rowlen; i++)
+                    D[i] = S0[i]*b[0] + S1[i]*b[1] + S2[i]*b[2] + S3[i]*b[3] +
+                           S4[i]*b[4] + S5[i]*b[5] + S6[i]*b[6] + S7[i]*b[7];
+                level[sg] = D;
+            }
+
+            for (int c=0; c<cn; c++)
+            {
+                float *tot = csTot32f[c].ptr<float>(y);
+                uchar *tot8u = csTot8u[c].ptr<uchar>(y);
+                for (int x=0, i=c; x<width; x++, i+=cn)
+                {
+                    float sum = 0;
+                    //1st neighbours:
+                    for (int nd=0; nd<ngauss-1; nd++)
+                        sum += fabsf( level[nd][i] - level[nd+1][i] );
+                    //2nd neighbours:
+                    for (int ndd=0; ndd<ngauss-2; ndd++)
+                        sum += fabsf( level[ndd][i] - level[ndd+2][i] );
+                    tot[x] = sum;
+                    //convert back to 8u with scale
+                    tot8u[x] = cv::saturate_cast<uchar>( sum * 255.0f );
+                }
+            }
+        }
+    }
+}
@@ -233,35 +233,17 @@ void PROCThread::onRead(ImageOf<yarp::sig::PixelRgb> &img)
     else
         cv::cvtColor( inputMat, orig, CV_RGB2HSV);
     
-    vector<cv::Mat> planes;
-    cv::split(orig, planes);
-    //performs centre-surround uniqueness analysis on first plane
-    centerSurr->proc_im_8u( planes[0] );
+    //performs centre-surround uniqueness analysis on the three planes in one pass
+    centerSurr->proc_im_8u( orig );
 
-    IplImage y_img = centerSurr->get_centsur_norm8u();
+    IplImage y_img = centerSurr->get_centsur_norm8u( 0 );
     cvCopy( &y_img, ( IplImage *)img_Y->getIplImage());
-    csTot32f.setTo(cv::Scalar(0));
 
-    //performs centre-surround uniqueness analysis on second plane:
-    centerSurr->proc_im_8u( planes[1] );
-    if ( isYUV )
-        cv::add(centerSurr->get_centsur_32f(), csTot32f, csTot32f);
-    else
-    {
-        IplImage s_img = centerSurr->get_centsur_norm8u();
-        cvCopy( &y_img, ( IplImage *)img_UV->getIplImage());
-    }
-    //performs centre-surround uniqueness analysis on third plane:
-    centerSurr->proc_im_8u( planes[2] );
-    if ( isYUV )
-        cv::add(centerSurr->get_centsur_32f(), csTot32f, csTot32f);
-    else
-    {
-        IplImage v_img = centerSurr->get_centsur_norm8u();
-        cvCopy( &v_img, ( IplImage *)img_V->getIplImage());
-    }
     if ( isYUV )
     {
+        //colour uniqueness is the sum of the second and third planes
+        cv::add(centerSurr->get_centsur_32f( 1 ), centerSurr->get_centsur_32f( 2 ), csTot32f);
+
         //get min max   
         double valueMin = 0.0f;
         double  valueMax = 0.0f;
@@ -274,6 +256,13 @@ void PROCThread::onRead(ImageOf<yarp::sig::PixelRgb> &img)
         IplImage uv_img = uvimg;
         cvCopy( &uv_img, ( IplImage *)img_UV->getIplImage());
     }
+    else
+    {
+        IplImage s_img = centerSurr->get_centsur_norm8u( 1 );
+        cvCopy( &s_img, ( IplImage *)img_UV->getIplImage());
+        IplImage v_img = centerSurr->get_centsur_norm8u( 2 );
+        cvCopy( &v_img, ( IplImage *)img_V->getIplImage());
+    }
     //this is nasty, resizes the images...
     unsigned char* imgY = img_Y->getPixelAddress( KERNSIZEMAX, KERNSIZEMAX );
     unsigned char* imgUV = img_UV->getPixelAddress( KERNSIZEMAX, KERNSIZEMAX );
@@ -65,6 +65,81 @@ public:
 };
 
 
+/************************************************************************/
+class FlowTile
+{
+public:
+    IplImage     *imgPrev;
+    IplImage     *imgCurr;
+    IplImage     *pyrPrev;
+    IplImage     *pyrCurr;
+    CvPoint2D32f *nodesPrev;
+    CvPoint2D32f *nodesCurr;
+    char         *featuresFound;
+    float        *featuresErrors;
+    int           count;
+    int           winSize;
+    int           flags;
+
+    /************************************************************************/
+    void track()
+    {
+        if (count>0)
+            cvCalcOpticalFlowPyrLK(imgPrev,imgCurr,pyrPrev,pyrCurr,
+                                   nodesPrev,nodesCurr,count,
+                                   cvSize(winSize,winSize),5,featuresFound,featuresErrors,
+                                   cvTermCriteria(CV_TERMCRIT_ITER|CV_TERMCRIT_EPS,20,0.3),flags);
+    }
+};
+
+
+/************************************************************************/
+class FlowWorker : public Thread
+{
+protected:
+    Semaphore startEvent;
+    Semaphore doneEvent;
+    FlowTile  tile;
+
+public:
+    /************************************************************************/
+    FlowWorker() : startEvent(0), doneEvent(0) { }
+
+    /************************************************************************/
+    void post(const FlowTile &t)
+    {
+        tile=t;
+        startEvent.post();
+    }
+
+    /************************************************************************/
+    void wait()
+    {
+        doneEvent.wait();
+    }
+
+    /************************************************************************/
+    void run()
+    {
+        while (true)
+        {
+            startEvent.wait();
+            if (isStopping())
+                break;
+
+            tile.track();
+            doneEvent.post();
+        }
+    }
+
+    /************************************************************************/
+    void onStop()
+    {
+        startEvent.post();
+    }
+};
+
+
 /************************************************************************/
 class ProcessThread : public Thread
 {
@@ -88,46 +163,131 @@ protected:
     int nodesNum;
     int nodesX;
     int nodesY;    
+    int flowThreads;
 
 #ifdef _MOTIONCUT_MULTITHREADING_OPENMP
     int numThreads;
 #endif
 
-    ImageOf<PixelMono>  imgMonoIn;
-    ImageOf<PixelMono>  imgMonoPrev;
-    ImageOf<PixelFloat> imgPyrPrev;
-    ImageOf<PixelFloat> imgPyrCurr;
+    // the current frame and its pyramid become the previous ones
+    // of the next cycle by swapping the index
+    ImageOf<PixelMono>  imgMono[2];
+    ImageOf<PixelFloat> imgPyr[2];
+    int                 prevIdx;
+    bool                pyrPrevReady;
+
+    // used when the corresponding output port is not connected
+    ImageOf<PixelBgr>   imgBgrOutLocal;
+    ImageOf<PixelMono>  imgMonoOptLocal;
 
     CvPoint2D32f        *nodesPrev;
     CvPoint2D32f        *nodesCurr;
     int                 *nodesPersistence;
     char                *featuresFound;
     float               *featuresErrors;
+    int                 *nodesParent;
 
-    set<int>             activeNodesIndexSet;
+    vector<int>          activeNodesIndexList;
+    vector<char>         activeNodes;
     deque<Blob>          blobSortedList;
 
+    vector<FlowWorker*>  flowWorkers;
+
     BufferedPort<ImageOf<PixelBgr> >  inPort;
     BufferedPort<ImageOf<PixelBgr> >  outPort;
     BufferedPort<ImageOf<PixelMono> > optPort;
     BufferedPort<ImageOf<PixelBgr> >  cropPort;
     BufferedPort<Bottle>              nodesPort;
     BufferedPort<Bottle>              blobsPort;
+    BufferedPort<Bottle>              timingPort;
 
     /************************************************************************/
     void disposeMem()
     {
-        delete nodesPrev;
-        delete nodesCurr;
-        delete nodesPersistence;
-        delete featuresFound;
-        delete featuresErrors;
+        delete[] nodesPrev;
+        delete[] nodesCurr;
+        delete[] nodesPersistence;
+        delete[] featuresFound;
+        delete[] featuresErrors;
+        delete[] nodesParent;
 
         nodesPrev=NULL;
         nodesCurr=NULL;
         nodesPersistence=NULL;
         featuresFound=NULL;
         featuresErrors=NULL;
+        nodesParent=NULL;
+    }
+
+    /************************************************************************/
+    void startFlowWorkers()
+    {
+        // the calling thread tracks one tile itself
+        for (int i=1; i<flowThreads; i++)
+        {
+            FlowWorker *worker=new FlowWorker;
+            if (worker->start())
+                flowWorkers.push_back(worker);
+            else
+                delete worker;
+        }
+    }
+
+    /************************************************************************/
+    void stopFlowWorkers()
+    {
+        for (size_t i=0; i<flowWorkers.size(); i++)
+        {
+            flowWorkers[i]->stop();
+            delete flowWorkers[i];
+        }
+
+        flowWorkers.clear();
+    }
+
+    /************************************************************************/
+    void computeFlow()
+    {
+        int curr=1-prevIdx;
+
+        FlowTile tile;
+        tile.imgPrev=(IplImage*)imgMono[prevIdx].getIplImage();
+        tile.imgCurr=(IplImage*)imgMono[curr].getIplImage();
+        tile.pyrPrev=(IplImage*)imgPyr[prevIdx].getIplImage();
+        tile.pyrCurr=(IplImage*)imgPyr[curr].getIplImage();
+        tile.winSize=winSize;
+
+        // the nodes are split in tiles of consecutive rows, one per thread;
+        // the first tile builds the pyramid of the current frame (and the previous one
+        // if it is not available from the last cycle), which is then shared by the others
+        int numTiles=(int)flowWorkers.size()+1;
+        int rowsPerTile=(nodesY+numTiles-1)/numTiles;
+        int nodesPerTile=rowsPerTile*nodesX;
+
+        for (int t=0; t<numTiles; t++)
+        {
+            int first=t*nodesPerTile;
+            tile.nodesPrev=nodesPrev+first;
+            tile.nodesCurr=nodesCurr+first;
+            tile.featuresFound=featuresFound+first;
+            tile.featuresErrors=featuresErrors+first;
+            tile.count=std::max(0,std::min(nodesPerTile,nodesNum-first));
+
+            if (t==0)
+            {
+                tile.flags=pyrPrevReady?CV_LKFLOW_PYR_A_READY:0;
+                tile.track();
+                tile.flags=CV_LKFLOW_PYR_A_READY|CV_LKFLOW_PYR_B_READY;
+            }
+            else
+                flowWorkers[t-1]->post(tile);
+        }
+
+        for (size_t i=0; i<flowWorkers.size(); i++)
+            flowWorkers[i]->wait();
+
+        prevIdx=curr;
+        pyrPrevReady=true;
     }
 
 #ifdef _MOTIONCUT_MULTITHREADING_OPENMP
@@ -170,6 +330,7 @@ public:
         adjNodesThres=rf.check("adjNodesThres",Value(4)).asInt();
         blobMinSizeThres=rf.check("blobMinSizeThres",Value(10)).asInt();
         framesPersistence=rf.check("framesPersistence",Value(3)).asInt();        
+        flowThreads=std::max(1,rf.check("flowThreads",Value(4)).asInt());
         verbosity=rf.check("verbosity");
 
         cropSize=0;
@@ -198,6 +359,11 @@ public:
         nodesPersistence=NULL;
         featuresFound=NULL;
         featuresErrors=NULL;
+        nodesParent=NULL;
+        prevIdx=0;
+        pyrPrevReady=false;
+
+        startFlowWorkers();
         
         inPort.open(("/"+name+"/img:i").c_str());
         outPort.open(("/"+name+"/img:o").c_str());
@@ -205,6 +371,7 @@ public:
         nodesPort.open(("/"+name+"/nodes:o").c_str());
         blobsPort.open(("/"+name+"/blobs:o").c_str());
         cropPort.open(("/"+name+"/crop:o").c_str());
+        timingPort.open(("/"+name+"/timing:o").c_str());
 
         firstConsistencyCheck=true;
 
@@ -228,6 +395,7 @@ public:
             yInfo("adjNodesThres     = %d",adjNodesThres);
             yInfo("blobMinSizeThres  = %d",blobMinSizeThres);
             yInfo("framesPersistence = %d",framesPersistence);
+            yInfo("flowThreads       = %d",(int)flowWorkers.size()+1);
             if (cropSize>0)
                 yInfo("cropSize          = %d",cropSize);
             else
@@ -248,7 +416,7 @@ public:
     /************************************************************************/
     void run()
     {
-        double latch_t, dt0, dt1, dt2;
+        double latch_t, dt0, dt1, dt2, dt3, dt4;
 
         while (!isStopping())
         {
@@ -264,25 +432,27 @@ public:
             double t0=Time::now();
              
             // consistency check
-            if (firstConsistencyCheck || (pImgBgrIn->width()!=imgMonoIn.width()) ||
-                (pImgBgrIn->height()!=imgMonoIn.height()))
+            if (firstConsistencyCheck || (pImgBgrIn->width()!=imgMono[prevIdx].width()) ||
+                (pImgBgrIn->height()!=imgMono[prevIdx].height()))
             {
                 firstConsistencyCheck=false;
 
-                imgMonoIn.resize(*pImgBgrIn);
-                imgMonoPrev.resize(*pImgBgrIn);
-
-                imgPyrPrev.resize(pImgBgrIn->width()+8,pImgBgrIn->height()/3);
-                imgPyrCurr.resize(pImgBgrIn->width()+8,pImgBgrIn->height()/3);
+                for (int i=0; i<2; i++)
+                {
+                    imgMono[i].resize(*pImgBgrIn);
+                    imgPyr[i].resize(pImgBgrIn->width()+8,pImgBgrIn->height()/3);
+                }
+                prevIdx=0;
+                pyrPrevReady=false;
 
                 // dispose previously allocated memory
                 disposeMem();
                 
-                int min_x=(int)(((1.0-coverXratio)/2.0)*imgMonoIn.width());
-                int min_y=(int)(((1.0-coverYratio)/2.0)*imgMonoIn.height());
+                int min_x=(int)(((1.0-coverXratio)/2.0)*pImgBgrIn->width());
+                int min_y=(int)(((1.0-coverYratio)/2.0)*pImgBgrIn->height());
 
-                nodesX=(imgMonoIn.width()-2*min_x)/nodesStep+1;
-                nodesY=(imgMonoIn.height()-2*min_y)/nodesStep+1;
+                nodesX=(pImgBgrIn->width()-2*min_x)/nodesStep+1;
+                nodesY=(pImgBgrIn->height()-2*min_y)/nodesStep+1;
 
                 nodesNum=nodesX*nodesY;
 
@@ -292,23 +462,26 @@ public:
 
                 featuresFound=new char[nodesNum];
                 featuresErrors=new float[nodesNum];
+                nodesParent=new int[nodesNum];
 
                 memset(nodesPersistence,0,nodesNum*sizeof(int));
+                activeNodes.assign(nodesNum,0);
+                activeNodesIndexList.reserve(nodesNum);
                 
                 // populate grid
                 int cnt=0;
-                for (int y=min_y; y<=(imgMonoIn.height()-min_y); y+=nodesStep)
-                    for (int x=min_x; x<=(imgMonoIn.width()-min_x); x+=nodesStep)
+                for (int y=min_y; y<=(pImgBgrIn->height()-min_y); y+=nodesStep)
+                    for (int x=min_x; x<=(pImgBgrIn->width()-min_x); x+=nodesStep)
                         nodesPrev[cnt++]=cvPoint2D32f(x,y);
 
                 // convert to gray-scale
-                cvCvtColor(pImgBgrIn->getIplImage(),imgMonoPrev.getIplImage(),CV_BGR2GRAY);
+                cvCvtColor(pImgBgrIn->getIplImage(),imgMono[prevIdx].getIplImage(),CV_BGR2GRAY);
 
                 if (verbosity)
                 {
                     // log message
                     yInfo("Detected image of size %dx%d; using %dx%d=%d nodes; populated %d nodes",
-                          imgMonoIn.width(),imgMonoIn.height(),nodesX,nodesY,nodesNum,cnt);
+                          pImgBgrIn->width(),pImgBgrIn->height(),nodesX,nodesY,nodesNum,cnt);
                 }
 
                 // skip to the next cycle
@@ -316,15 +489,22 @@ public:
             }
 
             // convert the input image to gray-scale
-            cvCvtColor(pImgBgrIn->getIplImage(),imgMonoIn.getIplImage(),CV_BGR2GRAY);
+            latch_t=Time::now();
+            cvCvtColor(pImgBgrIn->getIplImage(),imgMono[1-prevIdx].getIplImage(),CV_BGR2GRAY);
+
+            // the output images are drawn directly in the buffers of the ports
+            bool sendOut=(outPort.getOutputCount()>0);
+            bool sendOpt=(optPort.getOutputCount()>0);
 
             // copy input image into output image
-            ImageOf<PixelBgr> imgBgrOut=*pImgBgrIn;
+            ImageOf<PixelBgr> &imgBgrOut=sendOut?outPort.prepare():imgBgrOutLocal;
+            imgBgrOut=*pImgBgrIn;
 
             // get optFlow image
-            ImageOf<PixelMono> imgMonoOpt;
+            ImageOf<PixelMono> &imgMonoOpt=sendOpt?optPort.prepare():imgMonoOptLocal;
             imgMonoOpt.resize(imgBgrOut);
             imgMonoOpt.zero();
+            dt0=Time::now()-latch_t;
 
             // declare output bottles
             Bottle nodesBottle;
@@ -335,17 +515,15 @@ public:
             nodesStepBottle.addInt(nodesStep);
 
             // purge the content of variables
-            activeNodesIndexSet.clear();
+            for (size_t i=0; i<activeNodesIndexList.size(); i++)
+                activeNodes[activeNodesIndexList[i]]=0;
+            activeNodesIndexList.clear();
             blobSortedList.clear();
 
             // compute optical flow
             latch_t=Time::now();
-            cvCalcOpticalFlowPyrLK(imgMonoPrev.getIplImage(),imgMonoIn.getIplImage(),
-                                   imgPyrPrev.getIplImage(),imgPyrCurr.getIplImage(),
-                                   nodesPrev,nodesCurr,nodesNum,
-                                   cvSize(winSize,winSize),5,featuresFound,featuresErrors,
-                                   cvTermCriteria(CV_TERMCRIT_ITER|CV_TERMCRIT_EPS,20,0.3),0);
-            dt0=Time::now()-latch_t;
+            computeFlow();
+            dt1=Time::now()-latch_t;
 
             // assign status to the grid nodes
             latch_t=Time::now();
@@ -365,8 +543,8 @@ public:
                     nodeBottle.addInt((int)nodesPrev[i].x);
                     nodeBottle.addInt((int)nodesPrev[i].y);
 
-                    // update the active nodes set
-                    activeNodesIndexSet.insert(i);
+                    // update the active nodes list
+                    activateNode(i);
 
                     nodesPersistence[i]--;
 
@@ -406,13 +584,13 @@ public:
                             nodeBottle.addInt((int)nodesPrev[i].x);
                             nodeBottle.addInt((int)nodesPrev[i].y);
 
-                            // update the active nodes set
-                            activeNodesIndexSet.insert(i);
+                            // update the active nodes list
+                            activateNode(i);
                         }
                     }
                 }
             }
-            dt1=Time::now()-latch_t;
+            dt2=Time::now()-latch_t;
 
             latch_t=Time::now();
             findBlobs();
@@ -434,19 +612,18 @@ public:
 
                 cvCircle(imgBgrOut.getIplImage(),centroid,4,cvScalar(blueLev,0,redLev),3);
             }
-            dt2=Time::now()-latch_t;
+            dt3=Time::now()-latch_t;
 
             // send out images, propagating the time-stamp
-            if (outPort.getOutputCount()>0)
+            latch_t=Time::now();
+            if (sendOut)
             {
-                outPort.prepare()=imgBgrOut;
                 outPort.setEnvelope(stamp);
                 outPort.write();
             }
 
-            if (optPort.getOutputCount()>0)
+            if (sendOpt)
             {
-                optPort.prepare()=imgMonoOpt;
                 optPort.setEnvelope(stamp);
                 optPort.write();
             }
@@ -488,20 +665,51 @@ public:
                 cropPort.setEnvelope(stamp);
                 cropPort.write();
             }
+            dt4=Time::now()-latch_t;
 
-            // save data for next cycle
-            imgMonoPrev=imgMonoIn;
-            
             double t1=Time::now();
+            if (timingPort.getOutputCount()>0)
+            {
+                // per-stage timing breakdown [ms]
+                Bottle &timing=timingPort.prepare();
+                timing.clear();
+                addTiming(timing,"convert",dt0);
+                addTiming(timing,"optflow",dt1);
+                addTiming(timing,"colorgrid",dt2);
+                addTiming(timing,"blobdetection",dt3);
+                addTiming(timing,"output",dt4);
+                addTiming(timing,"overall",t1-t0);
+                timingPort.setEnvelope(stamp);
+                timingPort.write();
+            }
+
             if (verbosity)
             {
                 // dump statistics
-                yInfo("cycle timing [ms]: optflow(%g), colorgrid(%g), blobdetection(%g), overall(%g)",
-                      1000.0*dt0,1000.0*dt1,1000.0*dt2,1000.0*(t1-t0));
+                yInfo("cycle timing [ms]: convert(%g), optflow(%g), colorgrid(%g), blobdetection(%g), output(%g), overall(%g)",
+                      1000.0*dt0,1000.0*dt1,1000.0*dt2,1000.0*dt3,1000.0*dt4,1000.0*(t1-t0));
             }
         }
     }
 
+    /************************************************************************/
+    void addTiming(Bottle &timing, const char *stage, const double dt)
+    {
+        Bottle &item=timing.addList();
+        item.addString(stage);
+        item.addDouble(1000.0*dt);
+    }
+
+    /************************************************************************/
+    void activateNode(const int i)
+    {
+        if (!activeNodes[i])
+        {
+            activeNodes[i]=1;
+            activeNodesIndexList.push_back(i);
+        }
+    }
+
     /************************************************************************/
     void onStop()
     {
@@ -511,6 +719,7 @@ public:
     /************************************************************************/
     void threadRelease()
     {
+        stopFlowWorkers();
         disposeMem();
 
         inPort.close();
@@ -519,6 +728,7 @@ public:
         nodesPort.close();
         blobsPort.close();
         cropPort.close();
+        timingPort.close();
     }
 
     /************************************************************************/
@@ -527,17 +737,77 @@ public:
         return name;
     }
 
+    /************************************************************************/
+    int findRoot(int i)
+    {
+        // path halving
+        while (nodesParent[i]!=i)
+        {
+            nodesParent[i]=nodesParent[nodesParent[i]];
+            i=nodesParent[i];
+        }
+
+        return i;
+    }
+
     /************************************************************************/
     void findBlobs()
     {
-        // iterate until the set is empty
-        while (activeNodesIndexSet.size())
+        // visit the active nodes in increasing order, as the blobs are discovered
+        // in the order of their first node
+        std::sort(activeNodesIndexList.begin(),activeNodesIndexList.end());
+
+        // join every active node with its active 8-neighbours that come before it;
+        // the root of a blob is its smallest node (the active nodes are never on
+        // the border of the grid, hence the neighbours are always within the grid)
+        for (size_t n=0; n<activeNodesIndexList.size(); n++)
         {
-            Blob blob;
+            int i=activeNodesIndexList[n];
+            nodesParent[i]=i;
+
+            const int prev[4]={ i-nodesX-1, i-nodesX, i-nodesX+1, i-1 };
+            for (int j=0; j<4; j++)
+            {
+                int k=prev[j];
+                if ((k>=0) && activeNodes[k])
+                {
+                    int ri=findRoot(i);
+                    int rk=findRoot(k);
+                    if (ri<rk)
+                        nodesParent[rk]=ri;
+                    else if (rk<ri)
+                        nodesParent[ri]=rk;
+                }
+            }
+        }
 
-            // the nodes connected to the current one
-            // will be removed from the list            
-            floodFill(*(activeNodesIndexSet.begin()),&blob);
+        // number the blobs in the order of their roots, then accumulate every node on its blob
+        vector<int> roots(activeNodesIndexList.size());
+        for (size_t n=0; n<activeNodesIndexList.size(); n++)
+            roots[n]=findRoot(activeNodesIndexList[n]);
+
+        vector<Blob> blobs;
+        for (size_t n=0; n<activeNodesIndexList.size(); n++)
+        {
+            if (roots[n]==activeNodesIndexList[n])
+            {
+                nodesParent[roots[n]]=-(int)blobs.size()-1;
+                blobs.push_back(Blob());
+            }
+        }
+
+        for (size_t n=0; n<activeNodesIndexList.size(); n++)
+        {
+            int i=activeNodesIndexList[n];
+            Blob &blob=blobs[-nodesParent[roots[n]]-1];
+            blob.centroid.x+=(int)nodesPrev[i].x;
+            blob.centroid.y+=(int)nodesPrev[i].y;
+            blob.size++;
+        }
+
+        for (size_t b=0; b<blobs.size(); b++)
+        {
+            Blob &blob=blobs[b];
 
             // update centroid
             blob.centroid.x/=blob.size;
@@ -549,28 +819,6 @@ public:
         }
     }
 
-    /************************************************************************/
-    void floodFill(const int i, Blob *pBlob)
-    {
-        set<int>::iterator el=activeNodesIndexSet.find(i);
-        if ((el!=activeNodesIndexSet.end()) && (pBlob!=NULL))
-        {
-            // update blob
-            pBlob->centroid.x+=(int)nodesPrev[i].x;
-            pBlob->centroid.y+=(int)nodesPrev[i].y;
-            pBlob->size++;
-
-            // remove element from the set            
-            activeNodesIndexSet.erase(el);
-
-            // perform recursive exploration
-            for (int j=i-nodesX; j<=(i+nodesX); j+=nodesX)
-                for (int k=j-1; k<=(j+1); k++)
-                    if (k!=i)
-                        floodFill(k,pBlob);
-        }
-    }
-
     /************************************************************************/
     void insertBlob(const Blob &blob)
     {
@@ -804,6 +1052,7 @@ int main(int argc, char *argv[])
         printf("\t--blobMinSizeThres  <int>\n");
         printf("\t--framesPersistence <int>\n");
         printf("\t--cropSize          \"auto\" or <int>\n");
+        printf("\t--flowThreads       <int>\n");
     #ifdef _MOTIONCUT_MULTITHREADING_OPENMP
         printf("\t--numThreads        <int>\n");
     #endif
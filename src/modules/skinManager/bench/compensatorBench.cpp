@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2016 iCub Facility - Istituto Italiano di Tecnologia
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+// Benchmark of the compensation kernel of the skinManager on a synthetic full-body skin.
+// The taxels are laid out in triangles of 12 taxels on a plane, some patches are pressed and all the taxels
+// drift and are noisy. Every cycle runs the compensation, the baseline update and the clustering of the taxels
+// in touch into contacts (as getContacts() does); the same work is done by the per-taxel loops on vector<bool>
+// and list<int> and by the merge of the contacts in deques that the Compensator used before, as a reference. The neighbors are computed both by comparing
+// all the pairs of taxels and by the TaxelGrid of the skinDynLib.
+//
+// compensatorBench [taxels] [cycles] [maxNeighborDistance]
+// compensatorBench 4608 2000 0.015
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <ctime>
+#include <list>
+#include <deque>
+#include <vector>
+#include <algorithm>
+
+#include "iCub/skinDynLib/TaxelGrid.h"
+#include "iCub/skinManager/compensatorKernel.h"
+
+using namespace std;
+using namespace iCub::skinManager;
+using namespace iCub::skinDynLib;
+
+static const double MAX_SKIN = 255.0;
+
+struct Skin
+{
+    unsigned int n;
+    vector<double> x, y, z;
+    vector< vector<double> > frames;   // raw data of every cycle
+};
+
+// triangles of 12 taxels (radius 6 mm) on a grid with pitch 16 mm
+static void makeSkin(Skin &s, unsigned int taxels, unsigned int frames)
+{
+    s.n = taxels;
+    s.x.resize(taxels); s.y.resize(taxels); s.z.assign(taxels, 0.0);
+    unsigned int triangles = (taxels+11)/12;
+    unsigned int side = (unsigned int)ceil(sqrt((double)triangles));
+    for(unsigned int i=0; i<taxels; i++){
+        unsigned int t = i/12, k = i%12;
+        double a = 6.283185307179586*k/12.0;
+        s.x[i] = 0.016*(t%side) + 0.006*cos(a);
+        s.y[i] = 0.016*(t/side) + 0.006*sin(a);
+    }
+
+    srand(1);
+    s.frames.resize(frames);
+    for(unsigned int f=0; f<frames; f++){
+        vector<double> &raw = s.frames[f];
+        raw.resize(taxels);
+        // a few presses that move along the skin
+        unsigned int press = (f/50)*97 % triangles;
+        for(unsigned int i=0; i<taxels; i++){
+            double v = 240.0 - 0.002*f + (rand()%3) - 1.0;
+            unsigned int t = i/12;
+            if(t>=press && t<press+6)
+                v -= 60.0;
+            raw[i] = max(0.0, min(MAX_SKIN, floor(v)));
+        }
+    }
+}
+
+static double seconds()
+{
+    return (double)clock()/CLOCKS_PER_SEC;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int taxels = argc>1 ? atoi(argv[1]) : 4608;
+    unsigned int cycles = argc>2 ? atoi(argv[2]) : 2000;
+    double maxNeighDist = argc>3 ? atof(argv[3]) : 0.015;
+    if(taxels==0 || cycles==0){
+        fprintf(stderr, "compensatorBench: taxels and cycles must be positive\n");
+        return 1;
+    }
+
+    Skin s;
+    makeSkin(s, taxels, 100);
+
+    // neighbors: all the pairs
+    vector< pair<int,int> > pairs;
+    double d2 = maxNeighDist*maxNeighDist;
+    double t0 = seconds();
+    for(unsigned int i=0; i<taxels; i++)
+        for(unsigned int j=i+1; j<taxels; j++){
+            double dx = s.x[i]-s.x[j], dy = s.y[i]-s.y[j], dz = s.z[i]-s.z[j];
+            if(dx*dx+dy*dy+dz*dz <= d2)
+                pairs.push_back(make_pair((int)i, (int)j));
+        }
+    double tPairs = seconds()-t0;
+
+    // neighbors: grid
+    vector<double> xyz(3*taxels);
+    for(unsigned int i=0; i<taxels; i++){
+        xyz[3*i] = s.x[i]; xyz[3*i+1] = s.y[i]; xyz[3*i+2] = s.z[i];
+    }
+    vector< pair<int,int> > gridPairs;
+    t0 = seconds();
+    TaxelGrid grid;
+    grid.build(&xyz[0], taxels, maxNeighDist);
+    grid.radiusPairs(maxNeighDist, gridPairs);
+    double tGrid = seconds()-t0;
+
+    TaxelNeighbors csr;
+    csr.build(taxels, pairs);
+    vector< list<int> > lists(taxels);
+    for(size_t k=0; k<pairs.size(); k++){
+        lists[pairs[k].first].push_back(pairs[k].second);
+        lists[pairs[k].second].push_back(pairs[k].first);
+    }
+
+    CompensationParams p;
+    p.zeroUpRawData = false;
+    p.maxSkin = MAX_SKIN;
+    p.addThreshold = 2;
+    p.smoothFilter = true;
+    p.smoothFactor = 0.5;
+    p.binarization = false;
+    p.binTouch = 100.0;
+    p.binNoTouch = 0.0;
+    double gain = 0.2*0.02, contactGain = 0.0;
+
+    // reference: the per-taxel loop of the Compensator on vector<bool> and list<int>
+    vector<double> rBase(taxels, 15.0), rThr(taxels, 3.0), rComp(taxels), rOld(taxels, 15.0), rFilt(taxels), rOut(taxels);
+    vector<bool> rTouch(taxels), rSub(taxels), rTouchFilt(taxels);
+    long rContacts = 0;
+    vector<int> contactXtaxel(taxels);
+    t0 = seconds();
+    for(unsigned int c=0; c<cycles; c++){
+        const vector<double> &raw = s.frames[c%s.frames.size()];
+        for(unsigned int i=0; i<taxels; i++){
+            double d = p.zeroUpRawData ? raw[i]-rBase[i] : MAX_SKIN-raw[i]-rBase[i];
+            d = min<double>(MAX_SKIN, d);
+            rComp[i] = d;
+            rTouch[i] = (d > rThr[i] + p.addThreshold);
+            rSub[i] = (d < -rThr[i] - p.addThreshold);
+            if(p.smoothFilter){
+                d = (1-p.smoothFactor)*d + p.smoothFactor*rOld[i];
+                rOld[i] = d;
+            }
+            rFilt[i] = d;
+            rTouchFilt[i] = (d > rThr[i] + p.addThreshold);
+            if(p.binarization)
+                d = rTouchFilt[i] ? p.binTouch : p.binNoTouch;
+            rOut[i] = max<double>(0.0, d);
+        }
+        for(unsigned int j=0; j<taxels; j++){
+            double g = rTouch[j] ? contactGain : gain;
+            rBase[j] += g*rComp[j]/rThr[j];
+        }
+        contactXtaxel.assign(taxels, -1);
+        deque< deque<int> > taxelsXcontact;
+        for(unsigned int i=0; i<taxels; i++){
+            if(!rTouchFilt[i])
+                continue;
+            for(list<int>::iterator it=lists[i].begin(); it!=lists[i].end(); it++){
+                int neighCont = contactXtaxel[*it];
+                if(neighCont<0)
+                    continue;
+                if(contactXtaxel[i]<0){
+                    contactXtaxel[i] = neighCont;
+                    taxelsXcontact[neighCont].push_back(i);
+                }
+                else if(contactXtaxel[i]!=neighCont){
+                    int newId = min(contactXtaxel[i], neighCont), oldId = max(contactXtaxel[i], neighCont);
+                    deque<int> tax2move = taxelsXcontact[oldId];
+                    for(deque<int>::iterator t=tax2move.begin(); t!=tax2move.end(); t++){
+                        contactXtaxel[*t] = newId;
+                        taxelsXcontact[newId].push_back(*t);
+                    }
+                    taxelsXcontact[oldId].clear();
+                }
+            }
+            if(contactXtaxel[i]<0){
+                contactXtaxel[i] = taxelsXcontact.size();
+                taxelsXcontact.resize(taxelsXcontact.size()+1);
+                taxelsXcontact.back().push_back(i);
+            }
+        }
+        for(size_t k=0; k<taxelsXcontact.size(); k++)
+            rContacts += !taxelsXcontact[k].empty();
+    }
+    double tRef = seconds()-t0;
+
+    // kernel on aligned buffers and CSR neighbors
+    AlignedBuffer<double> raw, base, thr, comp, old, filt, out;
+    AlignedBuffer<unsigned char> touch, sub, touchFilt;
+    raw.assign(taxels, 0.0); base.assign(taxels, 15.0); thr.assign(taxels, 3.0); comp.assign(taxels, 0.0);
+    old.assign(taxels, 15.0); filt.assign(taxels, 0.0); out.assign(taxels, 0.0);
+    touch.assign(taxels, 0); sub.assign(taxels, 0); touchFilt.assign(taxels, 0);
+    AlignedBuffer<int> parent, label;
+    parent.assign(taxels, 0); label.assign(taxels, -1);
+    long kContacts = 0;
+    t0 = seconds();
+    for(unsigned int c=0; c<cycles; c++){
+        const vector<double> &frame = s.frames[c%s.frames.size()];
+        copy(frame.begin(), frame.end(), raw.data());
+        compensateTaxels(taxels, p, raw.data(), base.data(), thr.data(), comp.data(), old.data(), filt.data(),
+                         out.data(), touch.data(), sub.data(), touchFilt.data());
+        updateBaselines(taxels, gain, contactGain, comp.data(), thr.data(), touch.data(), base.data());
+        kContacts += labelContacts(taxels, touchFilt.data(), csr, parent.data(), label.data());
+    }
+    double tKernel = seconds()-t0;
+
+    double maxDiff = 0.0;
+    unsigned int labelDiff = 0;
+    for(unsigned int i=0; i<taxels; i++){
+        maxDiff = max(maxDiff, fabs(rBase[i]-base[i]));
+        // the taxels of the last cycle must be grouped in the same way (the contact ids may differ)
+        for(const int *it=csr.begin(i); it!=csr.end(i); it++)
+            labelDiff += (contactXtaxel[i]==contactXtaxel[*it]) != (label[i]==label[*it]);
+    }
+
+    printf("compensatorBench: %u taxels, %u cycles, %u neighbor pairs\n", taxels, cycles, (unsigned int)pairs.size());
+    printf("compensatorBench: neighbors from all the pairs %.3f ms, from the grid %.3f ms (%s)\n",
+           1e3*tPairs, 1e3*tGrid, gridPairs==pairs ? "same pairs" : "DIFFERENT PAIRS");
+    printf("compensatorBench: reference %.3f us/cycle, kernel %.3f us/cycle (x%.1f)\n",
+           1e6*tRef/cycles, 1e6*tKernel/cycles, tKernel>0 ? tRef/tKernel : 0.0);
+    printf("compensatorBench: max baseline difference %g, contacts %ld / %ld, different labels %u\n",
+           maxDiff, rContacts, kContacts, labelDiff);
+    return 0;
+}
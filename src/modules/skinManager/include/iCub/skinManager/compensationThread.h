@@ -139,6 +139,7 @@ private:
 
     // SKIN EVENTS
     bool skinEventsOn;
+    bool compactContacts;               // if true the skin events are written in the compact representation of skinContactList
 
 	/* ports */
     BufferedPort<skinContactList> skinEventsPort;   // skin events output port
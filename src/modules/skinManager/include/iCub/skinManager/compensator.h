@@ -26,6 +26,7 @@
 #include <list>
 #include <fstream>//duarte code
 #include <deque>
+#include <cstring>
 
 #include <yarp/sig/Vector.h>
 #include <yarp/os/BufferedPort.h>
@@ -41,6 +42,9 @@
 #include "iCub/skinDynLib/skinContactList.h"
 #include "iCub/skinDynLib/rpcSkinManager.h"
 #include "iCub/skinDynLib/common.h"
+#include "iCub/skinDynLib/skinDataCodec.h"
+#include "iCub/skinDynLib/TaxelGrid.h"
+#include "iCub/skinManager/compensatorKernel.h"
 
 using namespace std;
 using namespace yarp::os; 
@@ -61,6 +65,7 @@ private:
     static const int MIN_TOUCH_THR = 1;         // min value assigned to the touch thresholds (i.e. the 95% percentile)
 	static const double BIN_TOUCH;              // output value of the binarization filter when touch is detected
 	static const double BIN_NO_TOUCH;           // output value of the binarization filter when no touch is detected
+    static const double MIN_GRID_CELL;          // min size of the cells of the taxel grid (used if maxNeighDist is smaller)
 	
     // INIT
     unsigned int skinDim;						// number of taxels (for the hand it is 192)	
@@ -71,25 +76,41 @@ private:
     unsigned int linkNum;                       // number of the link
 
     // SKIN CONTACTS
-    vector< list<int> >     neighborsXtaxel;    // list of neighbors for each taxel    
+    TaxelNeighbors          neighborsXtaxel;    // neighbors of each taxel (CSR)
+    iCub::skinDynLib::TaxelGrid taxelGrid;      // spatial index over the taxel positions, used to compute the neighbors
 	vector<Vector>          taxelPos;		    // taxel positions {xPos, yPos, zPos}
     vector<Vector>          taxelOri;		    // taxel normals {xOri, yOri, zOri}
 	Vector					taxelPoseConfidence;// taxels pose estimation confidence 
     double                  maxNeighDist;       // max distance between two neighbor taxels
     Semaphore               poseSem;            // mutex to access taxel poses
 
+    // sums over the taxels of a contact, computed by getContacts()
+    struct ContactSums
+    {
+        double CoP[3], geoCenter[3], normal[3];
+        double pressure, pressureCoP, pressureNormal;
+        unsigned int taxels, taxelsGeo;         // number of taxels, number of taxels with a position
+        unsigned int first, next;               // range of the taxels of the contact in contactTaxels
+        ContactSums(){ memset(this, 0, sizeof(ContactSums)); }
+    };
+    AlignedBuffer<int>      contactParent;      // union-find work array of getContacts()
+    AlignedBuffer<int>      contactLabel;       // contact of each taxel (-1 if the taxel is not in touch)
+    vector<ContactSums>     contactSums;        // sums of each contact
+    vector<unsigned int>    contactTaxels;      // taxels of each contact, one contact after the other
+
 	// COMPENSATION
-	vector<bool> touchDetected;					// true if touch has been detected in the last read of the taxel
-	vector<bool> touchDetectedFilt;             // true if touch has been detected after applying the filtering
-    vector<bool> subTouchDetected;              // true if the taxel value has gone under the baseline (because of touch in neighbouring taxels)
-    Vector rawData;                             // data read from the skin
-    Vector touchThresholds;						// thresholds for discriminating between "touch" and "no touch"
-	Semaphore touchThresholdSem;				// semaphore for controlling the access to the touchThreshold
-    Vector initialBaselines;					// mean of the raw tactile data computed during calibration
-    Vector baselines;							// mean of the raw tactile data     
-    Vector compensatedData;			    		// compensated tactile data (that is rawData-touchThreshold)
-	Vector compensatedDataOld;			    	// compensated tactile data of the previous step (used for smoothing filter)
-    Vector compensatedDataFilt;                 // compensated tactile data after smooth filter
+    // one aligned array per quantity, processed by compensateTaxels() and updateBaselines() (see compensatorKernel.h)
+	AlignedBuffer<unsigned char> touchDetected;         // 1 if touch has been detected in the last read of the taxel
+	AlignedBuffer<unsigned char> touchDetectedFilt;     // 1 if touch has been detected after applying the filtering
+    AlignedBuffer<unsigned char> subTouchDetected;      // 1 if the taxel value has gone under the baseline (because of touch in neighbouring taxels)
+    Vector rawData;                                     // data read from the skin
+    AlignedBuffer<double> touchThresholds;              // thresholds for discriminating between "touch" and "no touch"
+	Semaphore touchThresholdSem;				        // semaphore for controlling the access to the touchThreshold
+    AlignedBuffer<double> initialBaselines;             // mean of the raw tactile data computed during calibration
+    AlignedBuffer<double> baselines;                    // mean of the raw tactile data     
+    AlignedBuffer<double> compensatedData;              // compensated tactile data (that is rawData-touchThreshold)
+	AlignedBuffer<double> compensatedDataOld;           // compensated tactile data of the previous step (used for smoothing filter)
+    AlignedBuffer<double> compensatedDataFilt;          // compensated tactile data after smooth filter
 	
 	// CALIBRATION
     int calibrationRead;						// count the calibration reads
@@ -122,11 +143,17 @@ private:
     BufferedPort<Vector> inputPort;
     Stamp timestamp;    // timestamp of last data read from inputPort
 
+    bool compactInput;                          // if true the raw data are read from the compact stream of the input port
+    BufferedPort<Bottle> compactInputPort;
+    iCub::skinDynLib::skinDataDecoder compactDecoder;
+
 	
 	/* class private methods */	    
     bool init(string name, string robotName, string outputPortName, string inputPortName);
     bool readInputData(Vector& skin_values);
+    bool readCompactInputData(Vector& skin_values);
     void sendInfoMsg(string msg);
+    static Vector toVector(const AlignedBuffer<double> &b);
     void computeNeighbors();
 	void updateNeighbors(unsigned int taxelId);
 
@@ -134,7 +161,7 @@ private:
 public:
 	Compensator(string name, string robotName, string outputPortName, string inputPortName, BufferedPort<Bottle>* _infoPort,
                          double _compensationGain, double _contactCompensationGain, int addThreshold, float _minBaseline, bool _zeroUpRawData, 
-                         bool _binarization, bool _smoothFilter, float _smoothFactor, unsigned int _linkId = 0);
+                         bool _binarization, bool _smoothFilter, float _smoothFactor, unsigned int _linkId = 0, bool _compactInput = false);
     ~Compensator();
 	    
 	void calibrationInit();
@@ -180,9 +207,9 @@ public:
     Vector getPoseConfidences();
     unsigned int getNumTaxels();
     Vector getCompensation();
-    Vector getBaselines(){      return baselines; }
+    Vector getBaselines(){      return toVector(baselines); }
     Vector getRawData(){        return rawData; }
-    Vector getCompData(){       return compensatedData; }
+    Vector getCompData(){       return toVector(compensatedData); }
     Stamp getTimestamp(){       return timestamp; }
     
     string getName(){           return name; }
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2016 iCub Facility - Istituto Italiano di Tecnologia
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+#ifndef __COMP_KERNEL_H__
+#define __COMP_KERNEL_H__
+
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+#if defined(_MSC_VER) || defined(__GNUC__)
+#define SKIN_RESTRICT __restrict
+#else
+#define SKIN_RESTRICT
+#endif
+
+namespace iCub{
+
+namespace skinManager{
+
+/**
+ * Array of n elements of T whose first element is aligned to ALIGNMENT bytes, so that the loops
+ * of the compensation kernel work on whole vector registers. It is not copyable.
+ */
+template <class T>
+class AlignedBuffer
+{
+public:
+    enum { ALIGNMENT = 64 };
+
+    AlignedBuffer(): raw(0), ptr(0), n(0) {}
+    ~AlignedBuffer(){ delete [] raw; }
+
+    /** Resize the buffer to n elements set to value (the previous content is lost). */
+    void assign(size_t _n, const T &value)
+    {
+        if(_n!=n){
+            delete [] raw;
+            raw = new unsigned char[_n*sizeof(T)+ALIGNMENT];
+            size_t misalignment = ((size_t)raw) % ALIGNMENT;
+            ptr = (T*)(raw + (misalignment ? ALIGNMENT-misalignment : 0));
+            n = _n;
+        }
+        for(size_t i=0; i<n; i++)
+            ptr[i] = value;
+    }
+
+    /** Resize the buffer to the size of other and copy its content. */
+    void copyFrom(const AlignedBuffer &other)
+    {
+        if(other.n!=n)
+            assign(other.n, T());
+        for(size_t i=0; i<n; i++)
+            ptr[i] = other.ptr[i];
+    }
+
+    size_t size() const { return n; }
+    T* data(){ return ptr; }
+    const T* data() const { return ptr; }
+    T& operator[](size_t i){ return ptr[i]; }
+    const T& operator[](size_t i) const { return ptr[i]; }
+
+private:
+    AlignedBuffer(const AlignedBuffer&);
+    AlignedBuffer& operator=(const AlignedBuffer&);
+
+    unsigned char *raw;
+    T *ptr;
+    size_t n;
+};
+
+/**
+ * Neighbors of every taxel in compressed sparse row format: the neighbors of taxel i are
+ * indices[offsets[i]] ... indices[offsets[i]+counts[i]-1]. The row of taxel i can have some spare
+ * room up to offsets[i+1], so that replace() patches only the rows that change.
+ */
+class TaxelNeighbors
+{
+public:
+    TaxelNeighbors(){ offsets.assign(1, 0); }
+
+    /** Every taxel is neighbor of all the taxels (itself included). */
+    void setAll(unsigned int taxels);
+
+    /** Build the table from the list of the pairs of neighbors (each pair appears once). */
+    void build(unsigned int taxels, const std::vector< std::pair<int,int> > &pairs);
+
+    /** Replace the neighbors of one taxel (the relation is kept symmetric). */
+    void replace(unsigned int taxel, const std::vector<int> &taxelNeighbors);
+
+    unsigned int taxels() const { return offsets.size()-1; }
+    unsigned int count(unsigned int taxel) const { return counts[taxel]; }
+    const int* begin(unsigned int taxel) const { return indices.empty() ? 0 : &indices[0]+offsets[taxel]; }
+    const int* end(unsigned int taxel) const { return indices.empty() ? 0 : &indices[0]+offsets[taxel]+counts[taxel]; }
+
+private:
+    enum { SPARE_PER_ROW = 4 };     // room left at the end of every row by build() and by a relayout in replace()
+
+    int capacity(unsigned int taxel) const { return offsets[taxel+1]-offsets[taxel]; }
+
+    /** Lay out the rows again with room for sizes[i]+SPARE_PER_ROW neighbors, keeping their content (sizes[i] >= counts[i]). */
+    void relayout(const std::vector<int> &sizes);
+
+    std::vector<int> offsets;
+    std::vector<int> counts;
+    std::vector<int> indices;
+};
+
+/** Parameters of compensateTaxels(). */
+struct CompensationParams
+{
+    bool   zeroUpRawData;       // if true the raw data are considered from zero up, otherwise from 255 down
+    double maxSkin;             // max value of the raw data
+    double addThreshold;        // value added to the touch thresholds
+    bool   smoothFilter;        // if true the exponential moving average is applied
+    double smoothFactor;        // alpha of the moving average
+    bool   binarization;        // if true the output is binTouch/binNoTouch
+    double binTouch;
+    double binNoTouch;
+};
+
+/**
+ * Baseline compensation, touch detection, smoothing and binarization of n taxels.
+ * Every quantity is a separate array and the loops have no branches, so that they are vectorised.
+ * The flags are 1 (true) or 0 (false).
+ * @param raw raw data read from the skin
+ * @param baselines baselines of the taxels
+ * @param thresholds touch thresholds of the taxels
+ * @param compensated output: compensated data, before filtering
+ * @param compensatedOld input/output: previous output of the smooth filter
+ * @param compensatedFilt output: compensated data after the smooth filter
+ * @param out output: data to send (after binarization and trimmed to positive values)
+ * @param touch output: touch detected on the compensated data
+ * @param subTouch output: the compensated data went under the baseline (because of touch in the neighbouring taxels)
+ * @param touchFilt output: touch detected on the filtered data
+ */
+void compensateTaxels(unsigned int n, const CompensationParams &p,
+                      const double * SKIN_RESTRICT raw, const double * SKIN_RESTRICT baselines,
+                      const double * SKIN_RESTRICT thresholds, double * SKIN_RESTRICT compensated,
+                      double * SKIN_RESTRICT compensatedOld, double * SKIN_RESTRICT compensatedFilt,
+                      double * SKIN_RESTRICT out, unsigned char * SKIN_RESTRICT touch,
+                      unsigned char * SKIN_RESTRICT subTouch, unsigned char * SKIN_RESTRICT touchFilt);
+
+/**
+ * Drift compensation of the baselines of n taxels: baseline += gain*compensated/threshold, where gain is
+ * contactGain for the taxels in touch and gain otherwise.
+ * @return the number of taxels whose baseline is negative
+ */
+unsigned int updateBaselines(unsigned int n, double gain, double contactGain,
+                             const double * SKIN_RESTRICT compensated, const double * SKIN_RESTRICT thresholds,
+                             const unsigned char * SKIN_RESTRICT touch, double * SKIN_RESTRICT baselines);
+
+/**
+ * Connected components of the taxels in touch (the contacts) on the neighbor graph, found by union-find.
+ * The contacts are numbered in the order of their first taxel.
+ * @param touch 1 for the taxels in touch
+ * @param neighbors neighbors of every taxel
+ * @param parent work array of n elements
+ * @param label output: contact of every taxel, -1 for the taxels not in touch
+ * @return the number of contacts
+ */
+unsigned int labelContacts(unsigned int n, const unsigned char *touch, const TaxelNeighbors &neighbors,
+                           int *parent, int *label);
+
+} //namespace skinManager
+
+} //namespace iCub
+
+#endif
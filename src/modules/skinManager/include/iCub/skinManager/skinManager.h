@@ -103,6 +103,9 @@ The following key-value pairs can be specified as command-line parameters by pre
     \t- y(t) = (1-alpha)*x(t) + alpha*y(t-1)
  - \c smoothFactor \c [0.5] \n
    alpha value of the smoothing filter, in [0, 1] where 0 is no smoothing at all and 1 is the max smoothing possible.
+ - \c compactStream \c [not active]\n
+   if specified the tactile data are read from the compact stream of the input ports (the port name followed by /compact,
+   published by the skinWrapper when its compactStream option is set, see skinDataCodec.h in skinDynLib).
 .
 An optional section called SKIN_EVENTS may be specified in the configuration file.
 These are the parameters of this section:
@@ -125,6 +128,10 @@ These are the parameters of this section:
     missing calibration procedure for that skin part).
  - \c maxNeighborDist \c 0.015 \n
     maximum distance between two neighbor tactile sensors (in meters).
+ - \c compactContacts \c [not active] \n
+    if specified the skin events are written in the compact binary representation of skinContactList
+    (see skinContactList::setCompact() in skinDynLib). Readers that use skinContactList (e.g. wholeBodyDynamics, iCubGui)
+    detect it automatically, whereas the readers of Bottles get a vocab and a blob instead of the list of contacts.
  
 
 \section portsa_sec Ports Accessed
@@ -98,6 +98,9 @@ bool CompensationThread::threadInit()
     compensatorCounter = portNum;
     SKIN_DIM = 0;
     cout<< portNum<< " input ports found in the configuration file\n";
+    bool compactStream = rf->check("compactStream");   // read the compact stream of the input ports (skinWrapper compactStream)
+    if(compactStream)
+        yInfo("Reading the compact skin stream of the input ports");
     FOR_ALL_PORTS(i){
 		string outputPortName = outputPortList->get(i).asString().c_str();
 		string inputPortName = inputPortList->get(i).asString().c_str();
@@ -107,7 +110,7 @@ bool CompensationThread::threadInit()
         name<< moduleName<< i;
 		compensators[i] = new Compensator(name.str(), robotName, outputPortName, inputPortName, &infoPort,
                          compensationGain, contactCompensationGain, ADD_THRESHOLD, minBaseline, zeroUpRawData, binarization, 
-                         smoothFilter, smoothFactor);
+                         smoothFilter, smoothFactor, 0, compactStream);
         SKIN_DIM += compensators[i]->getNumTaxels();
 	}
 
@@ -135,6 +138,7 @@ bool CompensationThread::threadInit()
 
     // configure the SKIN_EVENT if the corresponding section exists
     skinEventsOn = false;
+    compactContacts = false;
 	Bottle &skinEventsConf = rf->findGroup("SKIN_EVENTS");
 	if(!skinEventsConf.isNull()){
         yDebug("SKIN_EVENTS section found");
@@ -144,6 +148,10 @@ bool CompensationThread::threadInit()
         else
             skinEventsOn = true;
 
+        compactContacts = skinEventsConf.check("compactContacts");
+        if(compactContacts)
+            yInfo("Skin events are written in the compact representation");
+
         if(skinEventsConf.check("skinParts")){
             Bottle* skinPartList = skinEventsConf.find("skinParts").asList();
             if(skinPartList->size() != portNum){
@@ -252,6 +260,7 @@ void CompensationThread::run(){
 void CompensationThread::sendSkinEvents(){
     skinContactList &skinEvents = skinEventsPort.prepare();
     skinEvents.clear();
+    skinEvents.setCompact(compactContacts);
 
     skinContactList temp;
     Stamp timestamp;
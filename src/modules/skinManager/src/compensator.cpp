@@ -32,10 +32,11 @@ using namespace iCub::skinDynLib;
 
 const double Compensator::BIN_TOUCH     = 100.0;
 const double Compensator::BIN_NO_TOUCH  = 0.0;
+const double Compensator::MIN_GRID_CELL = 0.001;
 
 Compensator::Compensator(string _name, string _robotName, string outputPortName, string inputPortName, BufferedPort<Bottle>* _infoPort, 
                          double _compensationGain, double _contactCompensationGain, int addThreshold, float _minBaseline, bool _zeroUpRawData, 
-                         bool _binarization, bool _smoothFilter, float _smoothFactor, unsigned int _linkNum)
+                         bool _binarization, bool _smoothFilter, float _smoothFactor, unsigned int _linkNum, bool _compactInput)
 									   : 
 										compensationGain(_compensationGain), contactCompensationGain(_contactCompensationGain),
                                             addThreshold(addThreshold), infoPort(_infoPort),
@@ -43,6 +44,7 @@ Compensator::Compensator(string _name, string _robotName, string outputPortName,
                                             smoothFactor(_smoothFactor), robotName(_robotName), name(_name), linkNum(_linkNum)
 {
     this->zeroUpRawData = _zeroUpRawData;
+    this->compactInput = _compactInput;
     _isWorking = init(_name, _robotName, outputPortName, inputPortName);
 }
 
@@ -54,6 +56,10 @@ Compensator::~Compensator(){
 
     compensatedTactileDataPort.interrupt();
     compensatedTactileDataPort.close();
+    if(compactInput){
+        compactInputPort.interrupt();
+        compactInputPort.close();
+    }
 }
 
 bool Compensator::init(string name, string robotName, string outputPortName, string inputPortName){
@@ -90,19 +96,41 @@ bool Compensator::init(string name, string robotName, string outputPortName, str
 
     // (temp) open port to read skin data with timestamp (because device driver doesn't provide timestamps)
     localPortName<< "_temp";
-    if(!inputPort.open(localPortName.str().c_str()))
+    if(compactInput)
     {
-        stringstream msg; msg<< "Unable to open input data port "<< localPortName.str();
-        sendInfoMsg(msg.str());
-	    return false;
+        // the deltas of the compact stream must not be dropped, so the port is strict and it is drained at every read
+        compactInputPort.setStrict();
+        if(!compactInputPort.open(localPortName.str().c_str()))
+        {
+            stringstream msg; msg<< "Unable to open input data port "<< localPortName.str();
+            sendInfoMsg(msg.str());
+            return false;
+        }
+        string compactPortName = inputPortName + SKIN_COMPACT_PORT_SUFFIX;
+        if( !Network::connect(compactPortName.c_str(), localPortName.str().c_str()))
+        {
+            stringstream msg;
+            msg<< "Problems trying to connect ports "<< compactPortName<< " and "<< localPortName.str();
+            sendInfoMsg(msg.str());
+            return false;
+        }
     }
-    
-    if( !Network::connect(inputPortName.c_str(), localPortName.str().c_str()))
+    else
     {
-        stringstream msg;
-        msg<< "Problems trying to connect ports %s and %s."<< inputPortName.c_str()<< localPortName.str().c_str();
-        sendInfoMsg(msg.str());
-        return false;
+        if(!inputPort.open(localPortName.str().c_str()))
+        {
+            stringstream msg; msg<< "Unable to open input data port "<< localPortName.str();
+            sendInfoMsg(msg.str());
+            return false;
+        }
+
+        if( !Network::connect(inputPortName.c_str(), localPortName.str().c_str()))
+        {
+            stringstream msg;
+            msg<< "Problems trying to connect ports %s and %s."<< inputPortName.c_str()<< localPortName.str().c_str();
+            sendInfoMsg(msg.str());
+            return false;
+        }
     }
     
     int getChannelsCounter = 0;
@@ -121,30 +149,30 @@ bool Compensator::init(string name, string robotName, string outputPortName, str
 	}
     readErrorCounter = 0;
     rawData.resize(skinDim);
-    baselines.resize(skinDim);
-    touchThresholds.resize(skinDim);
-    touchDetected.resize(skinDim);
-    subTouchDetected.resize(skinDim);
-    touchDetectedFilt.resize(skinDim);
-    compensatedData.resize(skinDim);
-    compensatedDataOld.resize(skinDim);
-    compensatedDataFilt.resize(skinDim);
+    baselines.assign(skinDim, 0.0);
+    initialBaselines.assign(skinDim, 0.0);
+    touchThresholds.assign(skinDim, 0.0);
+    touchDetected.assign(skinDim, 0);
+    subTouchDetected.assign(skinDim, 0);
+    touchDetectedFilt.assign(skinDim, 0);
+    compensatedData.assign(skinDim, 0.0);
+    compensatedDataOld.assign(skinDim, 0.0);
+    compensatedDataFilt.assign(skinDim, 0.0);
     taxelPos.resize(skinDim, zeros(3));
     taxelOri.resize(skinDim, zeros(3));
 	taxelPoseConfidence.resize(skinDim,0.0);
     maxNeighDist = MAX_NEIGHBOR_DISTANCE;
     // by default every taxel is neighbor with all the other taxels
-    list<int> defaultNeighbors(skinDim);
-    int i=0;
-    for(list<int>::iterator it=defaultNeighbors.begin();it!=defaultNeighbors.end();it++, i++) 
-        *it = i;
-    neighborsXtaxel.resize(skinDim, defaultNeighbors);
+    neighborsXtaxel.setAll(skinDim);
+    contactParent.assign(skinDim, 0);
+    contactLabel.assign(skinDim, -1);
 
     // test read to check if the skin is broken (all taxel output is 0)
-    if(robotName!="icubSim" && readInputData(compensatedData)){
+    Vector testData(skinDim);
+    if(robotName!="icubSim" && readInputData(testData)){
         bool skinBroken = true;
         for(unsigned int i=0; i<skinDim; i++){
-            if(compensatedData[i]!=0.0){
+            if(testData[i]!=0.0){
                 skinBroken = false;
                 break;
             }
@@ -229,10 +257,10 @@ void Compensator::calibrationFinish(){
         
 	}
     // store the initial baseline to compute the drift compensated later
-    initialBaselines = baselines;
+    initialBaselines.copyFrom(baselines);
 	
 	// set the "old output value" for the smoothing filter to the baseline value to get a smooth start
-	compensatedDataOld = baselines;	
+	compensatedDataOld.copyFrom(baselines);
 
     // test to check if the skin is broken (all taxel baselines are 255 OR thresholds are 0)
     bool baseline255 = true, thresholdZero = true;
@@ -275,7 +303,54 @@ void Compensator::calibrationFinish(){
 	touchThresholdSem.post();
 }
 
+bool Compensator::readCompactInputData(Vector& skin_values){
+    bool got = false, decoded = false;
+    while(compactInputPort.getPendingReads()>0){
+        Bottle *msg = compactInputPort.read(false);
+        if(msg==0)
+            break;
+        got = true;
+        if(compactDecoder.decode(*msg)){
+            decoded = true;
+            compactInputPort.getEnvelope(timestamp);
+        }
+    }
+    if(!got){
+        readErrorCounter++;
+        if(readErrorCounter>MAX_READ_ERROR){
+            _isWorking = false;
+            sendInfoMsg("Too many errors in a row. Stopping the compensator.");
+        }
+        return false;
+    }
+    // waiting for the next keyframe
+    if(!decoded || !compactDecoder.isSynchronized())
+        return false;
+
+    const vector<unsigned char> &taxels = compactDecoder.getTaxels();
+    skin_values.resize(taxels.size());
+    for(size_t i=0; i<taxels.size(); i++)
+        skin_values[i] = taxels[i];
+    return true;
+}
+
 bool Compensator::readInputData(Vector& skin_values){
+    if(compactInput){
+        if(!readCompactInputData(skin_values))
+            return false;
+        if(skin_values.size() != skinDim){
+            readErrorCounter++;
+            sendInfoMsg("Unexpected size of the input array (raw tactile data): "+toString(skin_values.size()));
+            if(readErrorCounter>MAX_READ_ERROR){
+                _isWorking = false;
+                sendInfoMsg("Too many errors in a row. Stopping the compensator.");
+            }
+            return false;
+        }
+        readErrorCounter = 0;
+        return true;
+    }
+
     Vector *tmp=0;
     if((tmp=inputPort.read(false))==0){
         readErrorCounter++;
@@ -343,108 +418,42 @@ bool Compensator::readRawAndWriteCompensatedData(){
 	
 	Vector& compensatedData2Send = compensatedTactileDataPort.prepare();
     compensatedData2Send.resize(skinDim);   // local variable with data to send
-	compensatedData.resize(skinDim);        // global variable with data to store
-	
-	double d;
-	for(unsigned int i=0; i<skinDim; i++){
-	    // baseline compensation
-		d =  (double)( zeroUpRawData ? rawData(i)-baselines[i] : MAX_SKIN-rawData(i)-baselines[i] );
-	    d =   min<double>( MAX_SKIN, d);
-	    compensatedData[i] = d;     // save the data before applying filtering
-
-        // detect touch (before applying filtering, so the compensation algorithm is not affected by the filters)
-		touchDetected[i] = (d > touchThresholds[i] + addThreshold);
-	    
-        // detect subtouch
-		subTouchDetected[i] = (d < -touchThresholds[i] - addThreshold);
-	    
-        // smooth filter
-        if(smoothFilter){
-		    smoothFactorSem.wait();
-		    d = (1-smoothFactor)*d + smoothFactor*compensatedDataOld(i);
-		    smoothFactorSem.post();
-		    compensatedDataOld(i) = d;	// update old value
-	    }
-        compensatedDataFilt[i] = d;
-
-	    // binarization filter
-        // here we don't use the touchDetected array because, if the smooth filter is on,
-        // we want to use the filtered values
-        touchDetectedFilt[i] = (d > touchThresholds[i] + addThreshold);
-        if(binarization)
-		    d = ( touchDetectedFilt[i] ? BIN_TOUCH : BIN_NO_TOUCH );
-        
-	    compensatedData2Send[i] = max<double>(0.0, d); // trim only data to send because you need negative values for update baseline
-	}
+
+    CompensationParams p;
+    p.zeroUpRawData = zeroUpRawData;
+    p.maxSkin = MAX_SKIN;
+    p.addThreshold = addThreshold;
+    p.smoothFilter = smoothFilter;
+    p.smoothFactor = getSmoothFactor();
+    p.binarization = binarization;
+    p.binTouch = BIN_TOUCH;
+    p.binNoTouch = BIN_NO_TOUCH;
+
+    compensateTaxels(skinDim, p, rawData.data(), baselines.data(), touchThresholds.data(),
+                     compensatedData.data(), compensatedDataOld.data(), compensatedDataFilt.data(),
+                     compensatedData2Send.data(), touchDetected.data(), subTouchDetected.data(), touchDetectedFilt.data());
 
 	compensatedTactileDataPort.write();
 	return true;
 }
 
 void Compensator::updateBaseline(){
-	double mean_change = 0, change, gain;
-    unsigned int non_touching_taxels = 0;
-	double d; 
+    // the gain is smaller for the taxels in contact, so that the baseline does not follow the touch
+    unsigned int negative = updateBaselines(skinDim, compensationGain*0.02, contactCompensationGain*0.02,
+                                            compensatedData.data(), touchThresholds.data(), touchDetected.data(), baselines.data());
+    if(negative==0)
+        return;
 
     for(unsigned int j=0; j<skinDim; j++) {
-        // *** Algorithm 1
-        /*if(!touchDetected[j]){
-		    if(d > 0.5) {
-			    baselines[j]		+= compensationGain;
-			    mean_change			+= compensationGain;				//for changing the taxels where we detected touch
-		    }else if(d < -0.5) {
-			    baselines[j]		-= compensationGain;
-			    mean_change			-= compensationGain;				//for changing the taxels where we detected touch
-		    }
-        }*/
-
-        // *** Algorithm 2
-        /*if(!(touchDetected[j] || subTouchDetected[j])){
-			non_touching_taxels++;										//for changing the taxels where we detected touch
-			d = compensatedData(j);
-			if(fabs(d)>0.5){
-                change          = (compensationGain/50)*d/touchThresholds[j];
-				baselines[j]    += change;
-                mean_change     += change;
-			}
-		}*/
-    
-        d = compensatedData(j);
-        if(touchDetected[j]){
-            gain            = contactCompensationGain*0.02;                
-        }else{
-            gain            = compensationGain*0.02;
-            non_touching_taxels++;
-        }
-        change          = gain*d/touchThresholds[j];
-		baselines[j]    += change;
-        mean_change     += change;
-
-    //        if(j<5)
-    //        printf("%d touch detected %s, change %.6f, gain: %.3f\n", j, touchDetected[j]?"yes":"no", change, touchDetected[j]?contactCompensationGain:compensationGain);
-
         if(baselines[j]<0){
-            char* temp = new char[300];
-            sprintf(temp, "ERROR-Negative baseline. Port %s; tax %d; baseline %.2f; gain: %.4f; d: %.2f; raw: %.2f; change: %f; touchThr: %.2f", 
-                SkinPart_s[skinPart].c_str(), j, baselines[j], gain, d, rawData[j], change, touchThresholds[j]);
+            char temp[300];
+            double gain = (touchDetected[j] ? contactCompensationGain : compensationGain)*0.02;
+            double change = gain*compensatedData[j]/touchThresholds[j];
+            snprintf(temp, sizeof(temp), "ERROR-Negative baseline. Port %s; tax %d; baseline %.2f; gain: %.4f; d: %.2f; raw: %.2f; change: %f; touchThr: %.2f", 
+                SkinPart_s[skinPart].c_str(), j, baselines[j], gain, compensatedData[j], rawData[j], change, touchThresholds[j]);
             sendInfoMsg(temp);
-        }      
-    }
-    
-    //for compensating the taxels where we detected touch
-    /*if (non_touching_taxels>0 && non_touching_taxels<skinDim && mean_change!=0){
-        mean_change /= non_touching_taxels;
-        for(unsigned int j=0; j<skinDim; j++) {
-            if (touchDetected[j]) {
-                baselines[j]		+= mean_change;
-                if(baselines[j]<0){
-                    char* temp = new char[300];
-                    sprintf(temp, "ERROR-Negative baseline. Taxel %d; baseline %.2f; meanchange: %f", j, baselines[j], mean_change);
-                    sendInfoMsg(temp);
-                }
-            }
         }
-    }*/
+    }
 }
 
 bool Compensator::doesBaselineExceed(unsigned int &taxelIndex, double &baseline, double &initialBaseline){
@@ -465,94 +474,72 @@ bool Compensator::doesBaselineExceed(unsigned int &taxelIndex, double &baseline,
 	return false;
 }
 
-skinContactList Compensator::getContacts(){    
-    vector<int>         contactXtaxel(skinDim, -1);     // contact for each taxel (-1 means no contact)
-    deque<deque<int> >  taxelsXcontact;                 // taxels for each contact
-    int                 contactId = 0;                  // id of the next contact to create
-    int                 neighCont;                      // id of the contact of the current neighbor
+skinContactList Compensator::getContacts(){
+    skinContactList contactList;
 
     poseSem.wait();
-    {
-        for(unsigned int i=0; i<skinDim; i++){
-            if(touchDetectedFilt[i] ){ // && contactXtaxel[i]<0 (second condition should always be true)
-                list<int> *neighbors = &(neighborsXtaxel[i]);
-                //printf("Taxel %d active. Going to check its %d neighbors\n", i, neighbors->size());
-                for(list<int>::iterator it=neighbors->begin(); it!=neighbors->end(); it++){
-                    neighCont = contactXtaxel[(*it)];
-                    if(neighCont >= 0){                                     // ** if neighbor belongs to a contact
-                        if(contactXtaxel[i]<0){                             // ** add taxel to pre-existing contact
-                            contactXtaxel[i] = neighCont;
-                            taxelsXcontact[neighCont].push_back(i);
-                            //printf("Add taxel to pre existing contact %d (neighbor %d)\n", neighCont, (*neighbors)[n]);
-                        }else if(contactXtaxel[i]!=neighCont){              // ** merge 2 contacts
-                            //mergeContacts(contactXtaxel[i], neighCont);
-                            int newId = min(contactXtaxel[i], neighCont);
-                            int oldId = max(contactXtaxel[i], neighCont);
-                            deque<int> tax2move = taxelsXcontact[oldId];
-                            for(deque<int>::iterator it=tax2move.begin(); it!=tax2move.end(); it++){
-                                contactXtaxel[(*it)] = newId;               // assign new contact id
-                                taxelsXcontact[newId].push_back((*it));     // add taxel ids to contact
-                            }
-                            taxelsXcontact[oldId].clear();      // clear the list of taxels belonging to the merged contact
-                            //printf("Merge two contacts: %d and %d\n", oldId, newId);
-                        }
-                    }
+    unsigned int contacts = labelContacts(skinDim, touchDetectedFilt.data(), neighborsXtaxel, contactParent.data(), contactLabel.data());
+    if(contacts==0){
+        poseSem.post();
+        return contactList;
+    }
 
-                }
-                if(contactXtaxel[i]<0){            // ** if no neighbor belongs to a contact -> create new contact
-                    contactXtaxel[i] = contactId;
-                    taxelsXcontact.resize(contactId+1);
-                    taxelsXcontact[contactId].push_back(i);
-                    contactId++;
-                    //printf("New contact created: %d\n", contactId-1);
-                }
+    // features of all the contacts in one sweep over the taxels
+    contactSums.assign(contacts, ContactSums());
+    for(unsigned int i=0; i<skinDim; i++){
+        int c = contactLabel[i];
+        if(c<0) continue;
+        ContactSums &cs = contactSums[c];
+        double out = max(compensatedDataFilt[i], 0.0);
+        const double *pos = taxelPos[i].data();
+        const double *ori = taxelOri[i].data();
+        if(pos[0]!=0.0 || pos[1]!=0.0 || pos[2]!=0.0){     // if the taxel position estimate exists
+            for(int k=0; k<3; k++){
+                cs.CoP[k]       += pos[k]*out;
+                cs.geoCenter[k] += pos[k];
             }
+            cs.pressureCoP += out;
+            cs.taxelsGeo++;
+        }
+        if(ori[0]!=0.0 || ori[1]!=0.0 || ori[2]!=0.0){     // if the taxel orientation estimate exists
+            for(int k=0; k<3; k++)
+                cs.normal[k] += ori[k]*out;
+            cs.pressureNormal += out;
         }
+        cs.pressure += out;
+        cs.taxels++;
+    }
+
+    // taxels of every contact one after the other, in increasing order
+    unsigned int start = 0;
+    for(unsigned int c=0; c<contacts; c++){
+        contactSums[c].first = contactSums[c].next = start;
+        start += contactSums[c].taxels;
     }
+    contactTaxels.resize(start);
+    for(unsigned int i=0; i<skinDim; i++)
+        if(contactLabel[i]>=0)
+            contactTaxels[contactSums[contactLabel[i]].next++] = i;
     poseSem.post();
 
-    skinContactList contactList;
+    contactList.reserve(contacts);
     Vector CoP(3), geoCenter(3), normal(3);
-    double pressure, pressureCoP, pressureNormal, out;
-    int activeTaxels, activeTaxelsGeo;
-    vector<unsigned int> taxelList;
-    for( deque<deque<int> >::iterator it=taxelsXcontact.begin(); it!=taxelsXcontact.end(); it++){
-        activeTaxels = it->size();
-        if(activeTaxels==0) continue;
-        
-        taxelList.resize(activeTaxels);
-        CoP.zero();
-        geoCenter.zero();
-        normal.zero();
-        pressure = pressureCoP = pressureNormal = 0.0;
-        activeTaxelsGeo = 0;
-        int i=0;
-        for( deque<int>::iterator tax=it->begin(); tax!=it->end(); tax++, i++){
-            out         = max(compensatedDataFilt[(*tax)], 0.0);
-            if(norm(taxelPos[(*tax)])!=0.0){  // if the taxel position estimate exists
-                CoP         += taxelPos[(*tax)] * out;
-                pressureCoP += out;
-                activeTaxelsGeo++;
-                geoCenter   += taxelPos[(*tax)];
-            }
-            if(norm(taxelOri[(*tax)])!=0.0){  // if the taxel orientation estimate exists
-                normal          += taxelOri[(*tax)] * out;
-                pressureNormal  += out;
-            }
-            pressure    += out;
-            taxelList[i] = *tax;
-        }
+    for(unsigned int c=0; c<contacts; c++){
+        const ContactSums &cs = contactSums[c];
         // if this is not the only contact and no taxel in this contact has a position => discard it
-        if(taxelsXcontact.size()>1 && activeTaxelsGeo==0)
+        if(contacts>1 && cs.taxelsGeo==0)
             continue;
-        if(pressureCoP!=0.0)        CoP         /= pressureCoP;
-        if(pressureNormal!=0.0)     normal      /= pressureNormal;
-        if(activeTaxelsGeo!=0)      geoCenter   /= activeTaxelsGeo;
-        pressure    /= activeTaxels;
-        skinContact c(bodyPart, skinPart, linkNum, CoP, geoCenter, taxelList, pressure, normal);
+        for(int k=0; k<3; k++){
+            CoP[k]       = cs.pressureCoP!=0.0      ? cs.CoP[k]/cs.pressureCoP          : cs.CoP[k];
+            normal[k]    = cs.pressureNormal!=0.0   ? cs.normal[k]/cs.pressureNormal    : cs.normal[k];
+            geoCenter[k] = cs.taxelsGeo!=0          ? cs.geoCenter[k]/cs.taxelsGeo      : cs.geoCenter[k];
+        }
+        double pressure = cs.pressure/cs.taxels;
+        vector<unsigned int> taxelList(contactTaxels.begin()+cs.first, contactTaxels.begin()+cs.first+cs.taxels);
+        skinContact ctc(bodyPart, skinPart, linkNum, CoP, geoCenter, taxelList, pressure, normal);
         // set an estimate of the force that is with normal direction and intensity equal to the pressure
-        c.setForce(-0.05*activeTaxels*pressure*normal);
-        contactList.push_back(c);
+        ctc.setForce(-0.05*cs.taxels*pressure*normal);
+        contactList.push_back(ctc);
     }
     //printf("ContactList: %s\n", contactList.toString().c_str());
     
@@ -564,7 +551,7 @@ void Compensator::setSmoothFilter(bool value){
 		smoothFilter = value;
 		if(value){
 			// set the old output value of the smooth filter to the last read, to get a smooth start
-			compensatedDataOld = compensatedData;			
+			compensatedDataOld.copyFrom(compensatedData);			
 		}
 	}
 }
@@ -612,11 +599,23 @@ unsigned int Compensator::getNumTaxels(){
     return 0;
 }
 
-Vector Compensator::getCompensation(){   return baselines-initialBaselines; }
+Vector Compensator::getCompensation(){
+    Vector res(skinDim);
+    for(unsigned int i=0; i<skinDim; i++)
+        res[i] = baselines[i]-initialBaselines[i];
+    return res;
+}
+
+Vector Compensator::toVector(const AlignedBuffer<double> &b){
+    Vector res(b.size());
+    for(size_t i=0; i<b.size(); i++)
+        res[i] = b[i];
+    return res;
+}
 
 Vector Compensator::getTouchThreshold(){
 	touchThresholdSem.wait();
-	Vector res = touchThresholds;
+	Vector res = toVector(touchThresholds);
 	touchThresholdSem.post();
 	return res;
 }
@@ -874,27 +873,16 @@ bool Compensator::setTaxelOrientation(unsigned int taxelId, const Vector &orient
     return true;
 }
 void Compensator::computeNeighbors(){
-    neighborsXtaxel.clear();
-    neighborsXtaxel.resize(skinDim, list<int>(0));
-    Vector v;
-    double d2 = maxNeighDist*maxNeighDist;
-    for(unsigned int i=0; i<skinDim; i++){
-        for(unsigned int j=i+1; j<skinDim; j++){
-            //if(taxelPos[i][0]!=0.0 || taxelPos[i][1]!=0.0 || taxelPos[i][2]!=0.0){  // if the taxel exists
-            v = taxelPos[i]-taxelPos[j];
-            if( dot(v,v) <= d2){
-                neighborsXtaxel[i].push_back(j);
-                neighborsXtaxel[j].push_back(i);
-                //printf("Taxels %d (%s) and %d (%s) are neighbors\n", i, taxelPos[i].toString().c_str(), j, taxelPos[j].toString().c_str());
-            }
-            //}
-        }
-    }
+    // the cells of the grid are as large as the max neighbor distance, so only the adjacent cells are visited
+    vector< pair<int,int> > pairs;
+    taxelGrid.build(taxelPos, max(maxNeighDist, MIN_GRID_CELL));
+    taxelGrid.radiusPairs(maxNeighDist, pairs);
+    neighborsXtaxel.build(skinDim, pairs);
 
     int minNeighbors=skinDim, maxNeighbors=0, ns;
     for(unsigned int i=0; i<skinDim; i++){
         //if(taxelPos[i][0]!=0.0 || taxelPos[i][1]!=0.0 || taxelPos[i][2]!=0.0){  // if the taxel exists
-        ns = neighborsXtaxel[i].size();
+        ns = neighborsXtaxel.count(i);
         if(ns>maxNeighbors) maxNeighbors = ns;
         if(ns<minNeighbors) minNeighbors = ns;
     }
@@ -903,22 +891,15 @@ void Compensator::computeNeighbors(){
     sendInfoMsg(ss.str());
 }
 void Compensator::updateNeighbors(unsigned int taxelId){
-    Vector v;
-    double d2 = maxNeighDist*maxNeighDist;
-    // remove all the neighbors of the taxel with id=taxelId
-    neighborsXtaxel[taxelId].clear();
-
-    for(unsigned int i=0; i<skinDim; i++){
-        //if(taxelPos[i][0]!=0.0 || taxelPos[i][1]!=0.0 || taxelPos[i][2]!=0.0){  // if the taxel exists
-        // remove taxelId from the neighbor list (if there is)
-        neighborsXtaxel[i].remove(taxelId);
-        // check whether they are neighbors
-        v = taxelPos[i]-taxelPos[taxelId];
-        if( dot(v,v) <= d2){
-            neighborsXtaxel[i].push_back(taxelId);
-            neighborsXtaxel[taxelId].push_back(i);
-        }
-    }
+    // the position of the taxel has changed: only that taxel is moved to its new cell of the grid
+    vector<int> neighbors;
+    if(taxelGrid.size()!=skinDim)
+        taxelGrid.build(taxelPos, max(maxNeighDist, MIN_GRID_CELL));
+    else
+        taxelGrid.move(taxelId, taxelPos[taxelId]);
+    taxelGrid.radiusQuery(taxelPos[taxelId], maxNeighDist, neighbors, taxelId);
+    // the old neighbors of the taxel with id=taxelId are removed
+    neighborsXtaxel.replace(taxelId, neighbors);
 }
 
 void Compensator::sendInfoMsg(string msg){
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2016 iCub Facility - Istituto Italiano di Tecnologia
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#include <algorithm>
+#include <iterator>
+#include "iCub/skinManager/compensatorKernel.h"
+
+using namespace std;
+using namespace iCub::skinManager;
+
+
+void TaxelNeighbors::setAll(unsigned int taxels){
+    offsets.resize(taxels+1);
+    counts.assign(taxels, taxels);
+    indices.resize((size_t)taxels*taxels);
+    for(unsigned int i=0; i<=taxels; i++)
+        offsets[i] = i*taxels;
+    for(unsigned int i=0; i<taxels; i++)
+        for(unsigned int j=0; j<taxels; j++)
+            indices[(size_t)i*taxels+j] = j;
+}
+
+void TaxelNeighbors::build(unsigned int taxels, const vector< pair<int,int> > &pairs){
+    // count the neighbors of every taxel, then fill the rows
+    vector<int> sizes(taxels, 0);
+    for(size_t k=0; k<pairs.size(); k++){
+        sizes[pairs[k].first]++;
+        sizes[pairs[k].second]++;
+    }
+    counts.clear();
+    relayout(sizes);
+    counts.assign(taxels, 0);
+
+    for(size_t k=0; k<pairs.size(); k++){
+        int i = pairs[k].first, j = pairs[k].second;
+        indices[offsets[i]+counts[i]++] = j;
+        indices[offsets[j]+counts[j]++] = i;
+    }
+}
+
+void TaxelNeighbors::relayout(const vector<int> &sizes){
+    unsigned int n = sizes.size();
+    vector<int> newOffsets(n+1);
+    newOffsets[0] = 0;
+    for(unsigned int i=0; i<n; i++)
+        newOffsets[i+1] = newOffsets[i] + sizes[i] + SPARE_PER_ROW;
+
+    vector<int> newIndices(newOffsets[n]);
+    for(unsigned int i=0; i<n && i<counts.size(); i++)
+        copy(indices.begin()+offsets[i], indices.begin()+offsets[i]+counts[i], newIndices.begin()+newOffsets[i]);
+
+    offsets.swap(newOffsets);
+    indices.swap(newIndices);
+}
+
+void TaxelNeighbors::replace(unsigned int taxel, const vector<int> &taxelNeighbors){
+    // the old and the new neighbors, sorted, and which of them are removed or added
+    vector<int> oldNeighbors(begin(taxel), end(taxel));
+    vector<int> newNeighbors;
+    newNeighbors.reserve(taxelNeighbors.size());
+    for(size_t k=0; k<taxelNeighbors.size(); k++)
+        if(taxelNeighbors[k]!=(int)taxel)
+            newNeighbors.push_back(taxelNeighbors[k]);
+    sort(oldNeighbors.begin(), oldNeighbors.end());
+    sort(newNeighbors.begin(), newNeighbors.end());
+    newNeighbors.erase(unique(newNeighbors.begin(), newNeighbors.end()), newNeighbors.end());
+
+    vector<int> removed, added;
+    set_difference(oldNeighbors.begin(), oldNeighbors.end(), newNeighbors.begin(), newNeighbors.end(), back_inserter(removed));
+    set_difference(newNeighbors.begin(), newNeighbors.end(), oldNeighbors.begin(), oldNeighbors.end(), back_inserter(added));
+
+    // only the row of the taxel and the rows of the neighbors that changed are touched. the whole table
+    // is laid out again only when one of the growing rows has no spare room left
+    bool fits = (int)newNeighbors.size() <= capacity(taxel);
+    for(size_t k=0; k<added.size() && fits; k++)
+        fits = counts[added[k]] < capacity(added[k]);
+    if(!fits){
+        vector<int> sizes(counts);
+        sizes[taxel] = max(counts[taxel], (int)newNeighbors.size());    // the old row is copied before being overwritten
+        for(size_t k=0; k<added.size(); k++)
+            sizes[added[k]]++;
+        relayout(sizes);
+    }
+
+    for(size_t k=0; k<removed.size(); k++){
+        int *row = &indices[offsets[removed[k]]];
+        counts[removed[k]] = remove(row, row+counts[removed[k]], (int)taxel) - row;
+    }
+    for(size_t k=0; k<added.size(); k++)
+        indices[offsets[added[k]]+counts[added[k]]++] = taxel;
+    copy(newNeighbors.begin(), newNeighbors.end(), indices.begin()+offsets[taxel]);
+    counts[taxel] = newNeighbors.size();
+}
+
+
+void iCub::skinManager::compensateTaxels(unsigned int n, const CompensationParams &p,
+                      const double * SKIN_RESTRICT raw, const double * SKIN_RESTRICT baselines,
+                      const double * SKIN_RESTRICT thresholds, double * SKIN_RESTRICT compensated,
+                      double * SKIN_RESTRICT compensatedOld, double * SKIN_RESTRICT compensatedFilt,
+                      double * SKIN_RESTRICT out, unsigned char * SKIN_RESTRICT touch,
+                      unsigned char * SKIN_RESTRICT subTouch, unsigned char * SKIN_RESTRICT touchFilt)
+{
+    // raw data from 255 down are mapped to zero up: d = sign*raw + offset - baseline
+    const double sign = p.zeroUpRawData ? 1.0 : -1.0;
+    const double offset = p.zeroUpRawData ? 0.0 : p.maxSkin;
+    const double maxSkin = p.maxSkin;
+    const double addThreshold = p.addThreshold;
+
+    // baseline compensation and touch detection (before applying filtering, so the compensation algorithm is not affected by the filters)
+    for(unsigned int i=0; i<n; i++){
+        double d = sign*raw[i] + offset - baselines[i];
+        d = d < maxSkin ? d : maxSkin;
+        compensated[i] = d;
+        touch[i] = d > thresholds[i] + addThreshold;
+        subTouch[i] = d < -thresholds[i] - addThreshold;
+    }
+
+    // smooth filter
+    if(p.smoothFilter){
+        const double alpha = p.smoothFactor;
+        const double beta = 1.0 - alpha;
+        for(unsigned int i=0; i<n; i++){
+            double d = beta*compensated[i] + alpha*compensatedOld[i];
+            compensatedOld[i] = d;
+            compensatedFilt[i] = d;
+        }
+    }
+    else{
+        for(unsigned int i=0; i<n; i++)
+            compensatedFilt[i] = compensated[i];
+    }
+
+    // binarization filter: it uses the filtered values, not the touch array, so that it is affected by the smooth filter
+    if(p.binarization){
+        const double binTouch = p.binTouch, binNoTouch = p.binNoTouch;
+        for(unsigned int i=0; i<n; i++){
+            unsigned char t = compensatedFilt[i] > thresholds[i] + addThreshold;
+            touchFilt[i] = t;
+            double d = t ? binTouch : binNoTouch;
+            out[i] = d > 0.0 ? d : 0.0;
+        }
+    }
+    else{
+        for(unsigned int i=0; i<n; i++){
+            double d = compensatedFilt[i];
+            touchFilt[i] = d > thresholds[i] + addThreshold;
+            out[i] = d > 0.0 ? d : 0.0;     // trim only data to send because the negative values are needed to update the baseline
+        }
+    }
+}
+
+unsigned int iCub::skinManager::updateBaselines(unsigned int n, double gain, double contactGain,
+                             const double * SKIN_RESTRICT compensated, const double * SKIN_RESTRICT thresholds,
+                             const unsigned char * SKIN_RESTRICT touch, double * SKIN_RESTRICT baselines)
+{
+    unsigned int negative = 0;
+    for(unsigned int i=0; i<n; i++){
+        double g = touch[i] ? contactGain : gain;
+        double b = baselines[i] + g*compensated[i]/thresholds[i];
+        baselines[i] = b;
+        negative += b < 0.0;
+    }
+    return negative;
+}
+
+// root of the set of taxel i, halving the path on the way
+static inline int findRoot(int *parent, int i)
+{
+    while(parent[i]!=i){
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+unsigned int iCub::skinManager::labelContacts(unsigned int n, const unsigned char *touch, const TaxelNeighbors &neighbors,
+                                              int *parent, int *label)
+{
+    // union of every taxel in touch with its neighbors in touch; the root of a set is its smallest taxel
+    for(unsigned int i=0; i<n; i++){
+        if(!touch[i])
+            continue;
+        parent[i] = i;
+        for(const int *it=neighbors.begin(i); it!=neighbors.end(i); it++){
+            int j = *it;
+            if(j>=(int)i || !touch[j])
+                continue;
+            int ri = findRoot(parent, i), rj = findRoot(parent, j);
+            if(ri<rj)
+                parent[rj] = ri;
+            else if(rj<ri)
+                parent[ri] = rj;
+        }
+    }
+
+    // the root comes before the other taxels of its set, so it is labelled first
+    unsigned int contacts = 0;
+    for(unsigned int i=0; i<n; i++){
+        if(!touch[i]){
+            label[i] = -1;
+            continue;
+        }
+        int r = findRoot(parent, i);
+        label[i] = r==(int)i ? (int)contacts++ : label[r];
+    }
+    return contacts;
+}
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2016 iCub Facility - Istituto Italiano di Tecnologia
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+// Throughput of the likelihood of the particles of the templatePFTracker on synthetic frames:
+// the histogram of every window is computed from a copy of the window (as the tracker did)
+// and from the integral histogram of the frame (whose computation is counted in its time).
+//
+// likelihoodBench [width] [height] [particles] [frames]
+// likelihoodBench 320 240 1000 50
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+
+#include <yarp/os/Time.h>
+#include <iCub/particleFilter.h>
+
+using namespace std;
+using namespace yarp::os;
+
+#define BINS (NH*NS + NV)
+
+static void makeFrame(IplImage *bgr, int t)
+{
+    cvSet(bgr, cvScalar(40, 40, 40));
+    for (int i=0; i<12; i++)
+    {
+        int x=(37*i+3*t)%bgr->width;
+        int y=(53*i+2*t)%bgr->height;
+        CvScalar color=cvScalar((70*i)%256, (130*i+50)%256, (200*i+90)%256);
+        cvRectangle(bgr, cvPoint(x, y), cvPoint(x+bgr->width/6, y+bgr->height/5), color, CV_FILLED);
+    }
+    for (int r=0; r<bgr->height; r++)
+    {
+        uchar *row=(uchar*)(bgr->imageData+r*bgr->widthStep);
+        for (int c=0; c<3*bgr->width; c++)
+            row[c]=(uchar)MIN(255, row[c]+rand()%16);
+    }
+}
+
+static float distSq(const float *h1, const float *h2)
+{
+    float sum=0;
+    for (int i=0; i<BINS; i++)
+        sum+=sqrt(h1[i]*h2[i]);
+    return sum<1.0f ? sqrt(1.0f-sum) : 1.0f-sum;
+}
+
+// the histogram of a copy of the window, as the tracker computed it before the integral histogram
+static void windowHistogram(const IntegralHistogram &ih, IplImage *hsv, CvRect rect, float *hist)
+{
+    memset(hist, 0, BINS*sizeof(float));
+    cvSetImageROI(hsv, rect);
+    IplImage *tmp=cvCreateImage(cvGetSize(hsv), IPL_DEPTH_32F, 3);
+    cvCopy(hsv, tmp, NULL);
+    cvResetImageROI(hsv);
+    IplImage *h=cvCreateImage(cvGetSize(tmp), IPL_DEPTH_32F, 1);
+    IplImage *s=cvCreateImage(cvGetSize(tmp), IPL_DEPTH_32F, 1);
+    IplImage *v=cvCreateImage(cvGetSize(tmp), IPL_DEPTH_32F, 1);
+    cvSplit(tmp, h, s, v, NULL);
+    for (int r=0; r<tmp->height; r++)
+    {
+        float *hr=(float*)(h->imageData+r*h->widthStep);
+        float *sr=(float*)(s->imageData+r*s->widthStep);
+        float *vr=(float*)(v->imageData+r*v->widthStep);
+        for (int c=0; c<tmp->width; c++)
+            hist[ih.bin(hr[c], sr[c], vr[c])]+=1;
+    }
+    cvReleaseImage(&h);
+    cvReleaseImage(&s);
+    cvReleaseImage(&v);
+    cvReleaseImage(&tmp);
+
+    float sum=0;
+    for (int i=0; i<BINS; i++)
+        sum+=hist[i];
+    for (int i=0; i<BINS; i++)
+        hist[i]*=1.0f/sum;
+}
+
+int main(int argc, char *argv[])
+{
+    int width     = argc>1 ? atoi(argv[1]) : 320;
+    int height    = argc>2 ? atoi(argv[2]) : 240;
+    int particles = argc>3 ? atoi(argv[3]) : PARTICLES;
+    int frames    = argc>4 ? atoi(argv[4]) : 50;
+    if (width<=0 || height<=0 || particles<=0 || frames<=0)
+    {
+        fprintf(stderr, "likelihoodBench: wrong arguments\n");
+        return 1;
+    }
+
+    IplImage *bgr=cvCreateImage(cvSize(width, height), IPL_DEPTH_8U, 3);
+    IplImage *bgr32f=cvCreateImage(cvSize(width, height), IPL_DEPTH_32F, 3);
+    IplImage *hsv=cvCreateImage(cvSize(width, height), IPL_DEPTH_32F, 3);
+    IntegralHistogram ih(NH, NS, NV, S_THRESH, V_THRESH, H_MAX, S_MAX, V_MAX);
+
+    // the reference is a window of the first frame
+    makeFrame(bgr, 0);
+    cvConvertScale(bgr, bgr32f, 1.0/255.0, 0);
+    cvCvtColor(bgr32f, hsv, CV_BGR2HSV);
+    int tplW=width/8, tplH=height/8;
+    float ref[BINS];
+    windowHistogram(ih, hsv, cvRect(width/3, height/3, tplW, tplH), ref);
+
+    // windows centered anywhere in the frame, with the scales the particles reach
+    vector<CvRect> windows(particles);
+    vector<float> wCopy(particles), wIntegral(particles);
+
+    double tCopy=0.0, tIntegral=0.0, maxDiff=0.0;
+    for (int t=0; t<frames; t++)
+    {
+        makeFrame(bgr, t);
+        cvConvertScale(bgr, bgr32f, 1.0/255.0, 0);
+        cvCvtColor(bgr32f, hsv, CV_BGR2HSV);
+        for (int p=0; p<particles; p++)
+        {
+            float s=0.5f+2.5f*rand()/(float)RAND_MAX;
+            int w=MAX(1, cvRound(tplW*s)), h=MAX(1, cvRound(tplH*s));
+            windows[p]=cvRect(rand()%width-w/2, rand()%height-h/2, w, h);
+        }
+
+        double t0=Time::now();
+        for (int p=0; p<particles; p++)
+        {
+            float hist[BINS];
+            windowHistogram(ih, hsv, windows[p], hist);
+            wCopy[p]=exp(-LAMBDA*distSq(hist, ref));
+        }
+        double t1=Time::now();
+        ih.compute(hsv);
+        #pragma omp parallel for schedule(static)
+        for (int p=0; p<particles; p++)
+        {
+            float hist[BINS];
+            ih.getHistogram(windows[p], hist);
+            wIntegral[p]=exp(-LAMBDA*distSq(hist, ref));
+        }
+        double t2=Time::now();
+
+        tCopy+=t1-t0;
+        tIntegral+=t2-t1;
+        for (int p=0; p<particles; p++)
+            maxDiff=MAX(maxDiff, fabs(wCopy[p]-wIntegral[p]));
+    }
+
+    double n=(double)particles*frames;
+    printf("likelihoodBench: %dx%d frames, %d particles, %d frames\n", width, height, particles, frames);
+    printf("likelihoodBench: window copy %.0f particles/s, integral histogram %.0f particles/s, x%.1f, max difference of the likelihoods %g\n",
+           n/tCopy, n/tIntegral, tIntegral>0.0 ? tCopy/tIntegral : 0.0, maxDiff);
+
+    cvReleaseImage(&bgr);
+    cvReleaseImage(&bgr32f);
+    cvReleaseImage(&hsv);
+    return maxDiff<1e-4 ? 0 : 1;
+}
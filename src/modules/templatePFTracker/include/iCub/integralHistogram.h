@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2016 iCub Facility - Istituto Italiano di Tecnologia
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#ifndef __ICUB_INTEGRAL_HISTOGRAM_H__
+#define __ICUB_INTEGRAL_HISTOGRAM_H__
+
+#include <vector>
+
+#include <cv.h>
+
+/**
+ * Integral histogram of the quantised HSV values of a frame.
+ * The frame is quantised once in compute(), then the histogram of any window is
+ * obtained from the 4 corners of the window, that is in O(bins) whatever its size.
+ * The counts are stored on 16 bits and the window counts are computed modulo 2^16,
+ * so they are exact for windows of less than 65536 pixels; larger windows are counted
+ * directly on the quantised frame.
+ * getHistogram() does not modify the object, so it can be called by several threads.
+ */
+class IntegralHistogram
+{
+public:
+    /**
+     * @param nh, ns, nv number of bins of hue, saturation and value
+     * @param sThresh, vThresh the pixels with saturation or value under these thresholds are
+     *        counted only in the nv "colorless" bins of value
+     * @param hMax, sMax, vMax max values of hue, saturation and value
+     */
+    IntegralHistogram( int nh, int ns, int nv, float sThresh, float vThresh,
+                       float hMax, float sMax, float vMax );
+
+    /* number of bins of the histograms: nh*ns + nv */
+    int getBins() const { return bins; }
+
+    /* bin of an HSV value: sd*nh + hd for colorful pixels, nh*ns + vd for the others */
+    int bin( float h, float s, float v ) const;
+
+    /* quantise and integrate an HSV frame (32F, 3 channels) */
+    void compute( const IplImage* hsv );
+
+    /**
+     * Normalised histogram of a window of the last frame given to compute().
+     * The window is clipped to the frame, as cvSetImageROI does.
+     * @param rect the window
+     * @param hist output: getBins() values that sum to 1 (all 0 if the window is empty)
+     * @return the number of pixels of the clipped window
+     */
+    int getHistogram( CvRect rect, float* hist ) const;
+
+private:
+    int nh, ns, nv;
+    float sThresh, vThresh, hMax, sMax, vMax;
+    int bins;
+
+    int width, height;
+    std::vector<unsigned char>  binMap;     // bin of every pixel
+    std::vector<unsigned short> integral;   // counts of the pixels above and to the left, (width+1)*(height+1)*bins
+};
+
+#endif
+//empty line to make gcc happy
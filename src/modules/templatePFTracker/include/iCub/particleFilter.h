@@ -40,14 +40,17 @@
 #include <iostream>
 #include <iomanip>
 #include <deque>
+#include <vector>
 
 #include <cv.h>
 #include <highgui.h>
 
+#include <iCub/integralHistogram.h>
+
 /* default number of particles */
 #define PARTICLES 1000
-/* maximum number of objects to be tracked */
-#define MAX_OBJECTS 1
+/* default number of objects to be tracked */
+#define OBJECTS 1
 /* number of bins of HSV in histogram */
 #define NH 10
 #define NS 10
@@ -82,9 +85,6 @@ typedef struct TemplateStruct
 } TemplateStruct;
 
 
-int particle_cmp( const void* p1, const void* p2 );
-
-
 class PARTICLEThread : public yarp::os::Thread 
 {
 public:
@@ -99,18 +99,31 @@ public:
         float x;                  /* current x coordinate */
         float y;                  /* current y coordinate */
         float s;                  /* scale */
-        float xp;                 /* previous x coordinate */
-        float yp;                 /* previous y coordinate */
-        float sp;                 /* previous scale */
-        float x0;                 /* original x coordinate */
-        float y0;                 /* original y coordinate */
         int width;                /* original width of region described by particle */
         int height;               /* original height of region described by particle */
-        histogram* histo;         /* reference histogram describing region being tracked */
         float w;                  /* weight */
     } particle;
 
-    float average;
+    /* particles of a tracked object: one array per state variable, allocated once;
+       resample() writes into the other buffer, then the buffers are swapped */
+    typedef struct particle_set
+    {
+        std::vector<float> x[2], y[2], s[2];     /* current coordinates and scale */
+        std::vector<float> xp[2], yp[2], sp[2];  /* previous coordinates and scale */
+        std::vector<float> w;                    /* weights */
+        int cur;                  /* buffer of the current particles */
+        float x0;                 /* original x coordinate */
+        float y0;                 /* original y coordinate */
+        int width;                /* original width of region described by the particles */
+        int height;               /* original height of region described by the particles */
+        histogram ref_histo;      /* reference histogram describing region being tracked */
+        gsl_rng* rng;             /* generator of the transitions of this object */
+        IplImage* temp;           /* template, BGR */
+        bool active;              /* a template has been given */
+        bool firstFrame;          /* the template has to be found in the next frame */
+        particle best;            /* most likely particle of the last frame */
+        float average;
+    } particle_set;
 
 private:
     /*port name strings*/    
@@ -122,29 +135,23 @@ private:
     yarp::os::BufferedPort<yarp::sig::ImageOf<yarp::sig::PixelBgr> >  imageOut;
     yarp::os::BufferedPort<yarp::sig::ImageOf<yarp::sig::PixelMono> > imageOutBlob;
 
-    CvPoint	minloc, maxloc;
-	double	minval, maxval;
-
     bool init;
-    bool getImage, getTemplate, gotTemplate, sendTarget;
+    bool getImage;
     yarp::sig::ImageOf<yarp::sig::PixelRgb> *iCubImage;
-    
-    IplImage *temp, *res_left, *res_right, *res;
-    yarp::sig::ImageOf<yarp::sig::PixelRgb> *tpl;
 
     IplImage* frame, *frame_blob;
-    int width, height, tpl_width, tpl_height, res_width, res_height;
-    double scale;
-	IplImage* img_hsv;
-	gsl_rng* rng;
-	bool firstFrame;
-  	CvScalar color;
-  	CvRect** regions;
-  	int num_objects;
-  	float s;
-  	int i, j, k, w, h, x, y;
+    int width, height;
+	IplImage* img_hsv, *img_bgr32f;
+	IntegralHistogram integral_histo;   /* quantised HSV of the current frame, shared by the objects */
+	int num_objects;
 	int num_particles;
-    yarp::sig::Vector targetTemp;
+	std::vector<particle_set> objects;
+
+    /* templates given by setTemplate() and not yet applied, with the index of their object */
+    std::vector< std::pair<int, yarp::sig::ImageOf<yarp::sig::PixelRgb>*> > pendingTemplates;
+    yarp::os::Semaphore pendingMutex;
+
+    std::vector<yarp::sig::Vector> targets;   /* one target per object, empty if not tracked */
     //string containing module name
     std::string moduleName;
     yarp::os::Semaphore targetMutex, averageMutex;
@@ -156,58 +163,34 @@ private:
     yarp::os::Semaphore         templateMutex;
     yarp::os::Stamp             targetStamp;
 
-    typedef struct params 
-    {
-  		CvPoint loc1[MAX_OBJECTS];
-  		CvPoint loc2[MAX_OBJECTS];
-  		IplImage* objects[MAX_OBJECTS];
-  		char* win_name;
-  		IplImage* orig_img;
-  		IplImage* cur_img;
-  		int n;
-	} params;
-	
-    int total;
-
-	histogram** ref_histos;
-	particle* particles, * new_particles;    
-
-    void free_histos( histogram** histo, int n );
-    void free_regions( CvRect** regions, int n);
-
-    histogram** compute_ref_histos( IplImage* img, CvRect* rect, int n );
-	histogram* calc_histogram( IplImage** imgs, int n );
-	particle transition( const particle &p, int w, int h, gsl_rng* rng );
-	particle* init_distribution( CvRect* regions, histogram** histos, int n, int p);
-	IplImage* bgr2hsv( IplImage* bgr );
-	float likelihood( IplImage* img, int r, int c, int w, int h, histogram* ref_histo );
-	void normalize_weights( particle* particles, int n );
-	float histo_dist_sq( histogram* h1, histogram* h2 );
-	int histo_bin( float h, float s, float v );
-	float pixval32f(IplImage* img, int r, int c);
-	void setpix32f(IplImage* img, int r, int c, float val);
-	int get_regions( IplImage* frame, CvRect** regions );
-    int get_regionsImage( IplImage* frame, CvRect** regions );
-	particle* resample( particle* particles, int n );
+    void apply_templates();
+    void init_object( particle_set& o, IplImage* img );
+	void transition( particle_set& o, int w, int h );
+	void bgr2hsv( IplImage* bgr, IplImage* hsv );
+	float likelihood( int r, int c, int w, int h, const histogram* ref_histo );
+	void normalize_weights( particle_set& o );
+	int best_particle( const particle_set& o );
+	float histo_dist_sq( const histogram* h1, const histogram* h2 );
+	float resample( particle_set& o );
 	void display_particle( IplImage* img, const particle &p, CvScalar color, yarp::sig::Vector& target );
     void display_particleBlob( IplImage* img, const particle &p, yarp::sig::Vector& target );
     void trace_template( IplImage* img, const particle &p );
-    void normalize_histogram( histogram* histo );
     void initAll();
     void runAll(IplImage *img);
    
 
 public:
     /* class methods */
-    PARTICLEThread();
+    PARTICLEThread(int objects = OBJECTS);
     ~PARTICLEThread();
 
     bool threadInit();     
     void threadRelease();
     void run(); 
     void setName(std::string module);
-    void setTemplate(yarp::sig::ImageOf<yarp::sig::PixelRgb> *tpl);
+    void setTemplate(yarp::sig::ImageOf<yarp::sig::PixelRgb> *tpl, int object = 0);
     void pushTarget(yarp::sig::Vector &target, yarp::os::Stamp &stamp);
+    void pushTargets(std::vector<yarp::sig::Vector> &targets, yarp::os::Stamp &stamp);
     float getAverage();
     TemplateStruct getBestTemplate();
 };
@@ -222,6 +205,7 @@ private:
 
     yarp::os::BufferedPort<yarp::sig::ImageOf<yarp::sig::PixelRgb> >  imageInTemp;
     yarp::os::Port target; //vector containing the tracked target 2D and its probability
+    yarp::os::Port targetsPort; //bottle containing one list per tracked object
     yarp::os::Port disparityPort;
     yarp::os::Port target3D;
 
@@ -230,6 +214,8 @@ private:
 
     yarp::sig::ImageOf<yarp::sig::PixelRgb> *tpl;
     std::string moduleName;
+    int num_objects;
+    int nextObject;    /* object given the next template */
     
 
 public:
@@ -238,6 +224,7 @@ public:
     bool            shouldSend;
 
     void setName(std::string module);
+    void setObjects(int objects);
     bool threadInit();     
     void threadRelease();
     void run(); 
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2016 iCub Facility - Istituto Italiano di Tecnologia
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#include <cstring>
+#include <algorithm>
+#include <iCub/integralHistogram.h>
+
+using namespace std;
+
+/**********************************************************/
+IntegralHistogram::IntegralHistogram( int _nh, int _ns, int _nv, float _sThresh, float _vThresh,
+                                      float _hMax, float _sMax, float _vMax ) :
+    nh(_nh), ns(_ns), nv(_nv), sThresh(_sThresh), vThresh(_vThresh),
+    hMax(_hMax), sMax(_sMax), vMax(_vMax), width(0), height(0)
+{
+    bins = nh*ns + nv;
+    CV_Assert( bins <= 256 );   // the bins are stored in bytes
+}
+/**********************************************************/
+int IntegralHistogram::bin( float h, float s, float v ) const
+{
+    int hd, sd, vd;
+
+    // if S or V is less than its threshold, return a "colorless" bin
+    vd = MIN( (int)(v * nv / vMax), nv-1 );
+    if( s < sThresh  ||  v < vThresh )
+        return nh * ns + vd;
+
+    // otherwise determine "colorful" bin
+    hd = MIN( (int)(h * nh / hMax), nh-1 );
+    sd = MIN( (int)(s * ns / sMax), ns-1 );
+    return sd * nh + hd;
+}
+/**********************************************************/
+void IntegralHistogram::compute( const IplImage* hsv )
+{
+    CV_Assert( hsv->depth == IPL_DEPTH_32F && hsv->nChannels == 3 );
+
+    if( hsv->width != width || hsv->height != height )
+    {
+        width = hsv->width;
+        height = hsv->height;
+        binMap.resize( (size_t)width*height );
+        integral.resize( (size_t)(width+1)*(height+1)*bins );
+    }
+
+    // quantise the frame
+    for( int r = 0; r < height; r++ )
+    {
+        const float* row = (const float*)( hsv->imageData + hsv->widthStep*r );
+        unsigned char* b = &binMap[(size_t)r*width];
+        for( int c = 0; c < width; c++ )
+            b[c] = (unsigned char)bin( row[3*c], row[3*c+1], row[3*c+2] );
+    }
+
+    // the first row and the first column are 0, then every cell is the cell above
+    // plus the counts of the row up to the cell (wrapping around 2^16)
+    const size_t rowStride = (size_t)(width+1)*bins;
+    memset( &integral[0], 0, rowStride*sizeof(unsigned short) );
+    vector<unsigned short> rowCounts( bins );
+    for( int r = 0; r < height; r++ )
+    {
+        unsigned short* above = &integral[(size_t)r*rowStride];
+        unsigned short* cur = above + rowStride;
+        memset( cur, 0, bins*sizeof(unsigned short) );
+        fill( rowCounts.begin(), rowCounts.end(), 0 );
+        const unsigned char* b = &binMap[(size_t)r*width];
+        for( int c = 0; c < width; c++ )
+        {
+            rowCounts[b[c]]++;
+            const unsigned short* up = above + (size_t)(c+1)*bins;
+            unsigned short* dst = cur + (size_t)(c+1)*bins;
+            for( int k = 0; k < bins; k++ )
+                dst[k] = (unsigned short)( up[k] + rowCounts[k] );
+        }
+    }
+}
+/**********************************************************/
+int IntegralHistogram::getHistogram( CvRect rect, float* hist ) const
+{
+    // clip the window to the frame
+    int x0 = MAX( rect.x, 0 );
+    int y0 = MAX( rect.y, 0 );
+    int x1 = MIN( rect.x + rect.width, width );
+    int y1 = MIN( rect.y + rect.height, height );
+    if( x1 <= x0 || y1 <= y0 )
+    {
+        memset( hist, 0, bins*sizeof(float) );
+        return 0;
+    }
+    int area = (x1-x0)*(y1-y0);
+    float inv_area = 1.0f / area;
+
+    if( area < 65536 )
+    {
+        const size_t rowStride = (size_t)(width+1)*bins;
+        const unsigned short* a = &integral[(size_t)y0*rowStride + (size_t)x0*bins];
+        const unsigned short* b = &integral[(size_t)y0*rowStride + (size_t)x1*bins];
+        const unsigned short* c = &integral[(size_t)y1*rowStride + (size_t)x0*bins];
+        const unsigned short* d = &integral[(size_t)y1*rowStride + (size_t)x1*bins];
+        for( int k = 0; k < bins; k++ )
+        {
+            unsigned short n = (unsigned short)( d[k] - b[k] - c[k] + a[k] );
+            hist[k] = n * inv_area;
+        }
+    }
+    else
+    {
+        int counts[256];
+        memset( counts, 0, bins*sizeof(int) );
+        for( int r = y0; r < y1; r++ )
+        {
+            const unsigned char* row = &binMap[(size_t)r*width];
+            for( int c = x0; c < x1; c++ )
+                counts[row[c]]++;
+        }
+        for( int k = 0; k < bins; k++ )
+            hist[k] = counts[k] * inv_area;
+    }
+    return area;
+}
+//empty line to make gcc happy
@@ -20,7 +20,7 @@
 \defgroup icub_templatePFTracker Template Tracking with Particle Filter
 @ingroup icub_module
  
-This module expects a template from the following port /templatePFTracker/template/image:i in order to commence tracking. This is a simple single-object tracker that uses a color histogram-based observation model. 
+This module expects a template from the following port /templatePFTracker/template/image:i in order to commence tracking. This is a simple tracker that uses a color histogram-based observation model: each template is an object tracked by its own set of particles, and up to \c objects objects are tracked at the same time. 
 Particle filtering is a Monte Carlo sampling approach to Bayesian filtering.The particle filtering algorithm maintains a probability distribution over the state of the system it is monitoring, in this case, the state -- location, scale, etc. -- of the object being tracked. Particle filtering represents the distribution as a set of weighted samples, or particles. Each particle describes one possible location of the object being tracked. The set of particles contains more weight at locations where the object being tracked is more likely to be. The most probable state of the object is determined by finding the location in the particle filtering distribution with the highest weight.
 
 \section lib_sec Libraries
@@ -42,6 +42,10 @@ The following key-value pairs can be specified as command-line parameters by pre
 - \c name \c templatePFTracker \n   
   specifies the name of the module (used to form the stem of module port names)  
 
+- \c objects \c 1 \n   
+  specifies the number of objects tracked at the same time; every new template
+  replaces the oldest object
+
 <b>Configuration File Parameters </b>
 
 The following key-value pairs can be specified as parameters in the configuration file 
@@ -118,6 +122,10 @@ The value part can be changed to suit your needs; the default values are shown b
  - \c /templatePFTracker/leftblob/image:o \n
  - \c /templatePFTracker/rightblob/image:o \n
  - \c /templatePFTracker/target:o \n
+ - \c /templatePFTracker/targets:o \n
+   Sends a Bottle with one list per object tracked in both images: the index of the object,
+   then the target of the left and of the right image as in target:o, eg:
+   ((0 180.0 116.0 167.0 102.0 193.0 130.0 150.0 116.0 137.0 102.0 163.0 130.0))
 
 <b>Port types </b>
 
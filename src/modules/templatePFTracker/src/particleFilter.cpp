@@ -26,57 +26,63 @@ using namespace yarp::os;
 using namespace yarp::sig;
 
 /**********************************************************/
-int particle_cmp( const void* p1, const void* p2 ) 
-{
-    PARTICLEThread::particle* _p1 = (PARTICLEThread::particle*)p1;
-    PARTICLEThread::particle* _p2 = (PARTICLEThread::particle*)p2;
-
-    if( _p1->w > _p2->w )
-        return -1;
-    if( _p1->w < _p2->w )
-        return 1;
-    return 0;
-}
-/**********************************************************/
-
 PARTICLEThread::~PARTICLEThread() 
 {
     cout << "deleting dynamic objects" << endl;
-    if(regions!=NULL)
-        free_regions ( regions, num_objects );
-
-    gsl_rng_free ( rng );
-    free_histos ( ref_histos, num_objects);  
-    if(particles != NULL)
-        free ( particles);
-
-    if (temp)
+    for (size_t k = 0; k < objects.size(); k++)
     {
-        cout << "releasing temp" << endl;        
-        cvReleaseImage(&temp);
+        gsl_rng_free ( objects[k].rng );
+        if (objects[k].temp)
+            cvReleaseImage(&objects[k].temp);
     }
+    for (size_t k = 0; k < pendingTemplates.size(); k++)
+        delete pendingTemplates[k].second;
+
+    if (frame)
+        cvReleaseImage(&frame);
+    if (frame_blob)
+        cvReleaseImage(&frame_blob);
+    if (img_bgr32f)
+        cvReleaseImage(&img_bgr32f);
+    if (img_hsv)
+        cvReleaseImage(&img_hsv);
+
     cout << "finished particle thread" << endl;
 }
 /**********************************************************/
-PARTICLEThread::PARTICLEThread() 
+PARTICLEThread::PARTICLEThread(int _objects) :
+    integral_histo( NH, NS, NV, S_THRESH, V_THRESH, H_MAX, S_MAX, V_MAX )
 {
-    firstFrame = true;
-    num_objects = 0;
-    regions = (CvRect **) malloc(sizeof(CvRect*));
-    num_particles = PARTICLES;    /* number of particles */
-    rng = gsl_rng_alloc( gsl_rng_mt19937 );
-    gsl_rng_set( rng, (unsigned long)time(NULL) );
-    i = 0;
-    getTemplate = false;
-    gotTemplate = false;
-    sendTarget = false;
+    num_objects = MAX( 1, _objects );
+    num_particles = PARTICLES;    /* number of particles per object */
     getImage = false;
-    particles = NULL;
-    new_particles = NULL;
-    temp = NULL;
-    ref_histos = NULL;
-    tpl = NULL;
-    total = 0;
+    frame = frame_blob = NULL;
+    img_hsv = img_bgr32f = NULL;
+
+    // the particles of all the objects are allocated here, once
+    objects.resize( num_objects );
+    targets.resize( num_objects );
+    for( int k = 0; k < num_objects; k++ )
+    {
+        particle_set &o = objects[k];
+        for( int b = 0; b < 2; b++ )
+        {
+            o.x[b].resize( num_particles );
+            o.y[b].resize( num_particles );
+            o.s[b].resize( num_particles );
+            o.xp[b].resize( num_particles );
+            o.yp[b].resize( num_particles );
+            o.sp[b].resize( num_particles );
+        }
+        o.w.resize( num_particles );
+        o.cur = 0;
+        o.rng = gsl_rng_alloc( gsl_rng_mt19937 );
+        gsl_rng_set( o.rng, (unsigned long)time(NULL) + k );
+        o.temp = NULL;
+        o.active = false;
+        o.firstFrame = false;
+        o.average = 0.0f;
+    }
 }
 /**********************************************************/
 void PARTICLEThread::setName(string module) 
@@ -98,7 +104,6 @@ bool PARTICLEThread::threadInit()
     outputPortNameBlob = "/" + moduleName + "/blob/image:o";
     imageOutBlob.open( outputPortNameBlob.c_str() );
 
-    num_objects = 0;
     init = true;
 
     updateNeeded=false;
@@ -123,50 +128,17 @@ void PARTICLEThread::run()
                 initAll();     
             }
             else
-            {
                 iCubImage = imageIn.read();
-                templateMutex.wait();
-                imageIn.getEnvelope(targetTemp);
-                templateMutex.post();
-            }
  
-            frame = cvCreateImage(cvSize(width,height),IPL_DEPTH_8U, 3 );           
             cvCvtColor((IplImage*)iCubImage->getIplImage(), frame, CV_RGB2BGR);
-            frame_blob = cvCreateImage(cvSize(width,height),IPL_DEPTH_8U, 1 );
 
-            if ( tpl != NULL )
-            {
-                IplImage *ipl_tpl=(IplImage *) tpl->getIplImage();
-                tpl_width  = tpl->width();
-                tpl_height = tpl->height();
-                res_width  = width - tpl_width + 1;
-                res_height = height - tpl_height + 1;
-                cvReleaseImage(&temp);
-                temp = cvCreateImage(cvGetSize(ipl_tpl), ipl_tpl->depth, ipl_tpl->nChannels );
-                cvCvtColor(ipl_tpl, temp, CV_RGB2BGR);
-                gotTemplate = true;
-                firstFrame = true;
-                if (num_objects>0)
-                    free(*regions);
-                num_objects = 0;
-                delete tpl;
-                tpl = NULL;
-                //delete ipl_tpl;
-                
-                templateMutex.wait();
-                while(tempList.size())
-                {  
-                    delete tempList.back().templ;
-                    tempList.pop_back();
-                }
-                if(bestTempl.templ!=NULL)
-                    delete bestTempl.templ;
-                bestTempl.w=0.0;
-                updateNeeded=false;
-                templateMutex.post();
-            }
+            apply_templates();
+
+            bool tracking = false;
+            for( int k = 0; k < num_objects; k++ )
+                tracking = tracking || objects[k].active;
 
-            if (gotTemplate)
+            if (tracking)
             {
                 runAll(frame);
             }
@@ -186,8 +158,6 @@ void PARTICLEThread::run()
                 cvCopy( frame_blob, (IplImage *) imgBlob.getIplImage());
                 imageOutBlob.write();
             }
-            cvReleaseImage(&frame);
-            cvReleaseImage(&frame_blob);
         }
     } //while
 }
@@ -223,337 +193,256 @@ void PARTICLEThread::initAll()
     iCubImage = imageIn.read();
     width = iCubImage->width();
     height = iCubImage->height();
+
+    // the frames keep the size of the first image
+    frame = cvCreateImage( cvSize(width,height), IPL_DEPTH_8U, 3 );
+    frame_blob = cvCreateImage( cvSize(width,height), IPL_DEPTH_8U, 1 );
+    img_bgr32f = cvCreateImage( cvSize(width,height), IPL_DEPTH_32F, 3 );
+    img_hsv = cvCreateImage( cvSize(width,height), IPL_DEPTH_32F, 3 );
+    cvZero( frame_blob );
     init = false;
 }
 /**********************************************************/
-void PARTICLEThread::runAll(IplImage *img)
+void PARTICLEThread::apply_templates()
 {
-    img_hsv = bgr2hsv( img );
-    if (firstFrame)
+    pendingMutex.wait();
+    for (size_t i = 0; i < pendingTemplates.size(); i++)
     {
-        w = img->width;
-        h = img->height;
-            
-        while( num_objects == 0 )
+        particle_set &o = objects[pendingTemplates[i].first];
+        ImageOf<PixelRgb> *tpl = pendingTemplates[i].second;
+        IplImage *ipl_tpl=(IplImage *) tpl->getIplImage();
+        if (o.temp)
+            cvReleaseImage(&o.temp);
+        o.temp = cvCreateImage(cvGetSize(ipl_tpl), ipl_tpl->depth, ipl_tpl->nChannels );
+        cvCvtColor(ipl_tpl, o.temp, CV_RGB2BGR);
+        o.active = true;
+        o.firstFrame = true;
+        delete tpl;
+
+        // the stored templates belong to the first object
+        if (pendingTemplates[i].first == 0)
         {
-            num_objects = get_regionsImage( img, regions );
-            if( num_objects == 0 )
-                fprintf( stderr, "Problem! seg has issues\n" );
-        }   
-        if (ref_histos!=NULL)
-            free_histos ( ref_histos, num_objects);        
-
-        ref_histos = compute_ref_histos( img_hsv, *regions, num_objects );
-        if (particles != NULL)
-            free (particles);
-
-        particles= init_distribution( *regions, ref_histos, num_objects, num_particles );
+            templateMutex.wait();
+            while(tempList.size())
+            {  
+                delete tempList.back().templ;
+                tempList.pop_back();
+            }
+            if(bestTempl.templ!=NULL)
+                delete bestTempl.templ;
+            bestTempl.templ=NULL;
+            bestTempl.w=0.0;
+            updateNeeded=false;
+            templateMutex.post();
+        }
     }
-    else
+    pendingTemplates.clear();
+    pendingMutex.post();
+}
+/**********************************************************/
+void PARTICLEThread::runAll(IplImage *img)
+{
+    int w = img->width;
+    int h = img->height;
+
+    bgr2hsv( img, img_hsv );
+    integral_histo.compute( img_hsv );
+
+    // prediction for each particle: every object samples from its own generator,
+    // so the objects are independent; a new object is only initialized
+    vector<char> measure( num_objects, 0 );
+    #pragma omp parallel for schedule(dynamic)
+    for( int k = 0; k < num_objects; k++ )
     {
-        // perform prediction and measurement for each particle
-        for( j = 0; j < num_particles; j++ ) 
+        particle_set &o = objects[k];
+        if( !o.active )
+            continue;
+        if( o.firstFrame )
+            init_object( o, img );
+        else
         {
-            particles[j] = transition( particles[j], w, h, rng );
-            s = particles[j].s;
-            particles[j].w = likelihood( img_hsv, cvRound(particles[j].y),
-            cvRound( particles[j].x ),
-            cvRound( particles[j].width * s ),
-            cvRound( particles[j].height * s ),
-            particles[j].histo );
+            transition( o, w, h );
+            measure[k] = 1;
         }
-        // normalize weights and resample a set of unweighted particles
-        normalize_weights( particles, num_particles );
-        new_particles = resample( particles, num_particles );
-        free( particles );
-        particles = new_particles;
     }
-    qsort( particles, num_particles, sizeof( PARTICLEThread::particle ), &particle_cmp );
 
-    averageMutex.wait();
-    for( j = 0; j < num_particles; j++ ) 
-        average += particles[j].w;
-        
-    average = average/num_particles;
-    averageMutex.post();
+    // measurement for each particle of every object: the integral histogram is only read,
+    // so all the particles are weighted in parallel
+    int total = num_objects * num_particles;
+    #pragma omp parallel for schedule(static)
+    for( int n = 0; n < total; n++ )
+    {
+        particle_set &o = objects[n / num_particles];
+        if( !measure[n / num_particles] )
+            continue;
+        int p = n % num_particles;
+        float ps = o.s[o.cur][p];
+        o.w[p] = likelihood( cvRound( o.y[o.cur][p] ),
+        cvRound( o.x[o.cur][p] ),
+        cvRound( o.width * ps ),
+        cvRound( o.height * ps ),
+        &o.ref_histo );
+    }
 
-    //display most likely particle ------------------
-    color = CV_RGB(255,0,0);
+    cvZero( frame_blob );
     targetMutex.wait();
-    targetTemp.clear();
-    //if (imageOut.getOutputCount()>0)
-    display_particle( frame, particles[0], color, targetTemp );
-    
-    if (imageOutBlob.getOutputCount()>0)
-        display_particleBlob( frame_blob, particles[0], targetTemp );
-    targetMutex.post();
-    trace_template( frame, particles[0] );
+    for( int k = 0; k < num_objects; k++ )
+    {
+        particle_set &o = objects[k];
+        targets[k].clear();
+        if( !o.active )
+            continue;
+
+        // keep the most likely particle, then resample a set of unweighted particles
+        float sum = 0.0f;
+        if( measure[k] )
+        {
+            normalize_weights( o );
+            int b = best_particle( o );
+            o.best.x = o.x[o.cur][b];
+            o.best.y = o.y[o.cur][b];
+            o.best.s = o.s[o.cur][b];
+            o.best.w = o.w[b];
+            sum = resample( o );
+        }
+        o.best.width = o.width;
+        o.best.height = o.height;
+
+        averageMutex.wait();
+        o.average = ( o.average + sum ) / num_particles;
+        averageMutex.post();
+
+        //display most likely particle ------------------
+        CvScalar color = k == 0 ? CV_RGB(255,0,0) : CV_RGB((80*k)%256,255-(50*k)%256,(160*k)%256);
+        display_particle( frame, o.best, color, targets[k] );
 
-    cvReleaseImage(&img_hsv);
+        if (imageOutBlob.getOutputCount()>0)
+            display_particleBlob( frame_blob, o.best, targets[k] );
+    }
+    targetMutex.post();
+    if( objects[0].active )
+        trace_template( frame, objects[0].best );
 }
 /**********************************************************/
-void PARTICLEThread::setTemplate(ImageOf<PixelRgb> *_tpl)
+void PARTICLEThread::setTemplate(ImageOf<PixelRgb> *_tpl, int object)
 {
-    tpl = new ImageOf<PixelRgb> (*_tpl);
+    if (object < 0 || object >= num_objects)
+        return;
+    pendingMutex.wait();
+    pendingTemplates.push_back( make_pair( object, new ImageOf<PixelRgb> (*_tpl) ) );
+    pendingMutex.post();
 }
 /**********************************************************/
 void PARTICLEThread::pushTarget(Vector &target, Stamp &stamp)
 {
     targetMutex.wait();
-    for (size_t i=0; i< targetTemp.length(); i++ )
-        target.push_back(targetTemp[i]);
+    for (size_t i=0; i< targets[0].length(); i++ )
+        target.push_back(targets[0][i]);
 
     stamp=targetStamp;
     targetMutex.post();
 }
 /**********************************************************/
+void PARTICLEThread::pushTargets(vector<Vector> &_targets, Stamp &stamp)
+{
+    targetMutex.wait();
+    _targets = targets;
+    stamp=targetStamp;
+    targetMutex.post();
+}
+/**********************************************************/
 float PARTICLEThread::getAverage()
 {
     averageMutex.wait();
     float tmpAv = 0.0;
-    tmpAv = average;
+    tmpAv = objects[0].average;
     averageMutex.post();
     return tmpAv;
     //average.push_back(tmpAv);
 }
 /**********************************************************/
-int PARTICLEThread::get_regionsImage( IplImage* frame, CvRect** regions ) 
+void PARTICLEThread::init_object( particle_set& o, IplImage* img ) 
 {
-    firstFrame = false;
-    params p;
-    CvRect* r;
-    int i; //x1, y1, x2, y2, w, h;
+    CvPoint	minloc, maxloc;
+    double	minval, maxval;
 
-    p.orig_img = cvCloneImage( frame );
-    p.cur_img = NULL;
-    p.n = 0;
-
-    res = cvCreateImage( cvSize( res_width, res_height ), IPL_DEPTH_32F, 1 );
-
-    cvMatchTemplate( frame, temp, res, CV_TM_SQDIFF );
+    // find the template in the frame
+    IplImage* res = cvCreateImage( cvSize( img->width - o.temp->width + 1, img->height - o.temp->height + 1 ), IPL_DEPTH_32F, 1 );
+    cvMatchTemplate( img, o.temp, res, CV_TM_SQDIFF );
     cvMinMaxLoc( res, &minval, &maxval, &minloc, &maxloc, 0 );
-
-    cvReleaseImage( &(p.orig_img) );    //what was the purpose of this image?
     cvReleaseImage( &res );
-    if( p.cur_img )
-        cvReleaseImage( &(p.cur_img) );
-    p.n = 1;
-    // extract regions defined by user; store as an array of rectangles ----------
-    
-    r = (CvRect*) malloc ( p.n * sizeof( CvRect ) );
 
-    for( i = 0; i < p.n; i++ )
-        r[i] = cvRect( minloc.x, minloc.y, tpl_width, tpl_height );
-        
-    *regions = r;
-    
-    return p.n;
-}
-/**********************************************************/
-PARTICLEThread::histogram** PARTICLEThread::compute_ref_histos( IplImage* frame, CvRect* regions, int n )
-{
-    histogram** histos = (histogram**) malloc( n * sizeof( histogram* ) );
-    IplImage* tmp;
-    int i;
+    CvRect region = cvRect( minloc.x, minloc.y, o.temp->width, o.temp->height );
 
-    // extract each region from frame and compute its histogram 
-    for( i = 0; i < n; i++ )
-    {
-        cvSetImageROI( frame, regions[i]);
-        tmp = cvCreateImage( cvGetSize(frame), IPL_DEPTH_32F, 3 );
-        cvCopy( frame, tmp, NULL );
-        cvResetImageROI( frame );
-        histos[i] = calc_histogram( &tmp, 1 );
-        normalize_histogram( histos[i] );
-        cvReleaseImage( &tmp );
-    }
-    return histos;
-}
-/**********************************************************/
-PARTICLEThread::histogram* PARTICLEThread::calc_histogram( IplImage** imgs, int n ) 
-{
-    IplImage* img;
-    histogram* histo;
-    IplImage* h, * s, * v;
-    float* hist;
-    int i, r, c, bin;
-    histo = (histogram*) malloc( sizeof(histogram) );
-    histo->n = NH*NS + NV;
-    hist = histo->histo;
-    memset( hist, 0, histo->n * sizeof(float) );
-    for( i = 0; i < n; i++ )
-    {
-        // extract individual HSV planes from image 
-        img = imgs[i];
-        h = cvCreateImage( cvGetSize(img), IPL_DEPTH_32F, 1 );
-        s = cvCreateImage( cvGetSize(img), IPL_DEPTH_32F, 1 );
-        v = cvCreateImage( cvGetSize(img), IPL_DEPTH_32F, 1 );
-        cvSplit( img, h, s, v, NULL );
-
-        // increment appropriate histogram bin for each pixel 
-        for( r = 0; r < img->height; r++ )
-            for( c = 0; c < img->width; c++ )
-            {
-                bin = histo_bin( pixval32f( h, r, c ),
-                pixval32f( s, r, c ),
-                pixval32f( v, r, c ) );
-                hist[bin] += 1;
-            }
-        cvReleaseImage( &h );
-        cvReleaseImage( &s );
-        cvReleaseImage( &v );
-    }
-    return histo;
-}
-/**********************************************************/
-void PARTICLEThread::free_histos( PARTICLEThread::histogram** histo, int n) 
-{
-    for (int i = 0; i < n; i++)    
-        free (histo[i]);
+    // the histogram of the region comes from the integral histogram of the frame
+    o.ref_histo.n = NH*NS + NV;
+    integral_histo.getHistogram( region, o.ref_histo.histo );
 
-    free(histo);
-}
-/**********************************************************/
-void PARTICLEThread::free_regions( CvRect** regions, int n) 
-{
-    for (int i = 0; i < n; i++)    
-        free (regions[i]);
+    // create the particles at the center of the region
+    o.width = region.width;
+    o.height = region.height;
+    o.x0 = region.x + (float)(o.width / 2);
+    o.y0 = region.y + (float)(o.height / 2);
+    o.cur = 0;
+    fill( o.x[0].begin(), o.x[0].end(), o.x0 );
+    fill( o.xp[0].begin(), o.xp[0].end(), o.x0 );
+    fill( o.y[0].begin(), o.y[0].end(), o.y0 );
+    fill( o.yp[0].begin(), o.yp[0].end(), o.y0 );
+    fill( o.s[0].begin(), o.s[0].end(), 1.0f );
+    fill( o.sp[0].begin(), o.sp[0].end(), 1.0f );
+    fill( o.w.begin(), o.w.end(), 0.0f );
 
-   free(regions);
+    o.best.x = o.x0;
+    o.best.y = o.y0;
+    o.best.s = 1.0f;
+    o.best.w = 0.0f;
+    o.firstFrame = false;
 }
 /**********************************************************/
-void PARTICLEThread::normalize_histogram( PARTICLEThread::histogram* histo ) 
+void PARTICLEThread::transition( particle_set& o, int w, int h ) 
 {
-    float* hist;
-    float sum = 0, inv_sum;
-    int i, n;
-
-    hist = histo->histo;
-    n = histo->n;
-
-    // compute sum of all bins and multiply each bin by the sum's inverse 
-    for( i = 0; i < n; i++ )
-        sum += hist[i];
-    inv_sum = 1.0f / sum;
-    for( i = 0; i < n; i++ )
-        hist[i] *= inv_sum;
-}
-/**********************************************************/
-int PARTICLEThread::histo_bin( float h, float s, float v )
-{
-    int hd, sd, vd;
-
-    // if S or V is less than its threshold, return a "colorless" bin 
-    vd = MIN( (int)(v * NV / V_MAX), NV-1 );
-    if( s < S_THRESH  ||  v < V_THRESH )
-        return NH * NS + vd;
-
-    // otherwise determine "colorful" bin 
-    hd = MIN( (int)(h * NH / H_MAX), NH-1 );
-    sd = MIN( (int)(s * NS / S_MAX), NS-1 );
-    return sd * NH + hd;
-}
-/**********************************************************/
-PARTICLEThread::particle* PARTICLEThread::init_distribution( CvRect* regions, histogram** histos, int n, int p) 
-{
-    particle* particles;
-    int np;
-    float x, y;
-    int i, j, width, height, k = 0;
-
-    particles = (particle* )malloc( p * sizeof( particle ) );
-    np = p / n;
+    float x, y, s;
+    float* px = &o.x[o.cur][0], * py = &o.y[o.cur][0], * ps = &o.s[o.cur][0];
+    float* pxp = &o.xp[o.cur][0], * pyp = &o.yp[o.cur][0], * psp = &o.sp[o.cur][0];
 
-    // create particles at the centers of each of n regions 
-    for( i = 0; i < n; i++ ) {
-        width = regions[i].width;
-        height = regions[i].height;
-        x = regions[i].x + (float)(width / 2);
-        y = regions[i].y + (float) (height / 2);
-        for( j = 0; j < np; j++ ) 
-        {
-            particles[k].x0 = particles[k].xp = particles[k].x = x;
-            particles[k].y0 = particles[k].yp = particles[k].y = y;
-            particles[k].sp = particles[k].s = 1.0;
-            particles[k].width = width;
-            particles[k].height = height;
-            particles[k].histo = histos[i];
-            particles[k++].w = 0;
-        }
-    }
-    // make sure to create exactly p particles 
-    i = 0;
-    while( k < p ) 
+    // sample new state using second-order autoregressive dynamics 
+    for( int i = 0; i < num_particles; i++ )
     {
-        width = regions[i].width;
-        height = regions[i].height;
-        x = regions[i].x + (float) (width / 2);
-        y = regions[i].y + (float) (height / 2);
-        particles[k].x0 = particles[k].xp = particles[k].x = x;
-        particles[k].y0 = particles[k].yp = particles[k].y = y;
-        particles[k].sp = particles[k].s = 1.0;
-        particles[k].width = width;
-        particles[k].height = height;
-        particles[k].histo = histos[i];
-        particles[k++].w = 0;
-        i = ( i + 1 ) % n;
+        x = pfot_A1 * ( px[i] - o.x0 ) + pfot_A2 * ( pxp[i] - o.x0 ) +
+        pfot_B0 * (float)(gsl_ran_gaussian( o.rng, TRANS_X_STD )) + o.x0;
+        y = pfot_A1 * ( py[i] - o.y0 ) + pfot_A2 * ( pyp[i] - o.y0 ) +
+        pfot_B0 * (float)(gsl_ran_gaussian( o.rng, TRANS_Y_STD )) + o.y0;
+        s = pfot_A1 * ( ps[i] - 1.0f ) + pfot_A2 * ( psp[i] - 1.0f ) +
+        pfot_B0 * (float)(gsl_ran_gaussian( o.rng, TRANS_S_STD )) + 1.0f;
+
+        pxp[i] = px[i];
+        pyp[i] = py[i];
+        psp[i] = ps[i];
+        px[i] = MAX( 0.0f, MIN( (float)w - 1.0f, x ) );
+        py[i] = MAX( 0.0f, MIN( (float)h - 1.0f, y ) );
+        ps[i] = MAX( 0.1f, s );
+        o.w[i] = 0;
     }
-    return particles;
 }
 /**********************************************************/
-PARTICLEThread::particle PARTICLEThread::transition( const PARTICLEThread::particle &p, int w, int h, gsl_rng* rng ) 
+float PARTICLEThread::likelihood( int r, int c, int w, int h, const histogram* ref_histo ) 
 {
-    float x, y, s;
-    PARTICLEThread::particle pn;
-
-    // sample new state using second-order autoregressive dynamics 
-    x = pfot_A1 * ( p.x - p.x0 ) + pfot_A2 * ( p.xp - p.x0 ) +
-    pfot_B0 * (float)(gsl_ran_gaussian( rng, TRANS_X_STD )) + p.x0;
-    pn.x = MAX( 0.0f, MIN( (float)w - 1.0f, x ) );
-    y = pfot_A1 * ( p.y - p.y0 ) + pfot_A2 * ( p.yp - p.y0 ) +
-    pfot_B0 * (float)(gsl_ran_gaussian( rng, TRANS_Y_STD )) + p.y0;
-    pn.y = MAX( 0.0f, MIN( (float)h - 1.0f, y ) );
-    s = pfot_A1 * ( p.s - 1.0f ) + pfot_A2 * ( p.sp - 1.0f ) +
-    pfot_B0 * (float)(gsl_ran_gaussian( rng, TRANS_S_STD )) + 1.0f;
-    pn.s = MAX( 0.1f, s );
-
-    pn.xp = p.x;
-    pn.yp = p.y;
-    pn.sp = p.s;
-    pn.x0 = p.x0;
-    pn.y0 = p.y0;
-    pn.width = p.width;
-    pn.height = p.height;
-    pn.histo = p.histo; 
-    pn.w = 0;
-
-    return pn;
-}
-/**********************************************************/
-float PARTICLEThread::likelihood( IplImage* img, int r, int c, int w, int h, histogram* ref_histo ) 
-{
-    IplImage* tmp;
-    histogram* histo;
+    histogram histo;
     float d_sq;
 
-    // extract region around (r,c) and compute and normalize its histogram 
-    cvSetImageROI( img, cvRect( c - w / 2, r - h / 2, w, h ) );
-    tmp = cvCreateImage( cvGetSize(img), IPL_DEPTH_32F, 3 );
-    cvCopy( img, tmp, NULL );
-    cvResetImageROI( img );
-    histo = calc_histogram( &tmp, 1 );
-    cvReleaseImage( &tmp );
-    normalize_histogram( histo );
+    // normalized histogram of the region around (r,c), from the integral histogram 
+    histo.n = NH*NS + NV;
+    if( integral_histo.getHistogram( cvRect( c - w / 2, r - h / 2, w, h ), histo.histo ) == 0 )
+        return 0.0f;
 
     // compute likelihood as e^{\lambda D^2(h, h^*)} 
-    d_sq = histo_dist_sq( histo, ref_histo );
-    free( histo );
+    d_sq = histo_dist_sq( &histo, ref_histo );
     return exp( -LAMBDA * d_sq );
 }
 /**********************************************************/
-float PARTICLEThread::histo_dist_sq( histogram* h1, histogram* h2 ) 
+float PARTICLEThread::histo_dist_sq( const histogram* h1, const histogram* h2 ) 
 {
-    float* hist1, * hist2;
+    const float* hist1, * hist2;
     float sum = 0;
     int i, n;
 
@@ -576,41 +465,58 @@ float PARTICLEThread::histo_dist_sq( histogram* h1, histogram* h2 )
     }
 }
 /**********************************************************/
-void PARTICLEThread::normalize_weights( particle* particles, int n ) 
+void PARTICLEThread::normalize_weights( particle_set& o ) 
 {
     float sum = 0;
     int i;
 
-    for( i = 0; i < n; i++ )
-        sum += particles[i].w;
-    for( i = 0; i < n; i++ )
-        particles[i].w /= sum;
+    for( i = 0; i < num_particles; i++ )
+        sum += o.w[i];
+    if( sum <= 0.0f )
+    {
+        // the object is lost: the particles are equally likely
+        fill( o.w.begin(), o.w.end(), 1.0f / num_particles );
+        return;
+    }
+    for( i = 0; i < num_particles; i++ )
+        o.w[i] /= sum;
 }
 /**********************************************************/
-PARTICLEThread::particle* PARTICLEThread::resample( particle* particles, int n ) 
+int PARTICLEThread::best_particle( const particle_set& o ) 
 {
-    particle* _new_particles;
-    int i, j, np, k = 0;
-
-    //new_particles = (particle* )malloc( sizeof( particle ) );
-    qsort( particles, n, sizeof( particle ), &particle_cmp );
-    _new_particles = (particle* ) malloc( n * sizeof( particle ) );
+    int best = 0;
+    for( int i = 1; i < num_particles; i++ )
+        if( o.w[i] > o.w[best] )
+            best = i;
+    return best;
+}
+/**********************************************************/
+float PARTICLEThread::resample( particle_set& o ) 
+{
+    int c = o.cur, nc = 1 - o.cur;
+    int i = 0;
+    float step = 1.0f / num_particles;
+    float u = (float)gsl_rng_uniform( o.rng ) * step;
+    float cum = o.w[0];
+    float sum = 0;
 
-    for( i = 0; i < n; i++ ) 
+    // systematic resampling: the particles are picked by evenly spaced pointers with a
+    // single random offset, so each one is copied about w*n times
+    for( int k = 0; k < num_particles; k++ )
     {
-        np = cvRound( particles[i].w * n );
-        for( j = 0; j < np; j++ ) 
-        {
-            _new_particles[k++] = particles[i];
-        if( k == n )
-            goto exit;
-        }
+        while( cum < u && i < num_particles - 1 )
+            cum += o.w[++i];
+        o.x[nc][k] = o.x[c][i];
+        o.y[nc][k] = o.y[c][i];
+        o.s[nc][k] = o.s[c][i];
+        o.xp[nc][k] = o.xp[c][i];
+        o.yp[nc][k] = o.yp[c][i];
+        o.sp[nc][k] = o.sp[c][i];
+        sum += o.w[i];
+        u += step;
     }
-    while( k < n )
-        _new_particles[k++] = particles[0];
-
-    exit:
-    return _new_particles;
+    o.cur = nc;
+    return sum;
 }
 /**********************************************************/
 void PARTICLEThread::display_particle( IplImage* img, const PARTICLEThread::particle &p, CvScalar color, Vector& target ) 
@@ -643,16 +549,6 @@ void PARTICLEThread::display_particleBlob( IplImage* img, const PARTICLEThread::
     x1 = x0 + cvRound( p.s * p.width );
     y1 = y0 + cvRound( p.s * p.height );
 
-    int step       = img->widthStep/sizeof(uchar);
-    uchar* data    = (uchar *)img->imageData;
-    
-    for (int i=0; i<img->height; i++)
-    {
-        for (int j=0; j<img->width; j++)
-        {   
-            data[i*step+j] = 0;
-        }
-    }
     cvRectangle(img, cvPoint(x0,y0), cvPoint(x1,y1), cvScalar(255,255, 255), CV_FILLED);
 }
 /**********************************************************/
@@ -714,21 +610,10 @@ void PARTICLEThread::trace_template( IplImage* img, const particle &p )
     templateMutex.post();
 }
 /**********************************************************/
-float PARTICLEThread::pixval32f(IplImage* img, int r, int c) 
+void PARTICLEThread::bgr2hsv( IplImage* bgr, IplImage* hsv ) 
 {
-    return ( (float*)(img->imageData + img->widthStep*r) )[c];
-}
-/**********************************************************/
-IplImage* PARTICLEThread::bgr2hsv( IplImage* bgr ) 
-{
-    IplImage* bgr32f, * hsv;
-
-    bgr32f = cvCreateImage( cvGetSize(bgr), IPL_DEPTH_32F, 3 );
-    hsv = cvCreateImage( cvGetSize(bgr), IPL_DEPTH_32F, 3 );
-    cvConvertScale( bgr, bgr32f, 1.0 / 255.0, 0 );
-    cvCvtColor( bgr32f, hsv, CV_BGR2HSV );
-    cvReleaseImage( &bgr32f );
-    return hsv;
+    cvConvertScale( bgr, img_bgr32f, 1.0 / 255.0, 0 );
+    cvCvtColor( img_bgr32f, hsv, CV_BGR2HSV );
 }
 /**********************************************************/
 TemplateStruct PARTICLEThread::getBestTemplate()
@@ -751,6 +636,8 @@ TemplateStruct PARTICLEThread::getBestTemplate()
 PARTICLEManager::PARTICLEManager() : RateThread(20) 
 {
     tpl = NULL;
+    num_objects = OBJECTS;
+    nextObject = 0;
 }
 /**********************************************************/
 PARTICLEManager::~PARTICLEManager() { }
@@ -760,6 +647,11 @@ void PARTICLEManager::setName(string module)
     this->moduleName = module;
 }
 /**********************************************************/
+void PARTICLEManager::setObjects(int objects) 
+{
+    this->num_objects = MAX(1, objects);
+}
+/**********************************************************/
 bool PARTICLEManager::threadInit() 
 {
     //create all ports
@@ -768,12 +660,13 @@ bool PARTICLEManager::threadInit()
 
     outputPortNameTarget = "/" + moduleName + "/target:o";
     target.open( outputPortNameTarget.c_str() );
+    targetsPort.open(("/"+moduleName+"/targets:o").c_str());
 
     disparityPort.open(("/"+moduleName+"/triangulation:io").c_str());
     target3D.open(("/"+moduleName+"/target3d:o").c_str());
 
-    particleThreadLeft = new PARTICLEThread();
-    particleThreadRight = new PARTICLEThread();
+    particleThreadLeft = new PARTICLEThread(num_objects);
+    particleThreadRight = new PARTICLEThread(num_objects);
 
     particleThreadLeft->setName((moduleName + "/left").c_str());
     particleThreadRight->setName((moduleName + "/right").c_str());
@@ -801,8 +694,10 @@ void PARTICLEManager::run()
     if (tpl!=NULL) 
     {
         shouldSend = true;
-        particleThreadLeft->setTemplate(tpl);
-        particleThreadRight->setTemplate(tpl);
+        // every new template replaces the oldest object
+        particleThreadLeft->setTemplate(tpl, nextObject);
+        particleThreadRight->setTemplate(tpl, nextObject);
+        nextObject = (nextObject + 1) % num_objects;
     }
     Vector targetTemp;
     Stamp leftStamp,rightStamp;
@@ -810,6 +705,10 @@ void PARTICLEManager::run()
     particleThreadLeft->pushTarget(targetTemp,leftStamp);
     particleThreadRight->pushTarget(targetTemp,rightStamp);
 
+    vector<Vector> targetsLeft, targetsRight;
+    particleThreadLeft->pushTargets(targetsLeft,leftStamp);
+    particleThreadRight->pushTargets(targetsRight,rightStamp);
+
     float averageTempLeft = 0.0;
     float averageTempRight = 0.0;
 
@@ -828,6 +727,29 @@ void PARTICLEManager::run()
             target.setEnvelope(propagatedStamp);        
             target.write(targetTemp);
         }
+        if (targetsPort.getOutputCount() > 0 &&
+            fabs(leftStamp.getTime()-rightStamp.getTime())<0.002) 
+        {
+            // one list per object tracked in both images: index, then the left and the right target
+            Bottle targets;
+            for (size_t k=0; k<targetsLeft.size() && k<targetsRight.size(); k++)
+            {
+                if (targetsLeft[k].size() < 6 || targetsRight[k].size() < 6)
+                    continue;
+                Bottle &object = targets.addList();
+                object.addInt((int)k);
+                for (size_t i=0; i<6; i++)
+                    object.addDouble(targetsLeft[k][i]);
+                for (size_t i=0; i<6; i++)
+                    object.addDouble(targetsRight[k][i]);
+            }
+            if (targets.size() > 0)
+            {
+                Stamp propagatedStamp(leftStamp.getCount(),0.5*(leftStamp.getTime()+rightStamp.getTime()));
+                targetsPort.setEnvelope(propagatedStamp);
+                targetsPort.write(targets);
+            }
+        }
         if (disparityPort.getOutputCount() > 0 && targetTemp.size())
         {
             //fprintf(stdout,"getting ready to send\n");
@@ -868,8 +790,10 @@ void PARTICLEManager::threadRelease()
 
     imageInTemp.interrupt();
     target.interrupt();
+    targetsPort.interrupt();
     imageInTemp.close();
     target.close();
+    targetsPort.close();
 
     disparityPort.interrupt();
     disparityPort.close();
@@ -909,6 +833,9 @@ bool PARTICLEModule::configure(yarp::os::ResourceFinder &rf)
 
     /*pass the name of the module in order to create ports*/
     particleManager->setName(moduleName);    
+    particleManager->setObjects(rf.check("objects",
+                               Value(OBJECTS),
+                               "number of objects tracked at the same time (int)").asInt());
     /* now start the thread to do the work */
     particleManager->start();
     
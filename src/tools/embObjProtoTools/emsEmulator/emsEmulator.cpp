@@ -0,0 +1,705 @@
+/* Copyright (C) 2016  iCub Facility, Istituto Italiano di Tecnologia
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// - external dependencies
+// --------------------------------------------------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "emsEmulator.hpp"
+#include "cpuTime.h"
+
+#include "EoCommon.h"
+#include "EOarray.h"
+#include "EOnv.h"
+#include "EOrop.h"
+#include "EoProtocol.h"
+#include "EoProtocolMN.h"
+
+#include <ace/Handle_Set.h>
+
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Time.h>
+#include <yarp/os/Random.h>
+#include <yarp/os/Bottle.h>
+
+using namespace yarp::os;
+
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// - the emulated board
+// --------------------------------------------------------------------------------------------------------------------
+
+EmulatedBoard* EmulatedBoard::boards[16] = {NULL};
+
+
+EmulatedBoard::EmulatedBoard()
+{
+    period  = 0.001;
+    nextTX  = 0;
+    lastDue = 0;
+    memset(&impairments, 0, sizeof(impairments));
+    memset(&counters, 0, sizeof(counters));
+}
+
+
+EmulatedBoard::~EmulatedBoard()
+{
+    close();
+}
+
+
+bool EmulatedBoard::open(yarp::os::Searchable &config, const ACE_INET_Addr &boardaddr, const ACE_INET_Addr &hostaddr, FEAT_boardnumber_t board_n,
+                         double _period, const emsEmulatorImpairments_t &_impairments, bool startrunning)
+{
+    hostAddr    = hostaddr;
+    period      = _period;
+    impairments = _impairments;
+
+    uint32_t hostip = hostaddr.get_ip_address();
+    uint32_t boardip = boardaddr.get_ip_address();
+    eOipv4addr_t hostipv4 = eo_common_ipv4addr((hostip >> 24) & 0xff, (hostip >> 16) & 0xff, (hostip >> 8) & 0xff, hostip & 0xff);
+    eOipv4addr_t boardipv4 = eo_common_ipv4addr((boardip >> 24) & 0xff, (boardip >> 16) & 0xff, (boardip >> 8) & 0xff, boardip & 0xff);
+
+    if((0 == board_n) || (board_n > sizeof(boards)/sizeof(boards[0])))
+    {
+        yError() << "EmulatedBoard::open(): board number" << board_n << "is out of range [1, 16]";
+        return false;
+    }
+
+    if(false == init(config, boardipv4, hostipv4, hostaddr.get_port_number(), RECV_BUFFER_SIZE, board_n))
+    {
+        yError() << "EmulatedBoard::open(): cannot init the transceiver of board" << board_n;
+        return false;
+    }
+
+    createSocket(boardaddr);
+    if(NULL == UDP_socket)
+    {
+        return false;
+    }
+
+    boards[protboardnumber] = this;
+
+    pApplStatus->currstate = (startrunning) ? (applstate_running) : (applstate_config);
+    nextTX = yarp::os::Time::now();
+
+    return true;
+}
+
+
+void EmulatedBoard::close()
+{
+    if(NULL != UDP_socket)
+    {
+        UDP_socket->close();
+        delete UDP_socket;
+        UDP_socket = NULL;
+    }
+
+    if((eo_prot_BRDdummy != protboardnumber) && (this == boards[protboardnumber]))
+    {
+        boards[protboardnumber] = NULL;
+    }
+}
+
+
+ACE_HANDLE EmulatedBoard::getHandle()
+{
+    return (NULL == UDP_socket) ? (ACE_INVALID_HANDLE) : (UDP_socket->get_handle());
+}
+
+
+EmulatedBoard* EmulatedBoard::getBoard(eOprotBRD_t brd)
+{
+    if(brd >= sizeof(boards)/sizeof(boards[0]))
+    {
+        return NULL;
+    }
+    return boards[brd];
+}
+
+
+const emsEmulatorCounters_t& EmulatedBoard::getCounters(void)
+{
+    return counters;
+}
+
+
+bool EmulatedBoard::isRunning(void)
+{
+    return (applstate_running == pApplStatus->currstate);
+}
+
+
+bool EmulatedBoard::drop(void)
+{
+    if(impairments.lossprobability <= 0)
+    {
+        return false;
+    }
+    return (Random::uniform() < impairments.lossprobability);
+}
+
+
+void EmulatedBoard::receive(double now)
+{
+    ACE_INET_Addr sender;
+    ssize_t size = UDP_socket->recv(rxBuffer, sizeof(rxBuffer), sender, 0);
+
+    if(size <= 0)
+    {
+        return;
+    }
+
+    if(drop())
+    {
+        counters.rxdropped++;
+        return;
+    }
+
+    counters.rxpackets++;
+    onMsgReception(rxBuffer, size);
+
+    // as the ems does: in running state the replies go out with the ropframe of the next cycle,
+    // in the other states the board transmits only when it receives a packet.
+    if(false == isRunning())
+    {
+        transmit(now);
+    }
+}
+
+
+void EmulatedBoard::tick(double now)
+{
+    while((false == delayed.empty()) && (delayed.front().due <= now))
+    {
+        send(&delayed.front().data[0], delayed.front().data.size());
+        delayed.pop_front();
+    }
+
+    if(isRunning() && (now >= nextTX))
+    {
+        transmit(now);
+
+        // the next cycle is scheduled from the previous one, but we dont catch up after a late cycle
+        nextTX += period;
+        if(nextTX < now)
+        {
+            nextTX = now + period;
+        }
+    }
+}
+
+
+double EmulatedBoard::nextDeadline(void)
+{
+    double deadline = (isRunning()) ? (nextTX) : (yarp::os::Time::now() + 0.1);
+
+    if((false == delayed.empty()) && (delayed.front().due < deadline))
+    {
+        deadline = delayed.front().due;
+    }
+
+    return deadline;
+}
+
+
+void EmulatedBoard::transmit(double now)
+{
+    uint8_t *data = NULL;
+    uint16_t size = 0;
+
+    getTransmit(&data, &size);
+
+    if((NULL == data) || (0 == size))
+    {
+        return;
+    }
+
+    if(drop())
+    {
+        counters.txdropped++;
+        return;
+    }
+
+    if(impairments.maxjitter <= 0)
+    {
+        send(data, size);
+        return;
+    }
+
+    // the packet is copied because the transceiver reuses its buffer at the next transmission.
+    // the due time never goes back, so that jitter does not reorder the packets as it would not happen on the robot lan
+    double due = now + Random::uniform() * impairments.maxjitter;
+    if(due < lastDue)
+    {
+        due = lastDue;
+    }
+    lastDue = due;
+
+    delayedPacket_t pkt;
+    pkt.due = due;
+    pkt.data.assign(data, data + size);
+    delayed.push_back(pkt);
+}
+
+
+void EmulatedBoard::send(const uint8_t *data, uint16_t size)
+{
+    if(UDP_socket->send(data, size, hostAddr) < 0)
+    {
+        yError() << "EmulatedBoard::send(): board" << protboardnumber+1 << "is unable to send a message";
+        return;
+    }
+    counters.txpackets++;
+}
+
+
+// it is the same as BoardTransceiver::onMsgReception() but without printing every packet
+void EmulatedBoard::onMsgReception(uint8_t *data, uint16_t size)
+{
+    uint16_t numofrops = 0;
+    uint64_t txtime = 0;
+    uint16_t capacityrxpkt = 0;
+
+    eo_packet_Capacity_Get(p_RxPkt, &capacityrxpkt);
+    if(size > capacityrxpkt)
+    {
+        yError() << "EmulatedBoard::onMsgReception(): received packet has size" << size << "which is higher than capacity of rx pkt =" << capacityrxpkt;
+        return;
+    }
+
+    eo_packet_Payload_Set(p_RxPkt, data, size);
+    eo_packet_Addressing_Set(p_RxPkt, remoteipaddr, remoteipport);
+    eo_transceiver_Receive(transceiver, p_RxPkt, &numofrops, &txtime);
+}
+
+
+void EmulatedBoard::sendOccasional(eOprotID32_t id32, void *data)
+{
+    eOropdescriptor_t ropdesc = {0};
+    memcpy(&ropdesc, &eok_ropdesc_basic, sizeof(eOropdescriptor_t));
+    ropdesc.ropcode     = eo_ropcode_sig;
+    ropdesc.id32        = id32;
+    ropdesc.size        = 0;        // the size is internally computed from the id32
+    ropdesc.data        = (uint8_t*)data;
+    ropdesc.signature   = eo_rop_SIGNATUREdummy;
+
+    if(eores_OK != eo_transceiver_OccasionalROP_Load(transceiver, &ropdesc))
+    {
+        char nvinfo[128];
+        eoprot_ID2information(id32, nvinfo, sizeof(nvinfo));
+        yError() << "EmulatedBoard::sendOccasional(): board" << protboardnumber+1 << "cannot load a sig<> of" << nvinfo;
+    }
+}
+
+
+bool EmulatedBoard::loadRegulars(const eOmn_serv_arrayof_id32_t *arrayofid32)
+{
+    EOarray *array = (EOarray*) arrayofid32;
+    uint8_t size = eo_array_Size(array);
+
+    eOropdescriptor_t ropdesc = {0};
+    memcpy(&ropdesc, &eok_ropdesc_basic, sizeof(eOropdescriptor_t));
+    ropdesc.ropcode     = eo_ropcode_sig;
+    ropdesc.size        = 0;
+    ropdesc.data        = NULL;     // the regulars always take their value from the ram of the variable
+    ropdesc.signature   = eo_rop_SIGNATUREdummy;
+
+    bool ret = true;
+    for(int i=0; i<size; i++)
+    {
+        ropdesc.id32 = *((eOprotID32_t*)eo_array_At(array, i));
+        if(eores_OK != eo_transceiver_RegularROP_Load(transceiver, &ropdesc))
+        {
+            char nvinfo[128];
+            eoprot_ID2information(ropdesc.id32, nvinfo, sizeof(nvinfo));
+            yError() << "EmulatedBoard::loadRegulars(): board" << protboardnumber+1 << "cannot load the regular" << nvinfo;
+            ret = false;
+        }
+    }
+
+    return ret;
+}
+
+
+void EmulatedBoard::onServiceCommand(const eOmn_service_cmmnds_command_t *command)
+{
+    bool ok = true;
+
+    counters.servicecommands++;
+
+    switch(command->operation)
+    {
+        case eomn_serv_operation_start:
+        {
+            onGo2State(applstate_running);
+        } break;
+
+        case eomn_serv_operation_stop:
+        {
+            onGo2State(applstate_config);
+            if(eomn_serv_category_all == command->category)
+            {
+                eo_transceiver_RegularROPs_Clear(transceiver);
+            }
+        } break;
+
+        case eomn_serv_operation_regsig_load:
+        {
+            ok = loadRegulars(&command->parameter.arrayofid32);
+        } break;
+
+        case eomn_serv_operation_regsig_clear:
+        {
+            eo_transceiver_RegularROPs_Clear(transceiver);
+        } break;
+
+        default:
+        {   // verifyactivate and the others: the emulator has every service
+        } break;
+    }
+
+    eOmn_service_command_result_t result;
+    memset(&result, 0, sizeof(result));
+    result.latestcommandisok    = (ok) ? (eobool_true) : (eobool_false);
+    result.category             = command->category;
+    result.operation            = command->operation;
+
+    eOprotID32_t id32 = eoprot_ID_get(eoprot_endpoint_management, eoprot_entity_mn_service, 0, eoprot_tag_mn_service_status_commandresult);
+    sendOccasional(id32, &result);
+}
+
+
+void EmulatedBoard::onCommQueryArray(const eOmn_command_t *command)
+{
+    if(eomn_opc_query_array_EPdes != command->cmd.opc)
+    {
+        yWarning() << "EmulatedBoard::onCommQueryArray(): board" << protboardnumber+1 << "does not emulate the query w/ opc" << command->cmd.opc;
+        return;
+    }
+
+    // the reply contains the descriptor of every endpoint of the board, so that the host can verify the protocol version
+    eOmn_command_t reply;
+    memset(&reply, 0, sizeof(reply));
+    reply.cmd.opc                           = eomn_opc_reply_array_EPdes;
+    reply.cmd.replyarray.opcpar.opc         = eomn_opc_reply_array_EPdes;
+    reply.cmd.replyarray.opcpar.endpoint    = eoprot_endpoint_all;
+    reply.cmd.replyarray.opcpar.setnumber   = 0;
+
+    const uint8_t capacity = (sizeof(reply.cmd.replyarray.array) - sizeof(eOarray_head_t)) / sizeof(eoprot_endpoint_descriptor_t);
+    EOarray *array = eo_array_New(capacity, sizeof(eoprot_endpoint_descriptor_t), reply.cmd.replyarray.array);
+
+    static const eOprot_endpoint_t endpoints[] = { eoprot_endpoint_management, eoprot_endpoint_motioncontrol, eoprot_endpoint_analogsensors, eoprot_endpoint_skin };
+    for(size_t i=0; i<sizeof(endpoints)/sizeof(endpoints[0]); i++)
+    {
+        if(eobool_false == eoprot_endpoint_configured_is(protboardnumber, endpoints[i]))
+        {
+            continue;
+        }
+        eoprot_endpoint_descriptor_t epd;
+        memset(&epd, 0, sizeof(epd));
+        epd.endpoint = endpoints[i];
+        memcpy(&epd.version, eoprot_version_of_endpoint_get(endpoints[i]), sizeof(epd.version));
+        eo_array_PushBack(array, &epd);
+    }
+    reply.cmd.replyarray.opcpar.setsize = eo_array_Size(array);
+
+    eOprotID32_t id32 = eoprot_ID_get(eoprot_endpoint_management, eoprot_entity_mn_comm, 0, eoprot_tag_mn_comm_cmmnds_command_replyarray);
+    sendOccasional(id32, &reply);
+}
+
+
+void EmulatedBoard::onGo2State(eOmn_appl_state_t state)
+{
+    if((applstate_running == state) && (false == isRunning()))
+    {
+        nextTX = yarp::os::Time::now();
+    }
+    pApplStatus->currstate = state;
+}
+
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// - the protocol callbacks. they are common to all the boards, which are retrieved from the board number of the nv
+// --------------------------------------------------------------------------------------------------------------------
+
+static void emsemulator_fun_UPDT_mn_appl_cmmnds_go2state(const EOnv* nv, const eOropdescriptor_t* rd)
+{
+    EmulatedBoard *board = EmulatedBoard::getBoard(eo_nv_GetBRD(nv));
+    if(NULL != board)
+    {
+        board->onGo2State((eOmn_appl_state_t) *((eOenum08_t*)rd->data));
+    }
+}
+
+static void emsemulator_fun_UPDT_mn_service_cmmnds_command(const EOnv* nv, const eOropdescriptor_t* rd)
+{
+    EmulatedBoard *board = EmulatedBoard::getBoard(eo_nv_GetBRD(nv));
+    if(NULL != board)
+    {
+        board->onServiceCommand((const eOmn_service_cmmnds_command_t*) rd->data);
+    }
+}
+
+static void emsemulator_fun_UPDT_mn_comm_cmmnds_command_queryarray(const EOnv* nv, const eOropdescriptor_t* rd)
+{
+    EmulatedBoard *board = EmulatedBoard::getBoard(eo_nv_GetBRD(nv));
+    if(NULL != board)
+    {
+        board->onCommQueryArray((const eOmn_command_t*) rd->data);
+    }
+}
+
+
+void EmsEmulator::registerCallbacks(void)
+{
+    // they override the ones set by BoardTransceiver::initProtocol(), thus they must be registered after the boards are initted
+    static const eOprot_callbacks_variable_descriptor_t callbacks[] =
+    {
+        {
+            EO_INIT(.endpoint)      eoprot_endpoint_management,
+            EO_INIT(.entity)        eoprot_entity_mn_appl,
+            EO_INIT(.tag)           eoprot_tag_mn_appl_cmmnds_go2state,
+            EO_INIT(.init)          NULL,
+            EO_INIT(.update)        emsemulator_fun_UPDT_mn_appl_cmmnds_go2state
+        },
+        {
+            EO_INIT(.endpoint)      eoprot_endpoint_management,
+            EO_INIT(.entity)        eoprot_entity_mn_service,
+            EO_INIT(.tag)           eoprot_tag_mn_service_cmmnds_command,
+            EO_INIT(.init)          NULL,
+            EO_INIT(.update)        emsemulator_fun_UPDT_mn_service_cmmnds_command
+        },
+        {
+            EO_INIT(.endpoint)      eoprot_endpoint_management,
+            EO_INIT(.entity)        eoprot_entity_mn_comm,
+            EO_INIT(.tag)           eoprot_tag_mn_comm_cmmnds_command_queryarray,
+            EO_INIT(.init)          NULL,
+            EO_INIT(.update)        emsemulator_fun_UPDT_mn_comm_cmmnds_command_queryarray
+        }
+    };
+
+    uint32_t number = sizeof(callbacks)/sizeof(callbacks[0]);
+    for(uint32_t i=0; i<number; i++)
+    {
+        eoprot_config_callbacks_variable_set(&callbacks[i]);
+    }
+}
+
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// - the emulator
+// --------------------------------------------------------------------------------------------------------------------
+
+EmsEmulator::EmsEmulator()
+{
+    printInterval   = 10.0;
+    lastPrint       = 0;
+    startTime       = 0;
+    startCPU        = 0;
+}
+
+
+EmsEmulator::~EmsEmulator()
+{
+    close();
+}
+
+
+bool EmsEmulator::configure(yarp::os::ResourceFinder &rf)
+{
+    int numberofboards      = rf.check("boards", Value(1)).asInt();
+    int firstboard          = rf.check("firstBoard", Value(1)).asInt();
+    std::string network     = rf.check("boardsNetwork", Value("127.0.1")).asString();
+    std::string hostaddress = rf.check("hostAddress", Value("127.0.0.1")).asString();
+    int port                = rf.check("port", Value(12345)).asInt();
+    double period           = rf.check("period", Value(0.001)).asDouble();
+    bool startrunning       = rf.check("running");
+
+    emsEmulatorImpairments_t impairments;
+    impairments.lossprobability = rf.check("loss", Value(0.0)).asDouble();
+    impairments.maxjitter       = rf.check("jitter", Value(0.0)).asDouble();
+
+    printInterval = rf.check("printInterval", Value(10.0)).asDouble();
+
+    if((firstboard < 1) || (numberofboards < 1) || (firstboard + numberofboards - 1 > 16))
+    {
+        yError() << "EmsEmulator::configure(): the boards must be in range [1, 16] and they are [" << firstboard << "," << firstboard + numberofboards - 1 << "]";
+        return false;
+    }
+
+    if(period <= 0)
+    {
+        yError() << "EmsEmulator::configure(): the period must be positive";
+        return false;
+    }
+
+    // the PROTOCOL group, if present, tells the entities of the boards. if missing, the boards have max capabilities
+    Bottle protocol = rf.findGroup("PROTOCOL");
+
+    ACE_INET_Addr hostaddr((u_short)port, hostaddress.c_str());
+
+    for(int n=firstboard; n<firstboard+numberofboards; n++)
+    {
+        char boardaddress[32];
+        snprintf(boardaddress, sizeof(boardaddress), "%s.%d", network.c_str(), n);
+        ACE_INET_Addr boardaddr((u_short)port, boardaddress);
+
+        EmulatedBoard *board = new EmulatedBoard;
+        if(false == board->open(protocol, boardaddr, hostaddr, n, period, impairments, startrunning))
+        {
+            yError() << "EmsEmulator::configure(): cannot open the board w/ IP" << boardaddress;
+            delete board;
+            return false;
+        }
+        boards.push_back(board);
+    }
+
+    registerCallbacks();
+
+    yInfo() << "EmsEmulator is emulating" << numberofboards << "boards at IP" << network.c_str() << "." << firstboard << "-" << firstboard + numberofboards - 1
+            << "port" << port << "w/ period" << period*1000.0 << "ms, loss" << impairments.lossprobability << "and jitter" << impairments.maxjitter*1000.0 << "ms";
+
+    startTime = lastPrint = yarp::os::Time::now();
+    startCPU = cpuTime();
+
+    return true;
+}
+
+
+double EmsEmulator::getPeriod()
+{
+    // updateModule() waits on the sockets, thus it must be called again immediately
+    return 0.0;
+}
+
+
+bool EmsEmulator::updateModule()
+{
+    // it serves all the boards until the end of this call, which is limited so that the module can be stopped
+    const double end = yarp::os::Time::now() + 0.5;
+    double now = yarp::os::Time::now();
+
+    while(now < end)
+    {
+        double deadline = end;
+        ACE_Handle_Set readset;
+        int width = 0;
+
+        for(size_t i=0; i<boards.size(); i++)
+        {
+            double d = boards[i]->nextDeadline();
+            if(d < deadline)
+            {
+                deadline = d;
+            }
+            ACE_HANDLE h = boards[i]->getHandle();
+            readset.set_bit(h);
+            if((int)h + 1 > width)
+            {
+                width = (int)h + 1;
+            }
+        }
+
+        double wait = deadline - now;
+        ACE_Time_Value timeout(0);
+        if(wait > 0)
+        {
+            timeout.set(wait);
+        }
+
+        int ready = ACE::select(width, readset, &timeout);
+
+        now = yarp::os::Time::now();
+
+        if(ready > 0)
+        {
+            for(size_t i=0; i<boards.size(); i++)
+            {
+                if(readset.is_set(boards[i]->getHandle()))
+                {
+                    boards[i]->receive(now);
+                }
+            }
+        }
+
+        for(size_t i=0; i<boards.size(); i++)
+        {
+            boards[i]->tick(now);
+        }
+    }
+
+    if((printInterval > 0) && (now - lastPrint >= printInterval))
+    {
+        printStatistics(now);
+        lastPrint = now;
+    }
+
+    return true;
+}
+
+
+void EmsEmulator::printStatistics(double now)
+{
+    emsEmulatorCounters_t total;
+    memset(&total, 0, sizeof(total));
+
+    for(size_t i=0; i<boards.size(); i++)
+    {
+        const emsEmulatorCounters_t &c = boards[i]->getCounters();
+        total.rxpackets         += c.rxpackets;
+        total.rxdropped         += c.rxdropped;
+        total.txpackets         += c.txpackets;
+        total.txdropped         += c.txdropped;
+        total.servicecommands   += c.servicecommands;
+    }
+
+    double cpu = cpuTime() - startCPU;
+    unsigned long packets = total.rxpackets + total.txpackets;
+
+    yDebug() << "EmsEmulator: in" << now - startTime << "sec the" << boards.size() << "boards have rx" << total.rxpackets << "(dropped" << total.rxdropped
+             << ") and tx" << total.txpackets << "(dropped" << total.txdropped << ") packets, and received" << total.servicecommands << "service commands";
+    yDebug() << "EmsEmulator: cpu time =" << cpu << "sec, cpu per packet =" << ((packets > 0) ? (1000000.0 * cpu / packets) : (0.0)) << "us";
+}
+
+
+bool EmsEmulator::close()
+{
+    if(false == boards.empty())
+    {
+        printStatistics(yarp::os::Time::now());
+    }
+
+    for(size_t i=0; i<boards.size(); i++)
+    {
+        delete boards[i];
+    }
+    boards.clear();
+
+    return true;
+}
+
+
+// eof
+
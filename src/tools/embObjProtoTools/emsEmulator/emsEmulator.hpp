@@ -0,0 +1,159 @@
+/* Copyright (C) 2016  iCub Facility, Istituto Italiano di Tecnologia
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+// - include guard ----------------------------------------------------------------------------------------------------
+#ifndef _EMSEMULATOR_H_
+#define _EMSEMULATOR_H_
+
+
+/** @file       emsEmulator.hpp
+    @brief      This header file implements an emulator of a set of EMS boards which talk to the host over UDP.
+
+    It emulates N ems boards on localhost so that TheEthManager, EthResource and HostTransceiver can be exercised
+    without the robot. every board has its own socket at IP boardsNetwork.N (e.g. 127.0.1.N) and port 12345 so that
+    the host sees them exactly as real boards. the emulator:
+    - answers the ask<> ROPs with the say<> replies prepared by the board transceiver,
+    - acknowledges the service commands (verifyactivate, regsig load / clear, start, stop) and the query of the
+      endpoint descriptors, so that the boards can be opened by robotInterface,
+    - streams a ropframe with the loaded regular ROPs every period when the board is in running state,
+    - injects a configurable loss of packets (in both directions) and a jitter on transmission.
+ **/
+
+
+// - external dependencies --------------------------------------
+
+#include <deque>
+#include <vector>
+
+#include "boardTransceiver.hpp"
+
+#include <yarp/os/RFModule.h>
+#include <yarp/os/Searchable.h>
+
+
+// the impairments that the emulator applies to the traffic of a board
+typedef struct
+{
+    double      lossprobability;    // probability in [0, 1] that a packet is dropped. it applies to rx and to tx
+    double      maxjitter;          // every tx packet is delayed by a random time in [0, maxjitter] seconds
+} emsEmulatorImpairments_t;
+
+
+// the counters of a board. they are read by the EmsEmulator to print its statistics
+typedef struct
+{
+    unsigned long   rxpackets;
+    unsigned long   rxdropped;
+    unsigned long   txpackets;
+    unsigned long   txdropped;
+    unsigned long   servicecommands;
+} emsEmulatorCounters_t;
+
+
+// an emulated board: it is a BoardTransceiver which does not run as a module but is driven by the EmsEmulator
+class EmulatedBoard : public BoardTransceiver
+{
+public:
+
+    EmulatedBoard();
+    ~EmulatedBoard();
+
+    bool open(yarp::os::Searchable &config, const ACE_INET_Addr &boardaddr, const ACE_INET_Addr &hostaddr, FEAT_boardnumber_t board_n,
+              double period, const emsEmulatorImpairments_t &impairments, bool startrunning);
+    void close();
+
+    ACE_HANDLE getHandle();
+
+    // reads one packet from the socket (it must be called only when the socket is readable) and parses it
+    void receive(double now);
+
+    // transmits the ropframe if it is the case and sends the delayed packets whose time has come
+    void tick(double now);
+
+    // the time at which tick() must be called again
+    double nextDeadline(void);
+
+    const emsEmulatorCounters_t& getCounters(void);
+
+    // called by the protocol callbacks registered by the EmsEmulator
+    void onServiceCommand(const eOmn_service_cmmnds_command_t *command);
+    void onCommQueryArray(const eOmn_command_t *command);
+    void onGo2State(eOmn_appl_state_t state);
+
+    // the board which owns a given protocol board number. it is used by the protocol callbacks
+    static EmulatedBoard* getBoard(eOprotBRD_t brd);
+
+    virtual void onMsgReception(uint8_t *data, uint16_t size);
+
+private:
+
+    typedef struct
+    {
+        double                  due;
+        std::vector<uint8_t>    data;
+    } delayedPacket_t;
+
+    ACE_INET_Addr               hostAddr;
+    double                      period;
+    double                      nextTX;
+    emsEmulatorImpairments_t    impairments;
+    emsEmulatorCounters_t       counters;
+    std::deque<delayedPacket_t> delayed;
+    double                      lastDue;
+    uint8_t                     rxBuffer[RECV_BUFFER_SIZE];
+
+    static EmulatedBoard*       boards[16];
+
+    bool isRunning(void);
+    bool drop(void);
+    void transmit(double now);
+    void send(const uint8_t *data, uint16_t size);
+    void sendOccasional(eOprotID32_t id32, void *data);
+    bool loadRegulars(const eOmn_serv_arrayof_id32_t *arrayofid32);
+};
+
+
+// the module which holds the emulated boards and serves all their sockets from a single thread
+class EmsEmulator : public yarp::os::RFModule
+{
+public:
+
+    EmsEmulator();
+    ~EmsEmulator();
+
+    bool configure(yarp::os::ResourceFinder &rf);
+    bool updateModule();
+    bool close();
+    double getPeriod();
+
+private:
+
+    std::vector<EmulatedBoard*> boards;
+    double                      printInterval;
+    double                      lastPrint;
+    double                      startTime;
+    double                      startCPU;
+
+    static void registerCallbacks(void);
+    void printStatistics(double now);
+};
+
+
+#endif  // include-guard
+
+
+// - end-of-file (leave a blank line after)----------------------------------------------------------------------------
+
+
+
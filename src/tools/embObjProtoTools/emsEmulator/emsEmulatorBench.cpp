@@ -0,0 +1,501 @@
+/* Copyright (C) 2016  iCub Facility, Istituto Italiano di Tecnologia
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+/**
+ * @ingroup icub_tools
+ *
+ * \defgroup emsEmulatorBench emsEmulatorBench
+ *
+ * It measures the performance of the ethernet communication towards a set of boards emulated by emsEmulator.
+ * Every period it sends to every board a ropframe with an ask<> of the communication status which is tagged with
+ * a signature. The board answers with a say<> with the same signature, thus the benchmark measures the end-to-end
+ * latency of host tx -> board rx -> board tx -> host rx. Optionally, it loads some regulars in the boards and starts them,
+ * so that the boards stream a ropframe every cycle as they do on the robot.
+ *
+ * The ropframes of a cycle are first prepared for all the boards and then sent together through the EthTxQueue used by
+ * TheEthManager, i.e. with a single sendmmsg() where available, or with one send() per board if batched is 0. The time
+ * spent sending every cycle is collected in a second histogram, so that the two tx paths can be compared.
+ *
+ * At the end it prints the histograms of latency and of tx time per cycle, the lost replies, the received ropframes and
+ * the cpu time per packet spent by the host. Run the emulator with the same number of boards, e.g.:
+ *
+ * \code
+ * emsEmulator --boards 8
+ * emsEmulatorBench --boards 8 --period 0.001 --duration 10 --regulars 4
+ * \endcode
+ *
+ * Parameters (all optional):
+ * - boards, firstBoard, boardsNetwork, port: as in emsEmulator (1, 1, 127.0.1, 12345)
+ * - hostAddress: the local address of the host (127.0.0.1)
+ * - period: the period of the requests in seconds (0.001)
+ * - duration: the duration of the measure in seconds (10)
+ * - regulars: the number of joints whose status is loaded as regular in every board (0 = boards are not started)
+ * - batched: 1 sends the ropframes of a cycle with the EthTxQueue, 0 with one send() per board (1)
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "cpuTime.h"
+#include "latencyHistogram.h"
+#include "ethTxQueue.h"
+
+#include "EOYtheSystem.h"
+#include "EOtheErrorManager.h"
+#include "EoCommon.h"
+#include "EOarray.h"
+#include "EOnv.h"
+#include "EOrop.h"
+#include "EOpacket.h"
+#include "EOhostTransceiver.h"
+#include "EoProtocol.h"
+#include "EoProtocolMN.h"
+#include "EoProtocolMC.h"
+
+#include <ace/ACE.h>
+#include <ace/SOCK_Dgram.h>
+
+#include <yarp/os/Network.h>
+#include <yarp/os/ResourceFinder.h>
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Time.h>
+
+using namespace yarp::os;
+
+
+// the host side of one emulated board
+class BenchBoard
+{
+public:
+
+    enum { maxRequestsInFlight = 1024 };
+
+    eOprotBRD_t         brd;
+    ACE_INET_Addr       address;
+    eOipv4addr_t        ipv4;
+    EOhostTransceiver*  hosttxrx;
+    EOtransceiver*      txrx;
+    EOpacket*           rxpkt;
+
+    uint32_t            nextSignature;
+    double              sentTime[maxRequestsInFlight];
+    unsigned long       requests;
+    unsigned long       replies;
+    unsigned long       rxpackets;
+    bool                commandAcked;
+
+    BenchBoard() : brd(0), ipv4(0), hosttxrx(NULL), txrx(NULL), rxpkt(NULL), nextSignature(0), requests(0), replies(0), rxpackets(0), commandAcked(false)
+    {
+        for(int i=0; i<maxRequestsInFlight; i++)
+        {
+            sentTime[i] = 0;
+        }
+    }
+};
+
+
+static BenchBoard* benchBoards[256] = {NULL};
+static LatencyHistogram latency("emsEmulatorBench: end-to-end latency");
+static LatencyHistogram txcycle("emsEmulatorBench: tx time per cycle");
+static EthTxQueue<256> txqueue;
+
+
+static void embOBJerror(eOerrmanErrorType_t errtype, const char *info, eOerrmanCaller_t *caller, const eOerrmanDescriptor_t *des)
+{
+    const char defobjstr[] = "EO?";
+    const char *eobjstr = (NULL == caller) ? (defobjstr) : (caller->eobjstr);
+
+    yError() << "embOBJerror(): errtype = " << eo_errman_ErrorStringGet(eo_errman_GetHandle(), errtype) << "from EOobject = " << eobjstr << " w/ message = " << info;
+}
+
+
+// called for every say<> of the management endpoint. the signature tells which request it answers
+static void bench_fun_ONSAY_mn(const EOnv* nv, const eOropdescriptor_t* rd)
+{
+    BenchBoard *b = benchBoards[eo_nv_GetBRD(nv)];
+    if(NULL == b)
+    {
+        return;
+    }
+
+    uint32_t sig = rd->signature;
+    if((eo_rop_SIGNATUREdummy == sig) || (sig >= b->nextSignature) || (b->nextSignature - sig > BenchBoard::maxRequestsInFlight))
+    {
+        return;
+    }
+
+    double &sent = b->sentTime[sig % BenchBoard::maxRequestsInFlight];
+    if(sent > 0)
+    {
+        latency.add(yarp::os::Time::now() - sent);
+        sent = 0;
+        b->replies++;
+    }
+}
+
+
+static void bench_fun_UPDT_mn_service_status_commandresult(const EOnv* nv, const eOropdescriptor_t* rd)
+{
+    BenchBoard *b = benchBoards[eo_nv_GetBRD(nv)];
+    if(NULL != b)
+    {
+        b->commandAcked = true;
+    }
+}
+
+
+static bool initBoard(BenchBoard *b)
+{
+    eOhosttransceiver_cfg_t cfg;
+    memcpy(&cfg, &eo_hosttransceiver_cfg_default, sizeof(eOhosttransceiver_cfg_t));
+
+    uint32_t ip = b->address.get_ip_address();
+    b->ipv4 = eo_common_ipv4addr((ip >> 24) & 0xff, (ip >> 16) & 0xff, (ip >> 8) & 0xff, ip & 0xff);
+    b->brd = ip & 0xff;
+
+    if(eores_OK != eoprot_config_board_reserve(b->brd))
+    {
+        yError() << "emsEmulatorBench: eoprot_config_board_reserve() fails for board" << b->brd;
+        return false;
+    }
+
+    static eOnvset_BRDcfg_t nvsetbrdconfig[256];
+    memcpy(&nvsetbrdconfig[b->brd], &eonvset_BRDcfgMax, sizeof(eOnvset_BRDcfg_t));
+    nvsetbrdconfig[b->brd].boardnum = b->brd;
+
+    cfg.remoteboardipv4addr                 = b->ipv4;
+    cfg.remoteboardipv4port                 = b->address.get_port_number();
+    cfg.sizes.capacityoftxpacket            = 768;
+    cfg.sizes.capacityofrop                 = 256;
+    cfg.sizes.capacityofropframeregulars    = eo_ropframe_sizeforZEROrops;
+    cfg.sizes.capacityofropframereplies     = eo_ropframe_sizeforZEROrops;
+    cfg.sizes.capacityofropframeoccasionals = (cfg.sizes.capacityoftxpacket - eo_ropframe_sizeforZEROrops) - cfg.sizes.capacityofropframeregulars - cfg.sizes.capacityofropframereplies;
+    cfg.sizes.maxnumberofregularrops        = 0;
+    cfg.nvsetbrdcfg                         = &nvsetbrdconfig[b->brd];
+
+    b->hosttxrx = eo_hosttransceiver_New(&cfg);
+    if(NULL == b->hosttxrx)
+    {
+        return false;
+    }
+    b->txrx = eo_hosttransceiver_GetTransceiver(b->hosttxrx);
+    b->rxpkt = eo_packet_New(1500);
+
+    benchBoards[b->brd] = b;
+    return true;
+}
+
+
+static bool loadROP(BenchBoard *b, eOropcode_t ropcode, eOprotID32_t id32, void *data, uint32_t signature)
+{
+    eOropdescriptor_t ropdesc = {0};
+    memcpy(&ropdesc, &eok_ropdesc_basic, sizeof(eOropdescriptor_t));
+    ropdesc.control.plustime    = 1;
+    ropdesc.control.plussign    = (eo_rop_SIGNATUREdummy == signature) ? 0 : 1;
+    ropdesc.ropcode             = ropcode;
+    ropdesc.id32                = id32;
+    ropdesc.size                = 0;
+    ropdesc.data                = (uint8_t*)data;
+    ropdesc.signature           = signature;
+
+    return (eores_OK == eo_transceiver_OccasionalROP_Load(b->txrx, &ropdesc));
+}
+
+
+static unsigned long txpackets = 0;
+
+// a ropframe prepared in a tx cycle, kept to send it alone when the queue is not used
+struct TxFrame
+{
+    BenchBoard *board;
+    uint8_t *data;
+    uint16_t size;
+    TxFrame(BenchBoard *b, uint8_t *d, uint16_t s) : board(b), data(d), size(s) {}
+};
+
+// the ropframe stays in the transceiver of the board until its next prepare
+static bool prepare(BenchBoard *b, uint8_t **data, uint16_t *size)
+{
+    uint16_t numofrops = 0;
+    EOpacket *pkt = NULL;
+
+    if((eores_OK != eo_transceiver_outpacket_Prepare(b->txrx, &numofrops, NULL)) || (0 == numofrops))
+    {
+        return false;
+    }
+    eo_transceiver_outpacket_Get(b->txrx, &pkt);
+    eo_packet_Payload_Get(pkt, data, size);
+    return true;
+}
+
+
+static void transmit(ACE_SOCK_Dgram &socket, BenchBoard *b)
+{
+    uint8_t *data = NULL;
+    uint16_t size = 0;
+
+    if(prepare(b, &data, &size) && (socket.send(data, size, b->address) > 0))
+    {
+        txpackets++;
+    }
+}
+
+
+// it receives and parses all the packets which arrive before the deadline
+static void receiveUntil(ACE_SOCK_Dgram &socket, double deadline)
+{
+    static uint8_t buffer[1500];
+
+    for(;;)
+    {
+        double wait = deadline - yarp::os::Time::now();
+        if(wait <= 0)
+        {
+            return;
+        }
+
+        ACE_Time_Value timeout;
+        timeout.set(wait);
+        ACE_INET_Addr sender;
+        ssize_t size = socket.recv(buffer, sizeof(buffer), sender, 0, &timeout);
+        if(size <= 0)
+        {
+            continue;
+        }
+
+        BenchBoard *b = benchBoards[sender.get_ip_address() & 0xff];
+        if(NULL == b)
+        {
+            continue;
+        }
+
+        b->rxpackets++;
+        uint16_t numofrops = 0;
+        uint64_t txtime = 0;
+        eo_packet_Payload_Set(b->rxpkt, buffer, size);
+        eo_packet_Addressing_Set(b->rxpkt, b->ipv4, b->address.get_port_number());
+        eo_transceiver_Receive(b->txrx, b->rxpkt, &numofrops, &txtime);
+    }
+}
+
+
+// it sends a service command to all the boards and waits for their acks
+static bool serviceCommand(ACE_SOCK_Dgram &socket, std::vector<BenchBoard*> &boards, eOmn_serv_operation_t operation, int regulars)
+{
+    eOprotID32_t id32 = eoprot_ID_get(eoprot_endpoint_management, eoprot_entity_mn_service, 0, eoprot_tag_mn_service_cmmnds_command);
+
+    for(size_t i=0; i<boards.size(); i++)
+    {
+        eOmn_service_cmmnds_command_t command;
+        memset(&command, 0, sizeof(command));
+        command.operation = operation;
+        command.category = eomn_serv_category_all;
+        if(eomn_serv_operation_regsig_load == operation)
+        {
+            EOarray *array = eo_array_New(eOmn_serv_capacity_arrayof_id32, 4, &command.parameter.arrayofid32);
+            for(int j=0; j<regulars; j++)
+            {
+                eOprotID32_t reg = eoprot_ID_get(eoprot_endpoint_motioncontrol, eoprot_entity_mc_joint, j, eoprot_tag_mc_joint_status_core);
+                eo_array_PushBack(array, &reg);
+            }
+        }
+
+        boards[i]->commandAcked = false;
+        loadROP(boards[i], eo_ropcode_set, id32, &command, eo_rop_SIGNATUREdummy);
+        transmit(socket, boards[i]);
+    }
+
+    receiveUntil(socket, yarp::os::Time::now() + 0.5);
+
+    bool ok = true;
+    for(size_t i=0; i<boards.size(); i++)
+    {
+        if(false == boards[i]->commandAcked)
+        {
+            yError() << "emsEmulatorBench: board" << boards[i]->brd << "did not ack the service command" << operation;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+
+int main(int argc, char *argv[])
+{
+    Network::init();
+
+    ResourceFinder rf;
+    rf.configure(argc, argv);
+
+    int numberofboards      = rf.check("boards", Value(1)).asInt();
+    int firstboard          = rf.check("firstBoard", Value(1)).asInt();
+    std::string network     = rf.check("boardsNetwork", Value("127.0.1")).asString();
+    std::string hostaddress = rf.check("hostAddress", Value("127.0.0.1")).asString();
+    int port                = rf.check("port", Value(12345)).asInt();
+    double period           = rf.check("period", Value(0.001)).asDouble();
+    double duration         = rf.check("duration", Value(10.0)).asDouble();
+    int regulars            = rf.check("regulars", Value(0)).asInt();
+    bool batched            = (0 != rf.check("batched", Value(1)).asInt());
+
+    eOerrman_cfg_t errmanconfig = {0};
+    errmanconfig.extfn.usr_on_error = embOBJerror;
+    eoy_sys_Initialise(NULL, NULL, &errmanconfig);
+
+    if(eores_OK != eoprot_config_board_numberof(eoprot_boards_maxnumberof))
+    {
+        yError() << "emsEmulatorBench: eoprot_config_board_numberof() fails";
+        return 1;
+    }
+
+    eoprot_config_onsay_endpoint_set(eoprot_endpoint_management, bench_fun_ONSAY_mn);
+
+    const eOprot_callbacks_variable_descriptor_t commandresult =
+    {
+        EO_INIT(.endpoint)      eoprot_endpoint_management,
+        EO_INIT(.entity)        eoprot_entity_mn_service,
+        EO_INIT(.tag)           eoprot_tag_mn_service_status_commandresult,
+        EO_INIT(.init)          NULL,
+        EO_INIT(.update)        bench_fun_UPDT_mn_service_status_commandresult
+    };
+    eoprot_config_callbacks_variable_set(&commandresult);
+
+    ACE_INET_Addr local((u_short)port, hostaddress.c_str());
+    ACE_SOCK_Dgram socket;
+    if(-1 == socket.open(local))
+    {
+        yError() << "emsEmulatorBench: unable to bind to" << hostaddress.c_str() << ":" << port;
+        return 1;
+    }
+
+    std::vector<BenchBoard*> boards;
+    for(int n=firstboard; n<firstboard+numberofboards; n++)
+    {
+        char boardaddress[32];
+        snprintf(boardaddress, sizeof(boardaddress), "%s.%d", network.c_str(), n);
+
+        BenchBoard *b = new BenchBoard;
+        b->address = ACE_INET_Addr((u_short)port, boardaddress);
+        if(false == initBoard(b))
+        {
+            yError() << "emsEmulatorBench: cannot init the transceiver for board" << boardaddress;
+            return 1;
+        }
+        boards.push_back(b);
+    }
+
+    if(regulars > 0)
+    {
+        if((false == serviceCommand(socket, boards, eomn_serv_operation_regsig_load, regulars)) ||
+           (false == serviceCommand(socket, boards, eomn_serv_operation_start, 0)))
+        {
+            return 1;
+        }
+    }
+
+    yInfo() << "emsEmulatorBench: measuring" << numberofboards << "boards for" << duration << "sec w/ period" << period*1000.0 << "ms and" << regulars << "regulars per board,"
+            << (batched ? "tx w/ EthTxQueue" : "tx w/ one send() per board");
+
+    eOprotID32_t id32 = eoprot_ID_get(eoprot_endpoint_management, eoprot_entity_mn_comm, 0, eoprot_tag_mn_comm_status);
+
+    double start = yarp::os::Time::now();
+    double startcpu = cpuTime();
+    double next = start;
+    unsigned long rxbefore = 0;
+    for(size_t i=0; i<boards.size(); i++)
+    {
+        rxbefore += boards[i]->rxpackets;
+    }
+    unsigned long txbefore = txpackets;
+    std::vector<TxFrame> frames;
+    frames.reserve(boards.size());
+
+    while(next < start + duration)
+    {
+        // as in a tx cycle of TheEthManager: the ropframes of all the boards are prepared, then sent together
+        frames.clear();
+        for(size_t i=0; i<boards.size(); i++)
+        {
+            BenchBoard *b = boards[i];
+            uint32_t sig = b->nextSignature++;
+            b->sentTime[sig % BenchBoard::maxRequestsInFlight] = yarp::os::Time::now();
+            b->requests++;
+            loadROP(b, eo_ropcode_ask, id32, NULL, sig);
+
+            uint8_t *data = NULL;
+            uint16_t size = 0;
+            if(prepare(b, &data, &size))
+            {
+                txqueue.push(data, size, b->address, 0);
+                frames.push_back(TxFrame(b, data, size));
+            }
+        }
+
+        double txstart = yarp::os::Time::now();
+        if(batched)
+        {
+            txpackets += txqueue.send(&socket);
+        }
+        else
+        {
+            for(size_t i=0; i<frames.size(); i++)
+            {
+                if(socket.send(frames[i].data, frames[i].size, frames[i].board->address) > 0)
+                {
+                    txpackets++;
+                }
+            }
+        }
+        txcycle.add(yarp::os::Time::now() - txstart);
+        txqueue.clear();
+
+        next += period;
+        receiveUntil(socket, next);
+    }
+
+    double elapsed = yarp::os::Time::now() - start;
+    double cpu = cpuTime() - startcpu;
+
+    // the late replies are still welcome for the count of lost ones, but not for the cpu
+    receiveUntil(socket, yarp::os::Time::now() + 0.1);
+
+    unsigned long requests = 0, replies = 0, rxpackets = 0;
+    for(size_t i=0; i<boards.size(); i++)
+    {
+        requests += boards[i]->requests;
+        replies += boards[i]->replies;
+        rxpackets += boards[i]->rxpackets;
+    }
+    rxpackets -= rxbefore;
+    unsigned long packets = rxpackets + (txpackets - txbefore);
+
+    if(regulars > 0)
+    {
+        serviceCommand(socket, boards, eomn_serv_operation_stop, 0);
+    }
+
+    latency.print();
+    txcycle.print();
+    yInfo() << "emsEmulatorBench:" << requests << "requests," << replies << "replies," << requests-replies << "lost";
+    yInfo() << "emsEmulatorBench:" << rxpackets << "ropframes received in" << elapsed << "sec =" << rxpackets/elapsed << "per sec";
+    yInfo() << "emsEmulatorBench: host cpu time =" << cpu << "sec, cpu per packet =" << ((packets > 0) ? (1000000.0 * cpu / packets) : (0.0)) << "us";
+
+    socket.close();
+    Network::fini();
+
+    return 0;
+}
+
+// eof
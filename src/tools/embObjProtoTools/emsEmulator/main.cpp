@@ -0,0 +1,60 @@
+/*
+* Copyright (C) 2016 iCub Facility - Istituto Italiano di Tecnologia
+* website: www.robotcub.org
+* Permission is granted to copy, distribute, and/or modify this program
+* under the terms of the GNU General Public License, version 2 or any
+* later version published by the Free Software Foundation.
+*
+* A copy of the license can be found at
+* http://www.robotcub.org/icub/license/gpl.txt
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details
+*/
+
+/**
+ * @ingroup icub_tools
+ *
+ * \defgroup emsEmulator emsEmulator
+ *
+ * It emulates a set of EMS boards on the loopback interface, so that the ethernet part of robotInterface
+ * (TheEthManager, EthResource, HostTransceiver) and emsEmulatorBench can run without the robot.
+ *
+ * Board N listens at IP boardsNetwork.N and port 12345. On linux every address 127.x.y.z is served by the loopback
+ * interface, thus the xml files of robotInterface must only use 127.0.0.1 as PC104IpAddress and 127.0.1.N as IpAddress
+ * of the boards.
+ *
+ * Parameters (all optional):
+ * - boards: the number of emulated boards (1)
+ * - firstBoard: the number of the first board (1). the boards must be inside [1, 16]
+ * - boardsNetwork: the first three numbers of the IP address of the boards (127.0.1)
+ * - hostAddress: the IP address of the host (127.0.0.1)
+ * - port: the UDP port used by boards and host (12345)
+ * - period: the period of transmission of the ropframe in running state, in seconds (0.001)
+ * - running: the boards start in running state, thus they stream ropframes without waiting a start command
+ * - loss: the probability of losing a packet, in rx and in tx (0.0)
+ * - jitter: the max random delay added to every transmitted packet, in seconds (0.0)
+ * - printInterval: the interval in seconds between prints of the statistics, 0 to disable (10.0)
+ * - PROTOCOL group: the entities of the boards as in the boardTransceiver tool. if missing, the boards have max capabilities
+ */
+
+// yarp
+#include <yarp/os/Network.h>
+#include <yarp/os/ResourceFinder.h>
+
+#include "emsEmulator.hpp"
+
+using namespace yarp::os;
+
+
+int main(int argc, char *argv[])
+{
+    Network yarp;
+    ResourceFinder rf;
+    rf.setVerbose(true);
+    rf.configure(argc, argv);
+    EmsEmulator module;
+    return module.runModule(rf);
+}
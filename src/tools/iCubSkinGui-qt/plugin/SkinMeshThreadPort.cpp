@@ -38,6 +38,8 @@ SkinMeshThreadPort::SkinMeshThreadPort(Searchable& config,int period) : RateThre
     part.append(":i");
     part_virtual.append(":i");
 
+    // the port can be connected to the compact skin stream as well: its deltas must not be dropped
+    skin_port.setStrict();
     skin_port.open(part.c_str());
 
     // Ideally, we would use a --virtual flag. since this would make the skinmanager xml file unflexible,
@@ -199,21 +201,55 @@ void SkinMeshThreadPort::run()
     mutex.wait();
 
     bool gotRealData=false;
+    bool gotCompactData=false;
     bool gotVirtualData=false;
     yarp::sig::Vector skin_value;
     yarp::sig::Vector skin_value_virtual;
     std::vector<unsigned char> skin_color_virtual;
 
     // Read data from the real contacts
-    if (Bottle *input=skin_port.read(false))
+    // the port is strict, so all the pending messages are read and the last one is drawn
+    Bottle *last=NULL;
+    while (skin_port.getPendingReads()>0)
+    {
+        Bottle *input=skin_port.read(false);
+        if (input==NULL)
+            break;
+
+        if (iCub::skinDynLib::skinDataDecoder::isCompact(*input))
+        {
+            if (compactDecoder.decode(*input))
+            {
+                gotCompactData=true;
+            }
+        }
+        else
+        {
+            last=input;
+        }
+    }
+
+    if (last)
     {
         yTrace("Reading from real contacts...");
         gotRealData=true;
 
-        skin_value.resize(input->size(),0.0);
-        for (int i=0; i<input->size(); i++)
+        skin_value.resize(last->size(),0.0);
+        for (int i=0; i<last->size(); i++)
+        {
+            skin_value[i]=last->get(i).asDouble();
+        }
+    }
+    else if (gotCompactData && compactDecoder.isSynchronized())
+    {
+        yTrace("Reading from real contacts (compact stream)...");
+        gotRealData=true;
+
+        const std::vector<unsigned char> &taxels=compactDecoder.getTaxels();
+        skin_value.resize(taxels.size(),0.0);
+        for (size_t i=0; i<taxels.size(); i++)
         {
-            skin_value[i]=input->get(i).asDouble();
+            skin_value[i]=taxels[i];
         }
     }
 
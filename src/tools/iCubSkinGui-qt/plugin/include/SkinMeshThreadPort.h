@@ -22,6 +22,8 @@
 #include <yarp/dev/CanBusInterface.h>
 #include <yarp/sig/Vector.h>
 
+#include <iCub/skinDynLib/skinDataCodec.h>
+
 #include "include/Quad16.h"
 #include "include/PalmRight.h"
 #include "include/PalmLeft.h"
@@ -42,6 +44,7 @@ protected:
 
 	BufferedPort<Bottle> skin_port;
     BufferedPort<Bottle> skin_port_virtual;
+    iCub::skinDynLib::skinDataDecoder compactDecoder;   // used when skin_port is connected to a compact skin stream
 	TouchSensor *sensor[MAX_SENSOR_NUM];
 
     yarp::os::Semaphore mutex;
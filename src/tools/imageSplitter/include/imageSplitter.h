@@ -16,11 +16,47 @@
 #define ICUB_TOOLS_IMAGE_SPLITTER_H
 
 
+class ImageSplitter;
+
+/**
+ * Splits and sends one of the two images in a thread of its own,
+ * while the module does the other one (parallel mode).
+ */
+class SplitterWorker: public yarp::os::Thread
+{
+private:
+    ImageSplitter *splitter;
+    int side;
+    yarp::sig::ImageOf<yarp::sig::PixelRgb> *input;
+    yarp::os::Stamp stamp;
+    yarp::os::Semaphore go, done;
+
+public:
+    SplitterWorker(ImageSplitter *splitter, int side);
+    void trigger(yarp::sig::ImageOf<yarp::sig::PixelRgb> *input, const yarp::os::Stamp &stamp);
+    void waitDone();
+    void run();
+    void onStop();
+};
+
 class ImageSplitter: public yarp::os::RFModule
 {
+public:
+    // how the two images are laid out in the input
+    enum Layout
+    {
+        LAYOUT_HORIZONTAL,          // side by side
+        LAYOUT_VERTICAL,            // one above the other
+        LAYOUT_ROW_INTERLACED,      // even rows left, odd rows right
+        LAYOUT_COLUMN_INTERLACED    // even columns left, odd columns right
+    };
+
+    enum Side { LEFT=0, RIGHT=1 };
+
 private:
-    int method;  // tmp, just for testing different methods of filling the output images
-    bool horizontal;
+    int  layout;
+    bool parallel;
+    SplitterWorker *rightWorker;
 
     yarp::os::BufferedPort<yarp::sig::ImageOf<yarp::sig::PixelRgb> > inputPort;
     yarp::os::BufferedPort<yarp::sig::ImageOf<yarp::sig::PixelRgb> > outLeftPort;
@@ -29,6 +65,8 @@ private:
     int inWidth, inHeight;
     int outWidth, outHeight;
 
+    void split(yarp::sig::ImageOf<yarp::sig::PixelRgb> &input, yarp::sig::ImageOf<yarp::sig::PixelRgb> &output, int side);
+
 public:
     ImageSplitter();
     ~ImageSplitter();
@@ -37,6 +75,9 @@ public:
     bool close();                                 
     bool updateModule();
     double getPeriod(); 
+
+    // splits one of the images out of input and sends it with the given stamp
+    void splitAndWrite(yarp::sig::ImageOf<yarp::sig::PixelRgb> &input, yarp::os::Stamp &stamp, int side);
 };
 
 #endif  // ICUB_TOOLS_IMAGE_SPLITTER_H
@@ -8,20 +8,60 @@
 
 #include <imageSplitter.h>
 
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
 using namespace std;
 using namespace yarp::os;
 using namespace yarp::sig;
 
+SplitterWorker::SplitterWorker(ImageSplitter *splitter, int side) : splitter(splitter), side(side), input(NULL), go(0), done(0)
+{
+}
+
+void SplitterWorker::trigger(ImageOf<PixelRgb> *input, const Stamp &stamp)
+{
+    this->input = input;
+    this->stamp = stamp;
+    go.post();
+}
+
+void SplitterWorker::waitDone()
+{
+    done.wait();
+}
+
+void SplitterWorker::run()
+{
+    while(true)
+    {
+        go.wait();
+        if(isStopping())
+            break;
+        splitter->splitAndWrite(*input, stamp, side);
+        done.post();
+    }
+}
+
+void SplitterWorker::onStop()
+{
+    go.post();
+}
+
+
 ImageSplitter::ImageSplitter()
 {
-    horizontal = true;
-    method = 2;
+    layout = LAYOUT_HORIZONTAL;
+    parallel = false;
+    rightWorker = NULL;
 }
 
 ImageSplitter::~ImageSplitter()
 {
-    horizontal = true;
-    method = 2;
+    delete rightWorker;
 }
 
 bool ImageSplitter::configure(yarp::os::ResourceFinder &rf)
@@ -31,12 +71,14 @@ bool ImageSplitter::configure(yarp::os::ResourceFinder &rf)
     {
         cout<<"Usage:"<<endl<<"<imageSplitter> --param1 arg1 --param2 arg2 ..."<<endl;
         cout<<"Here the available parameters:"<<endl;
-        cout<<"align      specify if the alignement of the images is 'vertical' or 'horizontal'"<<endl;
+        cout<<"align      specify if the alignement of the images is 'horizontal' (default), 'vertical',"<<endl;
+        cout<<"           'rowInterlaced' (even rows left, odd rows right) or 'columnInterlaced' (even columns left, odd columns right)"<<endl;
         cout<<"local      prefix for the ports that will be opened by this module, if not specified the default is '/imageSplitter'"<<endl;
         cout<<"nameInput  name of the module's' input port, if not specified by default is <local> + '/input:i'"<<endl;
         cout<<"nameLeft   name of the output port for the 'left image', if not specified by default is <local> + '/left:o'"<<endl;
         cout<<"nameRight  name of the output port for the 'right image', if not specified by default is <local> + '/right:o'"<<endl;
         cout<<"remote     name of the source port, if specified it connects automatically to the module's input port"<<endl;
+        cout<<"parallel   split and send the right image in a thread of its own, while the module does the left one"<<endl;
         std::exit(1);
     }
     // Check input parameters
@@ -45,15 +87,23 @@ bool ImageSplitter::configure(yarp::os::ResourceFinder &rf)
         yarp::os::ConstString align = rf.find("align").asString();
         if(align == "vertical")
         {
-            horizontal = false;
+            layout = LAYOUT_VERTICAL;
         }
         else if(align == "horizontal")
         {
-            horizontal = true;
+            layout = LAYOUT_HORIZONTAL;
+        }
+        else if(align == "rowInterlaced")
+        {
+            layout = LAYOUT_ROW_INTERLACED;
+        }
+        else if(align == "columnInterlaced")
+        {
+            layout = LAYOUT_COLUMN_INTERLACED;
         }
         else
         {
-            yError() << " Incorrect parameter. Supported values for alignment are 'horizontal' or 'vertical'";
+            yError() << " Incorrect parameter. Supported values for alignment are 'horizontal', 'vertical', 'rowInterlaced' or 'columnInterlaced'";
             return false;
         }
     }
@@ -122,217 +172,180 @@ bool ImageSplitter::configure(yarp::os::ResourceFinder &rf)
         }
     }
 
-    // choose filling method
+    // the copy method is chosen from the alignment now
     if(rf.check("m"))
+        yWarning() << "The 'm' parameter is not used anymore";
+
+    parallel = rf.check("parallel");
+    if(parallel)
     {
-        yarp::os::ConstString align = rf.find("m").asString();
-        if(align == "pixel")
-        {
-            method = 0;
-        }
-        else if(align == "pixel2")
-        {
-            method = 1;
-        }
-        else if(align == "line")
-        {
-            method = 2;
-        }
-        else if(align == "whole")
-        {
-            if(horizontal)
-                yError() << "Cannot use 'whole' method for input image horizontally aligned";
-            method = 3;
-        }
-        else
+        rightWorker = new SplitterWorker(this, RIGHT);
+        if(!rightWorker->start())
         {
-            yError() << "Methods are pixel, line, whole; got " << align;
+            yError() << "Cannot start the thread of the right image";
             return false;
         }
+        yInfo() << "splitting the two images in parallel";
     }
 
-    yInfo() << "using method " << method;
     return true;
 }
 
 bool ImageSplitter::interruptModule()
 {
-
+    inputPort.interrupt();
+    outLeftPort.interrupt();
+    outRightPort.interrupt();
     return true;
 }
 
 bool ImageSplitter::close()
 {
+    if(rightWorker)
+        rightWorker->stop();
+
+    inputPort.close();
+    outLeftPort.close();
+    outRightPort.close();
     return true;
 }
 
-bool ImageSplitter::updateModule()
+void ImageSplitter::split(ImageOf<PixelRgb> &input, ImageOf<PixelRgb> &output, int side)
 {
-    ImageOf<PixelRgb> *inputImage    = inputPort.read();
-    yarp::os::Stamp stamp;
-    inputPort.getEnvelope(stamp);
-
-    ImageOf<PixelRgb> &outLeftImage  = outLeftPort.prepare();
-    ImageOf<PixelRgb> &outRightImage = outRightPort.prepare();
-
-    inWidth  = inputImage->width();
-    inHeight = inputImage->height();
+    int rowSizeByte = outWidth * output.getPixelSize();
 
-    if(horizontal)  // input image is horizontally aligned
-    {
-        outWidth  = inWidth/2;
-        outHeight = inHeight;
-    }
-    else
+    switch(layout)
     {
-        outWidth  = inWidth;
-        outHeight = inHeight/2;
-    }
-
-    outLeftImage.setQuantum(inputImage->getQuantum());
-    outRightImage.setQuantum(inputImage->getQuantum());
-    outLeftImage.resize(outWidth, outHeight);
-    outRightImage.resize(outWidth, outHeight);
+        case LAYOUT_HORIZONTAL: // one memcpy per row
+        {
+            output.resize(outWidth, outHeight);
+            for(int h=0; h<outHeight; h++)
+                memcpy(output.getRow(h), input.getRow(h) + side*rowSizeByte, rowSizeByte);
+        } break;
 
-    // alloc and compute some vars for efficency
-    int h2, w2;
-    unsigned char *pixelLeft, *pixelRight;
-    unsigned char *pixelInputL, *pixelInputR;
-    unsigned char *pixelInput = inputImage->getRawImage();
-    int dualImage_rowSizeByte = inputImage->getRowSize();
-    int singleImage_rowSizeByte = outLeftImage.getRowSize();
-    int singleImage_wholeSizeByte = outWidth * outHeight * outLeftImage.getPixelSize();
+        case LAYOUT_VERTICAL:
+        {
+            // The rows of the two halves have the layout of the rows of the output images, so
+            // these are views on the memory of the input (written before the next read).
+            output.setExternal(input.getRow(side*outHeight), outWidth, outHeight);
+        } break;
 
-    static int counter = 0;
-    static double start = 0;
-    start = yarp::os::Time::now();
+        case LAYOUT_ROW_INTERLACED: // one memcpy per row
+        {
+            output.resize(outWidth, outHeight);
+            for(int h=0; h<outHeight; h++)
+                memcpy(output.getRow(h), input.getRow(2*h + side), rowSizeByte);
+        } break;
 
-    switch(method)
-    {
-        case 0: // pixel by pixel
+        case LAYOUT_COLUMN_INTERLACED:
         {
-            if(horizontal)
+            output.resize(outWidth, outHeight);
+            for(int h=0; h<outHeight; h++)
             {
-                for(int h=0; h<outHeight; h++)
+                const unsigned char *src = input.getRow(h) + side*3;
+                unsigned char *dst = output.getRow(h);
+                int w = 0;
+#if defined(__SSSE3__)
+                // 8 pixels per step: 48 input bytes are shuffled into 24 output bytes. the last step keeps
+                // one pixel pair of margin, because with side 1 the 48 bytes go 3 bytes past the 8 pairs.
+                const __m128i lo0 = _mm_setr_epi8( 0,  1,  2,  6,  7,  8, 12, 13, 14, -1, -1, -1, -1, -1, -1, -1);
+                const __m128i lo1 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1,  2,  3,  4,  8,  9, 10, 14);
+                const __m128i hi1 = _mm_setr_epi8(15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+                const __m128i hi2 = _mm_setr_epi8(-1,  0,  4,  5,  6, 10, 11, 12, -1, -1, -1, -1, -1, -1, -1, -1);
+                for(; w+8<outWidth; w+=8)
                 {
-                    for(int w1=0; w1<outWidth; w1++)
-                    {
-                        w2 = w1+outWidth;
-                        pixelLeft = outLeftImage.getPixelAddress(w1, h);
-                        pixelLeft[0] = *(inputImage->getPixelAddress(w1, h)+0);
-                        pixelLeft[1] = *(inputImage->getPixelAddress(w1, h)+1);
-                        pixelLeft[2] = *(inputImage->getPixelAddress(w1, h)+2);
-
-                        pixelRight = outRightImage.getPixelAddress(w1, h);
-                        pixelRight[0] = *(inputImage->getPixelAddress(w2, h)+0);
-                        pixelRight[1] = *(inputImage->getPixelAddress(w2, h)+1);
-                        pixelRight[2] = *(inputImage->getPixelAddress(w2, h)+2);
-                    }
+                    __m128i r0 = _mm_loadu_si128((const __m128i*) (src + 6*w));
+                    __m128i r1 = _mm_loadu_si128((const __m128i*) (src + 6*w + 16));
+                    __m128i r2 = _mm_loadu_si128((const __m128i*) (src + 6*w + 32));
+                    _mm_storeu_si128((__m128i*) (dst + 3*w), _mm_or_si128(_mm_shuffle_epi8(r0, lo0), _mm_shuffle_epi8(r1, lo1)));
+                    _mm_storel_epi64((__m128i*) (dst + 3*w + 16), _mm_or_si128(_mm_shuffle_epi8(r1, hi1), _mm_shuffle_epi8(r2, hi2)));
                 }
-            }
-            else
-            {
-                for(int h1=0; h1<outHeight; h1++)
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+                // 16 pixels per step: vld3 splits 32 input pixels in their channels, vuzp keeps the even ones.
+                // the same margin of one pixel pair as above.
+                for(; w+16<outWidth; w+=16)
                 {
-                    for(int w=0; w<outWidth; w++)
-                    {
-                        h2 = h1+outHeight;
-                        pixelLeft = outLeftImage.getPixelAddress(w, h1);
-                        pixelLeft[0] = *(inputImage->getPixelAddress(w, h1)+0);
-                        pixelLeft[1] = *(inputImage->getPixelAddress(w, h1)+1);
-                        pixelLeft[2] = *(inputImage->getPixelAddress(w, h1)+2);
-
-                        pixelRight = outRightImage.getPixelAddress(w, h1);
-                        pixelRight[0] = *(inputImage->getPixelAddress(w, h2)+0);
-                        pixelRight[1] = *(inputImage->getPixelAddress(w, h2)+1);
-                        pixelRight[2] = *(inputImage->getPixelAddress(w, h2)+2);
-                    }
+                    uint8x16x3_t a = vld3q_u8(src + 6*w);
+                    uint8x16x3_t b = vld3q_u8(src + 6*w + 48);
+                    uint8x16x3_t out;
+                    out.val[0] = vuzpq_u8(a.val[0], b.val[0]).val[0];
+                    out.val[1] = vuzpq_u8(a.val[1], b.val[1]).val[0];
+                    out.val[2] = vuzpq_u8(a.val[2], b.val[2]).val[0];
+                    vst3q_u8(dst + 3*w, out);
+                }
+#endif
+                for(; w<outWidth; w++)
+                {
+                    dst[3*w]   = src[6*w];
+                    dst[3*w+1] = src[6*w+1];
+                    dst[3*w+2] = src[6*w+2];
                 }
             }
         } break;
 
-        case 1: // pixel by pixel, a bit better
+        default:
         {
-            if(horizontal)
-            {
-                pixelLeft  = outLeftImage.getRawImage();
-                pixelRight = outRightImage.getRawImage();
+            yError() << " @line " << __LINE__ << "unhandled switch case, we should not be here!";
+        }
+    }
+}
 
-                pixelInputL = pixelInput;
-                pixelInputR = pixelInput+singleImage_rowSizeByte;
-                for(int h=0, idx=0, idx2=0; h<outHeight; h++)
-                {
-                    for(int w=0; w<outWidth; w++)
-                    {
-                        pixelLeft[idx++] = *(pixelInputL++);
-                        pixelLeft[idx++] = *(pixelInputL++);
-                        pixelLeft[idx++] = *(pixelInputL++);
-
-                        pixelRight[idx2++] = *(pixelInputR++);
-                        pixelRight[idx2++] = *(pixelInputR++);
-                        pixelRight[idx2++] = *(pixelInputR++);
-                    }
-                    pixelInputL += singleImage_rowSizeByte;
-                    pixelInputR += singleImage_rowSizeByte;
-                }
-            }
-            else
-            {
+void ImageSplitter::splitAndWrite(ImageOf<PixelRgb> &input, Stamp &stamp, int side)
+{
+    BufferedPort<ImageOf<PixelRgb> > &port = (side == LEFT) ? outLeftPort : outRightPort;
 
-            }
-        } break;
+    ImageOf<PixelRgb> &output = port.prepare();
+    output.setQuantum(input.getQuantum());
+    split(input, output, side);
 
-        case 2: // line by line
-        {
-            if(horizontal)
-            {
-                pixelLeft  = outLeftImage.getRawImage();
-                pixelRight = outRightImage.getRawImage();
+    port.setEnvelope(stamp);
+    port.write();
+}
 
-                for(int h=0; h<inHeight; h++)
-                {
-                    memcpy(pixelLeft  + h*singleImage_rowSizeByte, pixelInput,                          singleImage_rowSizeByte);
-                    memcpy(pixelRight + h*singleImage_rowSizeByte, pixelInput+=singleImage_rowSizeByte, singleImage_rowSizeByte);
-                    pixelInput+= dualImage_rowSizeByte/2;
-                }
-            }
-            else
-            {
-                pixelLeft  = outLeftImage.getRawImage();
-                pixelRight = outRightImage.getRawImage();
-                pixelInputL = pixelInput;
-                pixelInputR = pixelInput+singleImage_wholeSizeByte;
+bool ImageSplitter::updateModule()
+{
+    // the outputs may be views on the last input, which is released by the next read
+    if(layout == LAYOUT_VERTICAL)
+    {
+        outLeftPort.waitForWrite();
+        outRightPort.waitForWrite();
+    }
 
-                for(int h=0; h<outHeight; h++)
-                {
-                    memcpy(pixelLeft  + h*singleImage_rowSizeByte, pixelInputL, singleImage_rowSizeByte);
-                    memcpy(pixelRight + h*singleImage_rowSizeByte, pixelInputR, singleImage_rowSizeByte);
-                    pixelInputL+= singleImage_rowSizeByte;
-                    pixelInputR+= singleImage_rowSizeByte;
-                }
-            }
-        } break;
+    ImageOf<PixelRgb> *inputImage = inputPort.read();
+    if(inputImage == NULL)
+        return false;
 
-        case 3: // whole image, only if input image is vertically aligned
-        {
-            if(horizontal)
-            {
-                yError() << "Cannot use this copy method with horizontally aligned source image.";
-            }
-            else
-            {
-                pixelLeft  = outLeftImage.getRawImage();
-                pixelRight = outRightImage.getRawImage();
+    yarp::os::Stamp stamp;
+    inputPort.getEnvelope(stamp);
 
-                memcpy(pixelLeft,  pixelInput,                            singleImage_wholeSizeByte);
-                memcpy(pixelRight, pixelInput+ singleImage_wholeSizeByte, singleImage_wholeSizeByte);
-            }
-        } break;
+    inWidth  = inputImage->width();
+    inHeight = inputImage->height();
 
-        default:
-        {
-            yError() << " @line " << __LINE__ << "unhandled switch case, we should not be here!";
-        }
+    if((layout == LAYOUT_HORIZONTAL) || (layout == LAYOUT_COLUMN_INTERLACED))
+    {
+        outWidth  = inWidth/2;
+        outHeight = inHeight;
+    }
+    else
+    {
+        outWidth  = inWidth;
+        outHeight = inHeight/2;
+    }
+
+    static int counter = 0;
+    static double start = 0;
+    start = yarp::os::Time::now();
+
+    if(parallel)
+    {
+        rightWorker->trigger(inputImage, stamp);
+        splitAndWrite(*inputImage, stamp, LEFT);
+        rightWorker->waitDone();
+    }
+    else
+    {
+        splitAndWrite(*inputImage, stamp, LEFT);
+        splitAndWrite(*inputImage, stamp, RIGHT);
     }
 
     static double end = 0;
@@ -347,11 +360,6 @@ bool ImageSplitter::updateModule()
         elapsed = 0;
     }
 
-    outLeftPort.setEnvelope(stamp);
-    outRightPort.setEnvelope(stamp);
-
-    outLeftPort.write();
-    outRightPort.write();
     return true;
 }
 
@@ -10,7 +10,13 @@ Split a single image with 2 frames in it into 2 images left/right
 Parameters
 \code
   align horizontal / vertical  :  input images are coupled on the horizontal / vertical way  -- default horizontal
+        rowInterlaced        :  even rows belong to the left image, odd rows to the right one
+        columnInterlaced     :  even columns belong to the left image, odd columns to the right one
+  parallel                   :  the right image is split and sent by a thread of its own
 \endcode
+
+With the vertical alignment the output images are views on the memory of the input image,
+no copy is done.
 */ 
 
 #include <yarp/dev/Drivers.h>
@@ -0,0 +1,305 @@
+/*
+ * Copyright (C) 2016 iCub Facility - Istituto Italiano di Tecnologia
+ * CopyPolicy: Released under the terms of the GNU GPL v2.0.
+ */
+
+/**
+@ingroup icub_tools
+
+\defgroup pipelineBenchmark pipelineBenchmark
+
+Latency and throughput of the vision modules fed by a recording (see the replay_grabber device).
+
+\section intro_sec Description
+The tool listens to the port of the grabber (the source of the frames) and to the output
+ports of the modules under test. Every message is recognised by the sequence number of its
+envelope, which the modules propagate from the grabber: the latency of a module is the time
+between the arrival of a frame from the grabber and the arrival of the output of the module
+with the same envelope, both measured here. Modules that do not propagate the envelope
+get their throughput only. The data of the messages are not read.
+
+It also packs a directory recorded by yarpdatadumper into a frame container, which
+replay_grabber maps in memory.
+
+\section parameters_sec Parameters
+\code
+  --name    prefix of the ports (default /pipelineBenchmark)
+  --source  port of the grabber (e.g. /replay/left)
+  --outputs list of the output ports of the modules (e.g. (/camCalib/left/out /lumaChroma/Y/image:o))
+  --period  seconds between two reports (default 5.0)
+  --log     file where to write a line per message: port, sequence number, arrival time, latency
+
+  --pack <dir> --to <file>   packs the images of dir into the container file and quits
+\endcode
+
+\section example_sec Example
+\code
+  yarpdev --device grabber --subdevice replay_grabber --source ~/recordings/left.rpl --speed 0 --name /replay/left
+  camCalib --from camCalibConf.ini --group CAMERA_CALIBRATION_LEFT --name /camCalib/left
+  pipelineBenchmark --source /replay/left --outputs "(/camCalib/left/out)"
+\endcode
+*/
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include <yarp/os/all.h>
+
+#include <ReplayFiles.h>
+
+using namespace std;
+using namespace yarp::os;
+
+
+class Statistics
+{
+public:
+    int frames, matched;
+    double latencySum, latencyMin, latencyMax;
+
+    Statistics() { reset(); }
+
+    void reset()
+    {
+        frames=matched=0;
+        latencySum=latencyMax=0.0;
+        latencyMin=1e9;
+    }
+
+    void add(double latency)
+    {
+        frames++;
+        if (latency>=0.0)
+        {
+            matched++;
+            latencySum+=latency;
+            latencyMin=min(latencyMin, latency);
+            latencyMax=max(latencyMax, latency);
+        }
+    }
+
+    void print(const string &name, double elapsed) const
+    {
+        if (matched>0)
+            yInfo("%s: %d frames, %.1f fps, latency %.2f ms (min %.2f, max %.2f)", name.c_str(), frames,
+                  elapsed>0.0 ? frames/elapsed : 0.0, 1e3*latencySum/matched, 1e3*latencyMin, 1e3*latencyMax);
+        else
+            yInfo("%s: %d frames, %.1f fps, latency not available (the envelope is not propagated)", name.c_str(), frames,
+                  elapsed>0.0 ? frames/elapsed : 0.0);
+    }
+};
+
+
+class PipelineBenchmark;
+
+// gets the envelopes of the messages of a port, without reading the data
+class EnvelopeReader : public PortReader
+{
+    PipelineBenchmark *owner;
+    Port *port;
+    int id;
+
+public:
+    EnvelopeReader(PipelineBenchmark *owner, Port *port, int id) : owner(owner), port(port), id(id) { }
+    virtual bool read(ConnectionReader &connection);
+};
+
+
+class PipelineBenchmark : public RFModule
+{
+    string name;
+    vector<string> remotes;         // 0 is the source, then the outputs
+    vector<Port*> ports;
+    vector<EnvelopeReader*> readers;
+    vector<Statistics> period, total;
+    map<int, double> arrivals;      // arrival time of the frames of the source, by sequence number
+    double periodStart, start;
+    double reportPeriod;
+    FILE *log;
+    Semaphore mutex;
+
+public:
+    PipelineBenchmark() : periodStart(0.0), start(0.0), reportPeriod(5.0), log(NULL), mutex(1) { }
+
+    bool configure(ResourceFinder &rf)
+    {
+        name=rf.check("name", Value("/pipelineBenchmark")).asString().c_str();
+        reportPeriod=rf.check("period", Value(5.0)).asDouble();
+
+        if (!rf.check("source"))
+        {
+            yError() << "the port of the grabber ('source') is missing";
+            return false;
+        }
+        remotes.push_back(rf.find("source").asString().c_str());
+
+        if (Bottle *outputs=rf.find("outputs").asList())
+            for (int i=0; i<outputs->size(); i++)
+                remotes.push_back(outputs->get(i).asString().c_str());
+
+        if (rf.check("log"))
+        {
+            log=fopen(rf.find("log").asString().c_str(), "w");
+            if (log==NULL)
+            {
+                yError() << "cannot write" << rf.find("log").asString();
+                return false;
+            }
+        }
+
+        period.resize(remotes.size());
+        total.resize(remotes.size());
+        for (size_t i=0; i<remotes.size(); i++)
+        {
+            Port *port=new Port;
+            EnvelopeReader *reader=new EnvelopeReader(this, port, (int)i);
+            ports.push_back(port);
+            readers.push_back(reader);
+
+            string local=name+(i==0 ? string("/source:i") : "/output"+int2str((int)i-1)+":i");
+            port->setReader(*reader);
+            if (!port->open(local.c_str()))
+                return false;
+            if (!Network::connect(remotes[i].c_str(), local.c_str()))
+                yWarning() << "cannot connect" << remotes[i] << "to" << local << ", connect it later";
+        }
+
+        start=periodStart=Time::now();
+        return true;
+    }
+
+    static string int2str(int i)
+    {
+        char s[16];
+        snprintf(s, sizeof(s), "%d", i);
+        return s;
+    }
+
+    void onMessage(int id, const Stamp &stamp)
+    {
+        double now=Time::now();
+        double latency=-1.0;
+
+        mutex.wait();
+        if (id==0)
+        {
+            arrivals[stamp.getCount()]=now;
+
+            // the frames older than a few seconds will not be matched anymore
+            while (!arrivals.empty() && (arrivals.begin()->second<now-10.0))
+                arrivals.erase(arrivals.begin());
+        }
+        else if (stamp.isValid())
+        {
+            map<int, double>::iterator it=arrivals.find(stamp.getCount());
+            if (it!=arrivals.end())
+                latency=now-it->second;
+        }
+
+        period[id].add(latency);
+        total[id].add(latency);
+        if (log!=NULL)
+            fprintf(log, "%s %d %.6f %.6f\n", remotes[id].c_str(), stamp.getCount(), now, latency);
+        mutex.post();
+    }
+
+    double getPeriod()
+    {
+        return reportPeriod;
+    }
+
+    bool updateModule()
+    {
+        mutex.wait();
+        double now=Time::now();
+        for (size_t i=0; i<remotes.size(); i++)
+        {
+            period[i].print(remotes[i], now-periodStart);
+            period[i].reset();
+        }
+        periodStart=now;
+        mutex.post();
+        return true;
+    }
+
+    bool interruptModule()
+    {
+        for (size_t i=0; i<ports.size(); i++)
+            ports[i]->interrupt();
+        return true;
+    }
+
+    bool close()
+    {
+        for (size_t i=0; i<ports.size(); i++)
+        {
+            ports[i]->close();
+            delete ports[i];
+            delete readers[i];
+        }
+        ports.clear();
+        readers.clear();
+
+        yInfo() << "whole run:";
+        double elapsed=Time::now()-start;
+        for (size_t i=0; i<total.size(); i++)
+            total[i].print(remotes[i], elapsed);
+
+        if (log!=NULL)
+            fclose(log);
+        log=NULL;
+        return true;
+    }
+};
+
+
+bool EnvelopeReader::read(ConnectionReader &connection)
+{
+    if (!connection.isValid())
+        return false;
+
+    Stamp stamp;
+    port->getEnvelope(stamp);
+    owner->onMessage(id, stamp);
+    return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+    ResourceFinder rf;
+    rf.configure(argc, argv);
+
+    if (rf.check("help"))
+    {
+        printf("pipelineBenchmark --source <port> --outputs \"(<port> ...)\" [--name <prefix>] [--period <s>] [--log <file>]\n");
+        printf("pipelineBenchmark --pack <directory> --to <file>\n");
+        return 0;
+    }
+
+    if (rf.check("pack"))
+    {
+        ImageDirectory dir;
+        if (!rf.check("to") ||
+            !dir.open(rf.find("pack").asString().c_str(), rf.check("pattern", Value("%08d.ppm")).asString().c_str(),
+                      rf.check("framerate", Value(30.0)).asDouble()))
+        {
+            yError() << "usage: pipelineBenchmark --pack <directory> --to <file>";
+            return 1;
+        }
+        return FrameContainer::pack(dir, rf.find("to").asString().c_str()) ? 0 : 1;
+    }
+
+    Network yarp;
+    if (!yarp.checkNetwork())
+    {
+        yError() << "YARP server not available!";
+        return 1;
+    }
+
+    PipelineBenchmark benchmark;
+    return benchmark.runModule(rf);
+}
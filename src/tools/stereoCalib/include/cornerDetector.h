@@ -0,0 +1,90 @@
+#ifndef __CORNER_DETECTOR_H__
+#define __CORNER_DETECTOR_H__
+
+#include <string>
+#include <vector>
+#include <deque>
+
+#include <opencv2/opencv.hpp>
+
+#include <yarp/os/Thread.h>
+#include <yarp/os/Semaphore.h>
+
+
+// a frame (mono) or a pair of frames (stereo) to look for the pattern in
+struct CalibView
+{
+    int generation;                         // views of an older generation are discarded
+    int n;                                  // 1 or 2 images
+    cv::Mat image[2];                       // rgb
+    bool found;
+    std::vector<cv::Point2f> corners[2];
+};
+
+
+/**
+ * Looks for the calibration pattern in the views on a pool of threads, so that the
+ * images keep flowing while the pattern is searched. A view is accepted only if a
+ * thread is free: views are never queued behind slower ones.
+ */
+class CornerDetector
+{
+public:
+    CornerDetector(cv::Size boardSize, const std::string &boardType, int threads);
+    ~CornerDetector();
+
+    /** Whether a thread is free to take a view */
+    bool isIdle();
+
+    /** Takes the view if a thread is free (the images are shared, not copied) */
+    bool submit(const CalibView &view);
+
+    /** Gets a view examined, if any, without waiting */
+    bool getResult(CalibView &view);
+
+    /** Searches the pattern in a rgb image (gray levels as cv::imread gives them) */
+    static bool detect(const cv::Mat &rgb, cv::Size boardSize, const std::string &boardType,
+                       std::vector<cv::Point2f> &corners);
+
+private:
+    class Worker : public yarp::os::Thread
+    {
+        CornerDetector *owner;
+    public:
+        Worker(CornerDetector *owner) : owner(owner) { }
+        void run();
+    };
+
+    cv::Size boardSize;
+    std::string boardType;
+    std::vector<Worker*> workers;
+    std::deque<CalibView> pending, done;
+    int busy;
+    bool stopping;
+    yarp::os::Semaphore mutex, jobs;
+};
+
+
+/**
+ * Saves the images on disk in a thread of its own; the images queued
+ * are all written before stopping.
+ */
+class ImageWriter : public yarp::os::Thread
+{
+public:
+    ImageWriter();
+
+    /** Queues a rgb image (shared, not copied) */
+    void save(const std::string &path, const cv::Mat &rgb);
+
+    void run();
+    void onStop();
+
+private:
+    std::deque<std::pair<std::string, cv::Mat> > queue;
+    yarp::os::Semaphore mutex, items;
+
+    bool writeNext();
+};
+
+#endif
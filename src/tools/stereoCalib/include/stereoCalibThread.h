@@ -1,6 +1,7 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <algorithm>
 
 #include <opencv2/opencv.hpp>
 
@@ -11,6 +12,8 @@
 
 #include <iCub/iKin/iKinFwd.h>
 
+#include "cornerDetector.h"
+
 using namespace std;
 using namespace cv;
 using namespace yarp::os;
@@ -29,8 +32,6 @@ private:
 
     ImageOf<PixelRgb> *imageL;
     ImageOf<PixelRgb> *imageR;
-    IplImage * imgL;
-    IplImage * imgR;
 
     string moduleName;
     string robotName;
@@ -65,9 +66,19 @@ private:
     string outNameLeft;
     string camCalibFile;
     string currentPathDir;
-    std::vector<string> imageListR;
-    std::vector<string> imageListL;
-    std::vector<string> imageListLR;
+
+    // the corners found in the views accepted, for the final solve
+    std::vector<std::vector<Point2f> > cornersL;
+    std::vector<std::vector<Point2f> > cornersR;
+    Size imageSize;
+
+    CornerDetector *detector;
+    ImageWriter *writer;
+    int detectionThreads;
+    int generation;             // bumped at every view accepted, the views still in the pool are discarded
+    double holdUntil;           // the last view accepted is shown until then
+    Mat heldL;
+    Mat heldR;
 
     BufferedPort<ImageOf<PixelRgb> > imagePortInLeft;
     BufferedPort<ImageOf<PixelRgb> > imagePortInRight;
@@ -86,14 +97,15 @@ private:
     void printMatrix(Mat &matrix);
     bool checkTS(double TSLeft, double TSRight, double th=0.08);
     void preparePath(const char * imageDir, char* pathL, char* pathR, int num);
-    void saveStereoImage(const char * imageDir, IplImage* left, IplImage * right, int num);
-    void monoCalibration(const vector<string>& imageList, int boardWidth, int boardHeight, Mat &K, Mat &Dist);
-    void stereoCalibration(const vector<string>& imagelist, int boardWidth, int boardHeight,float sqsizee);
+    void submitView(ImageOf<PixelRgb> *left, ImageOf<PixelRgb> *right);
+    bool collectViews(int &count);
+    void sendOutput(ImageOf<PixelRgb> *left, ImageOf<PixelRgb> *right);
+    void monoCalibration(const vector<vector<Point2f> >& imagePoints, Size imageSize, Mat &K, Mat &Dist);
+    void stereoCalibration(const vector<vector<Point2f> >& imagePointsL, const vector<vector<Point2f> >& imagePointsR, Size imageSize, float sqsize);
     void saveCalibration(const string& extrinsicFilePath, const string& intrinsicFilePath);
     void calcChessboardCorners(Size boardSize, float squareSize, vector<Point3f>& corners);
     bool updateIntrinsics( int width, int height, double fx, double fy,double cx, double cy, double k1, double k2, double p1, double p2, const string& groupname);
     bool updateExtrinsics(Mat Rot, Mat Tr, const string& groupname);
-    void saveImage(const char * imageDir, IplImage* left, int num);
     void stereoCalibRun();
     void monoCalibRun();
 
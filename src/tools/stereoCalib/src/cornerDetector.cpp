@@ -0,0 +1,168 @@
+#include <yarp/os/LogStream.h>
+
+#include "cornerDetector.h"
+
+using namespace std;
+using namespace cv;
+
+
+CornerDetector::CornerDetector(Size boardSize, const string &boardType, int threads) :
+    boardSize(boardSize), boardType(boardType), busy(0), stopping(false), mutex(1), jobs(0)
+{
+    for (int i=0; i<threads; i++)
+    {
+        Worker *worker=new Worker(this);
+        if (worker->start())
+            workers.push_back(worker);
+        else
+            delete worker;
+    }
+}
+
+CornerDetector::~CornerDetector()
+{
+    // every worker has to be woken up before any of them is joined
+    mutex.wait();
+    stopping=true;
+    mutex.post();
+    for (size_t i=0; i<workers.size(); i++)
+        jobs.post();
+
+    for (size_t i=0; i<workers.size(); i++)
+    {
+        workers[i]->stop();
+        delete workers[i];
+    }
+}
+
+bool CornerDetector::isIdle()
+{
+    mutex.wait();
+    bool free=busy<(int)workers.size();
+    mutex.post();
+    return free;
+}
+
+bool CornerDetector::submit(const CalibView &view)
+{
+    mutex.wait();
+    bool free=busy<(int)workers.size();
+    if (free)
+    {
+        busy++;
+        pending.push_back(view);
+    }
+    mutex.post();
+
+    if (free)
+        jobs.post();
+    return free;
+}
+
+bool CornerDetector::getResult(CalibView &view)
+{
+    mutex.wait();
+    bool ready=!done.empty();
+    if (ready)
+    {
+        view=done.front();
+        done.pop_front();
+    }
+    mutex.post();
+    return ready;
+}
+
+bool CornerDetector::detect(const Mat &rgb, Size boardSize, const string &boardType, vector<Point2f> &corners)
+{
+    Mat gray;
+    cvtColor(rgb, gray, CV_RGB2GRAY);
+
+    if(boardType == "CIRCLES_GRID")
+        return findCirclesGrid(gray, boardSize, corners, CALIB_CB_SYMMETRIC_GRID  | CALIB_CB_CLUSTERING);
+    else if(boardType == "ASYMMETRIC_CIRCLES_GRID")
+        return findCirclesGrid(gray, boardSize, corners, CALIB_CB_ASYMMETRIC_GRID | CALIB_CB_CLUSTERING);
+    else
+        return findChessboardCorners(gray, boardSize, corners, CV_CALIB_CB_ADAPTIVE_THRESH | CV_CALIB_CB_FAST_CHECK | CV_CALIB_CB_NORMALIZE_IMAGE);
+}
+
+void CornerDetector::Worker::run()
+{
+    while (true)
+    {
+        owner->jobs.wait();
+
+        owner->mutex.wait();
+        if (owner->stopping)
+        {
+            owner->mutex.post();
+            break;
+        }
+        if (owner->pending.empty())
+        {
+            owner->mutex.post();
+            continue;
+        }
+        CalibView view=owner->pending.front();
+        owner->pending.pop_front();
+        owner->mutex.post();
+
+        // all the images of the view have to show the pattern
+        view.found=true;
+        for (int k=0; (k<view.n) && view.found; k++)
+            view.found=detect(view.image[k], owner->boardSize, owner->boardType, view.corners[k]);
+
+        owner->mutex.wait();
+        owner->done.push_back(view);
+        owner->busy--;
+        owner->mutex.post();
+    }
+}
+
+
+ImageWriter::ImageWriter() : mutex(1), items(0)
+{
+}
+
+void ImageWriter::save(const string &path, const Mat &rgb)
+{
+    mutex.wait();
+    queue.push_back(make_pair(path, rgb));
+    mutex.post();
+    items.post();
+}
+
+bool ImageWriter::writeNext()
+{
+    mutex.wait();
+    if (queue.empty())
+    {
+        mutex.post();
+        return false;
+    }
+    pair<string, Mat> item=queue.front();
+    queue.pop_front();
+    mutex.post();
+
+    Mat bgr;
+    cvtColor(item.second, bgr, CV_RGB2BGR);
+    if (!imwrite(item.first, bgr))
+        yError("Unable to save %s", item.first.c_str());
+    return true;
+}
+
+void ImageWriter::run()
+{
+    while (!isStopping())
+    {
+        items.wait();
+        writeNext();
+    }
+
+    // what is left in the queue
+    while (writeNext());
+}
+
+void ImageWriter::onStop()
+{
+    items.post();
+}
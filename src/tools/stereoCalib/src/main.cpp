@@ -44,6 +44,7 @@ boardHeight H
 boardSize S
 numberOfImages N
 MonoCalib value
+detectionThreads T
 \endcode
 
 This is the ONLY group used by the module. Other groups in your config file will be discarded. See below for the parameter description. Calibration results will be saved in the specified context (default is: $ICUB_ROOT/main/app/cameraCalibration/conf/outputCalib.ini). You should replace your old calibration file (e.g. icubEyes.ini) with this new one.
@@ -72,6 +73,9 @@ YARP libraries and OpenCV
 --MonoCalib \e Val 
 - The parameter \e Val identifies if the module has to run the stereo calibration (Val=0) or the mono calibration (Val=1). For the mono calibration connect only the camera that you want to calibrate.
 
+--detectionThreads \e T 
+- The parameter \e T identifies the number of threads looking for the pattern while the images keep streaming (default 2). The frames arriving while all the threads are busy are not examined. The images with the pattern are saved in background and the corners found are used for the calibration, without reading the images back.
+
 \section portsc_sec Ports Created
 - <i> /stereoCalib/cam/left:i </i> accepts the incoming images from the left eye. 
 - <i> /stereoCalib/cam/right:i </i> accepts the incoming images from the right eye. 
@@ -24,6 +24,7 @@ stereoCalibThread::stereoCalibThread(ResourceFinder &rf, Port* commPort, const c
     this->numOfPairs= stereoCalibOpts.check("numberOfPairs", Value(30)).asInt();
     this->squareSize= (float)stereoCalibOpts.check("boardSize", Value(0.09241)).asDouble();
     this->boardType=  stereoCalibOpts.check("boardType", Value("CHESSBOARD")).asString();
+    this->detectionThreads= std::max(1, stereoCalibOpts.check("detectionThreads", Value(2)).asInt());
     this->commandPort=commPort;
     this->imageDir=imageDir;
     this->startCalibration=0;
@@ -37,6 +38,10 @@ stereoCalibThread::stereoCalibThread(ResourceFinder &rf, Port* commPort, const c
     this->camCalibFile=this->camCalibFile+"/"+fileName.c_str();
 
     this->mutex=new Semaphore(1);
+    this->detector=NULL;
+    this->writer=NULL;
+    this->generation=0;
+    this->holdUntil=0.0;
 }
 
 bool stereoCalibThread::threadInit()
@@ -61,6 +66,13 @@ bool stereoCalibThread::threadInit()
       return false;
    }
 
+    detector=new CornerDetector(Size(boardWidth,boardHeight),boardType,detectionThreads);
+    writer=new ImageWriter;
+    if (!writer->start()) {
+      cout << ": unable to start the image writer" << endl;
+      return false;
+    }
+
     //mono calibration does not need the joint positions initialised below
     if(!stereo) return true;
 
@@ -142,9 +154,6 @@ void stereoCalibThread::stereoCalibRun()
     bool initR=false;
 
     int count=1;
-    Size boardSize, imageSize;
-    boardSize.width=this->boardWidth;
-    boardSize.height=this->boardHeight;
 
     while (!isStopping()) {
         ImageOf<PixelRgb> *tmpL = imagePortInLeft.read(false);
@@ -165,88 +174,36 @@ void stereoCalibThread::stereoCalibRun()
 
         if(initL && initR && checkTS(TSLeft.getTime(),TSRight.getTime())){
 
-            bool foundL=false;
-            bool foundR=false;
-
             mutex->wait();
-            if(startCalibration>0) {
-
-                string pathImg=imageDir;
-                preparePath(pathImg.c_str(), pathL,pathR,count);
-                string iml(pathL);
-                string imr(pathR);
-                imgL= (IplImage*) imageL->getIplImage();
-                imgR= (IplImage*) imageR->getIplImage();
-                Mat Left=cvarrToMat(imgL);
-                Mat Right=cvarrToMat(imgR);
-
-                std::vector<Point2f> pointbufL;
-                std::vector<Point2f> pointbufR;
-                if(boardType == "CIRCLES_GRID") {
-                    foundL = findCirclesGrid(Left, boardSize, pointbufL, CALIB_CB_SYMMETRIC_GRID  | CALIB_CB_CLUSTERING);
-                    foundR = findCirclesGrid(Right, boardSize, pointbufR, CALIB_CB_SYMMETRIC_GRID  | CALIB_CB_CLUSTERING);
-                } else if(boardType == "ASYMMETRIC_CIRCLES_GRID") {
-                    foundL = findCirclesGrid(Left, boardSize, pointbufL, CALIB_CB_ASYMMETRIC_GRID | CALIB_CB_CLUSTERING);
-                    foundR = findCirclesGrid(Right, boardSize, pointbufR, CALIB_CB_ASYMMETRIC_GRID | CALIB_CB_CLUSTERING);
-                } else {
-                    foundL = findChessboardCorners( Left, boardSize, pointbufL, CV_CALIB_CB_ADAPTIVE_THRESH | CV_CALIB_CB_FAST_CHECK | CV_CALIB_CB_NORMALIZE_IMAGE);
-                    foundR = findChessboardCorners( Right, boardSize, pointbufR, CV_CALIB_CB_ADAPTIVE_THRESH | CV_CALIB_CB_FAST_CHECK | CV_CALIB_CB_NORMALIZE_IMAGE);
-                }
+            if(startCalibration>0)
+                submitView(imageL,imageR);
 
-                if(foundL && foundR) {
-                        cvCvtColor(imgL,imgL,CV_RGB2BGR);
-                        cvCvtColor(imgR,imgR, CV_RGB2BGR);
-                        saveStereoImage(pathImg.c_str(),imgL,imgR,count);
-
-                        imageListR.push_back(imr);
-                        imageListL.push_back(iml);
-                        imageListLR.push_back(iml);
-                        imageListLR.push_back(imr);
-                        Mat cL(pointbufL);
-                        Mat cR(pointbufR);
-                        drawChessboardCorners(Left, boardSize, cL, foundL);
-                        drawChessboardCorners(Right, boardSize, cR, foundR);
-                        count++;
-                }
-
-                if(count>numOfPairs) {
-                    yInfo(" Running Left Camera Calibration... \n");
-                    monoCalibration(imageListL,this->boardWidth,this->boardHeight,this->Kleft,this->DistL);
-
-                    yInfo(" Running Right Camera Calibration... \n");
-                    monoCalibration(imageListR,this->boardWidth,this->boardHeight,this->Kright,this->DistR);
+            if(collectViews(count) && count>numOfPairs) {
+                yInfo(" Running Left Camera Calibration... \n");
+                monoCalibration(cornersL,imageSize,this->Kleft,this->DistL);
 
-                    stereoCalibration(imageListLR, this->boardWidth,this->boardHeight,this->squareSize);
+                yInfo(" Running Right Camera Calibration... \n");
+                monoCalibration(cornersR,imageSize,this->Kright,this->DistR);
 
-                    yInfo(" Saving Calibration Results... \n");
-                    updateIntrinsics(imgL->width,imgL->height,Kright.at<double>(0,0),Kright.at<double>(1,1),Kright.at<double>(0,2),Kright.at<double>(1,2),DistR.at<double>(0,0),DistR.at<double>(0,1),DistR.at<double>(0,2),DistR.at<double>(0,3),"CAMERA_CALIBRATION_RIGHT");
-                    updateIntrinsics(imgL->width,imgL->height,Kleft.at<double>(0,0),Kleft.at<double>(1,1),Kleft.at<double>(0,2),Kleft.at<double>(1,2),DistL.at<double>(0,0),DistL.at<double>(0,1),DistL.at<double>(0,2),DistL.at<double>(0,3),"CAMERA_CALIBRATION_LEFT");
+                stereoCalibration(cornersL,cornersR,imageSize,this->squareSize);
 
-                    Mat Rot=Mat::eye(3,3,CV_64FC1);
-                    Mat Tr=Mat::zeros(3,1,CV_64FC1);
+                yInfo(" Saving Calibration Results... \n");
+                updateIntrinsics(imageSize.width,imageSize.height,Kright.at<double>(0,0),Kright.at<double>(1,1),Kright.at<double>(0,2),Kright.at<double>(1,2),DistR.at<double>(0,0),DistR.at<double>(0,1),DistR.at<double>(0,2),DistR.at<double>(0,3),"CAMERA_CALIBRATION_RIGHT");
+                updateIntrinsics(imageSize.width,imageSize.height,Kleft.at<double>(0,0),Kleft.at<double>(1,1),Kleft.at<double>(0,2),Kleft.at<double>(1,2),DistL.at<double>(0,0),DistL.at<double>(0,1),DistL.at<double>(0,2),DistL.at<double>(0,3),"CAMERA_CALIBRATION_LEFT");
 
-                    updateExtrinsics(this->R,this->T,"STEREO_DISPARITY");
+                updateExtrinsics(this->R,this->T,"STEREO_DISPARITY");
 
-                    yInfo("Calibration Results Saved in %s \n", camCalibFile.c_str());
+                yInfo("Calibration Results Saved in %s \n", camCalibFile.c_str());
 
-                    startCalibration=0;
-                    count=1;
-                    imageListR.clear();
-                    imageListL.clear();
-                    imageListLR.clear();
-                }
+                startCalibration=0;
+                count=1;
+                cornersL.clear();
+                cornersR.clear();
             }
             mutex->post();
-            ImageOf<PixelRgb>& outimL=outPortLeft.prepare();
-            outimL=*imageL;
-            outPortLeft.write();
 
-            ImageOf<PixelRgb>& outimR=outPortRight.prepare();
-            outimR=*imageR;
-            outPortRight.write();
+            sendOutput(imageL,imageR);
 
-            if(foundL && foundR && startCalibration==1)
-                Time::delay(2.0);
             initL=initR=false;
             cout.flush();
         }
@@ -283,11 +240,6 @@ void stereoCalibThread::monoCalibRun()
 
 
     int count=1;
-    Size boardSize, imageSize;
-    boardSize.width=this->boardWidth;
-    boardSize.height=this->boardHeight;
-
-
 
     while (!isStopping()) {
        if(left)
@@ -296,64 +248,29 @@ void stereoCalibThread::monoCalibRun()
             imageL = imagePortInRight.read(false);
 
        if(imageL!=NULL){
-            bool foundL=false;
             mutex->wait();
-            if(startCalibration>0) {
-
-                string pathImg=imageDir;
-                preparePath(pathImg.c_str(), pathL,pathR,count);
-                string iml(pathL);
-                imgL= (IplImage*) imageL->getIplImage();
-                Mat Left=cvarrToMat(imgL);
-                std::vector<Point2f> pointbufL;
-
-                if(boardType == "CIRCLES_GRID") {
-                    foundL = findCirclesGrid(Left, boardSize, pointbufL, CALIB_CB_SYMMETRIC_GRID  | CALIB_CB_CLUSTERING);
-                } else if(boardType == "ASYMMETRIC_CIRCLES_GRID") {
-                    foundL = findCirclesGrid(Left, boardSize, pointbufL, CALIB_CB_ASYMMETRIC_GRID | CALIB_CB_CLUSTERING);
-                } else {
-                    foundL = findChessboardCorners(Left, boardSize, pointbufL, CV_CALIB_CB_ADAPTIVE_THRESH | CV_CALIB_CB_FAST_CHECK | CV_CALIB_CB_NORMALIZE_IMAGE);
-                }
-
-                if(foundL) {
-                        cvCvtColor(imgL,imgL,CV_RGB2BGR);
-                        saveImage(pathImg.c_str(),imgL,count);
-                        imageListL.push_back(iml);
-                        Mat cL(pointbufL);
-                        drawChessboardCorners(Left, boardSize, cL, foundL);
-                        count++;
-                }
-
-                if(count>numOfPairs) {
-                    yInfo(" Running %s Camera Calibration... \n", cameraName.c_str());
-                    monoCalibration(imageListL,this->boardWidth,this->boardHeight,this->Kleft,this->DistL);
+            if(startCalibration>0)
+                submitView(imageL,NULL);
 
-                    yInfo(" Saving Calibration Results... \n");
-                    if(left)
-                        updateIntrinsics(imgL->width,imgL->height,Kleft.at<double>(0,0),Kleft.at<double>(1,1),Kleft.at<double>(0,2),Kleft.at<double>(1,2),DistL.at<double>(0,0),DistL.at<double>(0,1),DistL.at<double>(0,2),DistL.at<double>(0,3),"CAMERA_CALIBRATION_LEFT");
-                    else
-                        updateIntrinsics(imgL->width,imgL->height,Kleft.at<double>(0,0),Kleft.at<double>(1,1),Kleft.at<double>(0,2),Kleft.at<double>(1,2),DistL.at<double>(0,0),DistL.at<double>(0,1),DistL.at<double>(0,2),DistL.at<double>(0,3),"CAMERA_CALIBRATION_RIGHT");
+            if(collectViews(count) && count>numOfPairs) {
+                yInfo(" Running %s Camera Calibration... \n", cameraName.c_str());
+                monoCalibration(cornersL,imageSize,this->Kleft,this->DistL);
 
-                    yInfo("Calibration Results Saved in %s \n", camCalibFile.c_str());
-
-                    startCalibration=0;
-                    count=1;
-                    imageListL.clear();
-                }
+                yInfo(" Saving Calibration Results... \n");
+                if(left)
+                    updateIntrinsics(imageSize.width,imageSize.height,Kleft.at<double>(0,0),Kleft.at<double>(1,1),Kleft.at<double>(0,2),Kleft.at<double>(1,2),DistL.at<double>(0,0),DistL.at<double>(0,1),DistL.at<double>(0,2),DistL.at<double>(0,3),"CAMERA_CALIBRATION_LEFT");
+                else
+                    updateIntrinsics(imageSize.width,imageSize.height,Kleft.at<double>(0,0),Kleft.at<double>(1,1),Kleft.at<double>(0,2),Kleft.at<double>(1,2),DistL.at<double>(0,0),DistL.at<double>(0,1),DistL.at<double>(0,2),DistL.at<double>(0,3),"CAMERA_CALIBRATION_RIGHT");
 
+                yInfo("Calibration Results Saved in %s \n", camCalibFile.c_str());
 
+                startCalibration=0;
+                count=1;
+                cornersL.clear();
             }
             mutex->post();
-            ImageOf<PixelRgb>& outimL=outPortLeft.prepare();
-            outimL=*imageL;
-            outPortLeft.write();
 
-            ImageOf<PixelRgb>& outimR=outPortRight.prepare();
-            outimR=*imageL;
-            outPortRight.write();
-
-            if(foundL && startCalibration==1)
-                Time::delay(2.0);
+            sendOutput(imageL,NULL);
             cout.flush();
 
         }
@@ -361,6 +278,92 @@ void stereoCalibThread::monoCalibRun()
 
 
  }
+
+void stereoCalibThread::submitView(ImageOf<PixelRgb> *left, ImageOf<PixelRgb> *right)
+{
+    // a view is taken only when a detection thread is free: in the meantime the frames just flow to the output
+    if (Time::now()<holdUntil || !detector->isIdle())
+        return;
+
+    CalibView view;
+    view.generation=generation;
+    view.n=(right!=NULL)?2:1;
+    view.found=false;
+    view.image[0]=cvarrToMat((IplImage*)left->getIplImage()).clone();
+    if (right!=NULL)
+        view.image[1]=cvarrToMat((IplImage*)right->getIplImage()).clone();
+
+    detector->submit(view);
+}
+
+bool stereoCalibThread::collectViews(int &count)
+{
+    Size boardSize(boardWidth,boardHeight);
+    bool accepted=false;
+
+    CalibView view;
+    while (detector->getResult(view))
+    {
+        // the views submitted before the last one accepted, or before the calibration was stopped, are stale
+        if (!view.found || view.generation!=generation || startCalibration==0 || count>numOfPairs)
+            continue;
+
+        imageSize=view.image[0].size();
+        cornersL.push_back(view.corners[0]);
+        if (view.n>1)
+            cornersR.push_back(view.corners[1]);
+
+        yInfo("Saving images number %d \n",count);
+        preparePath(imageDir.c_str(),pathL,pathR,count);
+        writer->save(pathL,view.image[0]);
+        if (view.n>1)
+            writer->save(pathR,view.image[1]);
+
+        // the images saved are shared with the writer, the corners are drawn on copies
+        heldL=view.image[0].clone();
+        drawChessboardCorners(heldL,boardSize,Mat(view.corners[0]),true);
+        if (view.n>1)
+        {
+            heldR=view.image[1].clone();
+            drawChessboardCorners(heldR,boardSize,Mat(view.corners[1]),true);
+        }
+        else
+            heldR=heldL;
+
+        // the pattern has to be moved before the next view
+        holdUntil=Time::now()+2.0;
+        generation++;
+        count++;
+        accepted=true;
+    }
+
+    return accepted;
+}
+
+void stereoCalibThread::sendOutput(ImageOf<PixelRgb> *left, ImageOf<PixelRgb> *right)
+{
+    // the last view accepted is shown with its corners while the pattern is moved
+    bool held=(Time::now()<holdUntil) && !heldL.empty();
+
+    ImageOf<PixelRgb>& outimL=outPortLeft.prepare();
+    outimL=*left;
+    if (held)
+    {
+        Mat out=cvarrToMat((IplImage*)outimL.getIplImage());
+        heldL.copyTo(out);
+    }
+    outPortLeft.write();
+
+    ImageOf<PixelRgb>& outimR=outPortRight.prepare();
+    outimR=(right!=NULL)?*right:*left;
+    if (held)
+    {
+        Mat out=cvarrToMat((IplImage*)outimR.getIplImage());
+        heldR.copyTo(out);
+    }
+    outPortRight.write();
+}
+
 void stereoCalibThread::threadRelease()
 {
     imagePortInRight.close();
@@ -370,6 +373,16 @@ void stereoCalibThread::threadRelease()
     commandPort->close();
     delete mutex;
 
+    // the images still queued are written before leaving
+    if (writer!=NULL)
+    {
+        writer->stop();
+        delete writer;
+        writer=NULL;
+    }
+    delete detector;
+    detector=NULL;
+
     if (polyHead.isValid())
         polyHead.close();
 
@@ -441,26 +454,6 @@ void stereoCalibThread::preparePath(const char * imageDir, char* pathL, char* pa
 }
 
 
-void stereoCalibThread::saveStereoImage(const char * imageDir, IplImage* left, IplImage * right, int num) {
-    char pathL[256];
-    char pathR[256];
-    preparePath(imageDir, pathL,pathR,num);
-
-    yInfo("Saving images number %d \n",num);
-
-    cvSaveImage(pathL,left);
-    cvSaveImage(pathR,right);
-}
-
-void stereoCalibThread::saveImage(const char * imageDir, IplImage* left, int num) {
-    char pathL[256];
-    preparePath(imageDir, pathL,pathR,num);
-
-    yInfo("Saving images number %d \n",num);
-
-    cvSaveImage(pathL,left);
-
-}
 bool stereoCalibThread::updateIntrinsics(int width, int height, double fx, double fy,double cx, double cy, double k1, double k2, double p1, double p2, const string& groupname){
 
     std::vector<string> lines;
@@ -607,44 +600,15 @@ bool stereoCalibThread::updateIntrinsics(int width, int height, double fx, doubl
     return true;
 }
 
-void stereoCalibThread::monoCalibration(const vector<string>& imageList, int boardWidth, int boardHeight, Mat &K, Mat &Dist)
+void stereoCalibThread::monoCalibration(const vector<vector<Point2f> >& imagePoints, Size imageSize, Mat &K, Mat &Dist)
 {
-    vector<vector<Point2f> > imagePoints;
-    Size boardSize, imageSize;
+    Size boardSize;
     boardSize.width=boardWidth;
     boardSize.height=boardHeight;
     int flags=0;
-    int i;
 
     float squareSize = 1.f, aspectRatio = 1.f;
 
-      Mat view, viewGray;
-
-    for(i = 0; i<(int)imageList.size();i++)
-    {
-
-         view = cv::imread(imageList[i], 1);
-         imageSize = view.size();
-         vector<Point2f> pointbuf;
-         cvtColor(view, viewGray, CV_BGR2GRAY);
-
-         bool found = false;
-         if(boardType == "CIRCLES_GRID") {
-             found = findCirclesGrid(view, boardSize, pointbuf, CALIB_CB_SYMMETRIC_GRID  | CALIB_CB_CLUSTERING);
-         } else if(boardType == "ASYMMETRIC_CIRCLES_GRID") {
-             found = findCirclesGrid(view, boardSize, pointbuf, CALIB_CB_ASYMMETRIC_GRID | CALIB_CB_CLUSTERING);
-         } else {
-             found = findChessboardCorners( view, boardSize, pointbuf,
-                                            CV_CALIB_CB_ADAPTIVE_THRESH | CV_CALIB_CB_FAST_CHECK | CV_CALIB_CB_NORMALIZE_IMAGE);
-         }
-
-         if(found)
-         {
-            drawChessboardCorners( view, boardSize, Mat(pointbuf), found );
-            imagePoints.push_back(pointbuf);
-         }
-
-    }
     std::vector<Mat> rvecs, tvecs;
     std::vector<float> reprojErrs;
     double totalAvgErr = 0;
@@ -666,94 +630,32 @@ void stereoCalibThread::monoCalibration(const vector<string>& imageList, int boa
 }
 
 
-void stereoCalibThread::stereoCalibration(const vector<string>& imagelist, int boardWidth, int boardHeight,float sqsize)
+void stereoCalibThread::stereoCalibration(const vector<vector<Point2f> >& imagePointsL, const vector<vector<Point2f> >& imagePointsR, Size imageSize, float sqsize)
 {
     Size boardSize;
     boardSize.width=boardWidth;
     boardSize.height=boardHeight;
-    if( imagelist.size() % 2 != 0 )
+    if( imagePointsL.size() != imagePointsR.size() )
     {
-        cout << "Error: the image list contains odd (non-even) number of elements\n";
+        cout << "Error: the left and right views are not paired\n";
         return;
     }
 
-    const int maxScale = 2;
     // ARRAY AND VECTOR STORAGE:
-
+    // the corners were found in both images of the pairs as they were taken
     std::vector<std::vector<Point2f> > imagePoints[2];
-    Size imageSize;
-
-    int i, j, k, nimages = (int)imagelist.size()/2;
+    imagePoints[0]=imagePointsL;
+    imagePoints[1]=imagePointsR;
 
-    imagePoints[0].resize(nimages);
-    imagePoints[1].resize(nimages);
-    std::vector<string> goodImageList;
+    int i, j, k, nimages = (int)imagePointsL.size();
 
-    for( i = j = 0; i < nimages; i++ )
-    {
-        for( k = 0; k < 2; k++ )
-        {
-            const string& filename = imagelist[i*2+k];
-            Mat img = cv::imread(filename, 0);
-            if(img.empty())
-                break;
-            if( imageSize == Size() )
-                imageSize = img.size();
-            else if( img.size() != imageSize )
-            {
-                cout << "The image " << filename << " has the size different from the first image size. Skipping the pair\n";
-                break;
-            }
-            bool found = false;
-            std::vector<Point2f>& corners = imagePoints[k][j];
-            for( int scale = 1; scale <= maxScale; scale++ )
-            {
-                Mat timg;
-                if( scale == 1 )
-                    timg = img;
-                else
-                    resize(img, timg, Size(), scale, scale);
-
-                if(boardType == "CIRCLES_GRID") {
-                    found = findCirclesGrid(timg, boardSize, corners, CALIB_CB_SYMMETRIC_GRID  | CALIB_CB_CLUSTERING);
-                } else if(boardType == "ASYMMETRIC_CIRCLES_GRID") {
-                    found = findCirclesGrid(timg, boardSize, corners, CALIB_CB_ASYMMETRIC_GRID | CALIB_CB_CLUSTERING);
-                } else {
-                    found = findChessboardCorners(timg, boardSize, corners,
-                                                  CV_CALIB_CB_ADAPTIVE_THRESH | CV_CALIB_CB_NORMALIZE_IMAGE);
-                }
-
-                if( found )
-                {
-                    if( scale > 1 )
-                    {
-                        Mat cornersMat(corners);
-                        cornersMat *= 1./scale;
-                    }
-                    break;
-                }
-            }
-            if( !found )
-                break;
-            }
-        if( k == 2 )
-        {
-            goodImageList.push_back(imagelist[i*2]);
-            goodImageList.push_back(imagelist[i*2+1]);
-            j++;
-        }
-    }
-    yInfo("%i pairs have been successfully detected.\n",j);
-    nimages = j;
+    yInfo("%i pairs have been successfully detected.\n",nimages);
     if( nimages < 2 )
     {
         yError("Error: too few pairs detected \n");
         return;
     }
 
-    imagePoints[0].resize(nimages);
-    imagePoints[1].resize(nimages);
-
     std::vector<std::vector<Point3f> > objectPoints(1);
     calcChessboardCorners(boardSize, squareSize, objectPoints[0]);
     objectPoints.resize(nimages, objectPoints[0]);